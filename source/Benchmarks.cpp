@@ -0,0 +1,2183 @@
+#include "pch.h"
+#include "Benchmarks.h"
+#include "Sampler.h"
+#include "TextureData.h"
+#include "SoftwareRenderer.h"
+#include "RasterKernel.h"
+#include "OcclusionCuller.h"
+#include "Clipper.h"
+#include "VertexProcessor.h"
+#include "FrustumCuller.h"
+#include "Simplifier.h"
+#include "JobSystem.h"
+#include "Instancing.h"
+#include "RenderQueue.h"
+#include "NullRenderDevice.h"
+#include "Renderer.h"
+#include "Utils.h"
+#include "Camera.h"
+#include <chrono>
+#include <functional>
+#include <random>
+#include <array>
+#include <bit>
+#include <numeric>
+#include <thread>
+
+namespace dae
+{
+	namespace Benchmarks
+	{
+		namespace
+		{
+			//Checks that failed in this run, any of them fails the process
+			size_t failedChecks{};
+			//--save-frames, benchmarks only write images into the working directory when asked to
+			bool saveFrames{};
+
+			//Correctness checks the benchmarks make next to their measurements, prints what failed
+			bool Check(bool passed, const std::string& what)
+			{
+				if (!passed)
+				{
+					++failedChecks;
+					std::cout << "CHECK FAILED: " << what << "\n";
+				}
+				return passed;
+			}
+
+			//Runs work until at least minSeconds passed, returns items per second
+			double Measure(const std::function<size_t()>& work, double minSeconds = 0.5)
+			{
+				size_t items{};
+				const auto start{ std::chrono::steady_clock::now() };
+				double elapsed{};
+				do
+				{
+					items += work();
+					elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+				} while (elapsed < minSeconds);
+				return static_cast<double>(items) / elapsed;
+			}
+
+			//Set associative LRU cache, only counts misses for an address stream
+			class CacheModel final
+			{
+			public:
+				CacheModel(size_t sizeBytes, size_t ways, size_t lineBytes = 64)
+					: m_Ways{ ways }
+					, m_LineShift{ static_cast<size_t>(std::log2(lineBytes)) }
+					, m_SetCount{ sizeBytes / lineBytes / ways }
+					, m_Tags(m_SetCount * ways, ~0ull)
+					, m_Ages(m_SetCount * ways)
+				{
+				}
+
+				void Access(uint64_t address)
+				{
+					const uint64_t line{ address >> m_LineShift };
+					const size_t set{ static_cast<size_t>(line % m_SetCount) };
+					uint64_t* pTags{ &m_Tags[set * m_Ways] };
+					uint64_t* pAges{ &m_Ages[set * m_Ways] };
+					++m_Clock;
+					++m_Accesses;
+
+					size_t oldest{};
+					for (size_t way{}; way < m_Ways; ++way)
+					{
+						if (pTags[way] == line)
+						{
+							pAges[way] = m_Clock;
+							return;
+						}
+						if (pAges[way] < pAges[oldest])
+						{
+							oldest = way;
+						}
+					}
+
+					++m_Misses;
+					pTags[oldest] = line;
+					pAges[oldest] = m_Clock;
+				}
+
+				double GetMissRate() const { return static_cast<double>(m_Misses) / static_cast<double>(m_Accesses); }
+				uint64_t GetMisses() const { return m_Misses; }
+
+			private:
+				size_t m_Ways;
+				size_t m_LineShift;
+				size_t m_SetCount;
+				std::vector<uint64_t> m_Tags;
+				std::vector<uint64_t> m_Ages;
+				uint64_t m_Clock{};
+				uint64_t m_Accesses{};
+				uint64_t m_Misses{};
+			};
+
+			const char* ToString(TexelLayout layout)
+			{
+				switch (layout)
+				{
+				case TexelLayout::Linear: return "linear";
+				case TexelLayout::Block4x4: return "block4x4";
+				case TexelLayout::Morton: return "morton";
+				}
+				return "";
+			}
+
+			const char* ToString(Sampling::Filter filter)
+			{
+				switch (filter)
+				{
+				case Sampling::Filter::Point: return "point";
+				case Sampling::Filter::Bilinear: return "bilinear";
+				case Sampling::Filter::Trilinear: return "trilinear";
+				case Sampling::Filter::Anisotropic: return "anisotropic";
+				}
+				return "";
+			}
+
+			const char* ToString(Sampling::AddressMode mode)
+			{
+				switch (mode)
+				{
+				case Sampling::AddressMode::Wrap: return "wrap";
+				case Sampling::AddressMode::Mirror: return "mirror";
+				case Sampling::AddressMode::Clamp: return "clamp";
+				case Sampling::AddressMode::Border: return "border";
+				}
+				return "";
+			}
+		}
+
+		int Run(int argc, char* args[])
+		{
+			const std::vector<std::pair<std::string, std::function<void()>>> benchmarks
+			{
+				{ "sampler", &Sampler },
+				{ "tiling", &Tiling },
+				{ "colorspace", &ColorSpace },
+				{ "raster", &Raster },
+				{ "kernel", &Kernel },
+				{ "occlusion", &Occlusion },
+				{ "clip", &Clip },
+				{ "visibility", &Visibility },
+				{ "blending", &Blending },
+				{ "hiz", &HierarchicalDepth },
+				{ "msaa", &Multisample },
+				{ "vertex", &VertexProcessing },
+				{ "frustum", &Frustum },
+				{ "meshlet", &MeshletCulling },
+				{ "lod", &LevelOfDetail },
+				{ "jobs", &Jobs },
+				{ "instancing", &Instancing },
+				{ "queue", &Queue },
+				{ "headless", &Headless }
+			};
+
+			std::string name{};
+			saveFrames = false;
+			for (int i{ 2 }; i < argc; ++i)
+			{
+				const std::string arg{ args[i] };
+				if (arg == "--save-frames")
+				{
+					saveFrames = true;
+				}
+				else
+				{
+					name = arg;
+				}
+			}
+			failedChecks = 0;
+			bool found{};
+			for (const auto& [benchmarkName, benchmark] : benchmarks)
+			{
+				if (name.empty() || name == benchmarkName)
+				{
+					std::cout << "--- " << benchmarkName << " ---\n";
+					benchmark();
+					found = true;
+				}
+			}
+
+			if (!found)
+			{
+				std::cout << "Unknown benchmark: " << name << "\n";
+				return 1;
+			}
+			if (failedChecks > 0)
+			{
+				std::cout << failedChecks << " checks failed\n";
+				return 1;
+			}
+			return 0;
+		}
+
+		void Sampler()
+		{
+			const TextureData texture{ TextureData::Load("Resources/vehicle_diffuse.png") };
+			if (!texture.IsValid())
+			{
+				return;
+			}
+
+			const Sampling::MipChainRGBA8 chainRGBA8{ Sampling::MipChainRGBA8::Build(texture.pixels.data(), texture.width, texture.height) };
+			std::vector<float> floatTexels(texture.pixels.size());
+			std::transform(texture.pixels.begin(), texture.pixels.end(), floatTexels.begin(), [](uint8_t value) { return value / 255.f; });
+			const Sampling::MipChainFloat chainFloat{ Sampling::MipChainFloat::Build(floatTexels.data(), texture.width, texture.height) };
+
+			//Random quads, pixel footprints from 1 to 8 texels at random angles so every mip and aniso ratio shows up
+			constexpr size_t quadCount{ 1 << 16 };
+			std::mt19937 random{ 1337 };
+			std::uniform_real_distribution<float> unit{ 0.f, 1.f };
+			std::vector<std::array<Vector2, 4>> quads(quadCount);
+			for (auto& quad : quads)
+			{
+				const Vector2 origin{ unit(random) * 4.f - 2.f, unit(random) * 4.f - 2.f };
+				const float angle{ unit(random) * PI_2 };
+				const float stretch{ 1.f + unit(random) * 7.f };
+				const float step{ (1.f + unit(random) * 7.f) / texture.width };
+				const Vector2 ddx{ cosf(angle) * step * stretch, sinf(angle) * step * stretch };
+				const Vector2 ddy{ -sinf(angle) * step, cosf(angle) * step };
+				quad = { origin, origin + ddx, origin + ddy, origin + ddx + ddy };
+			}
+
+			constexpr Sampling::Filter filters[]{ Sampling::Filter::Point, Sampling::Filter::Bilinear, Sampling::Filter::Trilinear, Sampling::Filter::Anisotropic };
+
+			//Every lane of SampleQuad has to match SampleGrad with the quad's coarse derivatives. The quads reach outside
+			//[0, 1] so every address mode is exercised, only the order of float operations may differ
+			constexpr size_t checkedQuadCount{ 4096 };
+			constexpr float tolerance{ 1e-5f };
+			const auto getMaxDifference = [&quads](const auto& chain, const Sampling::SamplerState& state)
+			{
+				float maxDifference{};
+				for (size_t i{}; i < checkedQuadCount; ++i)
+				{
+					const Vector2 uv[4]{ quads[i][0], quads[i][1], quads[i][2], quads[i][3] };
+					const Vector2 ddx{ uv[1] - uv[0] };
+					const Vector2 ddy{ uv[2] - uv[0] };
+					const Sampling::ColorQuad samples{ Sampling::SampleQuad(chain, state, uv) };
+					for (int lane{}; lane < 4; ++lane)
+					{
+						const Sampling::ColorRGBA expected{ Sampling::SampleGrad(chain, state, uv[lane], ddx, ddy) };
+						const Sampling::ColorRGBA actual{ samples.Get(lane) };
+						maxDifference = std::max({ maxDifference, std::abs(actual.r - expected.r), std::abs(actual.g - expected.g),
+							std::abs(actual.b - expected.b), std::abs(actual.a - expected.a) });
+					}
+				}
+				return maxDifference;
+			};
+			float maxDifference{};
+			for (const Sampling::Filter filter : filters)
+			{
+				for (const Sampling::AddressMode mode : { Sampling::AddressMode::Wrap, Sampling::AddressMode::Mirror, Sampling::AddressMode::Clamp,
+					Sampling::AddressMode::Border })
+				{
+					Sampling::SamplerState state{};
+					state.filter = filter;
+					state.addressU = mode;
+					state.addressV = mode;
+					state.borderColor = { 0.25f, 0.5f, 0.75f, 1.f };
+
+					const std::string name{ std::string{ ToString(filter) } + " " + ToString(mode) };
+					const float differenceRGBA8{ getMaxDifference(chainRGBA8, state) };
+					const float differenceFloat{ getMaxDifference(chainFloat, state) };
+					Check(differenceRGBA8 <= tolerance, name + ": RGBA8 SampleQuad differs from SampleGrad by " + std::to_string(differenceRGBA8));
+					Check(differenceFloat <= tolerance, name + ": float SampleQuad differs from SampleGrad by " + std::to_string(differenceFloat));
+					maxDifference = std::max({ maxDifference, differenceRGBA8, differenceFloat });
+				}
+			}
+			std::cout << "quad vs scalar, every filter and address mode: max difference " << maxDifference << "\n";
+
+			float checksum{};
+			for (const Sampling::Filter filter : filters)
+			{
+				Sampling::SamplerState state{};
+				state.filter = filter;
+
+				const double scalar{ Measure([&]
+				{
+					for (const auto& quad : quads)
+					{
+						const Vector2 ddx{ quad[1] - quad[0] };
+						const Vector2 ddy{ quad[2] - quad[0] };
+						for (const Vector2& uv : quad)
+						{
+							checksum += Sampling::SampleGrad(chainRGBA8, state, uv, ddx, ddy).r;
+						}
+					}
+					return quads.size() * 4;
+				}) };
+
+				const double quadRGBA8{ Measure([&]
+				{
+					for (const auto& quad : quads)
+					{
+						const Vector2 uv[4]{ quad[0], quad[1], quad[2], quad[3] };
+						checksum += Sampling::SampleQuad(chainRGBA8, state, uv).Get(0).r;
+					}
+					return quads.size() * 4;
+				}) };
+
+				const double quadFloat{ Measure([&]
+				{
+					for (const auto& quad : quads)
+					{
+						const Vector2 uv[4]{ quad[0], quad[1], quad[2], quad[3] };
+						checksum += Sampling::SampleQuad(chainFloat, state, uv).Get(0).r;
+					}
+					return quads.size() * 4;
+				}) };
+
+				std::cout << ToString(filter) << ": scalar RGBA8 " << scalar / 1e6 << " Msamples/s, quad RGBA8 "
+					<< quadRGBA8 / 1e6 << " Msamples/s, quad float " << quadFloat / 1e6 << " Msamples/s\n";
+			}
+			std::cout << "(checksum " << checksum << ")\n";
+		}
+	}
+}
+
+namespace dae
+{
+	namespace Benchmarks
+	{
+		void Tiling()
+		{
+			constexpr TexelLayout layouts[]{ TexelLayout::Linear, TexelLayout::Block4x4, TexelLayout::Morton };
+
+			for (const char* path : { "Resources/vehicle_diffuse.png", "Resources/vehicle_normal.png" })
+			{
+				const TextureData texture{ TextureData::Load(path) };
+				if (!texture.IsValid())
+				{
+					continue;
+				}
+
+				//Conversion cost
+				for (const TexelLayout layout : layouts)
+				{
+					const double texelsPerSecond{ Measure([&]
+					{
+						const std::vector<uint8_t> tiled{ dae::Tiling::LinearToTiled(texture.pixels.data(), texture.width, texture.height, layout) };
+						return tiled.size() / 4;
+					}, 0.2) };
+					std::cout << path << " linear->" << ToString(layout) << ": " << texelsPerSecond * 4 / 1e9 << " GB/s\n";
+				}
+
+				//Screen of 512x512 pixels as 2x2 quads, footprint about one texel per pixel
+				constexpr int screenSize{ 512 };
+				std::vector<std::array<Vector2, 4>> randomQuads{};
+				std::mt19937 random{ 7 };
+				std::uniform_real_distribution<float> unit{ 0.f, 1.f };
+				const float texel{ 1.f / texture.width };
+				for (int i{}; i < screenSize * screenSize / 4; ++i)
+				{
+					const Vector2 origin{ unit(random), unit(random) };
+					randomQuads.push_back({ origin, origin + Vector2{ texel, 0.f }, origin + Vector2{ 0.f, texel }, origin + Vector2{ texel, texel } });
+				}
+
+				auto makeRotated = [&](float degrees)
+				{
+					const float angle{ degrees * TO_RADIANS };
+					const Vector2 axisX{ cosf(angle) * texel, sinf(angle) * texel };
+					const Vector2 axisY{ -sinf(angle) * texel, cosf(angle) * texel };
+					std::vector<std::array<Vector2, 4>> quads{};
+					for (int y{}; y < screenSize; y += 2)
+					{
+						for (int x{}; x < screenSize; x += 2)
+						{
+							const Vector2 origin{ axisX * static_cast<float>(x) + axisY * static_cast<float>(y) };
+							quads.push_back({ origin, origin + axisX, origin + axisY, origin + axisX + axisY });
+						}
+					}
+					return quads;
+				};
+
+				const std::vector<std::pair<std::string, std::vector<std::array<Vector2, 4>>>> patterns
+				{
+					{ "random uv", randomQuads },
+					{ "rotated 0", makeRotated(0.f) },
+					{ "rotated 45", makeRotated(45.f) },
+					{ "rotated 90", makeRotated(90.f) }
+				};
+
+				Sampling::SamplerState state{};
+				state.filter = Sampling::Filter::Bilinear;
+
+				for (const auto& [patternName, quads] : patterns)
+				{
+					for (const TexelLayout layout : layouts)
+					{
+						//Replay the bilinear footprints through a 32KB L1 and a 256KB L2 model
+						CacheModel l1{ 32 * 1024, 8 };
+						CacheModel l2{ 256 * 1024, 4 };
+						uint64_t samples{};
+						for (const auto& quad : quads)
+						{
+							for (const Vector2& uv : quad)
+							{
+								const int x0{ static_cast<int>(std::floor(uv.x * texture.width - 0.5f)) };
+								const int y0{ static_cast<int>(std::floor(uv.y * texture.height - 0.5f)) };
+								for (int corner{}; corner < 4; ++corner)
+								{
+									int x{ x0 + (corner & 1) };
+									int y{ y0 + (corner >> 1) };
+									Sampling::ApplyAddress(x, texture.width, state.addressU);
+									Sampling::ApplyAddress(y, texture.height, state.addressV);
+									const uint64_t address{ dae::Tiling::GetTexelIndex(layout, x, y, texture.width) * 4 };
+									l1.Access(address);
+									l2.Access(address);
+								}
+								++samples;
+							}
+						}
+
+						const Sampling::MipChainRGBA8 chain{ Sampling::MipChainRGBA8::Build(texture.pixels.data(), texture.width, texture.height, layout, ColorSpace::Linear, 1) };
+						float checksum{};
+						const double samplesPerSecond{ Measure([&]
+						{
+							for (const auto& quad : quads)
+							{
+								const Vector2 uv[4]{ quad[0], quad[1], quad[2], quad[3] };
+								checksum += Sampling::SampleQuad(chain, state, uv).Get(0).r;
+							}
+							return quads.size() * 4;
+						}, 0.25) };
+
+						std::cout << path << " " << patternName << " " << ToString(layout) << ": L1 misses/sample "
+							<< static_cast<double>(l1.GetMisses()) / samples << " (" << l1.GetMissRate() * 100.0 << "%), L2 misses/sample "
+							<< static_cast<double>(l2.GetMisses()) / samples << ", bilinear " << samplesPerSecond / 1e6
+							<< " Msamples/s (checksum " << checksum << ")\n";
+					}
+				}
+			}
+		}
+	
+		void ColorSpace()
+		{
+			const TextureData texture{ TextureData::Load("Resources/vehicle_diffuse.png") };
+			if (!texture.IsValid())
+			{
+				return;
+			}
+
+			const size_t texelCount{ static_cast<size_t>(texture.width) * texture.height };
+			const size_t bytes8{ texelCount * 4 };
+			const size_t bytesFloat{ texelCount * 4 * sizeof(float) };
+
+			std::vector<float> linear(texelCount * 4);
+			ColorConversion::Reference::SrgbToLinear(texture.pixels.data(), linear.data(), texelCount);
+			std::vector<float> encoded(texelCount * 4);
+			ColorConversion::Reference::LinearToSrgb(linear.data(), encoded.data(), texelCount);
+
+			std::vector<float> floatResult(texelCount * 4);
+			std::vector<float> floatReference(texelCount * 4);
+			std::vector<uint8_t> byteResult(texelCount * 4);
+			std::vector<uint8_t> byteReference(texelCount * 4);
+
+			//Throughput is input bytes per second
+			const auto report = [](const char* pName, size_t inputBytes, const std::function<void()>& reference, const std::function<void()>& fast)
+			{
+				const double referenceRate{ Measure([&] { reference(); return inputBytes; }, 0.25) };
+				const double fastRate{ Measure([&] { fast(); return inputBytes; }, 0.25) };
+				std::cout << pName << ": pow " << referenceRate / 1e9 << " GB/s, fast " << fastRate / 1e9 << " GB/s ("
+					<< fastRate / referenceRate << "x)";
+			};
+			const auto maxError = [&]
+			{
+				float error{};
+				for (size_t i{}; i < floatResult.size(); ++i)
+				{
+					error = std::max(error, std::abs(floatResult[i] - floatReference[i]));
+				}
+				return error;
+			};
+
+			report("sRGB8 -> linear float", bytes8,
+				[&] { ColorConversion::Reference::SrgbToLinear(texture.pixels.data(), floatReference.data(), texelCount); },
+				[&] { ColorConversion::SrgbToLinear(texture.pixels.data(), floatResult.data(), texelCount); });
+			std::cout << ", max error " << maxError() << "\n";
+
+			report("linear float -> sRGB8", bytesFloat,
+				[&] { ColorConversion::Reference::LinearToSrgb(linear.data(), byteReference.data(), texelCount); },
+				[&] { ColorConversion::LinearToSrgb(linear.data(), byteResult.data(), texelCount); });
+			size_t exact{};
+			int maxSteps{};
+			for (size_t i{}; i < byteResult.size(); ++i)
+			{
+				const int steps{ std::abs(byteResult[i] - byteReference[i]) };
+				exact += steps == 0;
+				maxSteps = std::max(maxSteps, steps);
+			}
+			std::cout << ", " << 100.0 * exact / byteResult.size() << "% of the decoded texels round trip exactly, max " << maxSteps << " step\n";
+
+			report("sRGB float -> linear float", bytesFloat,
+				[&] { ColorConversion::Reference::SrgbToLinear(encoded.data(), floatReference.data(), texelCount); },
+				[&] { ColorConversion::SrgbToLinear(encoded.data(), floatResult.data(), texelCount); });
+			std::cout << ", max error " << maxError() << "\n";
+
+			report("linear float -> sRGB float", bytesFloat,
+				[&] { ColorConversion::Reference::LinearToSrgb(linear.data(), floatReference.data(), texelCount); },
+				[&] { ColorConversion::LinearToSrgb(linear.data(), floatResult.data(), texelCount); });
+			std::cout << ", max error " << maxError() << "\n";
+
+			//Filtering the encoded values darkens every level, filtering in linear keeps the average light
+			const auto meanLuminance = [](const Sampling::MipLevel<uint8_t>& level)
+			{
+				const float* pTable{ ColorConversion::GetSrgb8ToLinearTable() };
+				double sum{};
+				for (size_t i{}; i < level.texels.size(); i += 4)
+				{
+					sum += 0.2126 * pTable[level.texels[i]] + 0.7152 * pTable[level.texels[i + 1]] + 0.0722 * pTable[level.texels[i + 2]];
+				}
+				return sum / (level.texels.size() / 4);
+			};
+
+			Sampling::MipChainRGBA8 naive{};
+			Sampling::MipChainRGBA8 correct{};
+			const double naiveRate{ Measure([&]
+			{
+				naive = Sampling::MipChainRGBA8::Build(texture.pixels.data(), texture.width, texture.height);
+				return texelCount;
+			}, 0.25) };
+			const double correctRate{ Measure([&]
+			{
+				correct = Sampling::MipChainRGBA8::Build(texture.pixels.data(), texture.width, texture.height, TexelLayout::Linear, ColorSpace::sRGB);
+				return texelCount;
+			}, 0.25) };
+
+			std::cout << "mip build: encoded " << naiveRate / 1e6 << " Mtexels/s, linear " << correctRate / 1e6 << " Mtexels/s\n";
+			std::cout << "mean linear luminance: source " << meanLuminance(naive.levels[0]);
+			for (const int mip : { 2, 4, 6 })
+			{
+				std::cout << ", mip " << mip << " encoded " << meanLuminance(naive.levels[mip]) << " linear " << meanLuminance(correct.levels[mip]);
+			}
+			std::cout << "\n";
+		}
+
+		void Raster()
+		{
+			//The Renderer's scene: vehicle and fire at the origin, seen from z = -50 at 45 degrees
+			MeshDataPaths vehiclePaths{};
+			vehiclePaths.mesh = "Resources/vehicle.obj";
+			vehiclePaths.effect = L"Resources/PosCol3D.fx";
+			vehiclePaths.diffuse = "Resources/vehicle_diffuse.png";
+			vehiclePaths.normal = "Resources/vehicle_normal.png";
+			vehiclePaths.specular = "Resources/vehicle_specular.png";
+			vehiclePaths.gloss = "Resources/vehicle_gloss.png";
+			MeshDataPaths firePaths{};
+			firePaths.mesh = "Resources/fireFX.obj";
+			firePaths.effect = L"Resources/PosTrans3D.fx";
+			firePaths.translucent = true;
+			firePaths.diffuse = "Resources/fireFX_diffuse.png";
+
+			//Without cache or streamer every map comes back decoded
+			const MeshData meshes[]{ MeshData::Load(vehiclePaths, nullptr, nullptr), MeshData::Load(firePaths, nullptr, nullptr) };
+			if (meshes[0].vertices.empty() || !meshes[0].diffuse.IsValid())
+			{
+				std::cout << "Could not load " << vehiclePaths.mesh << "\n";
+				return;
+			}
+
+			constexpr int width{ 640 };
+			constexpr int height{ 480 };
+			Camera camera{};
+			camera.Initialize(static_cast<float>(width) / height, 45.f, { 0.f, 0.f, -50.f });
+			camera.CalculateViewMatrix();
+
+			//Every run sees the same frames, the vehicle turning like it does at 45 degrees per second and 60fps
+			constexpr int frameCount{ 120 };
+			const auto renderFrames = [&](SoftwareRenderer& renderer)
+			{
+				SoftwareRenderer::Stats sum{};
+				for (int frame{}; frame < frameCount; ++frame)
+				{
+					const Matrix world{ Matrix::CreateRotationY(frame * 0.75f * TO_RADIANS) };
+					renderer.SetWorldMatrix(0, world);
+					renderer.SetWorldMatrix(1, world);
+					renderer.Render(camera);
+
+					const SoftwareRenderer::Stats& stats{ renderer.GetStats() };
+					sum.vertexMs += stats.vertexMs;
+					sum.binMs += stats.binMs;
+					sum.rasterMs += stats.rasterMs;
+					sum.totalMs += stats.totalMs;
+				}
+				return sum;
+			};
+
+			std::vector<int> threadCounts{};
+			const int maxThreads{ std::max(1, static_cast<int>(std::thread::hardware_concurrency())) };
+			for (int threads{ 1 }; threads < maxThreads; threads *= 2)
+			{
+				threadCounts.push_back(threads);
+			}
+			threadCounts.push_back(maxThreads);
+
+			float singleThreadMs{};
+			for (const int threads : threadCounts)
+			{
+				SoftwareRenderer renderer{ width, height, threads };
+				renderer.AddMesh(meshes[0]);
+				renderer.AddMesh(meshes[1]);
+				renderer.SetClearColor({ ColorConversion::SrgbToLinear(0.39f), ColorConversion::SrgbToLinear(0.59f), ColorConversion::SrgbToLinear(0.93f) });
+				renderer.Render(camera); //warm up
+
+				const SoftwareRenderer::Stats sum{ renderFrames(renderer) };
+				const float frameMs{ sum.totalMs / frameCount };
+				if (threads == 1)
+				{
+					singleThreadMs = frameMs;
+					const SoftwareRenderer::Stats& stats{ renderer.GetStats() };
+					std::cout << width << "x" << height << ", " << SoftwareRenderer::tileSize << "x" << SoftwareRenderer::tileSize
+						<< " tiles, last frame: " << stats.triangles << " triangles, "
+						<< stats.trianglesBinned << " binned, " << stats.binEntries << " bin entries, " << stats.pixelsShaded << " pixels shaded\n";
+				}
+				std::cout << threads << (threads == 1 ? " thread: " : " threads: ") << 1000.f / frameMs << " fps (" << frameMs << "ms: vertex "
+					<< sum.vertexMs / frameCount << "ms, bin " << sum.binMs / frameCount << "ms, raster " << sum.rasterMs / frameCount
+					<< "ms), " << singleThreadMs / frameMs << "x\n";
+
+				if (saveFrames && threads == maxThreads)
+				{
+					SDL_Surface* pSurface{ SDL_CreateRGBSurfaceWithFormatFrom(const_cast<uint8_t*>(renderer.GetPixels()), width, height, 32,
+						width * 4, SDL_PIXELFORMAT_RGBA32) };
+					if (pSurface && SDL_SaveBMP(pSurface, "raster.bmp") == 0)
+					{
+						std::cout << "Last frame saved to raster.bmp\n";
+					}
+					SDL_FreeSurface(pSurface);
+				}
+			}
+		}
+
+		void Kernel()
+		{
+			std::vector<Vertex> vertices{};
+			std::vector<uint32_t> indices{};
+			if (!Utils::ParseOBJ("Resources/vehicle.obj", vertices, indices))
+			{
+				std::cout << "Could not load Resources/vehicle.obj\n";
+				return;
+			}
+
+			//The raster benchmark's view, turned a little so both sides show up
+			Camera camera{};
+			camera.Initialize(640.f / 480.f, 45.f, { 0.f, 0.f, -50.f });
+			camera.CalculateViewMatrix();
+			const Matrix worldViewProjection{ Matrix::CreateRotationY(30.f * TO_RADIANS) * camera.viewMatrix * camera.projectionMatrix };
+
+			//Same triangles at two resolutions: small is the 640x480 frame, large the same view 8x wider and taller
+			struct Distribution
+			{
+				std::string name;
+				int scale;
+			};
+			for (const Distribution& distribution : { Distribution{ "small", 1 }, Distribution{ "large", 8 } })
+			{
+				const RasterKernel::Rect viewport{ 0, 0, 640 * distribution.scale, 480 * distribution.scale };
+				std::vector<RasterKernel::ScreenVertex> screenVertices(vertices.size());
+				for (size_t i{}; i < vertices.size(); ++i)
+				{
+					const Vector4 clip{ worldViewProjection.TransformPoint(Vector4{ vertices[i].Position, 1.f }) };
+					const float invW{ 1.f / clip.w };
+					screenVertices[i] = { (clip.x * invW * 0.5f + 0.5f) * viewport.right, (0.5f - clip.y * invW * 0.5f) * viewport.bottom,
+						clip.z * invW, invW };
+				}
+
+				std::vector<RasterKernel::TriangleSetup> setups{};
+				std::vector<const Vertex*> setupVertices{};
+				const double setupRate{ Measure([&]
+				{
+					setups.clear();
+					setupVertices.clear();
+					for (size_t i{}; i < indices.size(); i += 3)
+					{
+						const RasterKernel::ScreenVertex triangle[3]{ screenVertices[indices[i]], screenVertices[indices[i + 1]], screenVertices[indices[i + 2]] };
+						RasterKernel::TriangleSetup setup{};
+						if (RasterKernel::Setup(triangle, viewport, RasterKernel::Cull::None, setup))
+						{
+							setups.push_back(setup);
+							setupVertices.insert(setupVertices.end(), { &vertices[indices[i]], &vertices[indices[i + 1]], &vertices[indices[i + 2]] });
+						}
+					}
+					return indices.size() / 3;
+				}, 0.25) };
+
+				//Every path must produce the same blocks
+				std::vector<RasterKernel::CoverageBlock> reference{};
+				for (const RasterKernel::TriangleSetup& setup : setups)
+				{
+					RasterKernel::Reference::Rasterize(setup, viewport, reference);
+				}
+				size_t pixels{};
+				for (const RasterKernel::CoverageBlock& block : reference)
+				{
+					pixels += std::popcount(block.mask);
+				}
+				std::cout << distribution.name << ": " << setups.size() << " triangles at " << viewport.right << "x" << viewport.bottom << ", "
+					<< static_cast<float>(pixels) / setups.size() << " pixels per triangle, " << reference.size() << " blocks, setup "
+					<< setupRate / 1e6 << " Mtriangles/s\n";
+
+				using RasterizeFunction = void(*)(const RasterKernel::TriangleSetup&, const RasterKernel::Rect&, std::vector<RasterKernel::CoverageBlock>&);
+				std::vector<std::pair<std::string, RasterizeFunction>> paths
+				{
+					{ "per pixel", &RasterKernel::Reference::Rasterize },
+					{ "blocks scalar", &RasterKernel::RasterizeScalar }
+				};
+				if (RasterKernel::HasAvx2())
+				{
+					paths.push_back({ "blocks avx2", &RasterKernel::Rasterize });
+				}
+
+				std::vector<RasterKernel::CoverageBlock> blocks{};
+				double referenceRate{};
+				for (const auto& [pathName, rasterize] : paths)
+				{
+					blocks.clear();
+					for (const RasterKernel::TriangleSetup& setup : setups)
+					{
+						rasterize(setup, viewport, blocks);
+					}
+					const bool matches{ blocks.size() == reference.size() && std::equal(blocks.begin(), blocks.end(), reference.begin(),
+						[](const RasterKernel::CoverageBlock& a, const RasterKernel::CoverageBlock& b) { return a.x == b.x && a.y == b.y && a.mask == b.mask; }) };
+
+					const double rate{ Measure([&]
+					{
+						for (const RasterKernel::TriangleSetup& setup : setups)
+						{
+							blocks.clear();
+							rasterize(setup, viewport, blocks);
+						}
+						return setups.size();
+					}) };
+					referenceRate = referenceRate > 0.0 ? referenceRate : rate;
+					std::cout << "  coverage " << pathName << ": " << rate / 1e6 << " Mtriangles/s, " << rate * pixels / setups.size() / 1e6
+						<< " Mpixels/s, " << rate / referenceRate << "x" << (matches ? "" : " MISMATCH") << "\n";
+					Check(matches, distribution.name + " coverage " + pathName + " matches the per pixel reference");
+				}
+
+				//Coverage plus the perspective-correct Normal, Tangent and UV of every covered row
+				const auto shadeRate = [&](void(*computeBarycentrics)(const RasterKernel::TriangleSetup&, int, int, RasterKernel::Barycentrics8&))
+				{
+					float checksum{};
+					const double rate{ Measure([&]
+					{
+						for (size_t i{}; i < setups.size(); ++i)
+						{
+							blocks.clear();
+							RasterKernel::Rasterize(setups[i], viewport, blocks);
+							for (const RasterKernel::CoverageBlock& block : blocks)
+							{
+								for (int row{}; row < RasterKernel::blockSize; ++row)
+								{
+									if (!((block.mask >> (row * RasterKernel::blockSize)) & 0xFF))
+									{
+										continue;
+									}
+									RasterKernel::Barycentrics8 barycentrics{};
+									alignas(32) float attributes[8][8]{};
+									computeBarycentrics(setups[i], block.x, block.y + row, barycentrics);
+									RasterKernel::Interpolate(&setupVertices[i * 3]->Normal.x, &setupVertices[i * 3 + 1]->Normal.x,
+										&setupVertices[i * 3 + 2]->Normal.x, 8, barycentrics, attributes);
+									checksum += attributes[7][0];
+								}
+							}
+						}
+						return setups.size();
+					}) };
+					return std::pair{ rate, checksum };
+				};
+				const auto [scalarRate, scalarChecksum] { shadeRate(&RasterKernel::ComputeBarycentricsScalar) };
+				const auto [simdRate, simdChecksum] { shadeRate(&RasterKernel::ComputeBarycentrics) };
+				std::cout << "  with attributes: scalar barycentrics " << scalarRate / 1e6 << " Mtriangles/s, "
+					<< (RasterKernel::HasAvx2() ? "avx2 " : "dispatched ") << simdRate / 1e6 << " Mtriangles/s (checksum "
+					<< scalarChecksum + simdChecksum << ")\n";
+			}
+		}
+
+		void Occlusion()
+		{
+			std::vector<Vertex> vertices{};
+			std::vector<uint32_t> indices{};
+			if (!Utils::ParseOBJ("Resources/vehicle.obj", vertices, indices))
+			{
+				std::cout << "Could not load Resources/vehicle.obj\n";
+				return;
+			}
+
+			//The Renderer's view. A wall of boxes behind the vehicle, partly hidden by it, a few in front that never are
+			//and a few right behind its middle that always are
+			Camera camera{};
+			camera.Initialize(640.f / 480.f, 45.f, { 0.f, 0.f, -50.f });
+			camera.CalculateViewMatrix();
+			const Matrix viewProjection{ camera.viewMatrix * camera.projectionMatrix };
+
+			struct Box
+			{
+				Vector3 minimum;
+				Vector3 maximum;
+			};
+			std::vector<Box> behind{};
+			for (int y{}; y < 24; ++y)
+			{
+				for (int x{}; x < 32; ++x)
+				{
+					const Vector3 center{ -40.f + x * 2.5f, -30.f + y * 2.5f, 25.f };
+					behind.push_back({ center - Vector3{ 0.75f, 0.75f, 0.75f }, center + Vector3{ 0.75f, 0.75f, 0.75f } });
+				}
+			}
+			std::vector<Box> inFront{};
+			for (int y{}; y < 4; ++y)
+			{
+				for (int x{}; x < 8; ++x)
+				{
+					const Vector3 center{ -10.f + x * 3.f, -5.f + y * 3.f, -25.f };
+					inFront.push_back({ center - Vector3{ 0.5f, 0.5f, 0.5f }, center + Vector3{ 0.5f, 0.5f, 0.5f } });
+				}
+			}
+			std::vector<Box> hidden{};
+			for (int y{}; y < 3; ++y)
+			{
+				for (int x{}; x < 3; ++x)
+				{
+					const Vector3 center{ -3.f + x * 3.f, -2.f + y * 2.f, 25.f };
+					hidden.push_back({ center - Vector3{ 0.5f, 0.5f, 0.5f }, center + Vector3{ 0.5f, 0.5f, 0.5f } });
+				}
+			}
+			const Matrix identity{ Vector3::UnitX, Vector3::UnitY, Vector3::UnitZ, Vector3::Zero };
+
+			std::vector<int> threadCounts{};
+			const int maxThreads{ std::max(1, static_cast<int>(std::thread::hardware_concurrency())) };
+			for (int threads{ 1 }; threads < maxThreads; threads *= 2)
+			{
+				threadCounts.push_back(threads);
+			}
+			threadCounts.push_back(maxThreads);
+
+			//The vehicle turning like in the raster benchmark
+			constexpr int frameCount{ 120 };
+			float singleThreadMicroseconds{};
+			for (const int threads : threadCounts)
+			{
+				OcclusionCuller culler{ OcclusionCuller::defaultWidth, OcclusionCuller::defaultHeight, threads };
+				culler.AddOccluder(vertices, indices);
+
+				float renderMicroseconds{};
+				float testMicroseconds{};
+				int culled{};
+				int offscreen{};
+				int culledInFront{};
+				int hiddenVisible{};
+				size_t triangles{};
+				for (int frame{}; frame < frameCount; ++frame)
+				{
+					culler.SetOccluderWorld(0, Matrix::CreateRotationY(frame * 0.75f * TO_RADIANS));
+					culler.Render(viewProjection);
+
+					const auto start{ std::chrono::steady_clock::now() };
+					for (const Box& box : behind)
+					{
+						culler.IsVisible(box.minimum, box.maximum, identity);
+					}
+					testMicroseconds += std::chrono::duration<float, std::micro>(std::chrono::steady_clock::now() - start).count();
+					culled += culler.GetStats().culled;
+					offscreen += culler.GetStats().offscreen;
+
+					for (const Box& box : inFront)
+					{
+						culledInFront += culler.IsVisible(box.minimum, box.maximum, identity) ? 0 : 1;
+					}
+					for (const Box& box : hidden)
+					{
+						hiddenVisible += culler.IsVisible(box.minimum, box.maximum, identity) ? 1 : 0;
+					}
+					renderMicroseconds += culler.GetStats().renderMicroseconds;
+					triangles += culler.GetStats().occluderTriangles;
+				}
+
+				const float frameMicroseconds{ renderMicroseconds / frameCount };
+				if (threads == 1)
+				{
+					singleThreadMicroseconds = frameMicroseconds;
+					std::cout << culler.GetWidth() << "x" << culler.GetHeight() << ", " << OcclusionCuller::tileSize << "x" << OcclusionCuller::tileSize
+						<< " tiles, " << culler.GetLevelCount() << " levels, " << triangles / frameCount << " occluder triangles, "
+						<< behind.size() << " boxes behind: " << static_cast<float>(culled) / frameCount << " culled, "
+						<< static_cast<float>(offscreen) / frameCount << " offscreen, " << culledInFront << " of the boxes in front culled, "
+						<< hiddenVisible << " of the boxes behind its middle kept\n";
+				}
+				Check(culledInFront == 0, std::to_string(threads) + " threads: " + std::to_string(culledInFront) + " boxes in front of the vehicle culled");
+				Check(hiddenVisible == 0, std::to_string(threads) + " threads: " + std::to_string(hiddenVisible)
+					+ " boxes behind the middle of the vehicle not culled");
+				std::cout << threads << (threads == 1 ? " thread: " : " threads: ") << frameMicroseconds << "us per frame, "
+					<< singleThreadMicroseconds / frameMicroseconds << "x, tests " << testMicroseconds * 1000.f / (frameCount * behind.size()) << "ns per box\n";
+			}
+		}
+
+		void Clip()
+		{
+			std::vector<Vertex> vertices{};
+			std::vector<uint32_t> indices{};
+			if (!Utils::ParseOBJ("Resources/vehicle.obj", vertices, indices))
+			{
+				std::cout << "Could not load Resources/vehicle.obj\n";
+				return;
+			}
+
+			//Flying into the vehicle, from the Renderer's view to inside of it
+			constexpr int width{ 640 };
+			constexpr int height{ 480 };
+			const Clipping::GuardBand guardBand{ Clipping::GuardBand::ForViewport(width, height) };
+			for (const float distance : { 50.f, 20.f, 10.f, 5.f })
+			{
+				Camera camera{};
+				camera.Initialize(static_cast<float>(width) / height, 45.f, { 0.f, 2.f, -distance });
+				camera.CalculateViewMatrix();
+				const Matrix worldViewProjection{ Matrix::CreateRotationY(30.f * TO_RADIANS) * camera.viewMatrix * camera.projectionMatrix };
+
+				//Position and the 11 floats the software renderer interpolates, as a clipped vertex sees them
+				constexpr int floatCount{ 15 };
+				const size_t vertexCount{ vertices.size() };
+				std::vector<float> x(vertexCount), y(vertexCount), z(vertexCount), w(vertexCount);
+				std::vector<std::array<float, floatCount>> clipVertices(vertexCount);
+				for (size_t i{}; i < vertexCount; ++i)
+				{
+					const Vector4 clip{ worldViewProjection.TransformPoint(Vector4{ vertices[i].Position, 1.f }) };
+					x[i] = clip.x;
+					y[i] = clip.y;
+					z[i] = clip.z;
+					w[i] = clip.w;
+					clipVertices[i] = { clip.x, clip.y, clip.z, clip.w, vertices[i].Position.x, vertices[i].Position.y, vertices[i].Position.z,
+						vertices[i].Normal.x, vertices[i].Normal.y, vertices[i].Normal.z, vertices[i].Tangent.x, vertices[i].Tangent.y,
+						vertices[i].Tangent.z, vertices[i].UV.x, vertices[i].UV.y };
+				}
+
+				std::vector<uint8_t> outcodes(vertexCount);
+				std::vector<uint8_t> scalarOutcodes(vertexCount);
+				const double scalarRate{ Measure([&]
+				{
+					Clipping::ComputeOutcodesScalar(x.data(), y.data(), z.data(), w.data(), vertexCount, guardBand, scalarOutcodes.data());
+					return vertexCount;
+				}, 0.25) };
+				const double simdRate{ Measure([&]
+				{
+					Clipping::ComputeOutcodes(x.data(), y.data(), z.data(), w.data(), vertexCount, guardBand, outcodes.data());
+					return vertexCount;
+				}, 0.25) };
+
+				size_t rejected{};
+				std::vector<size_t> clipped{};
+				for (size_t i{}; i < indices.size(); i += 3)
+				{
+					const uint8_t codes[3]{ outcodes[indices[i]], outcodes[indices[i + 1]], outcodes[indices[i + 2]] };
+					if (Clipping::IsOutside(codes[0], codes[1], codes[2]))
+					{
+						++rejected;
+					}
+					else if (Clipping::NeedsClipping(codes[0], codes[1], codes[2]))
+					{
+						clipped.push_back(i);
+					}
+				}
+
+				const size_t mismatches{ static_cast<size_t>(std::inner_product(outcodes.begin(), outcodes.end(), scalarOutcodes.begin(),
+					size_t{}, std::plus<>{}, [](uint8_t a, uint8_t b) { return a != b ? size_t{ 1 } : size_t{}; })) };
+				std::cout << "distance " << distance << ": " << indices.size() / 3 << " triangles, " << rejected << " rejected, "
+					<< clipped.size() << " clipped; outcodes scalar " << scalarRate / 1e6 << " Mvertices/s, "
+					<< (RasterKernel::HasAvx2() ? "avx2 " : "dispatched ") << simdRate / 1e6 << " Mvertices/s, " << mismatches << " mismatches\n";
+				Check(mismatches == 0, "distance " + std::to_string(static_cast<int>(distance)) + ": " + std::to_string(mismatches)
+					+ " SIMD outcodes differ from the scalar ones");
+				if (clipped.empty())
+				{
+					continue;
+				}
+
+				size_t fanTriangles{};
+				float polygon[Clipping::maxPolygonVertices][Clipping::maxFloats];
+				const double clipRate{ Measure([&]
+				{
+					fanTriangles = 0;
+					for (const size_t i : clipped)
+					{
+						const uint8_t planes{ static_cast<uint8_t>(outcodes[indices[i]] | outcodes[indices[i + 1]] | outcodes[indices[i + 2]]) };
+						const int count{ Clipping::ClipTriangle(clipVertices[indices[i]].data(), clipVertices[indices[i + 1]].data(),
+							clipVertices[indices[i + 2]].data(), floatCount, planes, guardBand, polygon) };
+						fanTriangles += count >= 3 ? count - 2 : 0;
+					}
+					return clipped.size();
+				}, 0.25) };
+
+				//Every vertex that comes out lies between near and far and inside the guard band, up to rounding of the intersections.
+				//Near the guard band x and y are many times w, so the slack follows the size of the whole position
+				size_t outsideVertices{};
+				for (const size_t i : clipped)
+				{
+					const uint8_t planes{ static_cast<uint8_t>(outcodes[indices[i]] | outcodes[indices[i + 1]] | outcodes[indices[i + 2]]) };
+					const int count{ Clipping::ClipTriangle(clipVertices[indices[i]].data(), clipVertices[indices[i + 1]].data(),
+						clipVertices[indices[i + 2]].data(), floatCount, planes, guardBand, polygon) };
+					for (int vertex{}; vertex < count; ++vertex)
+					{
+						const float* pPosition{ polygon[vertex] };
+						const float slack{ 1e-5f * (std::abs(pPosition[0]) + std::abs(pPosition[1]) + std::abs(pPosition[2]) + std::abs(pPosition[3])) };
+						outsideVertices += pPosition[2] < -slack || pPosition[2] > pPosition[3] + slack
+							|| std::abs(pPosition[0]) > guardBand.x * pPosition[3] + slack || std::abs(pPosition[1]) > guardBand.y * pPosition[3] + slack;
+					}
+				}
+				std::cout << "  clipping " << clipRate / 1e6 << " Mtriangles/s, " << fanTriangles << " triangles out\n";
+				Check(outsideVertices == 0, "distance " + std::to_string(static_cast<int>(distance)) + ": " + std::to_string(outsideVertices)
+					+ " clipped vertices outside the near and far planes or the guard band");
+			}
+		}
+
+		void Visibility()
+		{
+			//The raster benchmark's scene and frames
+			MeshDataPaths vehiclePaths{};
+			vehiclePaths.mesh = "Resources/vehicle.obj";
+			vehiclePaths.effect = L"Resources/PosCol3D.fx";
+			vehiclePaths.diffuse = "Resources/vehicle_diffuse.png";
+			vehiclePaths.normal = "Resources/vehicle_normal.png";
+			vehiclePaths.specular = "Resources/vehicle_specular.png";
+			vehiclePaths.gloss = "Resources/vehicle_gloss.png";
+			MeshDataPaths firePaths{};
+			firePaths.mesh = "Resources/fireFX.obj";
+			firePaths.effect = L"Resources/PosTrans3D.fx";
+			firePaths.translucent = true;
+			firePaths.diffuse = "Resources/fireFX_diffuse.png";
+
+			const MeshData meshes[]{ MeshData::Load(vehiclePaths, nullptr, nullptr), MeshData::Load(firePaths, nullptr, nullptr) };
+			if (meshes[0].vertices.empty() || !meshes[0].diffuse.IsValid())
+			{
+				std::cout << "Could not load " << vehiclePaths.mesh << "\n";
+				return;
+			}
+
+			constexpr int width{ 640 };
+			constexpr int height{ 480 };
+			constexpr int frameCount{ 120 };
+			SoftwareRenderer renderer{ width, height };
+			renderer.AddMesh(meshes[0]);
+			renderer.AddMesh(meshes[1]);
+			renderer.SetClearColor({ ColorConversion::SrgbToLinear(0.39f), ColorConversion::SrgbToLinear(0.59f), ColorConversion::SrgbToLinear(0.93f) });
+
+			//Close up as well, where the vehicle covers the screen and hides most of itself
+			for (const float distance : { 50.f, 20.f })
+			{
+				Camera camera{};
+				camera.Initialize(static_cast<float>(width) / height, 45.f, { 0.f, 0.f, -distance });
+				camera.CalculateViewMatrix();
+
+				std::vector<uint8_t> lastFrames[2]{};
+				size_t forwardShaded{};
+				for (const SoftwareRenderer::ShadingMode mode : { SoftwareRenderer::ShadingMode::Forward, SoftwareRenderer::ShadingMode::VisibilityBuffer })
+				{
+					const bool forward{ mode == SoftwareRenderer::ShadingMode::Forward };
+					renderer.SetShadingMode(mode);
+					renderer.Render(camera); //warm up
+
+					SoftwareRenderer::Stats sum{};
+					for (int frame{}; frame < frameCount; ++frame)
+					{
+						const Matrix world{ Matrix::CreateRotationY(frame * 0.75f * TO_RADIANS) };
+						renderer.SetWorldMatrix(0, world);
+						renderer.SetWorldMatrix(1, world);
+						renderer.Render(camera);
+
+						const SoftwareRenderer::Stats& stats{ renderer.GetStats() };
+						sum.rasterMs += stats.rasterMs;
+						sum.shadeMs += stats.shadeMs;
+						sum.totalMs += stats.totalMs;
+						sum.pixelsShaded += stats.pixelsShaded;
+					}
+					lastFrames[forward ? 0 : 1].assign(renderer.GetPixels(), renderer.GetPixels() + static_cast<size_t>(width) * height * 4);
+					forwardShaded = forward ? sum.pixelsShaded : forwardShaded;
+
+					std::cout << "distance " << distance << (forward ? ", forward: " : ", visibility buffer: ") << 1000.f * frameCount / sum.totalMs
+						<< " fps (" << sum.totalMs / frameCount << "ms: raster " << sum.rasterMs / frameCount << "ms, shade "
+						<< sum.shadeMs / frameCount << "ms), " << sum.pixelsShaded / frameCount << " fragments shaded per frame";
+					if (!forward)
+					{
+						std::cout << ", " << static_cast<float>(forwardShaded) / sum.pixelsShaded << "x fewer";
+					}
+					std::cout << "\n";
+				}
+
+				const size_t differentBytes{ static_cast<size_t>(std::inner_product(lastFrames[0].begin(), lastFrames[0].end(), lastFrames[1].begin(),
+					size_t{}, std::plus<>{}, [](uint8_t a, uint8_t b) { return a != b ? size_t{ 1 } : size_t{}; })) };
+				std::cout << "  last frames differ in " << differentBytes << " bytes\n";
+				//Both modes shade the same fragments with the same code, only when differs
+				Check(differentBytes == 0, "distance " + std::to_string(static_cast<int>(distance)) + ": visibility buffer frame differs from forward in "
+					+ std::to_string(differentBytes) + " bytes");
+			}
+		}
+
+		void Blending()
+		{
+			MeshDataPaths vehiclePaths{};
+			vehiclePaths.mesh = "Resources/vehicle.obj";
+			vehiclePaths.effect = L"Resources/PosCol3D.fx";
+			vehiclePaths.diffuse = "Resources/vehicle_diffuse.png";
+			vehiclePaths.normal = "Resources/vehicle_normal.png";
+			vehiclePaths.specular = "Resources/vehicle_specular.png";
+			vehiclePaths.gloss = "Resources/vehicle_gloss.png";
+			MeshDataPaths firePaths{};
+			firePaths.mesh = "Resources/fireFX.obj";
+			firePaths.effect = L"Resources/PosTrans3D.fx";
+			firePaths.translucent = true;
+			firePaths.diffuse = "Resources/fireFX_diffuse.png";
+
+			const MeshData vehicle{ MeshData::Load(vehiclePaths, nullptr, nullptr) };
+			const MeshData fire{ MeshData::Load(firePaths, nullptr, nullptr) };
+			if (vehicle.vertices.empty() || fire.vertices.empty() || !fire.diffuse.IsValid())
+			{
+				std::cout << "Could not load " << firePaths.mesh << "\n";
+				return;
+			}
+
+			//The same fire with its triangles in reverse, an order-independent result must not change
+			MeshData reversedFire{ fire };
+			for (size_t i{}; i < fire.indices.size(); i += 3)
+			{
+				std::copy_n(&fire.indices[fire.indices.size() - 3 - i], 3, &reversedFire.indices[i]);
+			}
+
+			constexpr int width{ 640 };
+			constexpr int height{ 480 };
+			constexpr int frameCount{ 60 };
+			SoftwareRenderer renderer{ width, height };
+			renderer.AddMesh(vehicle);
+			renderer.AddMesh(fire);
+			renderer.AddMesh(reversedFire);
+			renderer.SetClearColor({ ColorConversion::SrgbToLinear(0.39f), ColorConversion::SrgbToLinear(0.59f), ColorConversion::SrgbToLinear(0.93f) });
+
+			//Close enough for the fire's sheets to cross each other on screen
+			Camera camera{};
+			camera.Initialize(static_cast<float>(width) / height, 45.f, { 0.f, 5.f, -30.f });
+			camera.CalculateViewMatrix();
+
+			//One turn, every 10th frame is kept for the comparisons
+			const auto renderFrames = [&](bool reversed)
+			{
+				renderer.SetVisible(1, !reversed);
+				renderer.SetVisible(2, reversed);
+				float totalMs{};
+				std::vector<uint8_t> frames{};
+				for (int frame{}; frame < frameCount; ++frame)
+				{
+					const Matrix world{ Matrix::CreateRotationY(frame * 360.f / frameCount * TO_RADIANS) };
+					for (size_t mesh{}; mesh < 3; ++mesh)
+					{
+						renderer.SetWorldMatrix(mesh, world);
+					}
+					renderer.Render(camera);
+					totalMs += renderer.GetStats().totalMs;
+					if (frame % 10 == 0)
+					{
+						frames.insert(frames.end(), renderer.GetPixels(), renderer.GetPixels() + static_cast<size_t>(width) * height * 4);
+					}
+				}
+				return std::pair{ totalMs / frameCount, frames };
+			};
+
+			//Of the color channels in 8-bit sRGB, the mean over the pixels that differ at all
+			const auto compare = [](const std::vector<uint8_t>& a, const std::vector<uint8_t>& b)
+			{
+				double sum{};
+				int maximum{};
+				size_t pixels{};
+				for (size_t pixel{}; pixel < a.size(); pixel += 4)
+				{
+					int pixelSum{};
+					for (size_t channel{}; channel < 3; ++channel)
+					{
+						const int difference{ std::abs(a[pixel + channel] - b[pixel + channel]) };
+						pixelSum += difference;
+						maximum = std::max(maximum, difference);
+					}
+					sum += pixelSum / 3.0;
+					pixels += pixelSum > 0 ? 1 : 0;
+				}
+				std::ostringstream text{};
+				text << pixels << " pixels (mean " << (pixels ? sum / pixels : 0.0) << ", max " << maximum << ")";
+				return text.str();
+			};
+
+			renderer.SetTransparencyMode(SoftwareRenderer::TransparencyMode::Sorted);
+			const std::vector<uint8_t> sorted{ renderFrames(false).second };
+
+			using Mode = std::pair<std::string, SoftwareRenderer::TransparencyMode>;
+			for (const auto& [modeName, mode] : { Mode{ "ordered", SoftwareRenderer::TransparencyMode::Ordered },
+				Mode{ "weighted blended", SoftwareRenderer::TransparencyMode::WeightedBlended }, Mode{ "sorted", SoftwareRenderer::TransparencyMode::Sorted } })
+			{
+				renderer.SetTransparencyMode(mode);
+				const auto [frameMs, image] { renderFrames(false) };
+				const auto [reversedMs, reversedImage] { renderFrames(true) };
+				std::cout << modeName << ": " << (frameMs + reversedMs) / 2.f << "ms per frame, differs from sorted in " << compare(image, sorted)
+					<< ", reversing the triangles changes " << compare(image, reversedImage) << "\n";
+			}
+		}
+
+		void HierarchicalDepth()
+		{
+			MeshDataPaths vehiclePaths{};
+			vehiclePaths.mesh = "Resources/vehicle.obj";
+			vehiclePaths.effect = L"Resources/PosCol3D.fx";
+			vehiclePaths.diffuse = "Resources/vehicle_diffuse.png";
+			vehiclePaths.normal = "Resources/vehicle_normal.png";
+			vehiclePaths.specular = "Resources/vehicle_specular.png";
+			vehiclePaths.gloss = "Resources/vehicle_gloss.png";
+			const MeshData vehicle{ MeshData::Load(vehiclePaths, nullptr, nullptr) };
+			if (vehicle.vertices.empty() || !vehicle.diffuse.IsValid())
+			{
+				std::cout << "Could not load " << vehiclePaths.mesh << "\n";
+				return;
+			}
+
+			constexpr int width{ 640 };
+			constexpr int height{ 480 };
+			constexpr int frameCount{ 60 };
+			SoftwareRenderer renderer{ width, height };
+			renderer.AddMesh(vehicle);
+			renderer.SetCullMode(SoftwareRenderer::Cull::Back);
+
+			struct Config
+			{
+				const char* name{};
+				bool hierarchical{};
+				DepthBuffer::Format format{};
+			};
+			const Config configs[]{ { "per pixel only, d32", false, DepthBuffer::Format::Float32 },
+				{ "hierarchical, d32", true, DepthBuffer::Format::Float32 },
+				{ "hierarchical, d24s8", true, DepthBuffer::Format::Unorm24 },
+				{ "hierarchical, d16", true, DepthBuffer::Format::Unorm16 } };
+
+			//From the whole vehicle to a part of it filling the screen
+			for (const float distance : { 50.f, 20.f, 10.f, 5.f })
+			{
+				Camera camera{};
+				camera.Initialize(static_cast<float>(width) / height, 45.f, { 0.f, 0.f, -distance });
+				camera.CalculateViewMatrix();
+				std::cout << "distance " << distance << "\n";
+
+				std::vector<uint8_t> reference{};
+				for (const Config& config : configs)
+				{
+					renderer.SetHierarchicalDepth(config.hierarchical);
+					renderer.SetDepthFormat(config.format);
+					renderer.Render(camera); //warm up
+
+					SoftwareRenderer::Stats sum{};
+					size_t differentPixels{};
+					for (int frame{}; frame < frameCount; ++frame)
+					{
+						renderer.SetWorldMatrix(0, Matrix::CreateRotationY(frame * 1.5f * TO_RADIANS));
+						renderer.Render(camera);
+
+						const SoftwareRenderer::Stats& stats{ renderer.GetStats() };
+						sum.rasterMs += stats.rasterMs;
+						sum.totalMs += stats.totalMs;
+						sum.pixelsShaded += stats.pixelsShaded;
+						sum.blocksTested += stats.blocksTested;
+						sum.blocksRejected += stats.blocksRejected;
+						sum.blocksAccepted += stats.blocksAccepted;
+
+						//Every frame of the first configuration is the reference, the same rotation gives the same frame
+						const uint8_t* pPixels{ renderer.GetPixels() };
+						const size_t frameBytes{ static_cast<size_t>(width) * height * 4 };
+						if (&config == configs)
+						{
+							reference.insert(reference.end(), pPixels, pPixels + frameBytes);
+							continue;
+						}
+						const uint8_t* pReference{ reference.data() + frame * frameBytes };
+						for (size_t pixel{}; pixel < frameBytes; pixel += 4)
+						{
+							differentPixels += std::equal(pPixels + pixel, pPixels + pixel + 4, pReference + pixel) ? 0 : 1;
+						}
+					}
+
+					const float blocks{ static_cast<float>(std::max(sum.blocksTested, size_t{ 1 })) };
+					std::cout << "  " << config.name << ": " << 1000.f * frameCount / sum.totalMs << " fps (raster " << sum.rasterMs / frameCount
+						<< "ms), " << sum.pixelsShaded / frameCount << " fragments shaded per frame";
+					if (config.hierarchical)
+					{
+						std::cout << ", blocks " << 100.f * sum.blocksRejected / blocks << "% rejected " << 100.f * sum.blocksAccepted / blocks
+							<< "% accepted, " << differentPixels / frameCount << " pixels per frame differ";
+					}
+					std::cout << "\n";
+				}
+			}
+		}
+
+		void Multisample()
+		{
+			MeshDataPaths vehiclePaths{};
+			vehiclePaths.mesh = "Resources/vehicle.obj";
+			vehiclePaths.effect = L"Resources/PosCol3D.fx";
+			vehiclePaths.diffuse = "Resources/vehicle_diffuse.png";
+			vehiclePaths.normal = "Resources/vehicle_normal.png";
+			vehiclePaths.specular = "Resources/vehicle_specular.png";
+			vehiclePaths.gloss = "Resources/vehicle_gloss.png";
+			const MeshData vehicle{ MeshData::Load(vehiclePaths, nullptr, nullptr) };
+			if (vehicle.vertices.empty() || !vehicle.diffuse.IsValid())
+			{
+				std::cout << "Could not load " << vehiclePaths.mesh << "\n";
+				return;
+			}
+
+			constexpr int width{ 640 };
+			constexpr int height{ 480 };
+			constexpr int frameCount{ 30 };
+			//The reference is a 16 times supersampled image, 4x4 pixels of a 4 times larger render averaged in linear
+			constexpr int referenceScale{ 4 };
+			const ColorRGB clearColor{ ColorConversion::SrgbToLinear(0.39f), ColorConversion::SrgbToLinear(0.59f), ColorConversion::SrgbToLinear(0.93f) };
+			SoftwareRenderer renderer{ width, height };
+			renderer.AddMesh(vehicle);
+			renderer.SetCullMode(SoftwareRenderer::Cull::Back);
+			renderer.SetClearColor(clearColor);
+			SoftwareRenderer referenceRenderer{ width * referenceScale, height * referenceScale };
+			referenceRenderer.AddMesh(vehicle);
+			referenceRenderer.SetCullMode(SoftwareRenderer::Cull::Back);
+			referenceRenderer.SetClearColor(clearColor);
+
+			for (const float distance : { 50.f, 20.f })
+			{
+				Camera camera{};
+				camera.Initialize(static_cast<float>(width) / height, 45.f, { 0.f, 0.f, -distance });
+				camera.CalculateViewMatrix();
+				const Matrix world{ Matrix::CreateRotationY(30.f * TO_RADIANS) };
+				renderer.SetWorldMatrix(0, world);
+				referenceRenderer.SetWorldMatrix(0, world);
+				std::cout << "distance " << distance << "\n";
+
+				referenceRenderer.Render(camera);
+				std::vector<float> reference(static_cast<size_t>(width) * height * 3);
+				std::vector<float> row(static_cast<size_t>(width) * referenceScale * 4);
+				for (int y{}; y < height * referenceScale; ++y)
+				{
+					ColorConversion::SrgbToLinear(referenceRenderer.GetPixels() + row.size() * y, row.data(), row.size() / 4);
+					for (int x{}; x < width * referenceScale; ++x)
+					{
+						for (int channel{}; channel < 3; ++channel)
+						{
+							reference[(static_cast<size_t>(y / referenceScale) * width + x / referenceScale) * 3 + channel] +=
+								row[static_cast<size_t>(x) * 4 + channel] / (referenceScale * referenceScale);
+						}
+					}
+				}
+
+				float singleSampleMs{};
+				size_t singleSampleShaded{};
+				for (const bool multisample : { false, true })
+				{
+					renderer.SetMultisample(multisample);
+					renderer.Render(camera); //warm up
+
+					SoftwareRenderer::Stats sum{};
+					for (int frame{}; frame < frameCount; ++frame)
+					{
+						renderer.Render(camera);
+						const SoftwareRenderer::Stats& stats{ renderer.GetStats() };
+						sum.totalMs += stats.totalMs;
+						sum.pixelsShaded += stats.pixelsShaded;
+						sum.pixelsExpanded += stats.pixelsExpanded;
+					}
+
+					//In 8 bit sRGB steps, like the swap chain shows it
+					double error{};
+					size_t badPixels{};
+					for (size_t pixel{}; pixel < static_cast<size_t>(width) * height; ++pixel)
+					{
+						int pixelError{};
+						for (int channel{}; channel < 3; ++channel)
+						{
+							pixelError = std::max(pixelError, std::abs(static_cast<int>(renderer.GetPixels()[pixel * 4 + channel])
+								- static_cast<int>(ColorConversion::LinearToSrgb8(reference[pixel * 3 + channel]))));
+						}
+						error += pixelError;
+						badPixels += pixelError > 16 ? 1 : 0;
+					}
+
+					const float frameMs{ sum.totalMs / frameCount };
+					const size_t shaded{ sum.pixelsShaded / frameCount };
+					std::cout << "  " << (multisample ? "4x" : "1x") << ": " << frameMs << "ms per frame, " << shaded << " fragments shaded, mean error "
+						<< error / (static_cast<double>(width) * height) << ", " << badPixels << " pixels off by more than 16";
+					if (multisample)
+					{
+						//Linear float color and 32 bit depth per sample, an int slot per pixel and 4 colors for each split one
+						const float expanded{ static_cast<float>(sum.pixelsExpanded / frameCount) / (static_cast<float>(width) * height) };
+						const float singleBytes{ 16.f + 4.f };
+						const float fullBytes{ RasterKernel::sampleCount * (16.f + 4.f) };
+						const float compressedBytes{ 16.f + RasterKernel::sampleCount * 4.f + 4.f + expanded * RasterKernel::sampleCount * 16.f };
+						std::cout << "\n    " << frameMs / singleSampleMs << "x the time, " << static_cast<float>(shaded) / singleSampleShaded
+							<< "x the fragments, " << 100.f * expanded << "% of pixels split, " << compressedBytes << " bytes per pixel vs "
+							<< singleBytes << " single sampled and " << fullBytes << " with 4 colors everywhere";
+					}
+					std::cout << "\n";
+					singleSampleMs = frameMs;
+					singleSampleShaded = shaded;
+				}
+			}
+		}
+
+		void VertexProcessing()
+		{
+			MeshDataPaths vehiclePaths{};
+			vehiclePaths.mesh = "Resources/vehicle.obj";
+			vehiclePaths.effect = L"Resources/PosCol3D.fx";
+			const MeshData vehicle{ MeshData::Load(vehiclePaths, nullptr, nullptr) };
+			if (vehicle.vertices.empty())
+			{
+				std::cout << "Could not load " << vehiclePaths.mesh << "\n";
+				return;
+			}
+
+			Camera camera{};
+			camera.Initialize(640.f / 480.f, 45.f, { 0.f, 0.f, -50.f });
+			camera.CalculateViewMatrix();
+			const Matrix world{ Matrix::CreateRotationY(30.f * TO_RADIANS) * Matrix::CreateTranslation({ 1.f, 2.f, 3.f }) };
+			const VertexShading::Constants constants{ world * camera.viewMatrix * camera.projectionMatrix, world };
+			const size_t vertexCount{ vehicle.vertices.size() };
+			const VertexShading::InputStreams input{ VertexShading::InputStreams::FromVertices(vehicle.vertices) };
+			std::cout << vertexCount << " vertices, " << vehicle.indices.size() / 3 << " triangles\n";
+
+			//The loop the software renderer had, one Vertex at a time into an array of structures
+			struct Transformed
+			{
+				Vector4 clip{};
+				Vector3 world{};
+				Vector3 normal{};
+				Vector3 tangent{};
+			};
+			std::vector<Transformed> structures(vertexCount);
+			const double perVertex{ Measure([&]
+				{
+					for (size_t i{}; i < vertexCount; ++i)
+					{
+						const Vertex& vertex{ vehicle.vertices[i] };
+						Transformed& transformed{ structures[i] };
+						transformed.clip = constants.worldViewProjection.TransformPoint(Vector4{ vertex.Position, 1.f });
+						transformed.world = constants.world.TransformPoint(vertex.Position);
+						transformed.normal = constants.world.TransformVector(vertex.Normal.Normalized());
+						transformed.tangent = constants.world.TransformVector(vertex.Tangent.Normalized());
+					}
+					return vertexCount;
+				}) };
+
+			VertexShading::OutputStreams scalar{};
+			scalar.Resize(vertexCount, true);
+			const double scalarRate{ Measure([&] { VertexShading::RunScalar(constants, input, 0, vertexCount, true, scalar); return vertexCount; }) };
+			VertexShading::OutputStreams batched{};
+			batched.Resize(vertexCount, true);
+			const double batchedRate{ Measure([&] { VertexShading::Run(constants, input, 0, vertexCount, true, batched); return vertexCount; }) };
+			VertexShading::OutputStreams positions{};
+			positions.Resize(vertexCount, false);
+			const double positionRate{ Measure([&] { VertexShading::Run(constants, input, 0, vertexCount, false, positions); return vertexCount; }) };
+
+			//Fused multiply-adds round differently from the scalar loop, a few ulp of the largest clip coordinates (about 60)
+			constexpr float tolerance{ 1e-4f };
+			float maxDifference{};
+			for (size_t i{}; i < vertexCount; ++i)
+			{
+				const float differences[]{ batched.clipX[i] - scalar.clipX[i], batched.clipY[i] - scalar.clipY[i], batched.clipZ[i] - scalar.clipZ[i],
+					batched.clipW[i] - scalar.clipW[i], batched.normalX[i] - scalar.normalX[i], batched.tangentZ[i] - scalar.tangentZ[i],
+					positions.clipW[i] - scalar.clipW[i] };
+				for (const float difference : differences)
+				{
+					maxDifference = std::max(maxDifference, std::abs(difference));
+				}
+			}
+			std::cout << "per vertex into structures: " << perVertex / 1e6 << " Mvertices/s\n";
+			std::cout << "streams scalar: " << scalarRate / 1e6 << " Mvertices/s, " << scalarRate / perVertex << "x\n";
+			std::cout << "streams batched: " << batchedRate / 1e6 << " Mvertices/s, " << batchedRate / perVertex << "x, positions only "
+				<< positionRate / 1e6 << " Mvertices/s, max difference to scalar " << maxDifference << "\n";
+			Check(maxDifference <= tolerance, "batched vertex shading differs from scalar by " + std::to_string(maxDifference));
+
+			//Part of the mesh, like what survives culling: only the vertices its triangles use, each once, into a packed stream
+			VertexShading::PostTransformCache cache{ vertexCount };
+			std::vector<uint32_t> misses{};
+			std::vector<uint32_t> slots(vehicle.indices.size());
+			VertexShading::OutputStreams packed{};
+			packed.Resize(vertexCount, true);
+			for (const size_t percent : { size_t{ 10 }, size_t{ 25 }, size_t{ 50 }, size_t{ 100 } })
+			{
+				const size_t indexCount{ vehicle.indices.size() / 3 * percent / 100 * 3 };
+				const double rate{ Measure([&]
+					{
+						cache.NewBatch();
+						misses.clear();
+						cache.Lookup(vehicle.indices.data(), indexCount, misses, slots.data());
+						VertexShading::RunIndexed(constants, input, misses.data(), misses.size(), true, packed);
+						return indexCount / 3;
+					}) };
+
+				float maxDifference{};
+				for (size_t i{}; i < indexCount; ++i)
+				{
+					maxDifference = std::max(maxDifference, std::abs(packed.clipX[slots[i]] - batched.clipX[vehicle.indices[i]]));
+					maxDifference = std::max(maxDifference, std::abs(packed.tangentY[slots[i]] - batched.tangentY[vehicle.indices[i]]));
+				}
+				std::cout << percent << "% of the triangles: " << misses.size() << " vertices shaded for " << indexCount << " indices ("
+					<< 100.f * (1.f - static_cast<float>(misses.size()) / indexCount) << "% cache hits), " << rate / 1e6
+					<< " Mtriangles/s vs " << batchedRate / vertexCount * (vehicle.indices.size() / 3) / 1e6 << " shading every vertex, max difference "
+					<< maxDifference << "\n";
+				Check(maxDifference <= tolerance, std::to_string(percent) + "% of the triangles: indexed vertex shading differs from batched by "
+					+ std::to_string(maxDifference));
+			}
+		}
+
+		void Frustum()
+		{
+			Camera camera{};
+			camera.Initialize(640.f / 480.f, 45.f, { 0.f, 0.f, -50.f });
+			camera.CalculateViewMatrix();
+			const Matrix viewProjection{ camera.viewMatrix * camera.projectionMatrix };
+
+			//Rotated boxes of up to 20 units scattered around the camera, most of them outside the 45 degree view or past the far plane
+			std::mt19937 random{ 7 };
+			std::uniform_real_distribution<float> position{ -100.f, 100.f };
+			std::uniform_real_distribution<float> size{ 0.5f, 10.f };
+			std::uniform_real_distribution<float> angle{ 0.f, 360.f * TO_RADIANS };
+			for (const size_t objectCount : { size_t{ 1000 }, size_t{ 10000 }, size_t{ 100000 } })
+			{
+				FrustumCuller culler{};
+				for (size_t i{}; i < objectCount; ++i)
+				{
+					const Vector3 extent{ size(random), size(random), size(random) };
+					const size_t object{ culler.AddObject(-extent, extent) };
+					culler.SetWorld(object, Matrix::CreateRotation(angle(random), angle(random), angle(random))
+						* Matrix::CreateTranslation(position(random), position(random), position(random)));
+				}
+
+				culler.CullScalar(viewProjection);
+				std::vector<bool> scalarVisible(objectCount);
+				for (size_t i{}; i < objectCount; ++i)
+				{
+					scalarVisible[i] = culler.IsVisible(i);
+				}
+				const double scalarRate{ Measure([&] { culler.CullScalar(viewProjection); return objectCount; }) };
+				const double batchedRate{ Measure([&] { culler.Cull(viewProjection); return objectCount; }) };
+				size_t mismatches{};
+				for (size_t i{}; i < objectCount; ++i)
+				{
+					mismatches += scalarVisible[i] != culler.IsVisible(i);
+				}
+
+				const FrustumCuller::Stats& stats{ culler.GetStats() };
+				std::cout << objectCount << " objects, " << stats.culled << " culled: scalar " << 1e9 / scalarRate << "ns/object, batched "
+					<< 1e9 / batchedRate << "ns/object (" << batchedRate / scalarRate << "x, " << stats.cullMicroseconds << "us per frame), "
+					<< mismatches << " mismatches\n";
+				Check(mismatches == 0, std::to_string(objectCount) + " objects batched culling matches scalar culling");
+			}
+		}
+
+		void MeshletCulling()
+		{
+			MeshDataPaths vehiclePaths{};
+			vehiclePaths.mesh = "Resources/vehicle.obj";
+			vehiclePaths.effect = L"Resources/PosCol3D.fx";
+			const MeshData source{ MeshData::Load(vehiclePaths, nullptr, nullptr, true, true, false, false) };
+			if (source.vertices.empty())
+			{
+				std::cout << "Could not load " << vehiclePaths.mesh << "\n";
+				return;
+			}
+
+			std::vector<Vertex> vertices{ source.vertices };
+			std::vector<uint32_t> indices{ source.indices };
+			const auto start{ std::chrono::steady_clock::now() };
+			Meshlets::WeldVertices(vertices, indices);
+			const auto welded{ std::chrono::steady_clock::now() };
+			const std::vector<Meshlet> meshlets{ Meshlets::Build(vertices, indices) };
+			const auto built{ std::chrono::steady_clock::now() };
+
+			size_t cullable{};
+			float meanVertices{};
+			float meanTriangles{};
+			for (const Meshlet& meshlet : meshlets)
+			{
+				cullable += meshlet.coneCutoff < 1.f;
+				meanVertices += static_cast<float>(meshlet.vertexCount) / meshlets.size();
+				meanTriangles += static_cast<float>(meshlet.triangleCount) / meshlets.size();
+			}
+			std::cout << source.vertices.size() << " -> " << vertices.size() << " vertices welded in "
+				<< std::chrono::duration<float, std::milli>(welded - start).count() << "ms, " << meshlets.size() << " meshlets built in "
+				<< std::chrono::duration<float, std::milli>(built - welded).count() << "ms, " << meanVertices << " vertices and " << meanTriangles
+				<< " triangles on average, " << cullable << " with a usable cone\n";
+
+			//Around the vehicle at the default distance, and close enough that parts leave the screen
+			Camera camera{};
+			std::vector<IndexRange> ranges{};
+			std::vector<uint32_t> compacted(indices.size());
+			for (const float distance : { 50.f, 25.f, 12.f })
+			{
+				camera.Initialize(640.f / 480.f, 45.f, { 0.f, 5.f, -distance });
+				camera.CalculateViewMatrix();
+				const Matrix viewProjection{ camera.viewMatrix * camera.projectionMatrix };
+
+				Meshlets::CullStats total{};
+				size_t unsafe{};
+				double perFrameSeconds{};
+				constexpr int angleCount{ 8 };
+				for (int angle{}; angle < angleCount; ++angle)
+				{
+					const Matrix world{ Matrix::CreateRotationY(360.f / angleCount * angle * TO_RADIANS) };
+					total += Meshlets::Cull(meshlets, world, viewProjection, camera.origin, Meshlets::FaceCull::Back, ranges);
+					//What the mesh does every frame: cull, then pack the survivors into its index buffer
+					perFrameSeconds += 1.0 / Measure([&]
+						{
+							Meshlets::Cull(meshlets, world, viewProjection, camera.origin, Meshlets::FaceCull::Back, ranges);
+							Meshlets::CompactRanges(ranges, indices.data(), compacted.data());
+							return size_t{ 1 };
+						}, 0.1);
+
+					//Every dropped triangle has to face away or lie outside one of the clip planes
+					const Matrix worldViewProjection{ world * viewProjection };
+					const Vector3 objectCamera{ Matrix::Inverse(world).TransformPoint(camera.origin) };
+					std::vector<bool> drawn(indices.size() / 3);
+					for (const IndexRange& range : ranges)
+					{
+						std::fill(drawn.begin() + range.firstIndex / 3, drawn.begin() + (range.firstIndex + range.indexCount) / 3, true);
+					}
+					for (size_t triangle{}; triangle < drawn.size(); ++triangle)
+					{
+						if (drawn[triangle])
+						{
+							continue;
+						}
+						const Vector3& p0{ vertices[indices[triangle * 3]].Position };
+						const Vector3& p1{ vertices[indices[triangle * 3 + 1]].Position };
+						const Vector3& p2{ vertices[indices[triangle * 3 + 2]].Position };
+						if (Vector3::Dot(Vector3::Cross(p1 - p0, p2 - p0), p0 - objectCamera) >= 0.f)
+						{
+							continue;
+						}
+						const Vector4 clip[]{ worldViewProjection.TransformPoint(Vector4{ p0, 1.f }), worldViewProjection.TransformPoint(Vector4{ p1, 1.f }),
+							worldViewProjection.TransformPoint(Vector4{ p2, 1.f }) };
+						const auto allOutside = [&clip](auto outside) { return outside(clip[0]) && outside(clip[1]) && outside(clip[2]); };
+						const bool outside{ allOutside([](const Vector4& v) { return v.x < -v.w; }) || allOutside([](const Vector4& v) { return v.x > v.w; })
+							|| allOutside([](const Vector4& v) { return v.y < -v.w; }) || allOutside([](const Vector4& v) { return v.y > v.w; })
+							|| allOutside([](const Vector4& v) { return v.z < 0.f; }) || allOutside([](const Vector4& v) { return v.z > v.w; }) };
+						unsafe += !outside;
+					}
+				}
+
+				const float removed{ 100.f * (1.f - static_cast<float>(total.trianglesDrawn) / total.triangles) };
+				std::cout << "distance " << distance << ": " << removed << "% of the triangles removed, " << 100.f * total.offscreen / total.meshlets
+					<< "% of the meshlets offscreen and " << 100.f * total.facingAway / total.meshlets << "% facing away, "
+					<< static_cast<float>(total.ranges) / angleCount << " ranges packed into one draw, cull and pack " << perFrameSeconds / angleCount * 1e6
+					<< "us, " << unsafe << " visible triangles dropped\n";
+				Check(unsafe == 0, "distance " + std::to_string(static_cast<int>(distance)) + ": " + std::to_string(unsafe)
+					+ " triangles dropped that face the camera inside the frustum");
+			}
+		}
+
+		void LevelOfDetail()
+		{
+			MeshDataPaths vehiclePaths{};
+			vehiclePaths.mesh = "Resources/vehicle.obj";
+			vehiclePaths.effect = L"Resources/PosCol3D.fx";
+			const MeshData vehicle{ MeshData::Load(vehiclePaths, nullptr, nullptr, true, true, true, false) };
+			if (vehicle.vertices.empty())
+			{
+				std::cout << "Could not load " << vehiclePaths.mesh << "\n";
+				return;
+			}
+
+			const auto start{ std::chrono::steady_clock::now() };
+			const std::vector<LodLevel> levels{ Simplifier::BuildChain(vehicle.vertices, vehicle.indices) };
+			std::cout << "chain of " << levels.size() << " built in " << std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count()
+				<< "ms from " << vehicle.indices.size() / 3 << " triangles\n";
+
+			//How far the simplified surface strays: distance from every original vertex to the closest triangle of the level
+			const auto getDistance = [](const Vector3& p, const Vector3& a, const Vector3& b, const Vector3& c)
+			{
+				const Vector3 ab{ b - a }, ac{ c - a }, ap{ p - a };
+				const Vector3 normal{ Vector3::Cross(ab, ac) };
+				const float area{ normal.SqrMagnitude() };
+				if (area > 0.f)
+				{
+					//Inside the triangle the plane distance is the distance
+					const float u{ Vector3::Dot(Vector3::Cross(ap, ac), normal) / area };
+					const float v{ Vector3::Dot(Vector3::Cross(ab, ap), normal) / area };
+					if (u >= 0.f && v >= 0.f && u + v <= 1.f)
+					{
+						return fabsf(Vector3::Dot(ap, normal)) / sqrtf(area);
+					}
+				}
+				const auto toSegment = [&p](const Vector3& s0, const Vector3& s1)
+				{
+					const Vector3 segment{ s1 - s0 };
+					const float length{ segment.SqrMagnitude() };
+					const float t{ length > 0.f ? std::clamp(Vector3::Dot(p - s0, segment) / length, 0.f, 1.f) : 0.f };
+					return (p - (s0 + segment * t)).Magnitude();
+				};
+				return std::min({ toSegment(a, b), toSegment(b, c), toSegment(c, a) });
+			};
+
+			for (size_t level{}; level < levels.size(); ++level)
+			{
+				const std::vector<uint32_t>& indices{ levels[level].indices };
+				std::vector<bool> used(vehicle.vertices.size());
+				for (const uint32_t index : indices)
+				{
+					used[index] = true;
+				}
+				float maxDistance{};
+				for (size_t vertex{}; vertex < vehicle.vertices.size(); vertex += 7)
+				{
+					const Vector3& p{ vehicle.vertices[vertex].Position };
+					float closest{ FLT_MAX };
+					for (size_t i{}; i < indices.size(); i += 3)
+					{
+						closest = std::min(closest, getDistance(p, vehicle.vertices[indices[i]].Position, vehicle.vertices[indices[i + 1]].Position,
+							vehicle.vertices[indices[i + 2]].Position));
+					}
+					maxDistance = std::max(maxDistance, closest);
+				}
+				std::cout << "level " << level + 1 << ": " << indices.size() / 3 << " triangles, " << 100.f * indices.size() / vehicle.indices.size()
+					<< "% of the full mesh, " << std::count(used.begin(), used.end(), true) << " of " << used.size() << " vertices used, error "
+					<< levels[level].error << ", farthest sampled vertex " << maxDistance << " away\n";
+			}
+
+			//Which level a one pixel budget picks at 640x480, the way Mesh::SelectLod does it
+			Camera camera{};
+			camera.Initialize(640.f / 480.f, 45.f, {});
+			for (const float distance : { 12.f, 25.f, 50.f, 100.f, 200.f })
+			{
+				const float pixelsPerUnit{ 480.f / (2.f * camera.fov * distance) };
+				size_t selected{};
+				for (size_t level{}; level < levels.size(); ++level)
+				{
+					if (levels[level].error * pixelsPerUnit <= 1.f)
+					{
+						selected = level + 1;
+					}
+				}
+				std::cout << "distance " << distance << ": level " << selected << ", "
+					<< (selected ? levels[selected - 1].indices.size() : vehicle.indices.size()) / 3 << " triangles\n";
+			}
+		}
+
+		void Jobs()
+		{
+			MeshDataPaths vehiclePaths{};
+			vehiclePaths.mesh = "Resources/vehicle.obj";
+			vehiclePaths.effect = L"Resources/PosCol3D.fx";
+			const MeshData vehicle{ MeshData::Load(vehiclePaths, nullptr, nullptr, true, true, true, false) };
+			if (vehicle.vertices.empty())
+			{
+				std::cout << "Could not load " << vehiclePaths.mesh << "\n";
+				return;
+			}
+
+			//Per-object frame work: meshlet culling of a field of vehicles around the camera
+			constexpr size_t instanceCount{ 1024 };
+			Camera camera{};
+			camera.Initialize(640.f / 480.f, 45.f, { 0.f, 5.f, -50.f });
+			camera.CalculateViewMatrix();
+			const Matrix viewProjection{ camera.viewMatrix * camera.projectionMatrix };
+			std::vector<Matrix> worlds(instanceCount);
+			std::mt19937 random{ 1337 };
+			std::uniform_real_distribution<float> unit{ 0.f, 1.f };
+			for (Matrix& world : worlds)
+			{
+				world = Matrix::CreateRotationY(unit(random) * PI_2) * Matrix::CreateTranslation({ unit(random) * 400.f - 200.f, 0.f, unit(random) * 400.f });
+			}
+			std::vector<std::vector<IndexRange>> ranges(instanceCount);
+			const auto cull = [&](size_t begin, size_t end)
+			{
+				for (size_t i{ begin }; i < end; ++i)
+				{
+					Meshlets::Cull(vehicle.meshlets, worlds[i], viewProjection, camera.origin, Meshlets::FaceCull::Back, ranges[i]);
+				}
+			};
+
+			std::vector<int> threadCounts{};
+			const int maxThreads{ std::max(1, static_cast<int>(std::thread::hardware_concurrency())) };
+			for (int threads{ 1 }; threads < maxThreads; threads *= 2)
+			{
+				threadCounts.push_back(threads);
+			}
+			threadCounts.push_back(maxThreads);
+
+			double singleCull{};
+			double singleChain{};
+			for (const int threads : threadCounts)
+			{
+				JobSystem jobs{ threads };
+				std::cout << threads << (threads == 1 ? " thread" : " threads") << ":\n";
+
+				//Scheduling cost alone, jobs that do nothing
+				constexpr int emptyJobCount{ 1 << 16 };
+				const double emptyJobs{ Measure([&]
+				{
+					JobSystem::Counter counter{};
+					for (int i{}; i < emptyJobCount; ++i)
+					{
+						jobs.Run([] {}, &counter);
+					}
+					jobs.Wait(counter);
+					return size_t{ emptyJobCount };
+				}) };
+				std::cout << "  empty jobs: " << 1e9 / emptyJobs << "ns each\n";
+
+				//Grain against the static split WorkerPool does, one contiguous share per thread
+				for (const size_t grain : { size_t{ 1 }, size_t{ 16 }, size_t{ 128 } })
+				{
+					const double rate{ Measure([&]
+					{
+						jobs.ParallelFor(instanceCount, grain, cull);
+						return instanceCount;
+					}) };
+					if (threads == 1 && grain == 16)
+					{
+						singleCull = rate;
+					}
+					std::cout << "  meshlet culling, grain " << grain << ": " << 1e6 / rate * instanceCount << "us for " << instanceCount
+						<< " instances, " << (singleCull > 0.0 ? rate / singleCull : 1.0) << "x\n";
+				}
+				WorkerPool pool{ threads };
+				const double poolRate{ Measure([&]
+				{
+					pool.Run([&](int thread)
+					{
+						cull(instanceCount * thread / threads, instanceCount * (thread + 1) / threads);
+					});
+					return instanceCount;
+				}) };
+				std::cout << "  meshlet culling, worker pool: " << 1e6 / poolRate * instanceCount << "us\n";
+
+				//Loading work: every level of the chain is its own job
+				const auto start{ std::chrono::steady_clock::now() };
+				const std::vector<LodLevel> levels{ Simplifier::BuildChain(vehicle.vertices, vehicle.indices, &jobs) };
+				const double chainSeconds{ std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() };
+				if (threads == 1)
+				{
+					singleChain = chainSeconds;
+				}
+				std::cout << "  LOD chain: " << chainSeconds * 1000.0 << "ms, " << singleChain / chainSeconds << "x\n";
+			}
+		}
+
+		void Instancing()
+		{
+			MeshDataPaths vehiclePaths{};
+			vehiclePaths.mesh = "Resources/vehicle.obj";
+			vehiclePaths.effect = L"Resources/PosCol3D.fx";
+			const MeshData vehicle{ MeshData::Load(vehiclePaths, nullptr, nullptr, true, true, true, true) };
+			if (vehicle.vertices.empty())
+			{
+				std::cout << "Could not load " << vehiclePaths.mesh << "\n";
+				return;
+			}
+
+			Vector3 boundsMinimum{ vehicle.vertices[0].Position };
+			Vector3 boundsMaximum{ vehicle.vertices[0].Position };
+			for (const Vertex& vertex : vehicle.vertices)
+			{
+				const Vector3& p{ vertex.Position };
+				boundsMinimum = { std::min(boundsMinimum.x, p.x), std::min(boundsMinimum.y, p.y), std::min(boundsMinimum.z, p.z) };
+				boundsMaximum = { std::max(boundsMaximum.x, p.x), std::max(boundsMaximum.y, p.y), std::max(boundsMaximum.z, p.z) };
+			}
+			std::vector<float> lodErrors{ 0.f };
+			std::vector<size_t> levelTriangles{ vehicle.indices.size() / 3 };
+			for (const LodLevel& level : vehicle.lods)
+			{
+				lodErrors.push_back(level.error);
+				levelTriangles.push_back(level.indices.size() / 3);
+			}
+
+			//A field of vehicles in front of and around the camera, the way the renderer's grid is laid out but bigger
+			constexpr int grid{ 100 };
+			constexpr float spacing{ 50.f };
+			InstanceSet instances{};
+			instances.Initialize(boundsMinimum, boundsMaximum, lodErrors);
+			for (int z{}; z < grid; ++z)
+			{
+				for (int x{}; x < grid; ++x)
+				{
+					const Vector3 position{ (x - grid / 2 + 0.5f) * spacing, -20.f, (z - grid / 2 + 0.5f) * spacing };
+					instances.Add(Matrix::CreateRotationY(static_cast<float>((x * 7 + z * 13) % 36) * 10.f * TO_RADIANS) * Matrix::CreateTranslation(position));
+				}
+			}
+
+			//Far plane out to the edge of the field, the default one would leave only the nearest copies
+			Camera camera{};
+			camera.farC = grid * spacing;
+			camera.Initialize(640.f / 480.f, 45.f, { 0.f, 5.f, -50.f });
+			camera.CalculateViewMatrix();
+			const double rate{ Measure([&]
+			{
+				instances.Update(camera, 480.f, 1.f);
+				return size_t{ 1 };
+			}) };
+
+			const InstanceSet::Stats& stats{ instances.GetStats() };
+			std::cout << stats.visible << "/" << stats.instances << " instances visible, update " << 1e6 / rate << "us (cull "
+				<< stats.cullMicroseconds << "us, layout " << stats.buildMicroseconds << "us), " << stats.visible * sizeof(Matrix) / 1024
+				<< "KB of instance data\n";
+			size_t drawCalls{};
+			size_t triangles{};
+			for (size_t level{}; level < instances.GetLevelCount(); ++level)
+			{
+				const size_t count{ instances.GetLevelStart(level + 1) - instances.GetLevelStart(level) };
+				drawCalls += count > 0;
+				triangles += count * levelTriangles[level];
+				std::cout << "level " << level << ": " << count << " instances of " << levelTriangles[level] << " triangles\n";
+			}
+			std::cout << drawCalls << " instanced draws instead of " << stats.visible << ", " << triangles << " triangles instead of "
+				<< stats.visible * levelTriangles[0] << " at full detail\n";
+		}
+
+		void Queue()
+		{
+			//A scene's worth of draws: a few effects, many material sets, a tenth of them translucent
+			std::mt19937 random{ 1337 };
+			std::uniform_int_distribution<uint32_t> effectDistribution{ 0, 31 };
+			std::uniform_int_distribution<uint32_t> textureSetDistribution{ 0, 63 };
+			std::uniform_real_distribution<float> unit{ 0.f, 1.f };
+			const auto makePackets = [&](size_t count)
+			{
+				std::vector<RenderQueue::Packet> packets(count);
+				for (size_t i{}; i < count; ++i)
+				{
+					const uint32_t effect{ effectDistribution(random) };
+					const uint32_t textureSet{ textureSetDistribution(random) };
+					const float depth{ unit(random) };
+					packets[i].key = unit(random) < 0.1f ? RenderQueue::MakeTranslucentKey(0, effect, textureSet, depth)
+						: RenderQueue::MakeOpaqueKey(0, effect, textureSet, depth);
+					packets[i].object = static_cast<uint32_t>(i);
+				}
+				return packets;
+			};
+			const auto stableSort = [](std::vector<RenderQueue::Packet>& packets)
+			{
+				std::stable_sort(packets.begin(), packets.end(), [](const RenderQueue::Packet& a, const RenderQueue::Packet& b) { return a.key < b.key; });
+			};
+			const auto samePackets = [](const std::vector<RenderQueue::Packet>& a, const std::vector<RenderQueue::Packet>& b)
+			{
+				return std::equal(a.begin(), a.end(), b.begin(), b.end(), [](const RenderQueue::Packet& left, const RenderQueue::Packet& right)
+					{
+						return left.key == right.key && left.object == right.object;
+					});
+			};
+			const auto countChanges = [](const std::vector<RenderQueue::Packet>& packets)
+			{
+				size_t changes{};
+				for (size_t i{ 1 }; i < packets.size(); ++i)
+				{
+					changes += RenderQueue::GetEffect(packets[i].key) != RenderQueue::GetEffect(packets[i - 1].key)
+						|| RenderQueue::GetTextureSet(packets[i].key) != RenderQueue::GetTextureSet(packets[i - 1].key);
+				}
+				return changes;
+			};
+
+			//Key packing: fields round trip and order draws by pass, then opaque before translucent. Opaque draws sort by
+			//effect, texture set and depth front to back, translucent ones back to front before effect and texture set
+			const uint32_t lastEffect{ RenderQueue::effectCount - 1 };
+			const uint32_t lastTextureSet{ RenderQueue::textureSetCount - 1 };
+			for (const bool translucent : { false, true })
+			{
+				const auto makeKey = translucent ? &RenderQueue::MakeTranslucentKey : &RenderQueue::MakeOpaqueKey;
+				const std::string kind{ translucent ? "translucent" : "opaque" };
+				const uint64_t key{ makeKey(2, 1234, 567, 0.5f) };
+				Check(RenderQueue::GetPass(key) == 2 && RenderQueue::IsTranslucent(key) == translucent && RenderQueue::GetEffect(key) == 1234
+					&& RenderQueue::GetTextureSet(key) == 567, kind + " key fields round trip");
+				Check(makeKey(0, lastEffect, lastTextureSet, 1.f) < makeKey(1, 0, 0, 0.f), kind + " keys sort by pass first");
+				Check(makeKey(0, 0, 0, -1.f) == makeKey(0, 0, 0, 0.f) && makeKey(0, 0, 0, 2.f) == makeKey(0, 0, 0, 1.f), kind + " keys clamp depth");
+			}
+			Check(RenderQueue::MakeOpaqueKey(0, lastEffect, lastTextureSet, 1.f) < RenderQueue::MakeTranslucentKey(0, 0, 0, 1.f),
+				"opaque keys sort before translucent keys of their pass");
+			Check(RenderQueue::MakeOpaqueKey(0, 0, lastTextureSet, 1.f) < RenderQueue::MakeOpaqueKey(0, 1, 0, 0.f), "opaque keys sort by effect before texture set and depth");
+			Check(RenderQueue::MakeOpaqueKey(0, 0, 0, 1.f) < RenderQueue::MakeOpaqueKey(0, 0, 1, 0.f), "opaque keys sort by texture set before depth");
+			Check(RenderQueue::MakeOpaqueKey(0, 0, 0, 0.1f) < RenderQueue::MakeOpaqueKey(0, 0, 0, 0.2f), "opaque keys sort front to back");
+			Check(RenderQueue::MakeTranslucentKey(0, 0, 0, 0.2f) < RenderQueue::MakeTranslucentKey(0, 0, 0, 0.1f), "translucent keys sort back to front");
+			Check(RenderQueue::MakeTranslucentKey(0, lastEffect, lastTextureSet, 0.2f) < RenderQueue::MakeTranslucentKey(0, 0, 0, 0.1f),
+				"translucent keys sort by depth before effect and texture set");
+			Check(RenderQueue::MakeTranslucentKey(0, 0, lastTextureSet, 0.5f) < RenderQueue::MakeTranslucentKey(0, 1, 0, 0.5f),
+				"translucent keys at one depth sort by effect before texture set");
+
+			//Both sides of the comparison sort threshold, with and without jobs, must match stable_sort packet for packet.
+			//The few key queues have long runs of equal keys and bytes every key shares
+			JobSystem jobs{};
+			for (const size_t count : { size_t{ 0 }, size_t{ 1 }, size_t{ 2047 }, size_t{ 2048 }, size_t{ 2049 }, size_t{ 50000 } })
+			{
+				std::vector<RenderQueue::Packet> fewKeys(count);
+				for (size_t i{}; i < count; ++i)
+				{
+					fewKeys[i] = { RenderQueue::MakeOpaqueKey(static_cast<uint32_t>(i % 3), 1, 2, static_cast<float>(i % 5) / 4.f), static_cast<uint32_t>(i) };
+				}
+
+				const std::pair<std::string, std::vector<RenderQueue::Packet>> queues[]{ { "", makePackets(count) }, { " with few keys", fewKeys } };
+				for (const auto& [queueName, packets] : queues)
+				{
+					std::vector<RenderQueue::Packet> reference{ packets };
+					stableSort(reference);
+					for (JobSystem* pJobs : { static_cast<JobSystem*>(nullptr), &jobs })
+					{
+						std::vector<RenderQueue::Packet> sorted{ packets };
+						std::vector<RenderQueue::Packet> scratch{};
+						RenderQueue::Sort(sorted, scratch, pJobs);
+						Check(samePackets(sorted, reference), std::to_string(count) + " packets" + queueName + (pJobs ? " on jobs" : "")
+							+ " sort like stable_sort");
+					}
+				}
+			}
+
+			for (const size_t count : { size_t{ 1000 }, size_t{ 1 } << 16, size_t{ 1 } << 20 })
+			{
+				const std::vector<RenderQueue::Packet> packets{ makePackets(count) };
+				std::vector<RenderQueue::Packet> sorted{};
+				std::vector<RenderQueue::Packet> scratch{};
+
+				//Stable on the key alone, the radix sort has to match it packet for packet
+				std::vector<RenderQueue::Packet> reference{ packets };
+				stableSort(reference);
+				sorted = packets;
+				RenderQueue::Sort(sorted, scratch, &jobs);
+				const bool matches{ samePackets(sorted, reference) };
+
+				//Opaque before translucent, and every opaque state front to back
+				bool ordered{ true };
+				for (size_t i{ 1 }; i < sorted.size(); ++i)
+				{
+					const uint64_t previous{ sorted[i - 1].key };
+					const uint64_t key{ sorted[i].key };
+					ordered &= RenderQueue::IsTranslucent(previous) <= RenderQueue::IsTranslucent(key);
+					if (!RenderQueue::IsTranslucent(key) && !RenderQueue::IsTranslucent(previous) && RenderQueue::GetEffect(key) == RenderQueue::GetEffect(previous)
+						&& RenderQueue::GetTextureSet(key) == RenderQueue::GetTextureSet(previous))
+					{
+						ordered &= (key & 0xFFFFFF) >= (previous & 0xFFFFFF);
+					}
+				}
+
+				const auto time = [&](JobSystem* pJobs)
+				{
+					return Measure([&]
+					{
+						sorted = packets;
+						RenderQueue::Sort(sorted, scratch, pJobs);
+						return count;
+					});
+				};
+				const double stableRate{ Measure([&]
+				{
+					sorted = packets;
+					stableSort(sorted);
+					return count;
+				}) };
+				const double radixRate{ time(nullptr) };
+				const double jobRate{ time(&jobs) };
+
+				std::cout << count << " draws: state changes " << countChanges(packets) << " -> " << countChanges(reference) << ", "
+					<< (matches ? "matches" : "DIFFERS FROM") << " stable_sort, " << (ordered ? "ordered" : "NOT ORDERED") << "\n"
+					<< "  stable_sort " << 1e6 / stableRate * count << "us, radix " << 1e6 / radixRate * count << "us ("
+					<< radixRate / stableRate << "x), radix on " << jobs.GetThreadCount() << " threads " << 1e6 / jobRate * count << "us\n";
+				Check(matches && ordered, std::to_string(count) + " draws sort like stable_sort into state order");
+			}
+		}
+
+		void Headless()
+		{
+			//The Renderer as main runs it, with every mesh, map and effect going to a device that only validates and counts.
+			//The instanced field is on, so one frame has the separately drawn meshes and the instanced draws
+			NullRenderDevice device{ 640, 480 };
+			{
+				Camera camera{};
+				camera.Initialize(640.f / 480.f, 45.f, { 0.f, 0.f, -50.f });
+				Timer timer{};
+				Renderer renderer{ device, &camera };
+				renderer.ToggleInstances();
+				renderer.CycleSampleStates();
+				renderer.CycleCullModes();
+
+				//At the start view every streamed map reaches the detail it asks for, with the budget the Renderer picks
+				timer.Start();
+				bool streamed{};
+				for (int attempt{}; attempt < 5000 && !streamed; ++attempt)
+				{
+					timer.Update();
+					renderer.Update(&timer);
+					renderer.Render();
+					const TextureStreamer::Stats& streaming{ renderer.GetTextureStreamerStats() };
+					streamed = streaming.atWantedMip == streaming.textures && streaming.pendingBytes == 0;
+					if (!streamed)
+					{
+						std::this_thread::sleep_for(std::chrono::milliseconds{ 1 });
+					}
+				}
+				const TextureStreamer::Stats& streaming{ renderer.GetTextureStreamerStats() };
+				std::cout << "start view: " << streaming.atWantedMip << "/" << streaming.textures << " textures at wanted mip, resident "
+					<< streaming.residentBytes / 1024 << "KB/" << streaming.budgetBytes / 1024 << "KB (wanted " << streaming.wantedBytes / 1024
+					<< "KB), denied " << streaming.loadsDenied << "\n";
+				Check(streamed && streaming.loadsDenied == 0, "every streamed texture reaches its wanted mip at the start view");
+
+				//Orbiting the scene, so culling, levels and streaming change from frame to frame
+				int frame{};
+				const auto runFrame = [&]
+				{
+					const float angle{ static_cast<float>(frame++) * 0.01f };
+					camera.origin = { sinf(angle) * -50.f, 10.f, cosf(angle) * -50.f };
+					camera.forward = Vector3{ -camera.origin.x, -camera.origin.y, -camera.origin.z }.Normalized();
+					camera.CalculateViewMatrix();
+
+					timer.Update();
+					renderer.Update(&timer);
+					renderer.Render();
+					return size_t{ 1 };
+				};
+
+				const double rate{ Measure(runFrame) };
+				const NullRenderDevice::Stats& stats{ device.GetStats() };
+				const double frames{ static_cast<double>(stats.frames) };
+				std::cout << stats.frames << " frames at " << 1e6 / rate << "us each: " << stats.draws / frames << " draws, " << stats.instances / frames
+					<< " instances, " << stats.triangles / frames / 1e6 << "M triangles, " << stats.bytesMapped / frames / 1024 << "KB mapped, "
+					<< stats.programChanges / frames << " program changes per frame, " << stats.errors << " errors\n";
+				Check(stats.errors == 0, "the Renderer's frames pass the device's validation"
+					+ (device.GetErrors().empty() ? std::string{} : ", first error: " + device.GetErrors().front()));
+
+				//One frame recorded call by call
+				device.ResetStats();
+				device.SetRecording(true);
+				runFrame();
+				device.SetRecording(false);
+				std::cout << "recorded " << device.GetCommands().size() << " calls in one frame\n";
+
+				//A draw past the bound index buffer is caught and not counted
+				device.ResetStats();
+				device.DrawIndexed(3u << 28, 0);
+				const bool caught{ !device.GetErrors().empty() && device.GetStats().draws == 0 };
+				std::cout << "out of range draw: " << (caught ? device.GetErrors().front() : std::string{ "not caught" }) << "\n";
+				Check(caught, "a draw past the index buffer is caught");
+
+				//The same frames drawn on the CPU, the device only gets the finished image
+				renderer.ToggleSoftwareRenderer();
+				device.ResetStats();
+				device.SetRecording(true);
+				runFrame();
+				device.SetRecording(false);
+				const std::vector<NullRenderDevice::Command>& commands{ device.GetCommands() };
+				const bool copied{ std::any_of(commands.begin(), commands.end(),
+					[](const NullRenderDevice::Command& command) { return command.type == NullRenderDevice::CommandType::CopyToBackBuffer; }) };
+				constexpr int softwareFrames{ 10 };
+				const auto softwareStart{ std::chrono::steady_clock::now() };
+				for (int i{}; i < softwareFrames; ++i)
+				{
+					runFrame();
+				}
+				const float softwareMs{ std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - softwareStart).count() / softwareFrames };
+				std::cout << "software renderer: " << softwareMs << "ms per frame, " << device.GetStats().draws << " device draws, "
+					<< device.GetStats().errors << " errors\n";
+				Check(copied && device.GetStats().draws == 0 && device.GetStats().errors == 0,
+					"the software renderer's frames reach the back buffer without device draws"
+					+ (device.GetErrors().empty() ? std::string{} : ", first error: " + device.GetErrors().front()));
+			}
+
+			//The renderer released its meshes, maps, programs and states
+			std::cout << device.GetLiveResourceCount() << " resources left after the renderer\n";
+			Check(device.GetLiveResourceCount() == 0, "the Renderer releases every device resource");
+		}
+	}
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+namespace dae
+{
+	//Headless measurements, run with "DirectX.exe --bench [name] [--save-frames]".
+	//--save-frames writes the raster benchmark's last frame to raster.bmp in the working directory
+	namespace Benchmarks
+	{
+		//Returns the process exit code, nonzero if a benchmark's correctness check failed
+		int Run(int argc, char* args[]);
+
+		void Sampler();
+		void Tiling();
+		void ColorSpace();
+		void Raster();
+		void Kernel();
+		void Occlusion();
+		void Clip();
+		void Visibility();
+		void Blending();
+		void HierarchicalDepth();
+		void Multisample();
+		void VertexProcessing();
+		void Frustum();
+		void MeshletCulling();
+		void LevelOfDetail();
+		void Jobs();
+		void Instancing();
+		void Queue();
+		void Headless();
+	}
+}
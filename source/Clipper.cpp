@@ -0,0 +1,174 @@
+#include "pch.h"
+#include "Clipper.h"
+#include <immintrin.h>
+
+namespace dae
+{
+	namespace Clipping
+	{
+		namespace
+		{
+			constexpr uint8_t planeOrder[]{ nearPlane, farPlane, leftPlane, rightPlane, bottomPlane, topPlane };
+
+			//Signed distance to the plane scaled by w, inside is >= 0
+			float Distance(const float* pVertex, uint8_t plane, const GuardBand& guardBand)
+			{
+				const float x{ pVertex[0] };
+				const float y{ pVertex[1] };
+				const float z{ pVertex[2] };
+				const float w{ pVertex[3] };
+				switch (plane)
+				{
+				case nearPlane: return z;
+				case farPlane: return w - z;
+				case leftPlane: return x + guardBand.x * w;
+				case rightPlane: return guardBand.x * w - x;
+				case bottomPlane: return y + guardBand.y * w;
+				case topPlane: return guardBand.y * w - y;
+				}
+				return 0.f;
+			}
+
+			void Lerp(const float* pFrom, const float* pTo, float t, int floatCount, float* pResult)
+			{
+				for (int i{}; i < floatCount; ++i)
+				{
+					pResult[i] = pFrom[i] + (pTo[i] - pFrom[i]) * t;
+				}
+			}
+		}
+
+		GuardBand GuardBand::ForViewport(int width, int height)
+		{
+			//Pixels then stay within (maxCoordinate + size) / 2 of the origin
+			return { std::max(1.f, RasterKernel::maxCoordinate / static_cast<float>(width)), std::max(1.f, RasterKernel::maxCoordinate / static_cast<float>(height)) };
+		}
+
+		void ComputeOutcodes(const float* pX, const float* pY, const float* pZ, const float* pW, size_t count,
+			const GuardBand& guardBand, uint8_t* pOutcodes)
+		{
+			if (!RasterKernel::HasAvx2())
+			{
+				ComputeOutcodesScalar(pX, pY, pZ, pW, count, guardBand, pOutcodes);
+				return;
+			}
+
+			const __m256 zero{ _mm256_setzero_ps() };
+			const __m256 guardX{ _mm256_set1_ps(guardBand.x) };
+			const __m256 guardY{ _mm256_set1_ps(guardBand.y) };
+			const auto planeBits = [](__m256 outside, uint8_t plane)
+			{
+				return _mm256_and_si256(_mm256_castps_si256(outside), _mm256_set1_epi32(plane));
+			};
+
+			size_t i{};
+			for (; i + 8 <= count; i += 8)
+			{
+				const __m256 x{ _mm256_loadu_ps(pX + i) };
+				const __m256 y{ _mm256_loadu_ps(pY + i) };
+				const __m256 z{ _mm256_loadu_ps(pZ + i) };
+				const __m256 w{ _mm256_loadu_ps(pW + i) };
+				const __m256 limitX{ _mm256_mul_ps(guardX, w) };
+				const __m256 limitY{ _mm256_mul_ps(guardY, w) };
+
+				__m256i codes{ planeBits(_mm256_cmp_ps(z, zero, _CMP_LT_OQ), nearPlane) };
+				codes = _mm256_or_si256(codes, planeBits(_mm256_cmp_ps(z, w, _CMP_GT_OQ), farPlane));
+				codes = _mm256_or_si256(codes, planeBits(_mm256_cmp_ps(x, _mm256_sub_ps(zero, limitX), _CMP_LT_OQ), leftPlane));
+				codes = _mm256_or_si256(codes, planeBits(_mm256_cmp_ps(x, limitX, _CMP_GT_OQ), rightPlane));
+				codes = _mm256_or_si256(codes, planeBits(_mm256_cmp_ps(y, _mm256_sub_ps(zero, limitY), _CMP_LT_OQ), bottomPlane));
+				codes = _mm256_or_si256(codes, planeBits(_mm256_cmp_ps(y, limitY, _CMP_GT_OQ), topPlane));
+
+				//8 ints to 8 bytes
+				const __m128i words{ _mm_packs_epi32(_mm256_castsi256_si128(codes), _mm256_extracti128_si256(codes, 1)) };
+				_mm_storel_epi64(reinterpret_cast<__m128i*>(pOutcodes + i), _mm_packus_epi16(words, words));
+			}
+			ComputeOutcodesScalar(pX + i, pY + i, pZ + i, pW + i, count - i, guardBand, pOutcodes + i);
+		}
+
+		void ComputeOutcodesScalar(const float* pX, const float* pY, const float* pZ, const float* pW, size_t count,
+			const GuardBand& guardBand, uint8_t* pOutcodes)
+		{
+			for (size_t i{}; i < count; ++i)
+			{
+				const float limitX{ guardBand.x * pW[i] };
+				const float limitY{ guardBand.y * pW[i] };
+				uint8_t code{};
+				code |= pZ[i] < 0.f ? nearPlane : 0;
+				code |= pZ[i] > pW[i] ? farPlane : 0;
+				code |= pX[i] < -limitX ? leftPlane : 0;
+				code |= pX[i] > limitX ? rightPlane : 0;
+				code |= pY[i] < -limitY ? bottomPlane : 0;
+				code |= pY[i] > limitY ? topPlane : 0;
+				pOutcodes[i] = code;
+			}
+		}
+
+		int ClipTriangle(const float* pVertex0, const float* pVertex1, const float* pVertex2, int floatCount, uint8_t planes,
+			const GuardBand& guardBand, float(*pPolygon)[maxFloats])
+		{
+			//Ping-pong between the output and a scratch polygon, the last plane clipped must land in the output
+			float scratch[maxPolygonVertices][maxFloats];
+			int planeCount{};
+			for (const uint8_t plane : planeOrder)
+			{
+				planeCount += (planes & plane) ? 1 : 0;
+			}
+			float(*pSource)[maxFloats]{ planeCount % 2 ? scratch : pPolygon };
+			float(*pTarget)[maxFloats]{ planeCount % 2 ? pPolygon : scratch };
+
+			std::copy_n(pVertex0, floatCount, pSource[0]);
+			std::copy_n(pVertex1, floatCount, pSource[1]);
+			std::copy_n(pVertex2, floatCount, pSource[2]);
+			int count{ 3 };
+
+			for (const uint8_t plane : planeOrder)
+			{
+				if (!(planes & plane))
+				{
+					continue;
+				}
+
+				int clippedCount{};
+				for (int i{}; i < count; ++i)
+				{
+					const float* pCurrent{ pSource[i] };
+					const float* pNext{ pSource[(i + 1) % count] };
+					const float currentDistance{ Distance(pCurrent, plane, guardBand) };
+					const float nextDistance{ Distance(pNext, plane, guardBand) };
+
+					if (currentDistance >= 0.f)
+					{
+						std::copy_n(pCurrent, floatCount, pTarget[clippedCount++]);
+					}
+					if ((currentDistance >= 0.f) != (nextDistance >= 0.f))
+					{
+						//Always from the inside vertex, so neighbours sharing the edge get the exact same point and no cracks
+						if (currentDistance >= 0.f)
+						{
+							Lerp(pCurrent, pNext, currentDistance / (currentDistance - nextDistance), floatCount, pTarget[clippedCount++]);
+						}
+						else
+						{
+							Lerp(pNext, pCurrent, nextDistance / (nextDistance - currentDistance), floatCount, pTarget[clippedCount++]);
+						}
+					}
+				}
+
+				count = clippedCount;
+				std::swap(pSource, pTarget);
+				if (count < 3)
+				{
+					return 0;
+				}
+			}
+			return count;
+		}
+
+		RasterKernel::ScreenVertex ToScreen(const float* pPosition, int width, int height)
+		{
+			const float invW{ 1.f / pPosition[3] };
+			return { (pPosition[0] * invW * 0.5f + 0.5f) * static_cast<float>(width), (0.5f - pPosition[1] * invW * 0.5f) * static_cast<float>(height),
+				pPosition[2] * invW, invW };
+		}
+	}
+}
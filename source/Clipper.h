@@ -0,0 +1,56 @@
+#pragma once
+#include <cstdint>
+
+#include "RasterKernel.h"
+
+//Homogeneous clipping for the CPU rasterizers. Only near and far are clipped for real: x and y are
+//left to the rasterizer's viewport scissor as long as a triangle stays inside a guard band many
+//viewports wide, which keeps almost every triangle that crosses a screen edge off the slow path.
+//Outcodes are computed for whole streams of clip-space positions, 8 at a time with AVX2.
+namespace dae
+{
+	namespace Clipping
+	{
+		//Outcode bits, a vertex is outside the plane when its bit is set
+		constexpr uint8_t nearPlane{ 1 << 0 }; //z < 0, D3D clips to 0 <= z <= w
+		constexpr uint8_t farPlane{ 1 << 1 };  //z > w
+		constexpr uint8_t leftPlane{ 1 << 2 }; //x < -guardBand.x * w
+		constexpr uint8_t rightPlane{ 1 << 3 };
+		constexpr uint8_t bottomPlane{ 1 << 4 };
+		constexpr uint8_t topPlane{ 1 << 5 };
+
+		//Floats per clipped vertex: x, y, z, w and up to 28 attributes
+		constexpr int maxFloats{ 32 };
+		//Every plane can add one vertex to the triangle
+		constexpr int maxPolygonVertices{ 3 + 6 };
+
+		//In NDC units, 1 is the viewport edge
+		struct GuardBand
+		{
+			float x{ 1.f };
+			float y{ 1.f };
+
+			//As wide as the rasterizer takes, RasterKernel::maxCoordinate pixels
+			static GuardBand ForViewport(int width, int height);
+		};
+
+		//Outcodes of count clip-space positions given as separate x, y, z and w arrays, AVX2 when available
+		void ComputeOutcodes(const float* pX, const float* pY, const float* pZ, const float* pW, size_t count,
+			const GuardBand& guardBand, uint8_t* pOutcodes);
+		void ComputeOutcodesScalar(const float* pX, const float* pY, const float* pZ, const float* pW, size_t count,
+			const GuardBand& guardBand, uint8_t* pOutcodes);
+
+		//Trivially rejected when all three are outside the same plane, accepted when none is outside any
+		inline bool IsOutside(uint8_t outcode0, uint8_t outcode1, uint8_t outcode2) { return (outcode0 & outcode1 & outcode2) != 0; }
+		inline bool NeedsClipping(uint8_t outcode0, uint8_t outcode1, uint8_t outcode2) { return (outcode0 | outcode1 | outcode2) != 0; }
+
+		//Sutherland-Hodgman against the planes in planes (the OR of the outcodes). Every vertex is floatCount floats,
+		//x, y, z, w first, the rest are attributes interpolated in clip space like the position.
+		//The polygon keeps the triangle's winding, draw it as a fan; returns its vertex count, below 3 means nothing is left
+		int ClipTriangle(const float* pVertex0, const float* pVertex1, const float* pVertex2, int floatCount, uint8_t planes,
+			const GuardBand& guardBand, float(*pPolygon)[maxFloats]);
+
+		//Perspective divide and viewport transform of a clipped vertex
+		RasterKernel::ScreenVertex ToScreen(const float* pPosition, int width, int height);
+	}
+}
@@ -0,0 +1,261 @@
+#include "pch.h"
+#include "ColorSpace.h"
+#include <array>
+#include <cmath>
+#include <emmintrin.h>
+
+namespace dae
+{
+	namespace ColorConversion
+	{
+		namespace
+		{
+			//LinearToSrgb8 buckets: every float in [2^-13, 1) by exponent and top 8 mantissa bits.
+			//Below 2^-13 the result rounds to 0 anyway
+			constexpr uint32_t bucketBase{ 0x39000000 }; //2^-13
+			constexpr uint32_t bucketShift{ 15 };
+			constexpr uint32_t lastBelowOne{ 0x3F7FFFFF };
+			constexpr size_t bucketCount{ ((lastBelowOne - bucketBase) >> bucketShift) + 1 };
+
+			float FromBits(uint32_t bits)
+			{
+				float value;
+				memcpy(&value, &bits, sizeof(value));
+				return value;
+			}
+
+			const std::array<uint8_t, bucketCount>& GetLinearToSrgb8Table()
+			{
+				static const std::array<uint8_t, bucketCount> table{ []
+					{
+						std::array<uint8_t, bucketCount> result{};
+						for (uint32_t i{}; i < bucketCount; ++i)
+						{
+							//Middle of the bucket keeps the error symmetric
+							const uint32_t low{ bucketBase + (i << bucketShift) };
+							const float middle{ (FromBits(low) + FromBits(low + (1u << bucketShift) - 1)) * 0.5f };
+							result[i] = static_cast<uint8_t>(LinearToSrgb(middle) * 255.f + 0.5f);
+						}
+						return result;
+					}() };
+				return table;
+			}
+
+			//Clamps to [0, 1) and turns the float bits into a bucket index, one per lane
+			__m128i GetBuckets(__m128 value)
+			{
+				value = _mm_max_ps(value, _mm_castsi128_ps(_mm_set1_epi32(bucketBase)));
+				value = _mm_min_ps(value, _mm_castsi128_ps(_mm_set1_epi32(lastBelowOne)));
+				return _mm_srli_epi32(_mm_sub_epi32(_mm_castps_si128(value), _mm_set1_epi32(bucketBase)), bucketShift);
+			}
+
+			//Polynomial log2/exp2 for pow on [0, 1], relative error around 1e-7
+			__m128 Log2(__m128 x)
+			{
+				const __m128i bits{ _mm_castps_si128(x) };
+				const __m128 exponent{ _mm_cvtepi32_ps(_mm_sub_epi32(_mm_srli_epi32(bits, 23), _mm_set1_epi32(127))) };
+				const __m128 mantissa{ _mm_castsi128_ps(_mm_or_si128(_mm_and_si128(bits, _mm_set1_epi32(0x007FFFFF)), _mm_set1_epi32(0x3F800000))) };
+				const __m128 t{ _mm_sub_ps(mantissa, _mm_set1_ps(1.f)) };
+
+				//log2(1 + t) / t
+				__m128 p{ _mm_set1_ps(-0.012077020f) };
+				p = _mm_add_ps(_mm_mul_ps(p, t), _mm_set1_ps(0.062748432f));
+				p = _mm_add_ps(_mm_mul_ps(p, t), _mm_set1_ps(-0.154152006f));
+				p = _mm_add_ps(_mm_mul_ps(p, t), _mm_set1_ps(0.255176336f));
+				p = _mm_add_ps(_mm_mul_ps(p, t), _mm_set1_ps(-0.353096366f));
+				p = _mm_add_ps(_mm_mul_ps(p, t), _mm_set1_ps(0.480012447f));
+				p = _mm_add_ps(_mm_mul_ps(p, t), _mm_set1_ps(-0.721306741f));
+				p = _mm_add_ps(_mm_mul_ps(p, t), _mm_set1_ps(1.442694783f));
+				return _mm_add_ps(exponent, _mm_mul_ps(p, t));
+			}
+
+			__m128 Exp2(__m128 x)
+			{
+				x = _mm_max_ps(x, _mm_set1_ps(-126.f));
+				const __m128i whole{ _mm_cvttps_epi32(x) };
+				//Truncation rounds negative values up, step back so the fraction is in [0, 1)
+				const __m128 truncated{ _mm_cvtepi32_ps(whole) };
+				const __m128 stepBack{ _mm_and_ps(_mm_cmpgt_ps(truncated, x), _mm_set1_ps(1.f)) };
+				const __m128 floor{ _mm_sub_ps(truncated, stepBack) };
+				const __m128 fraction{ _mm_sub_ps(x, floor) };
+
+				__m128 p{ _mm_set1_ps(0.001893754f) };
+				p = _mm_add_ps(_mm_mul_ps(p, fraction), _mm_set1_ps(0.008949591f));
+				p = _mm_add_ps(_mm_mul_ps(p, fraction), _mm_set1_ps(0.055860337f));
+				p = _mm_add_ps(_mm_mul_ps(p, fraction), _mm_set1_ps(0.240141824f));
+				p = _mm_add_ps(_mm_mul_ps(p, fraction), _mm_set1_ps(0.693154514f));
+				p = _mm_add_ps(_mm_mul_ps(p, fraction), _mm_set1_ps(0.999999881f));
+
+				const __m128i scale{ _mm_slli_epi32(_mm_add_epi32(_mm_cvttps_epi32(floor), _mm_set1_epi32(127)), 23) };
+				return _mm_mul_ps(p, _mm_castsi128_ps(scale));
+			}
+
+			__m128 Pow(__m128 x, float exponent)
+			{
+				//log2 of 0 is garbage, those lanes are fixed up by the linear segment anyway
+				const __m128 safe{ _mm_max_ps(x, _mm_set1_ps(FLT_MIN)) };
+				return Exp2(_mm_mul_ps(Log2(safe), _mm_set1_ps(exponent)));
+			}
+
+			__m128 Select(__m128 mask, __m128 ifTrue, __m128 ifFalse)
+			{
+				return _mm_or_ps(_mm_and_ps(mask, ifTrue), _mm_andnot_ps(mask, ifFalse));
+			}
+
+			__m128 Saturate(__m128 x)
+			{
+				return _mm_min_ps(_mm_max_ps(x, _mm_setzero_ps()), _mm_set1_ps(1.f));
+			}
+
+			__m128 SrgbToLinear(__m128 srgb)
+			{
+				srgb = Saturate(srgb);
+				const __m128 linear{ _mm_mul_ps(srgb, _mm_set1_ps(1.f / 12.92f)) };
+				const __m128 curve{ Pow(_mm_mul_ps(_mm_add_ps(srgb, _mm_set1_ps(0.055f)), _mm_set1_ps(1.f / 1.055f)), 2.4f) };
+				return Select(_mm_cmple_ps(srgb, _mm_set1_ps(0.04045f)), linear, curve);
+			}
+
+			__m128 LinearToSrgb(__m128 linear)
+			{
+				linear = Saturate(linear);
+				const __m128 scaled{ _mm_mul_ps(linear, _mm_set1_ps(12.92f)) };
+				const __m128 curve{ _mm_sub_ps(_mm_mul_ps(Pow(linear, 1.f / 2.4f), _mm_set1_ps(1.055f)), _mm_set1_ps(0.055f)) };
+				return Select(_mm_cmple_ps(linear, _mm_set1_ps(0.0031308f)), scaled, curve);
+			}
+
+			//Lanes 0-2 from converted, lane 3 (alpha) from original
+			__m128 KeepAlpha(__m128 converted, __m128 original)
+			{
+				return Select(_mm_castsi128_ps(_mm_setr_epi32(-1, -1, -1, 0)), converted, original);
+			}
+		}
+
+		float SrgbToLinear(float value)
+		{
+			return value <= 0.04045f ? value / 12.92f : powf((value + 0.055f) / 1.055f, 2.4f);
+		}
+
+		float LinearToSrgb(float value)
+		{
+			return value <= 0.0031308f ? value * 12.92f : 1.055f * powf(value, 1.f / 2.4f) - 0.055f;
+		}
+
+		const float* GetSrgb8ToLinearTable()
+		{
+			static const std::array<float, 256> table{ []
+				{
+					std::array<float, 256> result{};
+					for (int i{}; i < 256; ++i)
+					{
+						result[i] = SrgbToLinear(i / 255.f);
+					}
+					return result;
+				}() };
+			return table.data();
+		}
+
+		uint8_t LinearToSrgb8(float value)
+		{
+			if (!(value > 0.f))
+			{
+				return 0;
+			}
+			if (value >= 1.f)
+			{
+				return 255;
+			}
+
+			uint32_t bits;
+			memcpy(&bits, &value, sizeof(bits));
+			return GetLinearToSrgb8Table()[(std::max(bits, bucketBase) - bucketBase) >> bucketShift];
+		}
+
+		void SrgbToLinear(const uint8_t* pSource, float* pDestination, size_t count)
+		{
+			const float* pTable{ GetSrgb8ToLinearTable() };
+			for (size_t i{}; i < count; ++i)
+			{
+				const uint8_t* pTexel{ pSource + i * 4 };
+				_mm_storeu_ps(pDestination + i * 4, _mm_setr_ps(pTable[pTexel[0]], pTable[pTexel[1]], pTable[pTexel[2]], pTexel[3] * (1.f / 255.f)));
+			}
+		}
+
+		void LinearToSrgb(const float* pSource, uint8_t* pDestination, size_t count)
+		{
+			const uint8_t* pTable{ GetLinearToSrgb8Table().data() };
+			const __m128 scale{ _mm_set1_ps(255.f) };
+			const __m128 half{ _mm_set1_ps(0.5f) };
+
+			for (size_t i{}; i < count; ++i)
+			{
+				const __m128 texel{ _mm_loadu_ps(pSource + i * 4) };
+
+				alignas(16) uint32_t buckets[4];
+				_mm_store_si128(reinterpret_cast<__m128i*>(buckets), GetBuckets(texel));
+				const int alpha{ _mm_cvttss_si32(_mm_add_ss(_mm_mul_ss(Saturate(_mm_shuffle_ps(texel, texel, _MM_SHUFFLE(3, 3, 3, 3))), scale), half)) };
+
+				//Buckets clamp to [2^-13, 1), zero and negative inputs land in bucket 0 which is code 0
+				uint8_t* pTexel{ pDestination + i * 4 };
+				pTexel[0] = pTable[buckets[0]];
+				pTexel[1] = pTable[buckets[1]];
+				pTexel[2] = pTable[buckets[2]];
+				pTexel[3] = static_cast<uint8_t>(alpha);
+			}
+		}
+
+		void SrgbToLinear(const float* pSource, float* pDestination, size_t count)
+		{
+			for (size_t i{}; i < count; ++i)
+			{
+				const __m128 texel{ _mm_loadu_ps(pSource + i * 4) };
+				_mm_storeu_ps(pDestination + i * 4, KeepAlpha(SrgbToLinear(texel), texel));
+			}
+		}
+
+		void LinearToSrgb(const float* pSource, float* pDestination, size_t count)
+		{
+			for (size_t i{}; i < count; ++i)
+			{
+				const __m128 texel{ _mm_loadu_ps(pSource + i * 4) };
+				_mm_storeu_ps(pDestination + i * 4, KeepAlpha(LinearToSrgb(texel), texel));
+			}
+		}
+
+		namespace Reference
+		{
+			void SrgbToLinear(const uint8_t* pSource, float* pDestination, size_t count)
+			{
+				for (size_t i{}; i < count * 4; ++i)
+				{
+					pDestination[i] = (i % 4 == 3) ? pSource[i] / 255.f : ColorConversion::SrgbToLinear(pSource[i] / 255.f);
+				}
+			}
+
+			void LinearToSrgb(const float* pSource, uint8_t* pDestination, size_t count)
+			{
+				for (size_t i{}; i < count * 4; ++i)
+				{
+					const float value{ std::clamp(pSource[i], 0.f, 1.f) };
+					const float encoded{ (i % 4 == 3) ? value : ColorConversion::LinearToSrgb(value) };
+					pDestination[i] = static_cast<uint8_t>(encoded * 255.f + 0.5f);
+				}
+			}
+
+			void SrgbToLinear(const float* pSource, float* pDestination, size_t count)
+			{
+				for (size_t i{}; i < count * 4; ++i)
+				{
+					pDestination[i] = (i % 4 == 3) ? pSource[i] : ColorConversion::SrgbToLinear(std::clamp(pSource[i], 0.f, 1.f));
+				}
+			}
+
+			void LinearToSrgb(const float* pSource, float* pDestination, size_t count)
+			{
+				for (size_t i{}; i < count * 4; ++i)
+				{
+					pDestination[i] = (i % 4 == 3) ? pSource[i] : ColorConversion::LinearToSrgb(std::clamp(pSource[i], 0.f, 1.f));
+				}
+			}
+		}
+	}
+}
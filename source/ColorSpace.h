@@ -0,0 +1,41 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+
+namespace dae
+{
+	//How a texture's RGB channels are encoded, alpha is always linear
+	enum class ColorSpace : uint8_t
+	{
+		Linear, //data maps (normals, gloss, specular) and anything already linear
+		sRGB    //authored colors, decoded before they are filtered, blended or lit
+	};
+
+	namespace ColorConversion
+	{
+		//Exact IEC 61966-2-1 transfer functions
+		float SrgbToLinear(float value);
+		float LinearToSrgb(float value);
+
+		//256 entries, sRGB8 code -> linear [0, 1]
+		const float* GetSrgb8ToLinearTable();
+		inline float Srgb8ToLinear(uint8_t value) { return GetSrgb8ToLinearTable()[value]; }
+		//Table lookup on the float's exponent and top mantissa bits, clamps to [0, 1]
+		uint8_t LinearToSrgb8(float value);
+
+		//RGBA buffers, count is in texels. Alpha is only rescaled between UNORM8 and float, never converted
+		void SrgbToLinear(const uint8_t* pSource, float* pDestination, size_t count);
+		void LinearToSrgb(const float* pSource, uint8_t* pDestination, size_t count);
+		void SrgbToLinear(const float* pSource, float* pDestination, size_t count);
+		void LinearToSrgb(const float* pSource, float* pDestination, size_t count);
+
+		//Same buffers through pow per channel, ground truth for the fast paths
+		namespace Reference
+		{
+			void SrgbToLinear(const uint8_t* pSource, float* pDestination, size_t count);
+			void LinearToSrgb(const float* pSource, uint8_t* pDestination, size_t count);
+			void SrgbToLinear(const float* pSource, float* pDestination, size_t count);
+			void LinearToSrgb(const float* pSource, float* pDestination, size_t count);
+		}
+	}
+}
@@ -0,0 +1,657 @@
+#include "pch.h"
+#include "D3D11RenderDevice.h"
+#include "Texture.h"
+#include "Effect.h"
+
+#define DEBUG
+
+namespace dae
+{
+	namespace
+	{
+		//Handles are 1-based slots of the table
+		template<typename T, typename Tag>
+		T* FindSlot(std::vector<T>& table, DeviceHandle<Tag> handle)
+		{
+			return handle.IsValid() && handle.id <= table.size() ? &table[handle.id - 1] : nullptr;
+		}
+
+		template<typename T, typename Tag>
+		const T* FindSlot(const std::vector<T>& table, DeviceHandle<Tag> handle)
+		{
+			return handle.IsValid() && handle.id <= table.size() ? &table[handle.id - 1] : nullptr;
+		}
+
+		//Applies every pass of the technique in turn and draws with it
+		template<typename Draw>
+		void DrawPasses(ID3DX11EffectTechnique* pTechnique, ID3D11DeviceContext* pDeviceContext, const Draw& draw)
+		{
+			D3DX11_TECHNIQUE_DESC techDesc{};
+			pTechnique->GetDesc(&techDesc);
+			for (UINT p{ 0 }; p < techDesc.Passes; ++p)
+			{
+				pTechnique->GetPassByIndex(p)->Apply(0, pDeviceContext);
+				draw();
+			}
+		}
+	}
+
+	std::unique_ptr<D3D11RenderDevice> D3D11RenderDevice::Create(SDL_Window* pWindow, uint32_t gpuIndex)
+	{
+		std::unique_ptr<D3D11RenderDevice> pDevice{ new D3D11RenderDevice{} };
+		if (FAILED(pDevice->Initialize(pWindow, gpuIndex)))
+		{
+			std::cout << "DirectX initialization failed!\n";
+			return {};
+		}
+		std::cout << "DirectX is initialized and ready!\n";
+		return pDevice;
+	}
+
+	D3D11RenderDevice::~D3D11RenderDevice()
+	{
+		for (const Buffer& buffer : m_Buffers)
+		{
+			if (buffer.pBuffer)
+			{
+				buffer.pBuffer->Release();
+			}
+		}
+		for (ID3D11SamplerState* pSampler : m_Samplers)
+		{
+			if (pSampler)
+			{
+				pSampler->Release();
+			}
+		}
+		for (ID3D11RasterizerState* pRasterizer : m_Rasterizers)
+		{
+			if (pRasterizer)
+			{
+				pRasterizer->Release();
+			}
+		}
+		for (const Program& program : m_Programs)
+		{
+			if (program.pInputLayout)
+			{
+				program.pInputLayout->Release();
+			}
+		}
+		m_Programs.clear();
+		m_Textures.clear();
+
+		if (m_pRenderTargetView)
+		{
+			m_pRenderTargetView->Release();
+		}
+		if (m_pRenderTargetBuffer)
+		{
+			m_pRenderTargetBuffer->Release();
+		}
+		if (m_pDepthStencilView)
+		{
+			m_pDepthStencilView->Release();
+		}
+		if (m_pDepthStencilBuffer)
+		{
+			m_pDepthStencilBuffer->Release();
+		}
+		if (m_pSwapChain)
+		{
+			m_pSwapChain->Release();
+		}
+		if (m_pDeviceContext)
+		{
+			m_pDeviceContext->ClearState();
+			m_pDeviceContext->Flush();
+			m_pDeviceContext->Release();
+		}
+		if (m_pDevice)
+		{
+			m_pDevice->Release();
+		}
+	}
+
+	HRESULT D3D11RenderDevice::Initialize(SDL_Window* pWindow, uint32_t gpuIndex)
+	{
+		SDL_GetWindowSize(pWindow, &m_Width, &m_Height);
+
+		///1. Create Device & DeviceContext
+		D3D_FEATURE_LEVEL featureLevel = D3D_FEATURE_LEVEL_11_1;
+		uint32_t createDeviceFlags = 0;
+#if defined(DEBUG) || defined(_DEBUG)
+		createDeviceFlags |= D3D11_CREATE_DEVICE_DEBUG;
+#endif
+
+		IDXGIFactory1* pFactory = nullptr;
+		HRESULT hr = CreateDXGIFactory1(__uuidof(IDXGIFactory1), (void**)&pFactory);
+
+		HRESULT result{};
+
+		if (SUCCEEDED(hr))
+		{
+			IDXGIAdapter1* pAdapter = nullptr;
+
+			hr = pFactory->EnumAdapters1(gpuIndex, &pAdapter);
+			if (SUCCEEDED(hr))
+			{
+				// Create device and context on the second GPU
+				result = D3D11CreateDevice(pAdapter, D3D_DRIVER_TYPE_UNKNOWN, nullptr, createDeviceFlags, &featureLevel, 1, D3D11_SDK_VERSION, &m_pDevice, nullptr, &m_pDeviceContext);
+
+				if (FAILED(result))
+				{
+					return result;
+				}
+
+				pAdapter->Release();
+			}
+
+			pFactory->Release();
+		}
+
+		
+
+		IDXGIFactory1* pDxgiFactory{ nullptr };
+		result = CreateDXGIFactory1(__uuidof(IDXGIFactory1), reinterpret_cast<void**>(&pDxgiFactory));
+		if (FAILED(result))
+		{
+			return result;
+		}
+
+		///2. Create swapchain
+
+		//Set properties of swapchain
+		DXGI_SWAP_CHAIN_DESC swapChainDesc{};
+		swapChainDesc.BufferDesc.Width = m_Width;
+		swapChainDesc.BufferDesc.Height = m_Height;
+		swapChainDesc.BufferDesc.RefreshRate.Numerator = 1;
+		swapChainDesc.BufferDesc.RefreshRate.Denominator = 60;
+		swapChainDesc.BufferDesc.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
+		swapChainDesc.BufferDesc.ScanlineOrdering = DXGI_MODE_SCANLINE_ORDER_UNSPECIFIED;
+		swapChainDesc.BufferDesc.Scaling = DXGI_MODE_SCALING_UNSPECIFIED;
+		swapChainDesc.SampleDesc.Count = 1;
+		swapChainDesc.SampleDesc.Quality = 0;
+		swapChainDesc.BufferUsage = DXGI_USAGE_RENDER_TARGET_OUTPUT;
+		swapChainDesc.BufferCount = 1;
+		swapChainDesc.Windowed = true;
+		swapChainDesc.SwapEffect = DXGI_SWAP_EFFECT_DISCARD;
+		swapChainDesc.Flags = 0;
+
+		//Get the handle (HWND) from the SDL Backbuffer
+		SDL_SysWMinfo sysWMInfo{};
+		SDL_VERSION(&sysWMInfo.version);
+		SDL_GetWindowWMInfo(pWindow, &sysWMInfo);
+		swapChainDesc.OutputWindow = sysWMInfo.info.win.window;
+
+		//Create swapchain
+		result = pDxgiFactory->CreateSwapChain(m_pDevice, &swapChainDesc, &m_pSwapChain);
+		if (FAILED(result))
+		{
+			return result;
+		}
+
+		///3. Create DepthStencil (DS) & DepthStencilView (DSV)
+
+		//Set properties of depthstencil
+		D3D11_TEXTURE2D_DESC depthStencilDesc{};
+		depthStencilDesc.Width = m_Width;
+		depthStencilDesc.Height = m_Height;
+		depthStencilDesc.MipLevels = 1;
+		depthStencilDesc.ArraySize = 1;
+		depthStencilDesc.Format = DXGI_FORMAT_D24_UNORM_S8_UINT;
+		depthStencilDesc.SampleDesc.Count = 1;
+		depthStencilDesc.SampleDesc.Quality = 0;
+		depthStencilDesc.Usage = D3D11_USAGE_DEFAULT;
+		depthStencilDesc.BindFlags = D3D11_BIND_DEPTH_STENCIL;
+		depthStencilDesc.CPUAccessFlags = 0;
+		depthStencilDesc.MiscFlags = 0;
+
+		//View
+		D3D11_DEPTH_STENCIL_VIEW_DESC depthStencilViewDesc{};
+		depthStencilViewDesc.Format = depthStencilDesc.Format;
+		depthStencilViewDesc.ViewDimension = D3D11_DSV_DIMENSION_TEXTURE2D;
+		depthStencilViewDesc.Texture2D.MipSlice = 0;
+
+		result = m_pDevice->CreateTexture2D(&depthStencilDesc, nullptr, &m_pDepthStencilBuffer);
+		if (FAILED(result))
+		{
+			return result;
+		}
+
+		result = m_pDevice->CreateDepthStencilView(m_pDepthStencilBuffer, &depthStencilViewDesc, &m_pDepthStencilView);
+		if (FAILED(result))
+		{
+			return result;
+		}
+
+		///4. Create RenderTarget (RT) and RenderTargetView (RTV)
+		result = m_pSwapChain->GetBuffer(0, __uuidof(ID3D11Texture2D), reinterpret_cast<void**>(&m_pRenderTargetBuffer));
+		if (FAILED(result))
+		{
+			return result;
+		}
+
+		//View, _SRGB so shaders write linear light and blending happens in linear space
+		D3D11_RENDER_TARGET_VIEW_DESC renderTargetViewDesc{};
+		renderTargetViewDesc.Format = DXGI_FORMAT_R8G8B8A8_UNORM_SRGB;
+		renderTargetViewDesc.ViewDimension = D3D11_RTV_DIMENSION_TEXTURE2D;
+		renderTargetViewDesc.Texture2D.MipSlice = 0;
+
+		result = m_pDevice->CreateRenderTargetView(m_pRenderTargetBuffer, &renderTargetViewDesc, &m_pRenderTargetView);
+		if (FAILED(result))
+		{
+			return result;
+		}
+
+		///5. Bind RTV and DSV to Output Merger Stage
+		m_pDeviceContext->OMSetRenderTargets(1, &m_pRenderTargetView, m_pDepthStencilView);
+
+		///6. Set viewport
+		D3D11_VIEWPORT viewport{};
+		viewport.Width = static_cast<FLOAT>(m_Width);
+		viewport.Height = static_cast<FLOAT>(m_Height);
+		viewport.TopLeftX = 0;
+		viewport.TopLeftY = 0;
+		viewport.MinDepth = 0;
+		viewport.MaxDepth = 1;
+		m_pDeviceContext->RSSetViewports(1, &viewport);
+		return S_OK;
+	}
+
+	BufferHandle D3D11RenderDevice::CreateBuffer(const BufferDesc& desc, const void* pData)
+	{
+		const bool dynamic{ desc.usage == BufferUsage::Dynamic };
+		D3D11_BUFFER_DESC bd{};
+		bd.Usage = dynamic ? D3D11_USAGE_DYNAMIC : D3D11_USAGE_IMMUTABLE;
+		bd.ByteWidth = desc.byteWidth;
+		bd.BindFlags = desc.binding == BufferBinding::Index ? D3D11_BIND_INDEX_BUFFER : D3D11_BIND_VERTEX_BUFFER;
+		bd.CPUAccessFlags = dynamic ? D3D11_CPU_ACCESS_WRITE : 0;
+		bd.MiscFlags = 0;
+
+		D3D11_SUBRESOURCE_DATA initData{};
+		initData.pSysMem = pData;
+
+		ID3D11Buffer* pBuffer{};
+		if (desc.byteWidth == 0 || FAILED(m_pDevice->CreateBuffer(&bd, pData ? &initData : nullptr, &pBuffer)))
+		{
+			return {};
+		}
+		m_Buffers.push_back({ pBuffer, desc });
+		return { static_cast<uint32_t>(m_Buffers.size()) };
+	}
+
+	void D3D11RenderDevice::ReleaseBuffer(BufferHandle buffer)
+	{
+		if (Buffer* pSlot{ FindSlot(m_Buffers, buffer) }; pSlot && pSlot->pBuffer)
+		{
+			pSlot->pBuffer->Release();
+			pSlot->pBuffer = nullptr;
+		}
+	}
+
+	void* D3D11RenderDevice::Map(BufferHandle buffer)
+	{
+		const Buffer* pSlot{ FindBuffer(buffer) };
+		D3D11_MAPPED_SUBRESOURCE mapped{};
+		if (!pSlot || pSlot->desc.usage != BufferUsage::Dynamic
+			|| FAILED(m_pDeviceContext->Map(pSlot->pBuffer, 0, D3D11_MAP_WRITE_DISCARD, 0, &mapped)))
+		{
+			return nullptr;
+		}
+		return mapped.pData;
+	}
+
+	void D3D11RenderDevice::Unmap(BufferHandle buffer)
+	{
+		if (const Buffer* pSlot{ FindBuffer(buffer) })
+		{
+			m_pDeviceContext->Unmap(pSlot->pBuffer, 0);
+		}
+	}
+
+	TextureHandle D3D11RenderDevice::CreateTexture(const TextureDesc& desc, const std::vector<const void*>& mips)
+	{
+		const int sliceCount{ std::max(desc.arraySize, 1) };
+		if (!mips.empty() && static_cast<int>(mips.size()) != desc.mipLevels * sliceCount)
+		{
+			return {};
+		}
+		std::vector<D3D11_SUBRESOURCE_DATA> initData(mips.size());
+		for (size_t i{}; i < mips.size(); ++i)
+		{
+			const int mip{ static_cast<int>(i) % desc.mipLevels };
+			const int width{ std::max(desc.width >> mip, 1) };
+			const int height{ std::max(desc.height >> mip, 1) };
+			initData[i].pSysMem = mips[i];
+			initData[i].SysMemPitch = static_cast<UINT>(width * GetTexelSize(desc.format));
+			initData[i].SysMemSlicePitch = static_cast<UINT>(width * height * GetTexelSize(desc.format));
+		}
+
+		auto pTexture{ std::make_unique<Texture>(m_pDevice, desc.width, desc.height, desc.mipLevels, desc.arraySize,
+			initData.empty() ? nullptr : initData.data(), desc.colorSpace, desc.format) };
+		if (!pTexture->GetSRV())
+		{
+			return {};
+		}
+		m_Textures.push_back({ std::move(pTexture), desc });
+		return { static_cast<uint32_t>(m_Textures.size()) };
+	}
+
+	void D3D11RenderDevice::ReleaseTexture(TextureHandle texture)
+	{
+		if (TextureSlot* pSlot{ FindSlot(m_Textures, texture) })
+		{
+			pSlot->pTexture.reset();
+		}
+	}
+
+	void D3D11RenderDevice::UpdateTexture(TextureHandle texture, int mip, const void* pData)
+	{
+		const TextureSlot* pSlot{ FindTexture(texture) };
+		if (!pSlot || pSlot->desc.arraySize > 0 || mip < 0 || mip >= pSlot->desc.mipLevels || !pData)
+		{
+			return;
+		}
+		const int width{ std::max(pSlot->desc.width >> mip, 1) };
+		m_pDeviceContext->UpdateSubresource(pSlot->pTexture->GetTexture2D(), static_cast<UINT>(mip), nullptr, pData,
+			static_cast<UINT>(width * GetTexelSize(pSlot->desc.format)), 0);
+	}
+
+	void D3D11RenderDevice::CopyTextureLevels(TextureHandle source, int sourceMip, TextureHandle destination, int destinationMip, int count)
+	{
+		const TextureSlot* pSource{ FindTexture(source) };
+		const TextureSlot* pDestination{ FindTexture(destination) };
+		if (!pSource || !pDestination)
+		{
+			return;
+		}
+		for (int level{}; level < count; ++level)
+		{
+			m_pDeviceContext->CopySubresourceRegion(pDestination->pTexture->GetTexture2D(), static_cast<UINT>(destinationMip + level), 0, 0, 0,
+				pSource->pTexture->GetTexture2D(), static_cast<UINT>(sourceMip + level), nullptr);
+		}
+	}
+
+	SamplerHandle D3D11RenderDevice::CreateSampler(const SamplerDesc& desc)
+	{
+		D3D11_SAMPLER_DESC samplerDesc{};
+		switch (desc.filter)
+		{
+		case SamplerFilter::Point: samplerDesc.Filter = D3D11_FILTER_MIN_MAG_MIP_POINT; break;
+		case SamplerFilter::Linear: samplerDesc.Filter = D3D11_FILTER_MIN_MAG_MIP_LINEAR; break;
+		case SamplerFilter::Anisotropic: samplerDesc.Filter = D3D11_FILTER_ANISOTROPIC; break;
+		}
+		samplerDesc.AddressU = D3D11_TEXTURE_ADDRESS_WRAP;
+		samplerDesc.AddressV = D3D11_TEXTURE_ADDRESS_WRAP;
+		samplerDesc.AddressW = D3D11_TEXTURE_ADDRESS_WRAP;
+		samplerDesc.ComparisonFunc = D3D11_COMPARISON_NEVER;
+		samplerDesc.MipLODBias = 0;
+		samplerDesc.MinLOD = 0;
+		samplerDesc.MaxLOD = D3D11_FLOAT32_MAX;
+		samplerDesc.MaxAnisotropy = desc.maxAnisotropy;
+
+		ID3D11SamplerState* pSampler{};
+		if (FAILED(m_pDevice->CreateSamplerState(&samplerDesc, &pSampler)))
+		{
+			return {};
+		}
+		m_Samplers.push_back(pSampler);
+		return { static_cast<uint32_t>(m_Samplers.size()) };
+	}
+
+	void D3D11RenderDevice::ReleaseSampler(SamplerHandle sampler)
+	{
+		if (ID3D11SamplerState** pSlot{ FindSlot(m_Samplers, sampler) }; pSlot && *pSlot)
+		{
+			(*pSlot)->Release();
+			*pSlot = nullptr;
+		}
+	}
+
+	RasterizerHandle D3D11RenderDevice::CreateRasterizer(const RasterizerDesc& desc)
+	{
+		D3D11_RASTERIZER_DESC rasterizerDesc{};
+		rasterizerDesc.FillMode = D3D11_FILL_SOLID;
+		switch (desc.culling)
+		{
+		case FaceCulling::Back: rasterizerDesc.CullMode = D3D11_CULL_BACK; break;
+		case FaceCulling::Front: rasterizerDesc.CullMode = D3D11_CULL_FRONT; break;
+		case FaceCulling::None: rasterizerDesc.CullMode = D3D11_CULL_NONE; break;
+		}
+		rasterizerDesc.FrontCounterClockwise = false;
+		rasterizerDesc.DepthBias = 0;
+		rasterizerDesc.SlopeScaledDepthBias = 0.0f;
+		rasterizerDesc.DepthBiasClamp = 0.0f;
+		rasterizerDesc.DepthClipEnable = true;
+		rasterizerDesc.ScissorEnable = false;
+		rasterizerDesc.MultisampleEnable = false;
+		rasterizerDesc.AntialiasedLineEnable = false;
+
+		ID3D11RasterizerState* pRasterizer{};
+		if (FAILED(m_pDevice->CreateRasterizerState(&rasterizerDesc, &pRasterizer)))
+		{
+			return {};
+		}
+		m_Rasterizers.push_back(pRasterizer);
+		return { static_cast<uint32_t>(m_Rasterizers.size()) };
+	}
+
+	void D3D11RenderDevice::ReleaseRasterizer(RasterizerHandle rasterizer)
+	{
+		if (ID3D11RasterizerState** pSlot{ FindSlot(m_Rasterizers, rasterizer) }; pSlot && *pSlot)
+		{
+			(*pSlot)->Release();
+			*pSlot = nullptr;
+		}
+	}
+
+	ProgramHandle D3D11RenderDevice::CreateProgram(const ProgramDesc& desc)
+	{
+		auto pEffect{ std::make_unique<Effect>(m_pDevice, desc.source, desc.defines) };
+		if (!pEffect->IsValid())
+		{
+			return {};
+		}
+
+		std::vector<D3D11_INPUT_ELEMENT_DESC> vertexDesc(desc.layout.size());
+		for (size_t i{}; i < desc.layout.size(); ++i)
+		{
+			const VertexElement& element{ desc.layout[i] };
+			vertexDesc[i].SemanticName = element.semantic.c_str();
+			vertexDesc[i].SemanticIndex = element.semanticIndex;
+			switch (element.format)
+			{
+			case VertexFormat::Float2: vertexDesc[i].Format = DXGI_FORMAT_R32G32_FLOAT; break;
+			case VertexFormat::Float3: vertexDesc[i].Format = DXGI_FORMAT_R32G32B32_FLOAT; break;
+			case VertexFormat::Float4: vertexDesc[i].Format = DXGI_FORMAT_R32G32B32A32_FLOAT; break;
+			}
+			vertexDesc[i].InputSlot = element.slot;
+			vertexDesc[i].AlignedByteOffset = element.offset;
+			vertexDesc[i].InputSlotClass = element.perInstance ? D3D11_INPUT_PER_INSTANCE_DATA : D3D11_INPUT_PER_VERTEX_DATA;
+			vertexDesc[i].InstanceDataStepRate = element.perInstance ? 1 : 0;
+		}
+
+		//Create Input Layout and quit if failed
+		D3DX11_PASS_DESC passDesc{};
+		pEffect->GetTechnique()->GetPassByIndex(0)->GetDesc(&passDesc);
+
+		ID3D11InputLayout* pInputLayout{};
+		if (FAILED(m_pDevice->CreateInputLayout(vertexDesc.data(), static_cast<UINT>(vertexDesc.size()), passDesc.pIAInputSignature,
+			passDesc.IAInputSignatureSize, &pInputLayout)))
+		{
+			return {};
+		}
+		m_Programs.push_back({ std::move(pEffect), pInputLayout });
+		return { static_cast<uint32_t>(m_Programs.size()) };
+	}
+
+	void D3D11RenderDevice::ReleaseProgram(ProgramHandle program)
+	{
+		if (Program* pSlot{ FindSlot(m_Programs, program) })
+		{
+			if (pSlot->pInputLayout)
+			{
+				pSlot->pInputLayout->Release();
+			}
+			*pSlot = {};
+		}
+		if (program == m_Program)
+		{
+			m_Program = {};
+		}
+	}
+
+	void D3D11RenderDevice::SetMatrix(ProgramHandle program, const std::string& name, const Matrix& matrix)
+	{
+		if (ID3DX11EffectVariable* pVariable{ FindVariable(program, name) })
+		{
+			pVariable->AsMatrix()->SetMatrix(reinterpret_cast<const float*>(&matrix));
+		}
+	}
+
+	void D3D11RenderDevice::SetVector(ProgramHandle program, const std::string& name, const Vector4& vector)
+	{
+		if (ID3DX11EffectVariable* pVariable{ FindVariable(program, name) })
+		{
+			pVariable->AsVector()->SetFloatVector(&vector.x);
+		}
+	}
+
+	void D3D11RenderDevice::SetScalar(ProgramHandle program, const std::string& name, float value)
+	{
+		if (ID3DX11EffectVariable* pVariable{ FindVariable(program, name) })
+		{
+			pVariable->AsScalar()->SetFloat(value);
+		}
+	}
+
+	void D3D11RenderDevice::SetTexture(ProgramHandle program, const std::string& name, TextureHandle texture)
+	{
+		const TextureSlot* pSlot{ FindTexture(texture) };
+		ID3DX11EffectVariable* pVariable{ FindVariable(program, name) };
+		if (pSlot && pVariable)
+		{
+			pVariable->AsShaderResource()->SetResource(pSlot->pTexture->GetSRV());
+		}
+	}
+
+	void D3D11RenderDevice::SetSampler(ProgramHandle program, const std::string& name, SamplerHandle sampler)
+	{
+		ID3D11SamplerState* const* pSlot{ FindSlot(m_Samplers, sampler) };
+		ID3DX11EffectVariable* pVariable{ FindVariable(program, name) };
+		if (pSlot && *pSlot && pVariable)
+		{
+			pVariable->AsSampler()->SetSampler(0, *pSlot);
+		}
+	}
+
+	void D3D11RenderDevice::SetRasterizer(ProgramHandle program, const std::string& name, RasterizerHandle rasterizer)
+	{
+		ID3D11RasterizerState* const* pSlot{ FindSlot(m_Rasterizers, rasterizer) };
+		ID3DX11EffectVariable* pVariable{ FindVariable(program, name) };
+		if (pSlot && *pSlot && pVariable)
+		{
+			pVariable->AsRasterizer()->SetRasterizerState(0, *pSlot);
+		}
+	}
+
+	void D3D11RenderDevice::SetProgram(ProgramHandle program)
+	{
+		const Program* pProgram{ FindSlot(m_Programs, program) };
+		if (!pProgram || !pProgram->pEffect)
+		{
+			m_Program = {};
+			return;
+		}
+		m_Program = program;
+		m_pDeviceContext->IASetInputLayout(pProgram->pInputLayout);
+		m_pDeviceContext->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+	}
+
+	void D3D11RenderDevice::SetVertexBuffer(uint32_t slot, BufferHandle buffer)
+	{
+		const Buffer* pSlot{ FindBuffer(buffer) };
+		if (!pSlot)
+		{
+			return;
+		}
+		const UINT stride{ pSlot->desc.stride };
+		constexpr UINT offset{ 0 };
+		m_pDeviceContext->IASetVertexBuffers(slot, 1, &pSlot->pBuffer, &stride, &offset);
+	}
+
+	void D3D11RenderDevice::SetIndexBuffer(BufferHandle buffer)
+	{
+		if (const Buffer* pSlot{ FindBuffer(buffer) })
+		{
+			m_pDeviceContext->IASetIndexBuffer(pSlot->pBuffer, DXGI_FORMAT_R32_UINT, 0);
+		}
+	}
+
+	void D3D11RenderDevice::DrawIndexed(uint32_t indexCount, uint32_t firstIndex, int32_t baseVertex)
+	{
+		if (const Effect* pEffect{ FindEffect(m_Program) })
+		{
+			DrawPasses(pEffect->GetTechnique(), m_pDeviceContext, [&] { m_pDeviceContext->DrawIndexed(indexCount, firstIndex, baseVertex); });
+		}
+	}
+
+	void D3D11RenderDevice::DrawIndexedInstanced(uint32_t indexCount, uint32_t instanceCount, uint32_t firstIndex, int32_t baseVertex,
+		uint32_t firstInstance)
+	{
+		if (const Effect* pEffect{ FindEffect(m_Program) })
+		{
+			DrawPasses(pEffect->GetTechnique(), m_pDeviceContext,
+				[&] { m_pDeviceContext->DrawIndexedInstanced(indexCount, instanceCount, firstIndex, baseVertex, firstInstance); });
+		}
+	}
+
+	void D3D11RenderDevice::Clear(const ColorRGB& color)
+	{
+		const FLOAT clearColor[4]{ color.r, color.g, color.b, 1.f };
+		m_pDeviceContext->ClearRenderTargetView(m_pRenderTargetView, clearColor);
+		m_pDeviceContext->ClearDepthStencilView(m_pDepthStencilView, D3D11_CLEAR_DEPTH | D3D11_CLEAR_STENCIL, 1.0f, 0);
+	}
+
+	void D3D11RenderDevice::CopyToBackBuffer(TextureHandle texture)
+	{
+		//The _SRGB texture and the UNORM back buffer share a format family, the encoded bytes are copied as they are
+		const TextureSlot* pSlot{ FindTexture(texture) };
+		if (!pSlot || pSlot->desc.width != m_Width || pSlot->desc.height != m_Height || pSlot->desc.mipLevels != 1 || pSlot->desc.arraySize > 0
+			|| pSlot->desc.format != TexelFormat::RGBA8)
+		{
+			return;
+		}
+		m_pDeviceContext->CopyResource(m_pRenderTargetBuffer, pSlot->pTexture->GetTexture2D());
+	}
+
+	void D3D11RenderDevice::Present()
+	{
+		m_pSwapChain->Present(0, 0);
+	}
+
+	const D3D11RenderDevice::Buffer* D3D11RenderDevice::FindBuffer(BufferHandle buffer) const
+	{
+		const Buffer* pSlot{ FindSlot(m_Buffers, buffer) };
+		return pSlot && pSlot->pBuffer ? pSlot : nullptr;
+	}
+
+	const D3D11RenderDevice::TextureSlot* D3D11RenderDevice::FindTexture(TextureHandle texture) const
+	{
+		const TextureSlot* pSlot{ FindSlot(m_Textures, texture) };
+		return pSlot && pSlot->pTexture ? pSlot : nullptr;
+	}
+
+	Effect* D3D11RenderDevice::FindEffect(ProgramHandle program) const
+	{
+		const Program* pSlot{ FindSlot(m_Programs, program) };
+		return pSlot ? pSlot->pEffect.get() : nullptr;
+	}
+
+	ID3DX11EffectVariable* D3D11RenderDevice::FindVariable(ProgramHandle program, const std::string& name) const
+	{
+		Effect* pEffect{ FindEffect(program) };
+		return pEffect ? pEffect->GetVariable(name) : nullptr;
+	}
+}
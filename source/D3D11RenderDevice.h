@@ -0,0 +1,108 @@
+#pragma once
+#include <memory>
+#include <vector>
+
+#include "RenderDevice.h"
+
+struct SDL_Window;
+class Texture;
+class Effect;
+
+namespace dae
+{
+	//RenderDevice on D3D11. Creates the device, the swap chain of a window and the views of its back buffer
+	//and owns them. Programs are Effects11 effects, every pass of their technique is applied and drawn with
+	class D3D11RenderDevice final : public RenderDevice
+	{
+	public:
+		//nullptr when the adapter has no D3D11 device or the window gets no swap chain
+		static std::unique_ptr<D3D11RenderDevice> Create(SDL_Window* pWindow, uint32_t gpuIndex = 0);
+		~D3D11RenderDevice() override;
+
+		BufferHandle CreateBuffer(const BufferDesc& desc, const void* pData) override;
+		void ReleaseBuffer(BufferHandle buffer) override;
+		void* Map(BufferHandle buffer) override;
+		void Unmap(BufferHandle buffer) override;
+
+		TextureHandle CreateTexture(const TextureDesc& desc, const std::vector<const void*>& mips) override;
+		void ReleaseTexture(TextureHandle texture) override;
+		void UpdateTexture(TextureHandle texture, int mip, const void* pData) override;
+		void CopyTextureLevels(TextureHandle source, int sourceMip, TextureHandle destination, int destinationMip, int count) override;
+
+		SamplerHandle CreateSampler(const SamplerDesc& desc) override;
+		void ReleaseSampler(SamplerHandle sampler) override;
+		RasterizerHandle CreateRasterizer(const RasterizerDesc& desc) override;
+		void ReleaseRasterizer(RasterizerHandle rasterizer) override;
+		ProgramHandle CreateProgram(const ProgramDesc& desc) override;
+		void ReleaseProgram(ProgramHandle program) override;
+
+		void SetMatrix(ProgramHandle program, const std::string& name, const Matrix& matrix) override;
+		void SetVector(ProgramHandle program, const std::string& name, const Vector4& vector) override;
+		void SetScalar(ProgramHandle program, const std::string& name, float value) override;
+		void SetTexture(ProgramHandle program, const std::string& name, TextureHandle texture) override;
+		void SetSampler(ProgramHandle program, const std::string& name, SamplerHandle sampler) override;
+		void SetRasterizer(ProgramHandle program, const std::string& name, RasterizerHandle rasterizer) override;
+
+		//Sets the layout and a triangle list, the passes are applied by the draws
+		void SetProgram(ProgramHandle program) override;
+		void SetVertexBuffer(uint32_t slot, BufferHandle buffer) override;
+		void SetIndexBuffer(BufferHandle buffer) override;
+		void DrawIndexed(uint32_t indexCount, uint32_t firstIndex, int32_t baseVertex = 0) override;
+		void DrawIndexedInstanced(uint32_t indexCount, uint32_t instanceCount, uint32_t firstIndex, int32_t baseVertex,
+			uint32_t firstInstance) override;
+
+		int GetWidth() const override { return m_Width; }
+		int GetHeight() const override { return m_Height; }
+		void Clear(const ColorRGB& color) override;
+		void CopyToBackBuffer(TextureHandle texture) override;
+		void Present() override;
+
+	private:
+		struct Buffer
+		{
+			ID3D11Buffer* pBuffer{};
+			BufferDesc desc{};
+		};
+
+		struct TextureSlot
+		{
+			std::unique_ptr<Texture> pTexture{};
+			TextureDesc desc{};
+		};
+
+		struct Program
+		{
+			std::unique_ptr<Effect> pEffect{};
+			ID3D11InputLayout* pInputLayout{};
+		};
+
+		int m_Width{};
+		int m_Height{};
+
+		ID3D11Device* m_pDevice{};
+		ID3D11DeviceContext* m_pDeviceContext{};
+		IDXGISwapChain* m_pSwapChain{};
+		ID3D11Texture2D* m_pDepthStencilBuffer{};
+		ID3D11DepthStencilView* m_pDepthStencilView{};
+		ID3D11Resource* m_pRenderTargetBuffer{};
+		ID3D11RenderTargetView* m_pRenderTargetView{};
+
+		//Slot id - 1, released slots stay empty so stale handles never reach a new object
+		std::vector<Buffer> m_Buffers{};
+		std::vector<TextureSlot> m_Textures{};
+		std::vector<ID3D11SamplerState*> m_Samplers{};
+		std::vector<ID3D11RasterizerState*> m_Rasterizers{};
+		std::vector<Program> m_Programs{};
+
+		ProgramHandle m_Program{};
+
+		D3D11RenderDevice() = default;
+		HRESULT Initialize(SDL_Window* pWindow, uint32_t gpuIndex);
+
+		const Buffer* FindBuffer(BufferHandle buffer) const;
+		const TextureSlot* FindTexture(TextureHandle texture) const;
+		Effect* FindEffect(ProgramHandle program) const;
+		//Reported by the effect when it has no variable of that name
+		ID3DX11EffectVariable* FindVariable(ProgramHandle program, const std::string& name) const;
+	};
+}
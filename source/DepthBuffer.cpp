@@ -0,0 +1,130 @@
+#include "pch.h"
+#include "DepthBuffer.h"
+#include <bit>
+
+namespace dae
+{
+	namespace
+	{
+		//Slack for a triangle's block bounds, which come from the corners of its depth plane and round
+		//differently than the per-pixel depth. Below a step of the 16 bit format
+		constexpr float boundsMargin{ 1e-5f };
+	}
+
+	DepthBuffer::DepthBuffer(int width, int height, Format format)
+		: m_Width{ width }
+		, m_Height{ height }
+		, m_BlocksX{ width / blockSize }
+		, m_Format{ format }
+	{
+		const size_t pixelCount{ static_cast<size_t>(width) * height };
+		if (format == Format::Unorm16)
+		{
+			m_Texels16.resize(pixelCount);
+		}
+		else
+		{
+			m_Texels32.resize(pixelCount);
+		}
+		m_BlockMin.resize(pixelCount / (blockSize * blockSize));
+		m_BlockMax.resize(m_BlockMin.size());
+		Clear();
+	}
+
+	void DepthBuffer::Clear(float depth)
+	{
+		//The stencil of D24S8 clears to 0 as well
+		const uint32_t key{ ToKey(depth) };
+		std::fill(m_Texels32.begin(), m_Texels32.end(), key);
+		std::fill(m_Texels16.begin(), m_Texels16.end(), static_cast<uint16_t>(key));
+		std::fill(m_BlockMin.begin(), m_BlockMin.end(), key);
+		std::fill(m_BlockMax.begin(), m_BlockMax.end(), key);
+	}
+
+	uint32_t DepthBuffer::ToKey(float depth) const
+	{
+		//Written so -0 and NaN become 0, the bits of -0 would sort after every positive float
+		const float clamped{ depth > 0.f ? std::min(depth, 1.f) : 0.f };
+		switch (m_Format)
+		{
+		//Not in float, 2^24 - 1 + 0.5 rounds up to 2^24 and would spill into the stencil
+		case Format::Unorm24: return static_cast<uint32_t>(static_cast<double>(clamped) * unorm24Mask + 0.5);
+		case Format::Unorm16: return static_cast<uint32_t>(clamped * 65535.f + 0.5f);
+		default: return std::bit_cast<uint32_t>(clamped); //positive floats sort like their bits
+		}
+	}
+
+	float DepthBuffer::ToDepth(uint32_t key) const
+	{
+		switch (m_Format)
+		{
+		case Format::Unorm24: return static_cast<float>(key) / static_cast<float>(unorm24Mask);
+		case Format::Unorm16: return static_cast<float>(key) / 65535.f;
+		default: return std::bit_cast<float>(key);
+		}
+	}
+
+	DepthBuffer::BlockTest DepthBuffer::TestBlock(int blockX, int blockY, float minDepth, float maxDepth) const
+	{
+		const size_t block{ GetBlockIndex(blockX, blockY) };
+		//Every pixel is at least minDepth, so none is closer than the furthest stored value
+		if (ToKey(minDepth - boundsMargin) >= m_BlockMax[block])
+		{
+			return BlockTest::Rejected;
+		}
+		//Every pixel is closer than the closest stored value
+		if (ToKey(maxDepth + boundsMargin) < m_BlockMin[block])
+		{
+			return BlockTest::Accepted;
+		}
+		return BlockTest::Partial;
+	}
+
+	void DepthBuffer::Write(int x, int y, uint32_t key)
+	{
+		const size_t index{ static_cast<size_t>(y) * m_Width + x };
+		switch (m_Format)
+		{
+		case Format::Unorm24: m_Texels32[index] = (m_Texels32[index] & ~unorm24Mask) | key; break;
+		case Format::Unorm16: m_Texels16[index] = static_cast<uint16_t>(key); break;
+		default: m_Texels32[index] = key; break;
+		}
+
+		uint32_t& blockMin{ m_BlockMin[GetBlockIndex(x / blockSize, y / blockSize)] };
+		blockMin = std::min(blockMin, key);
+	}
+
+	void DepthBuffer::UpdateBlock(int blockX, int blockY)
+	{
+		uint32_t minKey{ ~0u };
+		uint32_t maxKey{};
+		for (int y{ blockY * blockSize }; y < (blockY + 1) * blockSize; ++y)
+		{
+			for (int x{ blockX * blockSize }; x < (blockX + 1) * blockSize; ++x)
+			{
+				const uint32_t key{ GetKey(x, y) };
+				minKey = std::min(minKey, key);
+				maxKey = std::max(maxKey, key);
+			}
+		}
+		const size_t block{ GetBlockIndex(blockX, blockY) };
+		m_BlockMin[block] = minKey;
+		m_BlockMax[block] = maxKey;
+	}
+
+	void DepthBuffer::UpdateBlocks()
+	{
+		for (int blockY{}; blockY < m_Height / blockSize; ++blockY)
+		{
+			for (int blockX{}; blockX < m_BlocksX; ++blockX)
+			{
+				UpdateBlock(blockX, blockY);
+			}
+		}
+	}
+
+	size_t DepthBuffer::GetBytes() const
+	{
+		return m_Texels32.size() * sizeof(uint32_t) + m_Texels16.size() * sizeof(uint16_t);
+	}
+}
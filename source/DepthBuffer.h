@@ -0,0 +1,85 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+
+namespace dae
+{
+	//Depth for the CPU rasterizers with DepthFunc = less: the full-resolution values plus the min and max of
+	//every 8x8 block. A triangle whose depth over a block is behind the block's max fails everywhere in it
+	//and the block is skipped whole, one in front of the block's min passes everywhere and needs no per-pixel
+	//test. Values are stored and compared the way the DXGI depth formats do.
+	class DepthBuffer final
+	{
+	public:
+		enum class Format
+		{
+			Float32, //DXGI_FORMAT_D32_FLOAT
+			Unorm24, //DXGI_FORMAT_D24_UNORM_S8_UINT, depth in the low 24 bits and stencil in the high 8, stencil stays 0
+			Unorm16  //DXGI_FORMAT_D16_UNORM
+		};
+
+		enum class BlockTest
+		{
+			Rejected, //every pixel fails
+			Accepted, //every pixel passes
+			Partial
+		};
+
+		static constexpr int blockSize{ 8 };
+
+		DepthBuffer() = default;
+		//Multiples of blockSize
+		DepthBuffer(int width, int height, Format format = Format::Float32);
+
+		void Clear(float depth = 1.f);
+
+		//Stored values as unsigned integers ordered like the depths, every comparison is done on these.
+		//Depth is clamped to [0, 1] and rounded to the format
+		uint32_t ToKey(float depth) const;
+		float ToDepth(uint32_t key) const;
+
+		//minDepth and maxDepth bound the triangle over the block
+		BlockTest TestBlock(int blockX, int blockY, float minDepth, float maxDepth) const;
+
+		bool Passes(int x, int y, uint32_t key) const { return key < GetKey(x, y); }
+		//Lowers the block's min right away, its max only in UpdateBlock
+		void Write(int x, int y, uint32_t key);
+		//Recomputes the block from its pixels, tightens the max after writes
+		void UpdateBlock(int blockX, int blockY);
+		//Every block, after filling the whole buffer with Write
+		void UpdateBlocks();
+
+		uint32_t GetKey(int x, int y) const
+		{
+			const size_t index{ static_cast<size_t>(y) * m_Width + x };
+			switch (m_Format)
+			{
+			case Format::Unorm24: return m_Texels32[index] & unorm24Mask;
+			case Format::Unorm16: return m_Texels16[index];
+			default: return m_Texels32[index];
+			}
+		}
+		float GetDepth(int x, int y) const { return ToDepth(GetKey(x, y)); }
+
+		Format GetFormat() const { return m_Format; }
+		//Full resolution only, the blocks add 8 bytes per 64 pixels
+		size_t GetBytes() const;
+
+	private:
+		static constexpr uint32_t unorm24Mask{ (1u << 24) - 1 };
+
+		int m_Width{};
+		int m_Height{};
+		int m_BlocksX{};
+		Format m_Format{};
+
+		//Laid out like the texture, only the one of the format is used
+		std::vector<uint32_t> m_Texels32{}; //float bits or depth and stencil
+		std::vector<uint16_t> m_Texels16{};
+
+		std::vector<uint32_t> m_BlockMin{};
+		std::vector<uint32_t> m_BlockMax{};
+
+		size_t GetBlockIndex(int blockX, int blockY) const { return static_cast<size_t>(blockY) * m_BlocksX + blockX; }
+	};
+}
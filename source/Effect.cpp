@@ -1,8 +1,8 @@
 #include "pch.h"
 #include "Effect.h"
 
-Effect::Effect(ID3D11Device* pDevice, const std::wstring& assetFile)
-	: m_pEffect{ LoadEffect(pDevice, assetFile) }
+Effect::Effect(ID3D11Device* pDevice, const std::wstring& assetFile, const std::vector<std::string>& defines)
+	: m_pEffect{ LoadEffect(pDevice, assetFile, defines) }
 {
 	if (m_pEffect == nullptr)
 	{
@@ -15,73 +15,25 @@ Effect::Effect(ID3D11Device* pDevice, const std::wstring& assetFile)
 	if (!m_pTechnique->IsValid())
 	{
 		std::wcout << L"Technique not valid!\n";
-	}
-
-	//Matrices
-	m_pMatWorldViewProjVariable = m_pEffect->GetVariableByName("gWorldViewProj")->AsMatrix();
-	if (!m_pMatWorldViewProjVariable->IsValid())
-	{
-		std::wcout << L"m_pMatWorldViewProjVariable not valid!\n";
-	}
-	m_pMatWorldVariable = m_pEffect->GetVariableByName("gWorldMatrix")->AsMatrix();
-	if (!m_pMatWorldVariable->IsValid())
-	{
-		std::wcout << L"m_pMatWorldVariable not valid!\n";
-	}
-	m_pMatViewInvVariable = m_pEffect->GetVariableByName("gViewInverseMatrix")->AsMatrix();
-	if (!m_pMatViewInvVariable->IsValid())
-	{
-		std::wcout << L"m_pMatViewInvVariable not valid!\n";
-	}
-
-	//Textures
-	m_pDiffuseMapVariable = m_pEffect->GetVariableByName("gDiffuseMap")->AsShaderResource();
-	if (!m_pDiffuseMapVariable->IsValid())
-	{
-		std::wcout << L"m_pDiffuseMapVariable not valid!\n";
-	}
-	m_pNormalMapVariable = m_pEffect->GetVariableByName("gNormalMap")->AsShaderResource();
-	if (!m_pNormalMapVariable->IsValid())
-	{
-		std::wcout << L"m_pNormalMapVariable not valid!\n";
-	}
-	m_pSpecularMapVariable = m_pEffect->GetVariableByName("gSpecularMap")->AsShaderResource();
-	if (!m_pSpecularMapVariable->IsValid())
-	{
-		std::wcout << L"m_pSpecularMapVariable not valid!\n";
-	}
-	m_pGlossinessMapVariable = m_pEffect->GetVariableByName("gGlossinessMap")->AsShaderResource();
-	if (!m_pGlossinessMapVariable->IsValid())
-	{
-		std::wcout << L"m_pGlossinessMapVariable not valid!\n";
+		m_pTechnique->Release();
+		m_pTechnique = nullptr;
 	}
 }
 
 Effect::~Effect()
 {
-	if (m_pTechnique)
-	{
-		m_pTechnique->Release();
-	}
-
-	//Matrices
-	if (m_pMatViewInvVariable)
-	{
-		m_pMatViewInvVariable->Release();
-	}
-	if (m_pMatWorldVariable)
-	{
-		m_pMatWorldVariable->Release();
-	}
-	if (m_pMatWorldViewProjVariable)
+	//Variables
+	for (const auto& [name, pVariable] : m_Variables)
 	{
-		m_pMatWorldViewProjVariable->Release();
+		if (pVariable)
+		{
+			pVariable->Release();
+		}
 	}
 
-	//Textures
-	if (m_pDiffuseMapVariable)
+	if (m_pTechnique)
 	{
-		m_pDiffuseMapVariable->Release();
+		m_pTechnique->Release();
 	}
 
 	//Whole effect
@@ -91,12 +43,19 @@ Effect::~Effect()
 	}
 }
 
-ID3DX11Effect* Effect::LoadEffect(ID3D11Device* pDevice, const std::wstring& assetFile)
+ID3DX11Effect* Effect::LoadEffect(ID3D11Device* pDevice, const std::wstring& assetFile, const std::vector<std::string>& defines)
 {
 	HRESULT result;
 	ID3D10Blob* pErrorBlob{ nullptr };
 	ID3DX11Effect* pEffect{ nullptr };
 
+	std::vector<D3D_SHADER_MACRO> macros{};
+	for (const std::string& define : defines)
+	{
+		macros.push_back({ define.c_str(), "1" });
+	}
+	macros.push_back({ nullptr, nullptr });
+
 	DWORD shaderFlags{ 0 };
 #if defined(DEBUG) || defined(_DEBUG)
 	shaderFlags |= D3DCOMPILE_DEBUG;
@@ -105,7 +64,7 @@ ID3DX11Effect* Effect::LoadEffect(ID3D11Device* pDevice, const std::wstring& ass
 
 	result = D3DX11CompileEffectFromFile(
 		assetFile.c_str(),
-		nullptr,
+		macros.data(),
 		nullptr,
 		shaderFlags,
 		0,
@@ -144,43 +103,20 @@ ID3DX11Effect* Effect::LoadEffect(ID3D11Device* pDevice, const std::wstring& ass
 	return pEffect;
 }
 
-void Effect::SetDiffuseMap(const Texture* pDiffuseTexture) const
-{
-	if (m_pDiffuseMapVariable)
-	{
-		m_pDiffuseMapVariable->SetResource(pDiffuseTexture->GetSRV());
-	}
-}
-void Effect::SetNormalMap(const Texture* pDiffuseTexture) const
+ID3DX11EffectVariable* Effect::GetVariable(const std::string& name)
 {
-	if (m_pNormalMapVariable)
+	const auto found{ m_Variables.find(name) };
+	if (found != m_Variables.end())
 	{
-		m_pNormalMapVariable->SetResource(pDiffuseTexture->GetSRV());
+		return found->second;
 	}
-}
-void Effect::SetSpecularMap(const Texture* pDiffuseTexture) const
-{
-	if (m_pSpecularMapVariable)
-	{
-		m_pSpecularMapVariable->SetResource(pDiffuseTexture->GetSRV());
-	}
-}
-void Effect::SetGlossinessMap(const Texture* pDiffuseTexture) const
-{
-	if (m_pGlossinessMapVariable)
+
+	ID3DX11EffectVariable* pVariable{ m_pEffect ? m_pEffect->GetVariableByName(name.c_str()) : nullptr };
+	if (pVariable && !pVariable->IsValid())
 	{
-		m_pGlossinessMapVariable->SetResource(pDiffuseTexture->GetSRV());
+		std::wcout << name.c_str() << L" not valid!\n";
+		pVariable = nullptr;
 	}
+	m_Variables.emplace(name, pVariable);
+	return pVariable;
 }
-void Effect::SetMatrixViewProj(const dae::Matrix& matrix) const
-{
-	m_pMatWorldViewProjVariable->SetMatrix(reinterpret_cast<const float*>(&matrix));
-}
-void Effect::SetMatrixWorld(const dae::Matrix& matrix) const
-{
-	m_pMatWorldVariable->SetMatrix(reinterpret_cast<const float*>(&matrix));
-}
-void Effect::SetMatrixViewInv(const dae::Matrix& matrix) const
-{
-	m_pMatViewInvVariable->SetMatrix(reinterpret_cast<const float*>(&matrix));
-}
\ No newline at end of file
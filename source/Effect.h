@@ -1,11 +1,15 @@
 #pragma once
-#include "Texture.h"
+#include <string>
+#include <unordered_map>
+#include <vector>
 
+//One compiled permutation of an effect file, the D3D11 backend's program. Variables are looked up by name
+//once and kept, names the effect does not have are reported once and ignored after
 class Effect final
 {
 public:
-
-	Effect(ID3D11Device* pDevice, const std::wstring& assetFile);
+	//Every define is set to 1
+	Effect(ID3D11Device* pDevice, const std::wstring& assetFile, const std::vector<std::string>& defines = {});
 	~Effect();
 
 	Effect(const Effect&) = delete;
@@ -13,38 +17,19 @@ public:
 	Effect& operator=(const Effect&) = delete;
 	Effect& operator=(Effect&&) noexcept = delete;
 
-	static ID3DX11Effect* LoadEffect(ID3D11Device* pDevice, const std::wstring& assetFile);
-	void SetDiffuseMap(const Texture* pDiffuseTexture) const;
-	void SetNormalMap(const Texture* pDiffuseTexture) const;
-	void SetSpecularMap(const Texture* pDiffuseTexture) const;
-	void SetGlossinessMap(const Texture* pDiffuseTexture) const;
-
-	ID3DX11Effect* GetEffect() const
-	{
-		return m_pEffect;
-	}
+	static ID3DX11Effect* LoadEffect(ID3D11Device* pDevice, const std::wstring& assetFile, const std::vector<std::string>& defines = {});
 
+	bool IsValid() const { return m_pTechnique != nullptr; }
 	ID3DX11EffectTechnique* GetTechnique() const
 	{
 		return m_pTechnique;
 	}
-	void SetMatrixViewProj(const dae::Matrix& matrix) const;
-	void SetMatrixWorld(const dae::Matrix& matrix) const;
-	void SetMatrixViewInv(const dae::Matrix& matrix) const;
+	//nullptr when the effect has no variable of that name
+	ID3DX11EffectVariable* GetVariable(const std::string& name);
 
 private:
-
 	ID3DX11Effect* m_pEffect{};
 	ID3DX11EffectTechnique* m_pTechnique{};
 
-	//Matrices
-	ID3DX11EffectMatrixVariable* m_pMatWorldViewProjVariable{};
-	ID3DX11EffectMatrixVariable* m_pMatWorldVariable{};
-	ID3DX11EffectMatrixVariable* m_pMatViewInvVariable{};
-
-	//Textures
-	ID3DX11EffectShaderResourceVariable* m_pDiffuseMapVariable{};
-	ID3DX11EffectShaderResourceVariable* m_pNormalMapVariable{};
-	ID3DX11EffectShaderResourceVariable* m_pSpecularMapVariable{};
-	ID3DX11EffectShaderResourceVariable* m_pGlossinessMapVariable{};
-};
\ No newline at end of file
+	std::unordered_map<std::string, ID3DX11EffectVariable*> m_Variables{};
+};
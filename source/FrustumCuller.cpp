@@ -0,0 +1,149 @@
+#include "pch.h"
+#include "FrustumCuller.h"
+#include "RasterKernel.h"
+#include <bit>
+#include <chrono>
+#include <immintrin.h>
+
+namespace dae
+{
+	namespace
+	{
+		Vector4 GetColumn(const Matrix& matrix, int column)
+		{
+			return { matrix[0][column], matrix[1][column], matrix[2][column], matrix[3][column] };
+		}
+
+		//The box's corner furthest along the normal is behind the plane
+		bool IsOutside(const Vector4& plane, float centerX, float centerY, float centerZ, float extentX, float extentY, float extentZ)
+		{
+			const float distance{ plane.x * centerX + plane.y * centerY + plane.z * centerZ + plane.w };
+			const float reach{ std::abs(plane.x) * extentX + std::abs(plane.y) * extentY + std::abs(plane.z) * extentZ };
+			return distance + reach < 0.f;
+		}
+	}
+
+	std::array<Vector4, 6> FrustumCuller::ExtractPlanes(const Matrix& viewProjection)
+	{
+		//-w <= x <= w, -w <= y <= w and 0 <= z <= w in clip space, each clip component a column dotted with the point
+		const Vector4 x{ GetColumn(viewProjection, 0) };
+		const Vector4 y{ GetColumn(viewProjection, 1) };
+		const Vector4 z{ GetColumn(viewProjection, 2) };
+		const Vector4 w{ GetColumn(viewProjection, 3) };
+		return { w + x, w - x, w + y, w - y, z, w - z };
+	}
+
+	size_t FrustumCuller::AddObject(const Vector3& minimum, const Vector3& maximum)
+	{
+		const size_t object{ m_Minimum.size() };
+		m_Minimum.push_back(minimum);
+		m_Maximum.push_back(maximum);
+
+		const size_t paddedCount{ (object + 1 + 7) / 8 * 8 };
+		for (std::vector<float>* pStream : { &m_CenterX, &m_CenterY, &m_CenterZ, &m_ExtentX, &m_ExtentY, &m_ExtentZ })
+		{
+			pStream->resize(paddedCount);
+		}
+		m_Visible.resize(paddedCount, 1);
+		SetWorld(object, Matrix{});
+		return object;
+	}
+
+	void FrustumCuller::SetWorld(size_t object, const Matrix& world)
+	{
+		//Each world axis of the new box gets the object extents scaled by how much they point along it
+		const Vector3 center{ (m_Minimum[object] + m_Maximum[object]) * 0.5f };
+		const Vector3 extent{ (m_Maximum[object] - m_Minimum[object]) * 0.5f };
+		const Vector3 worldCenter{ world.TransformPoint(center) };
+		m_CenterX[object] = worldCenter.x;
+		m_CenterY[object] = worldCenter.y;
+		m_CenterZ[object] = worldCenter.z;
+		float* const pExtents[]{ &m_ExtentX[object], &m_ExtentY[object], &m_ExtentZ[object] };
+		for (int axis{}; axis < 3; ++axis)
+		{
+			*pExtents[axis] = std::abs(world[0][axis]) * extent.x + std::abs(world[1][axis]) * extent.y + std::abs(world[2][axis]) * extent.z;
+		}
+	}
+
+	void FrustumCuller::Cull(const Matrix& viewProjection)
+	{
+		if (!RasterKernel::HasAvx2())
+		{
+			CullScalar(viewProjection);
+			return;
+		}
+
+		const auto start{ std::chrono::steady_clock::now() };
+		const std::array<Vector4, 6> planes{ ExtractPlanes(viewProjection) };
+		const __m256 signMask{ _mm256_set1_ps(-0.f) };
+		__m256 planeX[6]{};
+		__m256 planeY[6]{};
+		__m256 planeZ[6]{};
+		__m256 planeW[6]{};
+		for (int plane{}; plane < 6; ++plane)
+		{
+			planeX[plane] = _mm256_set1_ps(planes[plane].x);
+			planeY[plane] = _mm256_set1_ps(planes[plane].y);
+			planeZ[plane] = _mm256_set1_ps(planes[plane].z);
+			planeW[plane] = _mm256_set1_ps(planes[plane].w);
+		}
+
+		//The padding is tested too, its results are never read
+		int culled{};
+		for (size_t i{}; i < m_CenterX.size(); i += 8)
+		{
+			const __m256 centerX{ _mm256_loadu_ps(&m_CenterX[i]) };
+			const __m256 centerY{ _mm256_loadu_ps(&m_CenterY[i]) };
+			const __m256 centerZ{ _mm256_loadu_ps(&m_CenterZ[i]) };
+			const __m256 extentX{ _mm256_loadu_ps(&m_ExtentX[i]) };
+			const __m256 extentY{ _mm256_loadu_ps(&m_ExtentY[i]) };
+			const __m256 extentZ{ _mm256_loadu_ps(&m_ExtentZ[i]) };
+			__m256 outside{ _mm256_setzero_ps() };
+			for (int plane{}; plane < 6; ++plane)
+			{
+				const __m256 distance{ _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(planeX[plane], centerX), _mm256_mul_ps(planeY[plane], centerY)),
+					_mm256_add_ps(_mm256_mul_ps(planeZ[plane], centerZ), planeW[plane])) };
+				const __m256 reach{ _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(_mm256_andnot_ps(signMask, planeX[plane]), extentX),
+					_mm256_mul_ps(_mm256_andnot_ps(signMask, planeY[plane]), extentY)), _mm256_mul_ps(_mm256_andnot_ps(signMask, planeZ[plane]), extentZ)) };
+				outside = _mm256_or_ps(outside, _mm256_cmp_ps(_mm256_add_ps(distance, reach), _mm256_setzero_ps(), _CMP_LT_OQ));
+			}
+
+			const int outsideBits{ _mm256_movemask_ps(outside) };
+			for (int lane{}; lane < 8; ++lane)
+			{
+				m_Visible[i + lane] = static_cast<uint8_t>(~outsideBits >> lane & 1);
+			}
+			const int realLanes{ static_cast<int>(std::min<size_t>(m_Minimum.size() - i, 8)) };
+			culled += std::popcount(static_cast<unsigned>(outsideBits) & ((1u << realLanes) - 1));
+		}
+
+		m_Stats.tested = static_cast<int>(m_Minimum.size());
+		m_Stats.culled = culled;
+		m_Stats.cullMicroseconds = std::chrono::duration<float, std::micro>(std::chrono::steady_clock::now() - start).count();
+	}
+
+	void FrustumCuller::CullScalar(const Matrix& viewProjection)
+	{
+		const auto start{ std::chrono::steady_clock::now() };
+		const std::array<Vector4, 6> planes{ ExtractPlanes(viewProjection) };
+		int culled{};
+		for (size_t i{}; i < m_Minimum.size(); ++i)
+		{
+			bool visible{ true };
+			for (const Vector4& plane : planes)
+			{
+				if (IsOutside(plane, m_CenterX[i], m_CenterY[i], m_CenterZ[i], m_ExtentX[i], m_ExtentY[i], m_ExtentZ[i]))
+				{
+					visible = false;
+					break;
+				}
+			}
+			m_Visible[i] = visible;
+			culled += !visible;
+		}
+
+		m_Stats.tested = static_cast<int>(m_Minimum.size());
+		m_Stats.culled = culled;
+		m_Stats.cullMicroseconds = std::chrono::duration<float, std::micro>(std::chrono::steady_clock::now() - start).count();
+	}
+}
@@ -0,0 +1,57 @@
+#pragma once
+#include <array>
+#include <cstdint>
+#include <vector>
+
+#include "Math.h"
+
+namespace dae
+{
+	//View frustum test for many objects at once. Every object keeps its world-space box as center and
+	//half extents in separate arrays, so 8 boxes are tested against the 6 planes per AVX2 instruction.
+	//A box is outside when it lies entirely behind one plane; boxes near a frustum corner can pass
+	//without being visible, never the other way around.
+	class FrustumCuller final
+	{
+	public:
+		struct Stats
+		{
+			int tested{};
+			int culled{};
+			float cullMicroseconds{}; //the plane tests only, not SetWorld
+		};
+
+		//Planes of mul(v, viewProjection) with D3D's 0 to 1 depth, left, right, bottom, top, near and far.
+		//A point p is inside a plane when dot(plane.xyz, p) + plane.w >= 0, the planes are not normalized
+		static std::array<Vector4, 6> ExtractPlanes(const Matrix& viewProjection);
+
+		//Object-space box, returns the object's index. Its world matrix starts as identity
+		size_t AddObject(const Vector3& minimum, const Vector3& maximum);
+		//Moves the object's world-space box along with it
+		void SetWorld(size_t object, const Matrix& world);
+
+		//Once per frame after SetWorld, AVX2 when available
+		void Cull(const Matrix& viewProjection);
+		void CullScalar(const Matrix& viewProjection);
+
+		bool IsVisible(size_t object) const { return m_Visible[object] != 0; }
+		size_t GetObjectCount() const { return m_Minimum.size(); }
+		const Stats& GetStats() const { return m_Stats; }
+
+	private:
+		//Object space
+		std::vector<Vector3> m_Minimum{};
+		std::vector<Vector3> m_Maximum{};
+
+		//World space, padded to a multiple of 8 with empty boxes at the origin
+		std::vector<float> m_CenterX{};
+		std::vector<float> m_CenterY{};
+		std::vector<float> m_CenterZ{};
+		std::vector<float> m_ExtentX{};
+		std::vector<float> m_ExtentY{};
+		std::vector<float> m_ExtentZ{};
+
+		std::vector<uint8_t> m_Visible{}; //bytes rather than vector<bool>, the kernel writes 8 at a time
+		Stats m_Stats{};
+	};
+}
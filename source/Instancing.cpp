@@ -0,0 +1,141 @@
+#include "pch.h"
+#include "Instancing.h"
+#include "Camera.h"
+#include "Simplifier.h"
+#include <bit>
+#include <chrono>
+
+namespace dae
+{
+	void InstanceSet::Initialize(const Vector3& boundsMinimum, const Vector3& boundsMaximum, std::vector<float> lodErrors)
+	{
+		m_BoundsMinimum = boundsMinimum;
+		m_BoundsMaximum = boundsMaximum;
+		m_BoundsCenter = (boundsMinimum + boundsMaximum) * 0.5f;
+		m_BoundsRadius = ((boundsMaximum - boundsMinimum) * 0.5f).Magnitude();
+		m_LodErrors = lodErrors.empty() ? std::vector<float>{ 0.f } : std::move(lodErrors);
+		m_LevelStarts.assign(m_LodErrors.size() + 1, 0);
+	}
+
+	size_t InstanceSet::Add(const Matrix& world)
+	{
+		const size_t instance{ m_Culler.AddObject(m_BoundsMinimum, m_BoundsMaximum) };
+		m_Worlds.push_back(world);
+		m_InstanceLevels.push_back(0);
+		m_Culler.SetWorld(instance, world);
+		return instance;
+	}
+
+	void InstanceSet::SetWorld(size_t instance, const Matrix& world)
+	{
+		m_Worlds[instance] = world;
+		m_Culler.SetWorld(instance, world);
+	}
+
+	void InstanceSet::Update(const Camera& camera, float screenHeight, float maxPixelError)
+	{
+		m_Stats = {};
+		m_Stats.instances = m_Worlds.size();
+		m_Culler.Cull(camera.viewMatrix * camera.projectionMatrix);
+		m_Stats.cullMicroseconds = m_Culler.GetStats().cullMicroseconds;
+
+		const auto start{ std::chrono::steady_clock::now() };
+		const size_t levelCount{ m_LodErrors.size() };
+		std::fill(m_LevelStarts.begin(), m_LevelStarts.end(), 0);
+
+		const float unitsToPixels{ screenHeight / (2.f * camera.fov) };
+		for (size_t i{}; i < m_Worlds.size(); ++i)
+		{
+			if (!m_Culler.IsVisible(i))
+			{
+				continue;
+			}
+			const Matrix& world{ m_Worlds[i] };
+			const float scale{ world.GetAxisX().Magnitude() };
+			const float distance{ std::max((world.TransformPoint(m_BoundsCenter) - camera.origin).Magnitude() - m_BoundsRadius * scale, camera.nearC) };
+
+			//Errors are in object space, a scaled copy moves its surface further
+			const size_t level{ Simplifier::SelectLevel(m_LodErrors, unitsToPixels * scale / distance, maxPixelError) };
+			m_InstanceLevels[i] = static_cast<uint32_t>(level);
+			++m_LevelStarts[level + 1];
+		}
+
+		//Counting sort by level, instances keep their order within one
+		for (size_t level{ 1 }; level <= levelCount; ++level)
+		{
+			m_LevelStarts[level] += m_LevelStarts[level - 1];
+		}
+		m_Stats.visible = m_LevelStarts[levelCount];
+		m_Visible.resize(m_Stats.visible);
+		std::vector<uint32_t> fill(m_LevelStarts.begin(), m_LevelStarts.end() - 1);
+		for (size_t i{}; i < m_Worlds.size(); ++i)
+		{
+			if (m_Culler.IsVisible(i))
+			{
+				m_Visible[fill[m_InstanceLevels[i]]++] = m_Worlds[i];
+			}
+		}
+		m_Stats.buildMicroseconds = std::chrono::duration<float, std::micro>(std::chrono::steady_clock::now() - start).count();
+	}
+
+	bool InstanceBuffer::Upload(RenderDevice& device, const InstanceSet& instances)
+	{
+		const std::vector<Matrix>& worlds{ instances.GetVisible() };
+		if (worlds.empty())
+		{
+			return false;
+		}
+		static_assert(sizeof(Matrix) == 16 * sizeof(float), "instance rows are read straight from the matrices");
+
+		const uint32_t instanceCount{ static_cast<uint32_t>(worlds.size()) };
+		if (instanceCount > m_Capacity)
+		{
+			Release(device);
+			BufferDesc desc{};
+			desc.binding = BufferBinding::Vertex;
+			desc.usage = BufferUsage::Dynamic;
+			desc.byteWidth = static_cast<uint32_t>(sizeof(Matrix)) * std::bit_ceil(instanceCount);
+			desc.stride = sizeof(Matrix);
+			m_Buffer = device.CreateBuffer(desc, nullptr);
+			if (!m_Buffer.IsValid())
+			{
+				return false;
+			}
+			m_Capacity = std::bit_ceil(instanceCount);
+		}
+
+		void* pData{ device.Map(m_Buffer) };
+		if (!pData)
+		{
+			return false;
+		}
+		std::copy(worlds.begin(), worlds.end(), static_cast<Matrix*>(pData));
+		device.Unmap(m_Buffer);
+		return true;
+	}
+
+	void InstanceBuffer::Draw(RenderDevice& device, const InstanceSet& instances, const std::vector<IndexRange>& levelRanges) const
+	{
+		device.SetVertexBuffer(1, m_Buffer);
+		for (size_t level{}; level < instances.GetLevelCount() && level < levelRanges.size(); ++level)
+		{
+			const uint32_t firstInstance{ instances.GetLevelStart(level) };
+			const uint32_t levelInstances{ instances.GetLevelStart(level + 1) - firstInstance };
+			if (levelInstances > 0)
+			{
+				const IndexRange& range{ levelRanges[level] };
+				device.DrawIndexedInstanced(range.indexCount, levelInstances, range.firstIndex, 0, firstInstance);
+			}
+		}
+	}
+
+	void InstanceBuffer::Release(RenderDevice& device)
+	{
+		if (m_Buffer.IsValid())
+		{
+			device.ReleaseBuffer(m_Buffer);
+		}
+		m_Buffer = {};
+		m_Capacity = 0;
+	}
+}
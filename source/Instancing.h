@@ -0,0 +1,80 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+
+#include "Math.h"
+#include "FrustumCuller.h"
+#include "Meshlets.h"
+#include "RenderDevice.h"
+
+namespace dae
+{
+	struct Camera;
+
+	//Copies of one mesh, each with its own world matrix. Every frame the copies outside the view are dropped
+	//and the rest are laid out level of detail by level of detail, ready to be copied into a per-instance
+	//vertex buffer and drawn with one instanced draw per level. Touches no D3D state.
+	//World matrices may rotate, translate and scale uniformly
+	class InstanceSet final
+	{
+	public:
+		struct Stats
+		{
+			size_t instances{};
+			size_t visible{};
+			float cullMicroseconds{};
+			float buildMicroseconds{}; //level selection and layout
+		};
+
+		//Object-space bounds of the mesh and the errors of its levels, the full mesh first with 0
+		void Initialize(const Vector3& boundsMinimum, const Vector3& boundsMaximum, std::vector<float> lodErrors);
+
+		//Returns the instance's index
+		size_t Add(const Matrix& world);
+		void SetWorld(size_t instance, const Matrix& world);
+		const Matrix& GetWorld(size_t instance) const { return m_Worlds[instance]; }
+		size_t GetCount() const { return m_Worlds.size(); }
+
+		//Frustum culls every instance, picks a level for each one that is left like Mesh::SelectLod does, with the
+		//sphere around the bounds, and writes their world matrices grouped by level
+		void Update(const Camera& camera, float screenHeight, float maxPixelError);
+
+		//World matrices of the visible instances, the ones of level l at [GetLevelStart(l), GetLevelStart(l + 1))
+		const std::vector<Matrix>& GetVisible() const { return m_Visible; }
+		uint32_t GetLevelStart(size_t level) const { return m_LevelStarts[level]; }
+		size_t GetLevelCount() const { return m_LodErrors.size(); }
+		const Stats& GetStats() const { return m_Stats; }
+
+	private:
+		FrustumCuller m_Culler{};
+		Vector3 m_BoundsMinimum{};
+		Vector3 m_BoundsMaximum{};
+		Vector3 m_BoundsCenter{};
+		float m_BoundsRadius{};
+		std::vector<float> m_LodErrors{ 0.f };
+
+		std::vector<Matrix> m_Worlds{};
+
+		std::vector<Matrix> m_Visible{};
+		std::vector<uint32_t> m_LevelStarts{ 0, 0 };
+		std::vector<uint32_t> m_InstanceLevels{}; //per instance, only valid for visible ones
+		Stats m_Stats{};
+	};
+
+	//Vertex buffer with the world matrices of an InstanceSet's visible instances, rewritten every frame
+	//and grown to the next power of two when they no longer fit
+	class InstanceBuffer final
+	{
+	public:
+		//False when nothing is visible or the buffer could not be made, there is nothing to draw then
+		bool Upload(RenderDevice& device, const InstanceSet& instances);
+		//Binds the buffer to slot 1 and draws every level that has instances with one DrawIndexedInstanced.
+		//levelRanges are the levels in the bound index buffer, the full mesh first
+		void Draw(RenderDevice& device, const InstanceSet& instances, const std::vector<IndexRange>& levelRanges) const;
+		void Release(RenderDevice& device);
+
+	private:
+		BufferHandle m_Buffer{};
+		uint32_t m_Capacity{};
+	};
+}
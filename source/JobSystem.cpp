@@ -0,0 +1,295 @@
+#include "pch.h"
+#include "JobSystem.h"
+
+namespace dae
+{
+	namespace
+	{
+		//Idle rounds before a worker goes to sleep, waking up costs far more than a few yields
+		constexpr int spinRounds{ 64 };
+
+		//Which system the calling thread works for, a thread belongs to at most one
+		thread_local const JobSystem* tl_pSystem{};
+		thread_local int tl_WorkerIndex{ -1 };
+		thread_local uint32_t tl_Random{ 0x9E3779B9u };
+
+		uint32_t NextRandom()
+		{
+			//xorshift32
+			tl_Random ^= tl_Random << 13;
+			tl_Random ^= tl_Random >> 17;
+			tl_Random ^= tl_Random << 5;
+			return tl_Random;
+		}
+	}
+
+	//Chase-Lev with the memory orders of Le et al., "Correct and Efficient Work-Stealing for Weak Memory Models".
+	//The slots are release/acquire as well, which costs nothing on x86 and lets thread sanitizers follow the hand-over
+	bool JobSystem::Deque::Push(Job* pJob)
+	{
+		const int64_t bottom{ m_Bottom.load(std::memory_order_relaxed) };
+		const int64_t top{ m_Top.load(std::memory_order_acquire) };
+		if (bottom - top >= capacity)
+		{
+			return false;
+		}
+		m_Jobs[bottom & (capacity - 1)].store(pJob, std::memory_order_release);
+		std::atomic_thread_fence(std::memory_order_release);
+		m_Bottom.store(bottom + 1, std::memory_order_relaxed);
+		return true;
+	}
+
+	JobSystem::Job* JobSystem::Deque::Pop()
+	{
+		const int64_t bottom{ m_Bottom.load(std::memory_order_relaxed) - 1 };
+		m_Bottom.store(bottom, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		int64_t top{ m_Top.load(std::memory_order_relaxed) };
+		if (top > bottom)
+		{
+			m_Bottom.store(bottom + 1, std::memory_order_relaxed);
+			return nullptr;
+		}
+
+		Job* pJob{ m_Jobs[bottom & (capacity - 1)].load(std::memory_order_relaxed) };
+		if (top == bottom)
+		{
+			//The last job, a thief may be taking it at the same time
+			if (!m_Top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+			{
+				pJob = nullptr;
+			}
+			m_Bottom.store(bottom + 1, std::memory_order_relaxed);
+		}
+		return pJob;
+	}
+
+	JobSystem::Job* JobSystem::Deque::Steal()
+	{
+		int64_t top{ m_Top.load(std::memory_order_acquire) };
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		const int64_t bottom{ m_Bottom.load(std::memory_order_acquire) };
+		if (top >= bottom)
+		{
+			return nullptr;
+		}
+
+		Job* pJob{ m_Jobs[top & (capacity - 1)].load(std::memory_order_acquire) };
+		//Lost to the owner or another thief, the caller moves on to the next victim
+		if (!m_Top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+		{
+			return nullptr;
+		}
+		return pJob;
+	}
+
+	JobSystem::JobSystem(int threadCount)
+	{
+		if (threadCount <= 0)
+		{
+			threadCount = std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+		}
+
+		for (int i{}; i < threadCount; ++i)
+		{
+			m_Deques.push_back(std::make_unique<Deque>());
+		}
+		tl_pSystem = this;
+		tl_WorkerIndex = 0;
+
+		m_Threads.reserve(threadCount - 1);
+		for (int i{ 1 }; i < threadCount; ++i)
+		{
+			m_Threads.emplace_back(&JobSystem::WorkerLoop, this, i);
+		}
+	}
+
+	JobSystem::~JobSystem()
+	{
+		{
+			std::lock_guard lock{ m_SleepMutex };
+			m_Quit = true;
+		}
+		m_WakeCondition.notify_all();
+
+		for (std::thread& thread : m_Threads)
+		{
+			thread.join();
+		}
+		if (tl_pSystem == this)
+		{
+			tl_pSystem = nullptr;
+			tl_WorkerIndex = -1;
+		}
+	}
+
+	void JobSystem::Run(std::function<void()> job, Counter* pCounter, const Counter* pDependency)
+	{
+		if (pCounter)
+		{
+			pCounter->fetch_add(1, std::memory_order_relaxed);
+		}
+		Submit(new Job{ std::move(job), pCounter, pDependency });
+	}
+
+	void JobSystem::Wait(const Counter& counter)
+	{
+		const int workerIndex{ GetWorkerIndex() };
+		while (counter.load(std::memory_order_acquire) > 0)
+		{
+			if (Job* pJob{ FindJob(workerIndex) })
+			{
+				Execute(pJob);
+			}
+			else
+			{
+				std::this_thread::yield();
+			}
+		}
+	}
+
+	void JobSystem::ParallelFor(size_t count, size_t grain, const std::function<void(size_t, size_t)>& body)
+	{
+		if (count == 0)
+		{
+			return;
+		}
+		grain = std::max(grain, size_t{ 1 });
+
+		//Hands the upper half to the deque until the rest fits in one grain. The owner pops the smallest
+		//halves first, thieves get the biggest
+		Counter counter{};
+		const auto runRange = [&](const auto& self, size_t begin, size_t end) -> void
+		{
+			while (end - begin > grain)
+			{
+				const size_t middle{ begin + (end - begin) / 2 };
+				Run([&self, middle, end] { self(self, middle, end); }, &counter);
+				end = middle;
+			}
+			body(begin, end);
+		};
+		runRange(runRange, 0, count);
+		Wait(counter);
+	}
+
+	void JobSystem::WorkerLoop(int workerIndex)
+	{
+		tl_pSystem = this;
+		tl_WorkerIndex = workerIndex;
+		tl_Random ^= static_cast<uint32_t>(workerIndex) * 0x85EBCA6Bu;
+
+		int idleRounds{};
+		while (true)
+		{
+			if (Job* pJob{ FindJob(workerIndex) })
+			{
+				Execute(pJob);
+				idleRounds = 0;
+				continue;
+			}
+			if (++idleRounds < spinRounds)
+			{
+				std::this_thread::yield();
+				continue;
+			}
+
+			//Announcing the sleep before checking for work pairs with Submit raising m_Pending before checking
+			//for sleepers, one of the two always sees the other
+			std::unique_lock lock{ m_SleepMutex };
+			m_Sleeping.fetch_add(1);
+			m_WakeCondition.wait(lock, [this] { return m_Quit || m_Pending.load() > 0; });
+			m_Sleeping.fetch_sub(1);
+			if (m_Quit)
+			{
+				return;
+			}
+			idleRounds = 0;
+		}
+	}
+
+	void JobSystem::Submit(Job* pJob)
+	{
+		const int workerIndex{ GetWorkerIndex() };
+		if (workerIndex >= 0)
+		{
+			if (!m_Deques[workerIndex]->Push(pJob))
+			{
+				Execute(pJob);
+				return;
+			}
+		}
+		else
+		{
+			std::lock_guard lock{ m_SharedMutex };
+			m_SharedJobs.push_back(pJob);
+			m_SharedCount.fetch_add(1, std::memory_order_relaxed);
+		}
+
+		m_Pending.fetch_add(1);
+		if (m_Sleeping.load() > 0)
+		{
+			//Taking the lock orders the notify after a sleeper's check of m_Pending
+			std::lock_guard lock{ m_SleepMutex };
+			m_WakeCondition.notify_one();
+		}
+	}
+
+	JobSystem::Job* JobSystem::FindJob(int workerIndex)
+	{
+		if (m_Pending.load(std::memory_order_relaxed) <= 0)
+		{
+			return nullptr;
+		}
+
+		Job* pJob{ workerIndex >= 0 ? m_Deques[workerIndex]->Pop() : nullptr };
+		if (!pJob && m_SharedCount.load(std::memory_order_relaxed) > 0)
+		{
+			std::lock_guard lock{ m_SharedMutex };
+			if (!m_SharedJobs.empty())
+			{
+				pJob = m_SharedJobs.back();
+				m_SharedJobs.pop_back();
+				m_SharedCount.fetch_sub(1, std::memory_order_relaxed);
+			}
+		}
+		if (!pJob)
+		{
+			const size_t dequeCount{ m_Deques.size() };
+			const size_t first{ NextRandom() % dequeCount };
+			for (size_t i{}; i < dequeCount && !pJob; ++i)
+			{
+				const size_t victim{ (first + i) % dequeCount };
+				if (static_cast<int>(victim) != workerIndex)
+				{
+					pJob = m_Deques[victim]->Steal();
+				}
+			}
+		}
+
+		if (pJob)
+		{
+			m_Pending.fetch_sub(1, std::memory_order_relaxed);
+		}
+		return pJob;
+	}
+
+	void JobSystem::Execute(Job* pJob)
+	{
+		if (pJob->pDependency)
+		{
+			Wait(*pJob->pDependency);
+		}
+		pJob->work();
+		if (pJob->pCounter)
+		{
+			pJob->pCounter->fetch_sub(1, std::memory_order_release);
+		}
+		delete pJob;
+	}
+
+	int JobSystem::GetWorkerIndex() const
+	{
+		return tl_pSystem == this ? tl_WorkerIndex : -1;
+	}
+}
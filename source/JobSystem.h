@@ -0,0 +1,90 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace dae
+{
+	//Work-stealing scheduler for jobs of any size. Every worker owns a Chase-Lev deque: it pushes and pops
+	//at the bottom without locks while idle workers steal the oldest job from the top of someone else's.
+	//The thread that creates the system is worker 0 and runs jobs while it waits. Other threads may submit
+	//and wait too, their jobs go through a locked queue every worker checks.
+	class JobSystem final
+	{
+	public:
+		//Jobs still running that were started with it, waiting for it runs other jobs meanwhile
+		using Counter = std::atomic<int>;
+
+		//0 starts one thread per hardware thread
+		explicit JobSystem(int threadCount = 0);
+		~JobSystem();
+
+		JobSystem(const JobSystem&) = delete;
+		JobSystem(JobSystem&&) noexcept = delete;
+		JobSystem& operator=(const JobSystem&) = delete;
+		JobSystem& operator=(JobSystem&&) noexcept = delete;
+
+		//pCounter is incremented now and decremented when job returns. A job with a dependency waits for
+		//that counter to reach 0 before it starts, running other jobs in the meantime
+		void Run(std::function<void()> job, Counter* pCounter = nullptr, const Counter* pDependency = nullptr);
+		void Wait(const Counter& counter);
+
+		//body(begin, end) over [0, count) in ranges of at most grain items. Ranges are split in halves as they
+		//are stolen, so a thief takes the largest piece left. Returns when every range is done
+		void ParallelFor(size_t count, size_t grain, const std::function<void(size_t, size_t)>& body);
+
+		int GetThreadCount() const { return static_cast<int>(m_Threads.size()) + 1; }
+
+	private:
+		struct Job
+		{
+			std::function<void()> work{};
+			Counter* pCounter{};
+			const Counter* pDependency{};
+		};
+
+		//Fixed size, a full deque runs new jobs right away instead of growing
+		class Deque final
+		{
+		public:
+			static constexpr int64_t capacity{ 4096 };
+
+			bool Push(Job* pJob);
+			Job* Pop();
+			Job* Steal();
+
+		private:
+			alignas(64) std::atomic<int64_t> m_Top{};
+			alignas(64) std::atomic<int64_t> m_Bottom{};
+			std::atomic<Job*> m_Jobs[capacity]{};
+		};
+
+		std::vector<std::thread> m_Threads{};
+		std::vector<std::unique_ptr<Deque>> m_Deques{};
+
+		//Jobs from threads that are not workers
+		std::mutex m_SharedMutex{};
+		std::vector<Job*> m_SharedJobs{};
+		std::atomic<int> m_SharedCount{}; //checked before taking the lock
+
+		//Queued and not taken yet, sleeping workers wake up when it rises
+		std::atomic<int> m_Pending{};
+		std::atomic<int> m_Sleeping{};
+		std::mutex m_SleepMutex{};
+		std::condition_variable m_WakeCondition{};
+		std::atomic<bool> m_Quit{};
+
+		void WorkerLoop(int workerIndex);
+		void Submit(Job* pJob);
+		//Own deque, shared queue, then the other workers from a random one on, -1 for threads that are not workers
+		Job* FindJob(int workerIndex);
+		void Execute(Job* pJob);
+		//The calling thread's index in this system, -1 when it is not one of its workers
+		int GetWorkerIndex() const;
+	};
+}
@@ -0,0 +1,153 @@
+#include "pch.h"
+#include "MaterialCook.h"
+
+namespace dae
+{
+	int MaterialPacking::GetChannelIndex(MaterialChannel channel) const
+	{
+		for (int i{}; i < 4; ++i)
+		{
+			if (channels[i] == channel)
+			{
+				return i;
+			}
+		}
+		return -1;
+	}
+
+	Vector4 MaterialPacking::GetMask(MaterialChannel channel) const
+	{
+		Vector4 mask{ 0.f, 0.f, 0.f, 0.f };
+		const int index{ GetChannelIndex(channel) };
+		if (index >= 0)
+		{
+			mask[index] = 1.f;
+		}
+		return mask;
+	}
+
+	namespace MaterialCook
+	{
+		//Gloss was only ever read from .r, specular maps are grey so luma keeps their intensity
+		static uint8_t ExtractScalar(MaterialChannel channel, const uint8_t* pTexel)
+		{
+			switch (channel)
+			{
+			case MaterialChannel::Specular:
+				return static_cast<uint8_t>((54 * pTexel[0] + 183 * pTexel[1] + 19 * pTexel[2] + 128) >> 8);
+			default:
+				return pTexel[0];
+			}
+		}
+
+		static uint8_t GetDefault(MaterialChannel channel)
+		{
+			switch (channel)
+			{
+			case MaterialChannel::Occlusion:
+				return 255;
+			default:
+				return 0;
+			}
+		}
+
+		std::string MakeKey(const std::string& gloss, const std::string& specular,
+			const std::string& occlusion, const std::string& metalness, const MaterialPacking& packing)
+		{
+			std::string key{ "packed:" };
+			for (const MaterialChannel channel : packing.channels)
+			{
+				const std::string* pPath{};
+				switch (channel)
+				{
+				case MaterialChannel::Gloss: pPath = &gloss; break;
+				case MaterialChannel::Specular: pPath = &specular; break;
+				case MaterialChannel::Occlusion: pPath = &occlusion; break;
+				case MaterialChannel::Metalness: pPath = &metalness; break;
+				default: break;
+				}
+				key += (pPath ? *pPath : std::string{}) + ";";
+			}
+			return key;
+		}
+
+		PackedMaterial Pack(const TextureData* pGloss, const TextureData* pSpecular,
+			const TextureData* pOcclusion, const TextureData* pMetalness, const MaterialPacking& packing)
+		{
+			PackedMaterial result{};
+			result.packing = packing;
+
+			auto getSource = [&](MaterialChannel channel) -> const TextureData*
+			{
+				const TextureData* pSource{};
+				switch (channel)
+				{
+				case MaterialChannel::Gloss: pSource = pGloss; break;
+				case MaterialChannel::Specular: pSource = pSpecular; break;
+				case MaterialChannel::Occlusion: pSource = pOcclusion; break;
+				case MaterialChannel::Metalness: pSource = pMetalness; break;
+				default: break;
+				}
+				return (pSource && pSource->IsValid()) ? pSource : nullptr;
+			};
+
+			//Output takes the size of the largest source, smaller ones are point sampled up
+			TextureData& texture{ result.texture };
+			for (const MaterialChannel channel : packing.channels)
+			{
+				if (const TextureData* pSource = getSource(channel))
+				{
+					texture.width = std::max(texture.width, pSource->width);
+					texture.height = std::max(texture.height, pSource->height);
+					result.sourceBytes += pSource->pixels.size();
+					++result.sourceCount;
+				}
+			}
+
+			if (result.sourceCount == 0)
+			{
+				texture = {};
+				return result;
+			}
+
+			auto getPath = [&](const TextureData* pSource)
+			{
+				return (pSource && pSource->IsValid()) ? pSource->path : std::string{};
+			};
+			texture.path = MakeKey(getPath(pGloss), getPath(pSpecular), getPath(pOcclusion), getPath(pMetalness), packing);
+
+			texture.pixels.resize(static_cast<size_t>(texture.width) * texture.height * 4);
+
+			for (int c{}; c < 4; ++c)
+			{
+				const MaterialChannel channel{ packing.channels[c] };
+				const TextureData* pSource{ getSource(channel) };
+
+				if (!pSource)
+				{
+					const uint8_t value{ GetDefault(channel) };
+					for (size_t i{ static_cast<size_t>(c) }; i < texture.pixels.size(); i += 4)
+					{
+						texture.pixels[i] = value;
+					}
+					continue;
+				}
+
+				for (int y{}; y < texture.height; ++y)
+				{
+					const int sourceY{ y * pSource->height / texture.height };
+					const uint8_t* pSourceRow{ pSource->pixels.data() + static_cast<size_t>(sourceY) * pSource->width * 4 };
+					uint8_t* pRow{ texture.pixels.data() + static_cast<size_t>(y) * texture.width * 4 };
+
+					for (int x{}; x < texture.width; ++x)
+					{
+						const int sourceX{ x * pSource->width / texture.width };
+						pRow[x * 4 + c] = ExtractScalar(channel, pSourceRow + sourceX * 4);
+					}
+				}
+			}
+
+			return result;
+		}
+	}
+}
@@ -0,0 +1,55 @@
+#pragma once
+#include "TextureData.h"
+
+namespace dae
+{
+	//Scalar material properties that can share one texture
+	enum class MaterialChannel : uint8_t
+	{
+		None,
+		Gloss,
+		Specular,
+		Occlusion,
+		Metalness
+	};
+
+	//Describes which property lives in which RGBA channel of a packed material texture
+	struct MaterialPacking
+	{
+		MaterialChannel channels[4]
+		{
+			MaterialChannel::Gloss,
+			MaterialChannel::Specular,
+			MaterialChannel::Occlusion,
+			MaterialChannel::Metalness
+		};
+
+		int GetChannelIndex(MaterialChannel channel) const;
+		//dot(sample, mask) extracts the property in the shader, zero mask if not packed
+		Vector4 GetMask(MaterialChannel channel) const;
+	};
+
+	struct PackedMaterial
+	{
+		TextureData texture{};
+		MaterialPacking packing{};
+
+		size_t sourceBytes{}; //size of the separate maps that went in
+		int sourceCount{};
+
+		bool IsValid() const { return !texture.path.empty(); }
+	};
+
+	namespace MaterialCook
+	{
+		//Name of the packed texture, known before any source is decoded so caches can be checked first
+		std::string MakeKey(const std::string& gloss, const std::string& specular,
+			const std::string& occlusion = {}, const std::string& metalness = {},
+			const MaterialPacking& packing = {});
+
+		//Missing maps (nullptr or not loaded) are filled with the property's default value
+		PackedMaterial Pack(const TextureData* pGloss, const TextureData* pSpecular,
+			const TextureData* pOcclusion = nullptr, const TextureData* pMetalness = nullptr,
+			const MaterialPacking& packing = {});
+	}
+}
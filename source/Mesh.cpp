@@ -1,178 +1,328 @@
 #include "pch.h"
 #include "Mesh.h"
-#include "Effect.h"
-#include "Texture.h"
+#include "Utils.h"
+#include "Camera.h"
 
 namespace dae
 {
-	Mesh::Mesh(ID3D11Device* pDevice, const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices, const MeshDataPaths& paths)
-		: m_pEffect{ new Effect{ pDevice, paths.effect } }
+	Mesh::Mesh(RenderDevice& device, const MeshData& data, TextureCache& textureCache, TextureStreamer* pStreamer,
+		const MeshArrayMaps* pArrayMaps, bool instanced)
+		: m_pDevice{ &device }
+		, m_Instanced{ instanced }
 	{
-		///Create textures
-		
-		m_pDiffuseTexture = new Texture{ pDevice, paths.diffuse };
-		m_pEffect->SetDiffuseMap(m_pDiffuseTexture);
-
-		if (!paths.normal.empty())
+		//Compile time variants of the effect, instanced meshes read the rows of a world matrix from slot 1
+		ProgramDesc programDesc{};
+		programDesc.source = data.effect;
+		if (data.material.IsValid()) programDesc.defines.push_back("PACKED_MATERIAL");
+		if (data.normal.format == TexelFormat::RG8) programDesc.defines.push_back("TWO_CHANNEL_NORMALS");
+		if (pArrayMaps) programDesc.defines.push_back("TEXTURE_ARRAYS"); //maps are Texture2DArrays, each with a slice and uv region
+		if (m_Instanced) programDesc.defines.push_back("INSTANCED"); //gWorldViewProj holds only the view projection
+		programDesc.layout =
 		{
-			m_pNormalTexture = new Texture{ pDevice, paths.normal };
-			m_pEffect->SetNormalMap(m_pNormalTexture);
-		}
-		if (!paths.specular.empty())
+			{ "POSITION", 0, VertexFormat::Float3, 0, 0 },
+			{ "NORMAL", 0, VertexFormat::Float3, 0, 12 },
+			{ "TANGENT", 0, VertexFormat::Float3, 0, 24 },
+			{ "TEXCOORD", 0, VertexFormat::Float2, 0, 36 }
+		};
+		if (m_Instanced)
 		{
-			m_pSpecularTexture = new Texture{ pDevice, paths.specular };
-			m_pEffect->SetSpecularMap(m_pSpecularTexture);
+			for (uint32_t row{}; row < 4; ++row)
+			{
+				programDesc.layout.push_back({ "WORLD", row, VertexFormat::Float4, 1, row * 16, true });
+			}
 		}
-		if (!paths.gloss.empty())
+
+		m_Program = device.CreateProgram(programDesc);
+		if (!m_Program.IsValid())
 		{
-			m_pGlossinessTexture = new Texture{ pDevice, paths.gloss };
-			m_pEffect->SetGlossinessMap(m_pGlossinessTexture);
+			return;
 		}
 
-		//Get Technique from Effect
-		m_pTechnique = m_pEffect->GetTechnique();
-
-		//Create Vertex Layout
-		static constexpr uint32_t numElements{ 4 };
-		D3D11_INPUT_ELEMENT_DESC vertexDesc[numElements]{};
+		const std::vector<Vertex>& vertices{ data.vertices };
+		//Meshlet culling needs one world matrix, instances share the index buffer
+		if (!m_Instanced)
+		{
+			m_Meshlets = data.meshlets;
+		}
 
-		vertexDesc[0].SemanticName = "POSITION";
-		vertexDesc[0].Format = DXGI_FORMAT_R32G32B32_FLOAT;
-		vertexDesc[0].AlignedByteOffset = 0;
-		vertexDesc[0].InputSlotClass = D3D11_INPUT_PER_VERTEX_DATA;
+		//The levels follow the full mesh in one index buffer
+		std::vector<uint32_t> indices{ data.indices };
+		m_LodRanges.push_back({ 0, static_cast<uint32_t>(indices.size()) });
+		m_LodErrors.push_back(0.f);
+		for (const LodLevel& level : data.lods)
+		{
+			m_LodRanges.push_back({ static_cast<uint32_t>(indices.size()), static_cast<uint32_t>(level.indices.size()) });
+			m_LodErrors.push_back(level.error);
+			indices.insert(indices.end(), level.indices.begin(), level.indices.end());
+		}
+		m_DrawRanges.push_back(m_LodRanges.front());
+		if (!m_Meshlets.empty())
+		{
+			m_Indices = indices;
+		}
 
-		vertexDesc[1].SemanticName = "NORMAL";
-		vertexDesc[1].Format = DXGI_FORMAT_R32G32B32_FLOAT;
-		vertexDesc[1].AlignedByteOffset = 12;
-		vertexDesc[1].InputSlotClass = D3D11_INPUT_PER_VERTEX_DATA;
+		///Upload textures (already decoded), streamed maps start out as their mip tail, the cache hands out shared copies.
+		///Maps packed into shared arrays are already on the GPU
+		if (pArrayMaps)
+		{
+			m_ArrayMaps = *pArrayMaps;
+		}
+		auto upload = [&](MapSlot slot, TextureCache::Handle& pCached, const TextureData& texture, const ArrayMap& arrayMap)
+		{
+			if (texture.path.empty())
+			{
+				return;
+			}
+			if (arrayMap.pArray)
+			{
+				BindMap(slot, *arrayMap.pArray);
+				device.SetVector(m_Program, GetMapName(slot) + "Region", arrayMap.region.transform);
+				device.SetScalar(m_Program, GetMapName(slot) + "Slice", static_cast<float>(arrayMap.region.slice));
+				return;
+			}
+			if (pStreamer)
+			{
+				if (TextureStreamer::Handle pStreamed = pStreamer->Acquire(device, texture.path))
+				{
+					BindMap(slot, *pStreamed->pTexture);
+					m_StreamedMaps.push_back({ slot, std::move(pStreamed) });
+					return;
+				}
+			}
+			pCached = textureCache.Acquire(device, texture);
+			if (pCached)
+			{
+				BindMap(slot, *pCached);
+			}
+		};
 
-		vertexDesc[2].SemanticName = "TANGENT";
-		vertexDesc[2].Format = DXGI_FORMAT_R32G32B32_FLOAT;
-		vertexDesc[2].AlignedByteOffset = 24;
-		vertexDesc[2].InputSlotClass = D3D11_INPUT_PER_VERTEX_DATA;
+		m_MaterialPacking = data.material.packing;
+		upload(MapSlot::Diffuse, m_pDiffuseTexture, data.diffuse, m_ArrayMaps.diffuse);
+		upload(MapSlot::Normal, m_pNormalTexture, data.normal, m_ArrayMaps.normal);
+		upload(MapSlot::Specular, m_pSpecularTexture, data.specular, m_ArrayMaps.specular);
+		upload(MapSlot::Gloss, m_pGlossinessTexture, data.gloss, m_ArrayMaps.gloss);
+		if (data.material.IsValid())
+		{
+			upload(MapSlot::Material, m_pMaterialTexture, data.material.texture, m_ArrayMaps.material);
+		}
 
-		vertexDesc[3].SemanticName = "TEXCOORD";
-		vertexDesc[3].Format = DXGI_FORMAT_R32G32_FLOAT;
-		vertexDesc[3].AlignedByteOffset = 36;
-		vertexDesc[3].InputSlotClass = D3D11_INPUT_PER_VERTEX_DATA;
+		//Bounds and UV density for mip selection, the box is for occlusion tests
+		if (!vertices.empty())
+		{
+			Vector3 minimum{ vertices[0].Position };
+			Vector3 maximum{ vertices[0].Position };
+			for (const Vertex& vertex : vertices)
+			{
+				minimum = { std::min(minimum.x, vertex.Position.x), std::min(minimum.y, vertex.Position.y), std::min(minimum.z, vertex.Position.z) };
+				maximum = { std::max(maximum.x, vertex.Position.x), std::max(maximum.y, vertex.Position.y), std::max(maximum.z, vertex.Position.z) };
+			}
+			m_BoundsMinimum = minimum;
+			m_BoundsMaximum = maximum;
+			m_BoundsCenter = (minimum + maximum) * 0.5f;
+			for (const Vertex& vertex : vertices)
+			{
+				m_BoundsRadius = std::max(m_BoundsRadius, (vertex.Position - m_BoundsCenter).Magnitude());
+			}
 
-		//Create Input Layout and quit if failed
-		D3DX11_PASS_DESC passDesc{};
-		m_pTechnique->GetPassByIndex(0)->GetDesc(&passDesc);
+			float worldArea{};
+			float uvArea{};
+			for (size_t i{}; i + 2 < data.indices.size(); i += 3)
+			{
+				const Vertex& v0{ vertices[data.indices[i]] };
+				const Vertex& v1{ vertices[data.indices[i + 1]] };
+				const Vertex& v2{ vertices[data.indices[i + 2]] };
+				worldArea += Vector3::Cross(v1.Position - v0.Position, v2.Position - v0.Position).Magnitude() * 0.5f;
+				uvArea += std::abs(Vector2::Cross(v1.UV - v0.UV, v2.UV - v0.UV)) * 0.5f;
+			}
+			m_UVDensity = worldArea > 0.f ? sqrtf(uvArea / worldArea) : 0.f;
+		}
 
-		HRESULT result{
-				pDevice->CreateInputLayout(
-				vertexDesc,
-				numElements,
-				passDesc.pIAInputSignature,
-				passDesc.IAInputSignatureSize,
-				&m_pInputLayout
-			)
-		};
+		//Create vertex buffer and quit if failed
+		BufferDesc bufferDesc{};
+		bufferDesc.binding = BufferBinding::Vertex;
+		bufferDesc.usage = BufferUsage::Immutable;
+		bufferDesc.byteWidth = sizeof(Vertex) * static_cast<uint32_t>(vertices.size());
+		bufferDesc.stride = sizeof(Vertex);
+		m_VertexBuffer = device.CreateBuffer(bufferDesc, vertices.data());
 
-		if (FAILED(result))
+		if (!m_VertexBuffer.IsValid())
 		{
 			return;
 		}
 
-		//Create vertex buffer and quit if failed
-		D3D11_BUFFER_DESC bd{};
-		bd.Usage = D3D11_USAGE_IMMUTABLE;
-		bd.ByteWidth = sizeof(Vertex) * static_cast<uint32_t>(vertices.size());
-		bd.BindFlags = D3D11_BIND_VERTEX_BUFFER;
-		bd.CPUAccessFlags = 0;
-		bd.MiscFlags = 0;
+		//Create index buffer and quit if failed, with meshlets it is rewritten every frame with the ones that survive culling
+		m_NumIndices = static_cast<uint32_t>(indices.size());
+		bufferDesc.binding = BufferBinding::Index;
+		bufferDesc.usage = m_Meshlets.empty() ? BufferUsage::Immutable : BufferUsage::Dynamic;
+		bufferDesc.byteWidth = sizeof(uint32_t) * m_NumIndices;
+		bufferDesc.stride = sizeof(uint32_t);
+		m_IndexBuffer = device.CreateBuffer(bufferDesc, indices.data());
 
-		D3D11_SUBRESOURCE_DATA initData{};
-		initData.pSysMem = vertices.data();
+		if (!m_IndexBuffer.IsValid())
+		{
+			return;
+		}
+	}
 
-		result = pDevice->CreateBuffer(&bd, &initData, &m_pVertexBuffer);
+	dae::Mesh::~Mesh()
+	{
+		m_InstanceBuffer.Release(*m_pDevice);
 
-		if (FAILED(result))
+		if (m_Program.IsValid())
 		{
-			return;
+			m_pDevice->ReleaseProgram(m_Program);
 		}
 
-		//Create index buffer and quit if failed
-		m_NumIndices = static_cast<uint32_t>(indices.size());
-		bd.Usage = D3D11_USAGE_IMMUTABLE;
-		bd.ByteWidth = sizeof(uint32_t) * m_NumIndices;
-		bd.BindFlags = D3D11_BIND_INDEX_BUFFER;
-		bd.CPUAccessFlags = 0;
-		bd.MiscFlags = 0;
-		initData.pSysMem = indices.data();
+		if (m_IndexBuffer.IsValid())
+		{
+			m_pDevice->ReleaseBuffer(m_IndexBuffer);
+		}
 
-		result = pDevice->CreateBuffer(&bd, &initData, &m_pIndexBuffer);
+		if (m_VertexBuffer.IsValid())
+		{
+			m_pDevice->ReleaseBuffer(m_VertexBuffer);
+		}
+	}
+	void Mesh::Render(RenderDevice& device) const
+	{
+		//1-3. Buffers and maps
+		Bind(device);
 
-		if (FAILED(result))
+		//4. Pack the visible meshlets to the front of the index buffer, one draw instead of one per range.
+		//Without meshlets there is one range, the selected level
+		IndexRange draw{ m_DrawRanges.empty() ? IndexRange{} : m_DrawRanges.front() };
+		if (!m_Meshlets.empty())
+		{
+			if (void* pIndices{ device.Map(m_IndexBuffer) })
+			{
+				draw = { 0, Meshlets::CompactRanges(m_DrawRanges, m_Indices.data(), static_cast<uint32_t*>(pIndices)) };
+				device.Unmap(m_IndexBuffer);
+			}
+		}
+		if (draw.indexCount == 0)
 		{
 			return;
 		}
+
+		//5. Draw, the program sets its shaders, layout and topology
+		device.SetProgram(m_Program);
+		device.DrawIndexed(draw.indexCount, draw.firstIndex, 0);
 	}
 
-	dae::Mesh::~Mesh()
+	void Mesh::RenderInstanced(RenderDevice& device, const InstanceSet& instances)
 	{
-		if (m_pIndexBuffer)
+		//1. Upload the world matrices of the visible instances
+		if (!m_Instanced || !m_InstanceBuffer.Upload(device, instances))
 		{
-			m_pIndexBuffer->Release();
+			return;
 		}
 
-		if (m_pInputLayout)
+		//2. Mesh buffers, the instances go in slot 1
+		Bind(device);
+
+		//3. One draw per level that has instances
+		device.SetProgram(m_Program);
+		m_InstanceBuffer.Draw(device, instances, m_LodRanges);
+	}
+
+	void Mesh::Bind(RenderDevice& device) const
+	{
+		//1. Set Vertex Buffer
+		device.SetVertexBuffer(0, m_VertexBuffer);
+
+		//2. Set Index Buffer
+		device.SetIndexBuffer(m_IndexBuffer);
+
+		//3. Bind streamed maps, their textures may have been swapped since last frame
+		for (const StreamedMap& map : m_StreamedMaps)
 		{
-			m_pInputLayout->Release();
+			BindMap(map.slot, *map.pTexture->pTexture);
 		}
+	}
+
+	void Mesh::SetMatrices(const Matrix& viewProj, const Matrix& invView) const
+	{
+		m_pDevice->SetMatrix(m_Program, "gWorldMatrix", m_RotationMatrix);
+		m_pDevice->SetMatrix(m_Program, "gWorldViewProj", m_Instanced ? viewProj : m_RotationMatrix * viewProj);
+		m_pDevice->SetMatrix(m_Program, "gViewInverseMatrix", invView);
+	}
 
-		if (m_pVertexBuffer)
+	const Meshlets::CullStats& Mesh::CullMeshlets(const Matrix& viewProj, const Vector3& cameraPosition, Meshlets::FaceCull faceCull)
+	{
+		if (m_Lod == 0 && !m_Meshlets.empty())
 		{
-			m_pVertexBuffer->Release();
+			m_MeshletStats = Meshlets::Cull(m_Meshlets, m_RotationMatrix, viewProj, cameraPosition, faceCull, m_DrawRanges);
+			return m_MeshletStats;
 		}
 
-		delete m_pEffect;
-		delete m_pDiffuseTexture;
-		delete m_pNormalTexture;
-		delete m_pSpecularTexture;
-		delete m_pGlossinessTexture;
+		const IndexRange& range{ m_LodRanges[m_Lod] };
+		m_DrawRanges.assign(1, range);
+		m_MeshletStats = {};
+		m_MeshletStats.triangles = m_LodRanges.front().indexCount / 3;
+		m_MeshletStats.trianglesDrawn = range.indexCount / 3;
+		m_MeshletStats.ranges = 1;
+		return m_MeshletStats;
 	}
-	void Mesh::Render(ID3D11DeviceContext* pDeviceContext) const
+
+	void Mesh::SelectLod(const Camera& camera, float screenHeight, float maxPixelError)
 	{
-		//1. Set Primitive Topology
-		pDeviceContext->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+		const Vector3 toCenter{ m_RotationMatrix.TransformPoint(m_BoundsCenter) - camera.origin };
+		const float distance{ std::max(toCenter.Magnitude() - m_BoundsRadius, camera.nearC) };
+		const float pixelsPerUnit{ screenHeight / (2.f * camera.fov * distance) };
+		m_Lod = Simplifier::SelectLevel(m_LodErrors, pixelsPerUnit, maxPixelError);
+	}
 
-		//2. Set Input Layout
-		pDeviceContext->IASetInputLayout(m_pInputLayout);
+	void Mesh::RequestMips(TextureStreamer& streamer, const Camera& camera, float screenHeight) const
+	{
+		const Vector3 toCenter{ m_RotationMatrix.TransformPoint(m_BoundsCenter) - camera.origin };
 
-		//3. Set Vertex Buffer
-		constexpr UINT stride{ sizeof(Vertex) };
-		constexpr UINT offset{ 0 };
-		pDeviceContext->IASetVertexBuffers(0, 1, &m_pVertexBuffer, &stride, &offset);
+		//Entirely behind the camera, the tails will do
+		if (Vector3::Dot(toCenter, camera.forward) < -m_BoundsRadius)
+		{
+			return;
+		}
 
-		//4. Set Index Buffer
-		pDeviceContext->IASetIndexBuffer(m_pIndexBuffer, DXGI_FORMAT_R32_UINT, 0);
+		const float distance{ std::max(toCenter.Magnitude() - m_BoundsRadius, camera.nearC) };
+		const float pixelsPerUnit{ screenHeight / (2.f * camera.fov * distance) };
 
-		//5. Draw
-		D3DX11_TECHNIQUE_DESC techDesc{};
-		m_pTechnique->GetDesc(&techDesc);
-		for (UINT p{ 0 }; p < techDesc.Passes; ++p)
+		for (const StreamedMap& map : m_StreamedMaps)
 		{
-			m_pTechnique->GetPassByIndex(p)->Apply(0, pDeviceContext);
-			pDeviceContext->DrawIndexed(m_NumIndices, 0, 0);
+			const StreamedTexture& texture{ *map.pTexture };
+			const float texelsPerUnit{ m_UVDensity * sqrtf(static_cast<float>(texture.width) * static_cast<float>(texture.height)) };
+			streamer.Request(map.pTexture, log2f(std::max(texelsPerUnit / pixelsPerUnit, 1.f)));
 		}
 	}
 
-	void Mesh::SetMatrices(const Matrix& viewProj, const Matrix& invView) const
+	void Mesh::BindMap(MapSlot slot, TextureHandle texture) const
+	{
+		m_pDevice->SetTexture(m_Program, GetMapName(slot) + "Map", texture);
+		if (slot == MapSlot::Material)
+		{
+			m_pDevice->SetVector(m_Program, "gGlossMask", m_MaterialPacking.GetMask(MaterialChannel::Gloss));
+			m_pDevice->SetVector(m_Program, "gSpecularMask", m_MaterialPacking.GetMask(MaterialChannel::Specular));
+		}
+	}
+
+	std::string Mesh::GetMapName(MapSlot slot)
 	{
-		m_pEffect->SetMatrixWorld(m_RotationMatrix);
-		m_pEffect->SetMatrixViewProj(m_RotationMatrix * viewProj);
-		m_pEffect->SetMatrixViewInv(invView);
+		switch (slot)
+		{
+		case MapSlot::Diffuse: return "gDiffuse";
+		case MapSlot::Normal: return "gNormal";
+		case MapSlot::Specular: return "gSpecular";
+		case MapSlot::Gloss: return "gGlossiness";
+		case MapSlot::Material: return "gMaterial";
+		}
+		return {};
 	}
 
-	ID3DX11EffectSamplerVariable* Mesh::GetSampleVar() const
+	void Mesh::SetSampler(SamplerHandle sampler) const
 	{
-		return m_pEffect->GetEffect()->GetVariableByName("gSampler")->AsSampler();
+		m_pDevice->SetSampler(m_Program, "gSampler", sampler);
 	}
 
-	ID3DX11EffectRasterizerVariable* Mesh::GetRasterizer() const
+	void Mesh::SetRasterizer(RasterizerHandle rasterizer) const
 	{
-		return m_pEffect->GetEffect()->GetVariableByName("gRasterizerState")->AsRasterizer();
+		m_pDevice->SetRasterizer(m_Program, "gRasterizerState", rasterizer);
 	}
-}
+}
\ No newline at end of file
@@ -1,41 +1,42 @@
 #pragma once
 #include "pch.h"
-
-class Effect;
-class Texture;
+#include "MeshData.h"
+#include "TexturePacker.h"
+#include "TextureCache.h"
+#include "TextureStreamer.h"
+#include "Instancing.h"
 
 namespace dae
 {
-	struct Vertex
+	struct Camera;
+
+	//A map that lives in a Texture2DArray shared with other meshes
+	struct ArrayMap
 	{
-		Vector3 Position;
-		Vector3 Normal;
-		Vector3 Tangent;
-		Vector2 UV;
+		SharedTexture pArray{};
+		TextureRegion region{};
 	};
 
-	struct MeshDataPaths
+	//Must cover every map the mesh has, the shader then expects arrays for all of them
+	struct MeshArrayMaps
 	{
-		std::wstring effect;
-		std::string diffuse;
-		std::string normal;
-		std::string specular;
-		std::string gloss;
-		void Clear()
-		{
-			effect.clear();
-			diffuse.clear();
-			normal.clear();
-			specular.clear();
-			gloss.clear();
-		}
+		ArrayMap diffuse;
+		ArrayMap normal;
+		ArrayMap specular;
+		ArrayMap gloss;
+		ArrayMap material;
 	};
 
 	class Mesh final
 	{
 	public:
 
-		explicit Mesh(ID3D11Device* pDevice, const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices, const MeshDataPaths& paths);
+		//Maps the streamer has prepared are streamed, everything else goes through the cache.
+		//With array maps the mesh binds those instead and draws with the TextureArrays permutation.
+		//An instanced mesh takes its world matrices from an InstanceSet and is drawn with RenderInstanced only.
+		//Buffers, maps and the program are created on the device, which must outlive the mesh
+		explicit Mesh(RenderDevice& device, const MeshData& data, TextureCache& textureCache, TextureStreamer* pStreamer = nullptr,
+			const MeshArrayMaps* pArrayMaps = nullptr, bool instanced = false);
 		~Mesh();
 
 		Mesh(const Mesh&) = delete;
@@ -43,32 +44,99 @@ namespace dae
 		Mesh& operator=(const Mesh&) = delete;
 		Mesh& operator=(Mesh&&) noexcept = delete;
 
-		void Render(ID3D11DeviceContext* pDeviceContext) const;
+		void Render(RenderDevice& device) const;
+		//Uploads the visible instances after InstanceSet::Update and draws each level's with one DrawIndexedInstanced
+		void RenderInstanced(RenderDevice& device, const InstanceSet& instances);
 
 		void SetMatrices(const Matrix& viewProj, const Matrix& invView) const;
 
+		//Picks the coarsest level whose error projects to at most maxPixelError pixels at the closest point of the bounds
+		void SelectLod(const Camera& camera, float screenHeight, float maxPixelError);
+		size_t GetLod() const { return m_Lod; }
+		//Object space, the full mesh first
+		const std::vector<float>& GetLodErrors() const { return m_LodErrors; }
+
+		//Picks the meshlets Render draws, everything when the mesh has none. Only the full mesh has meshlets,
+		//coarser levels are drawn whole
+		const Meshlets::CullStats& CullMeshlets(const Matrix& viewProj, const Vector3& cameraPosition, Meshlets::FaceCull faceCull);
+		const Meshlets::CullStats& GetMeshletStats() const { return m_MeshletStats; }
+
+		//Asks for the mip level that puts about one texel on a pixel at the closest point of the bounds
+		void RequestMips(TextureStreamer& streamer, const Camera& camera, float screenHeight) const;
+
 		void RotateY(float rotation)
 		{
 			m_RotationMatrix = Matrix::CreateRotationY(rotation) * m_RotationMatrix;
 		}
 
-		ID3DX11EffectSamplerVariable* GetSampleVar() const;
-		ID3DX11EffectRasterizerVariable* GetRasterizer() const;
+		const Matrix& GetWorldMatrix() const { return m_RotationMatrix; }
+		//Object space
+		const Vector3& GetBoundsMinimum() const { return m_BoundsMinimum; }
+		const Vector3& GetBoundsMaximum() const { return m_BoundsMaximum; }
+
+		//The program's gSampler and gRasterizerState, until then the ones in the effect file are used
+		void SetSampler(SamplerHandle sampler) const;
+		void SetRasterizer(RasterizerHandle rasterizer) const;
 	private:
+		enum class MapSlot
+		{
+			Diffuse,
+			Normal,
+			Specular,
+			Gloss,
+			Material
+		};
 
-		Effect* m_pEffect{};
-		Texture* m_pDiffuseTexture{};
-		Texture* m_pNormalTexture{};
-		Texture* m_pSpecularTexture{};
-		Texture* m_pGlossinessTexture{};
-		ID3DX11EffectTechnique* m_pTechnique{};
+		struct StreamedMap
+		{
+			MapSlot slot{};
+			TextureStreamer::Handle pTexture{};
+		};
+
+		TextureCache::Handle m_pDiffuseTexture{};
+		TextureCache::Handle m_pNormalTexture{};
+		TextureCache::Handle m_pSpecularTexture{};
+		TextureCache::Handle m_pGlossinessTexture{};
+		TextureCache::Handle m_pMaterialTexture{};
+		MaterialPacking m_MaterialPacking{};
+		MeshArrayMaps m_ArrayMaps{};
+
+		//Their textures change as mips stream in and out, so they are bound again every frame
+		std::vector<StreamedMap> m_StreamedMaps{};
+
+		//Object space, for mip selection and occlusion tests
+		Vector3 m_BoundsMinimum{};
+		Vector3 m_BoundsMaximum{};
+		Vector3 m_BoundsCenter{};
+		float m_BoundsRadius{};
+		float m_UVDensity{}; //UV units per world unit
 
-		ID3D11Buffer* m_pVertexBuffer{};
-		ID3D11InputLayout* m_pInputLayout{};
-		ID3D11Buffer* m_pIndexBuffer{};
+		RenderDevice* m_pDevice{};
+		ProgramHandle m_Program{};
+		BufferHandle m_VertexBuffer{};
+		BufferHandle m_IndexBuffer{};
+
+		bool m_Instanced{};
+		InstanceBuffer m_InstanceBuffer{};
 
 		uint32_t m_NumIndices{};
 
+		std::vector<Meshlet> m_Meshlets{};
+		std::vector<uint32_t> m_Indices{}; //meshlet order then the levels, the source for the index buffer each frame
+		std::vector<IndexRange> m_DrawRanges{};
+		Meshlets::CullStats m_MeshletStats{};
+
+		//Every level is a range of the one index buffer, the full mesh first
+		std::vector<IndexRange> m_LodRanges{};
+		std::vector<float> m_LodErrors{};
+		size_t m_Lod{};
+
 		Matrix m_RotationMatrix{ Vector3::UnitX, Vector3::UnitY, Vector3::UnitZ, Vector3::Zero };
+
+		//The vertex and index buffer and the streamed maps, topology and layout come with the program
+		void Bind(RenderDevice& device) const;
+		void BindMap(MapSlot slot, TextureHandle texture) const;
+		//Name of the slot's variables in the effect, without their Map/Region/Slice suffix
+		static std::string GetMapName(MapSlot slot);
 	};
 }
\ No newline at end of file
@@ -0,0 +1,177 @@
+#include "pch.h"
+#include "MeshData.h"
+#include "TextureCache.h"
+#include "TextureStreamer.h"
+#include "Utils.h"
+#include "JobSystem.h"
+#include <chrono>
+
+namespace dae
+{
+	MeshData MeshData::Load(const MeshDataPaths& paths, TextureCache* pCache, TextureStreamer* pStreamer, bool packMaterial, bool encodeNormals,
+		bool buildMeshlets, bool buildLods, JobSystem* pJobs)
+	{
+		MeshData data{};
+		data.effect = paths.effect;
+		data.translucent = paths.translucent;
+
+		//Decode stage, every map is a job unless the cache has it or is decoding it already.
+		//Without jobs the maps are decoded when they are taken, one after another on this thread
+		auto requestDecode = [pCache, pJobs](const std::string& path) -> std::shared_ptr<const TextureCache::Decode>
+		{
+			if (pCache && pJobs && !path.empty())
+			{
+				return pCache->RequestDecode(path, *pJobs);
+			}
+			auto pDecode{ std::make_shared<TextureCache::Decode>() };
+			if (pJobs && !path.empty())
+			{
+				pJobs->Run([pDecode, path] { pDecode->data = TextureData::Load(path); }, &pDecode->counter);
+			}
+			else
+			{
+				pDecode->data.path = path;
+			}
+			return pDecode;
+		};
+		//Waiting runs other jobs, the mesh loads and LOD builds among them
+		auto takeDecode = [pJobs](const std::shared_ptr<const TextureCache::Decode>& pDecode)
+		{
+			if (!pJobs)
+			{
+				return pDecode->data.path.empty() ? TextureData{} : TextureData::Load(pDecode->data.path);
+			}
+			pJobs->Wait(pDecode->counter);
+			return pDecode->data;
+		};
+
+		//Maps with an up to date cooked chain only need their mip tail, they are not decoded at all
+		auto prepare = [pStreamer](const std::string& path, ColorSpace colorSpace)
+		{
+			return pStreamer && !path.empty() && pStreamer->Prepare(path, { path }, colorSpace);
+		};
+
+		//A cooked material that is resident makes decoding its sources pointless
+		const std::string materialKey{ MaterialCook::MakeKey(paths.gloss, paths.specular) };
+		const bool materialResident{ packMaterial && ((pCache && pCache->Contains(materialKey))
+			|| (pStreamer && pStreamer->Prepare(materialKey, { paths.gloss, paths.specular }, ColorSpace::Linear))) };
+
+		//Same for an encoded normal map
+		const std::string normalKey{ NormalCook::MakeKey(paths.normal) };
+		const bool normalResident{ encodeNormals && !paths.normal.empty() && ((pCache && pCache->Contains(normalKey))
+			|| (pStreamer && pStreamer->Prepare(normalKey, { paths.normal }, ColorSpace::Linear, TexelFormat::RG8))) };
+
+		//Only the diffuse map holds colors, every other map is data
+		const bool diffusePrepared{ prepare(paths.diffuse, ColorSpace::sRGB) };
+		const bool normalPrepared{ !encodeNormals && prepare(paths.normal, ColorSpace::Linear) };
+		const bool specularPrepared{ !packMaterial && prepare(paths.specular, ColorSpace::Linear) };
+		const bool glossPrepared{ !packMaterial && prepare(paths.gloss, ColorSpace::Linear) };
+
+		auto diffuse{ requestDecode(diffusePrepared ? std::string{} : paths.diffuse) };
+		auto normal{ requestDecode(normalResident || normalPrepared ? std::string{} : paths.normal) };
+		auto specular{ requestDecode(materialResident || specularPrepared ? std::string{} : paths.specular) };
+		auto gloss{ requestDecode(materialResident || glossPrepared ? std::string{} : paths.gloss) };
+
+		const auto start{ std::chrono::steady_clock::now() };
+		Utils::ParseOBJ(paths.mesh, data.vertices, data.indices);
+		data.parseTime = std::chrono::duration<float>(std::chrono::steady_clock::now() - start).count();
+
+		//Mesh step: clusters of neighbouring triangles the renderer can drop when they face away or are off screen
+		if (buildMeshlets)
+		{
+			const auto meshletStart{ std::chrono::steady_clock::now() };
+			Meshlets::WeldVertices(data.vertices, data.indices);
+			data.meshlets = Meshlets::Build(data.vertices, data.indices);
+			data.meshletTime = std::chrono::duration<float>(std::chrono::steady_clock::now() - meshletStart).count();
+		}
+		//Mesh step: with a streamer the chain is cooked next to the texture chains, later runs read it back instead of simplifying
+		if (buildLods)
+		{
+			const auto lodStart{ std::chrono::steady_clock::now() };
+			const uint64_t meshHash{ pStreamer ? Simplifier::HashMesh(data.vertices, data.indices) : 0 };
+			data.lodsCooked = pStreamer && Simplifier::ReadChain(pStreamer->GetCookDirectory(), meshHash, data.lods);
+			if (data.lodsCooked)
+			{
+				data.lodTime = std::chrono::duration<float>(std::chrono::steady_clock::now() - lodStart).count();
+			}
+			else
+			{
+				data.lods = Simplifier::BuildChain(data.vertices, data.indices, pJobs, &data.lodTime);
+				if (pStreamer && !Simplifier::WriteChain(pStreamer->GetCookDirectory(), meshHash, data.lods))
+				{
+					std::cout << "MeshData: failed to cook the LOD chain of " << paths.mesh << "\n";
+				}
+			}
+		}
+
+		data.diffuse = takeDecode(diffuse);
+		data.normal = takeDecode(normal);
+		data.specular = takeDecode(specular);
+		data.gloss = takeDecode(gloss);
+
+		data.diffuse.colorSpace = ColorSpace::sRGB;
+
+		if (diffusePrepared) data.diffuse.path = paths.diffuse;
+		if (normalPrepared) data.normal.path = paths.normal;
+		if (specularPrepared) data.specular.path = paths.specular;
+		if (glossPrepared) data.gloss.path = paths.gloss;
+
+		//Cook step: scalar maps share one texture so the PS needs a single fetch for them
+		if (materialResident)
+		{
+			data.material.texture.path = materialKey;
+		}
+		else if (packMaterial && (data.gloss.IsValid() || data.specular.IsValid()))
+		{
+			data.material = MaterialCook::Pack(&data.gloss, &data.specular);
+			data.material.texture.decodeTime = data.gloss.decodeTime + data.specular.decodeTime;
+			data.specular = {};
+			data.gloss = {};
+
+			if (pStreamer)
+			{
+				pStreamer->Prepare(materialKey, { paths.gloss, paths.specular }, data.material.texture);
+			}
+		}
+
+		//Cook step: tangent-space normals are unit length, x and y are enough to rebuild z
+		if (normalResident)
+		{
+			data.normal.path = normalKey;
+			data.normal.format = TexelFormat::RG8;
+		}
+		else if (encodeNormals && data.normal.IsValid())
+		{
+			const float decodeTime{ data.normal.decodeTime };
+			EncodedNormals encoded{ NormalCook::Encode(data.normal) };
+			data.normal = std::move(encoded.texture);
+			data.normal.decodeTime = decodeTime;
+			data.normalError = encoded.error;
+		}
+
+		//Freshly decoded maps get their chain cooked so the next start skips the decode
+		if (pStreamer)
+		{
+			const std::pair<const TextureData*, const std::string*> cooks[]
+			{
+				{ &data.diffuse, &paths.diffuse },
+				{ &data.normal, &paths.normal },
+				{ &data.specular, &paths.specular },
+				{ &data.gloss, &paths.gloss }
+			};
+			for (const auto& [pTexture, pSource] : cooks)
+			{
+				if (pTexture->IsValid())
+				{
+					pStreamer->Prepare(pTexture->path, { *pSource }, *pTexture);
+				}
+			}
+		}
+		return data;
+	}
+
+	float MeshData::GetDecodeTime() const
+	{
+		return diffuse.decodeTime + normal.decodeTime + specular.decodeTime + gloss.decodeTime + material.texture.decodeTime;
+	}
+}
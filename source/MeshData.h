@@ -0,0 +1,79 @@
+#pragma once
+#include <string>
+#include <vector>
+
+#include "Math.h"
+#include "TextureData.h"
+#include "MaterialCook.h"
+#include "NormalCook.h"
+#include "Meshlets.h"
+#include "Simplifier.h"
+
+//Mesh and texture data in CPU memory. Nothing here touches the GPU, so the software renderer and the
+//cooks build without D3D
+namespace dae
+{
+	class TextureCache;
+	class TextureStreamer;
+	class JobSystem;
+
+	struct Vertex
+	{
+		Vector3 Position;
+		Vector3 Normal;
+		Vector3 Tangent;
+		Vector2 UV;
+	};
+
+	struct MeshDataPaths
+	{
+		std::string mesh;
+		std::wstring effect;
+		std::string diffuse;
+		std::string normal;
+		std::string specular;
+		std::string gloss;
+		bool translucent{}; //blended after the opaque meshes, never an occluder
+		void Clear()
+		{
+			mesh.clear();
+			effect.clear();
+			diffuse.clear();
+			normal.clear();
+			specular.clear();
+			gloss.clear();
+			translucent = false;
+		}
+	};
+
+	//Everything a Mesh needs in CPU memory, loading it touches no D3D state.
+	//Maps the cache already holds, or the streamer has prepared, come back as a path without pixels.
+	struct MeshData
+	{
+		std::vector<Vertex> vertices;
+		std::vector<uint32_t> indices; //in meshlet order when there are meshlets
+		std::vector<Meshlet> meshlets;
+		std::vector<LodLevel> lods; //coarser index buffers over the same vertices, indices stays the full mesh
+		std::wstring effect;
+		bool translucent{};
+		TextureData diffuse;
+		TextureData normal;
+		TextureData specular;
+		TextureData gloss;
+		PackedMaterial material; //replaces specular and gloss when cooked
+		NormalErrorStats normalError; //of the two-channel normal map, when it was encoded during this load
+
+		float parseTime{}; //seconds spent in ParseOBJ
+		float meshletTime{}; //seconds spent welding and building meshlets
+		float lodTime{}; //seconds spent simplifying every level one after another, or reading the cooked chain back
+		bool lodsCooked{}; //the LOD chain was read from the cook of an earlier run
+
+		//Decodes all maps concurrently while the obj is parsed on the calling thread.
+		//With a streamer, maps are cooked into mip chains and only their tails are kept. With jobs the levels of detail are built on them
+		static MeshData Load(const MeshDataPaths& paths, TextureCache* pCache, TextureStreamer* pStreamer, bool packMaterial = true,
+			bool encodeNormals = true, bool buildMeshlets = true, bool buildLods = true, JobSystem* pJobs = nullptr);
+		float GetDecodeTime() const;
+		//What parsing, decoding and building take on a single thread
+		float GetSerialLoadTime() const { return parseTime + meshletTime + lodTime + GetDecodeTime(); }
+	};
+}
@@ -0,0 +1,325 @@
+#include "pch.h"
+#include "Meshlets.h"
+#include "MeshData.h"
+#include "FrustumCuller.h"
+#include <array>
+#include <chrono>
+#include <map>
+
+namespace dae
+{
+	namespace Meshlets
+	{
+		namespace
+		{
+			constexpr uint32_t noMeshlet{ ~0u };
+			//cos(45 degrees) between a joining face and the cluster's mean normal. Without it the cones of the vehicle's
+			//clusters open so wide that few can ever face away
+			constexpr float minimumAlignment{ 0.7071f };
+
+			Vector3 GetFaceNormal(const std::vector<Vertex>& vertices, const uint32_t* pTriangle)
+			{
+				const Vector3& p0{ vertices[pTriangle[0]].Position };
+				const Vector3 normal{ Vector3::Cross(vertices[pTriangle[1]].Position - p0, vertices[pTriangle[2]].Position - p0) };
+				const float length{ normal.Magnitude() };
+				return length > 0.f ? normal / length : Vector3{};
+			}
+
+			//Sphere around the box of the vertices, cone around the mean face normal
+			void ComputeBounds(const std::vector<Vertex>& vertices, const uint32_t* pIndices, const std::vector<Vector3>& faceNormals,
+				uint32_t firstTriangle, Meshlet& meshlet)
+			{
+				Vector3 minimum{ vertices[pIndices[0]].Position };
+				Vector3 maximum{ minimum };
+				Vector3 normalSum{};
+				for (uint32_t i{}; i < meshlet.triangleCount * 3; ++i)
+				{
+					const Vector3& position{ vertices[pIndices[i]].Position };
+					minimum = { std::min(minimum.x, position.x), std::min(minimum.y, position.y), std::min(minimum.z, position.z) };
+					maximum = { std::max(maximum.x, position.x), std::max(maximum.y, position.y), std::max(maximum.z, position.z) };
+				}
+				for (uint32_t triangle{}; triangle < meshlet.triangleCount; ++triangle)
+				{
+					normalSum += faceNormals[firstTriangle + triangle];
+				}
+
+				meshlet.center = (minimum + maximum) * 0.5f;
+				for (uint32_t i{}; i < meshlet.triangleCount * 3; ++i)
+				{
+					meshlet.radius = std::max(meshlet.radius, (vertices[pIndices[i]].Position - meshlet.center).Magnitude());
+				}
+
+				const float sumLength{ normalSum.Magnitude() };
+				if (sumLength <= 0.f)
+				{
+					return;
+				}
+				meshlet.coneAxis = normalSum / sumLength;
+				float minimumDot{ 1.f };
+				for (uint32_t triangle{}; triangle < meshlet.triangleCount; ++triangle)
+				{
+					minimumDot = std::min(minimumDot, Vector3::Dot(faceNormals[firstTriangle + triangle], meshlet.coneAxis));
+				}
+				//A degenerate face has no normal and could face anywhere
+				if (minimumDot > 0.f)
+				{
+					meshlet.coneCutoff = sqrtf(1.f - minimumDot * minimumDot);
+				}
+			}
+		}
+
+		CullStats& CullStats::operator+=(const CullStats& other)
+		{
+			meshlets += other.meshlets;
+			offscreen += other.offscreen;
+			facingAway += other.facingAway;
+			triangles += other.triangles;
+			trianglesDrawn += other.trianglesDrawn;
+			ranges += other.ranges;
+			microseconds += other.microseconds;
+			return *this;
+		}
+
+		void WeldVertices(std::vector<Vertex>& vertices, std::vector<uint32_t>& indices)
+		{
+			std::map<std::array<float, 8>, uint32_t> lookup{};
+			std::vector<Vertex> welded{};
+			std::vector<uint32_t> remap(vertices.size());
+			for (size_t i{}; i < vertices.size(); ++i)
+			{
+				const Vertex& vertex{ vertices[i] };
+				const std::array<float, 8> key{ vertex.Position.x, vertex.Position.y, vertex.Position.z, vertex.Normal.x, vertex.Normal.y,
+					vertex.Normal.z, vertex.UV.x, vertex.UV.y };
+				const auto [it, inserted] { lookup.try_emplace(key, static_cast<uint32_t>(welded.size())) };
+				if (inserted)
+				{
+					welded.push_back(vertex);
+				}
+				else
+				{
+					welded[it->second].Tangent += vertex.Tangent;
+				}
+				remap[i] = it->second;
+			}
+
+			for (Vertex& vertex : welded)
+			{
+				if (vertex.Tangent.SqrMagnitude() > 0.f)
+				{
+					vertex.Tangent.Normalize();
+				}
+			}
+			for (uint32_t& index : indices)
+			{
+				index = remap[index];
+			}
+			vertices = std::move(welded);
+		}
+
+		std::vector<Meshlet> Build(const std::vector<Vertex>& vertices, std::vector<uint32_t>& indices)
+		{
+			const size_t triangleCount{ indices.size() / 3 };
+
+			//Triangles around every position. Hard edges and UV seams split vertices, but the triangles on
+			//either side are still neighbours
+			std::map<std::array<float, 3>, uint32_t> positionLookup{};
+			std::vector<uint32_t> positionIds(vertices.size());
+			for (size_t i{}; i < vertices.size(); ++i)
+			{
+				const Vector3& position{ vertices[i].Position };
+				positionIds[i] = positionLookup.try_emplace({ position.x, position.y, position.z }, static_cast<uint32_t>(positionLookup.size())).first->second;
+			}
+			std::vector<uint32_t> adjacencyOffsets(positionLookup.size() + 1);
+			for (const uint32_t index : indices)
+			{
+				++adjacencyOffsets[positionIds[index] + 1];
+			}
+			for (size_t i{ 1 }; i < adjacencyOffsets.size(); ++i)
+			{
+				adjacencyOffsets[i] += adjacencyOffsets[i - 1];
+			}
+			std::vector<uint32_t> adjacency(indices.size());
+			std::vector<uint32_t> adjacencyFill(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+			for (size_t i{}; i < indices.size(); ++i)
+			{
+				adjacency[adjacencyFill[positionIds[indices[i]]]++] = static_cast<uint32_t>(i / 3);
+			}
+
+			std::vector<Vector3> faceNormals(triangleCount);
+			for (size_t triangle{}; triangle < triangleCount; ++triangle)
+			{
+				faceNormals[triangle] = GetFaceNormal(vertices, &indices[triangle * 3]);
+			}
+
+			std::vector<Meshlet> meshlets{};
+			std::vector<uint32_t> ordered{};
+			ordered.reserve(indices.size());
+			std::vector<Vector3> orderedNormals{};
+			orderedNormals.reserve(triangleCount);
+			std::vector<bool> emitted(triangleCount);
+			std::vector<uint32_t> vertexMeshlet(vertices.size(), noMeshlet); //the last meshlet that took the vertex
+			std::vector<uint32_t> candidates{};
+
+			size_t seed{};
+			while (true)
+			{
+				while (seed < triangleCount && emitted[seed])
+				{
+					++seed;
+				}
+				if (seed == triangleCount)
+				{
+					break;
+				}
+
+				const uint32_t meshletIndex{ static_cast<uint32_t>(meshlets.size()) };
+				Meshlet meshlet{};
+				meshlet.firstIndex = static_cast<uint32_t>(ordered.size());
+				Vector3 normalSum{};
+				candidates.assign(1, static_cast<uint32_t>(seed));
+				while (meshlet.triangleCount < maxTriangles)
+				{
+					const Vector3 axis{ normalSum.SqrMagnitude() > 0.f ? normalSum.Normalized() : Vector3{} };
+					uint32_t best{ noMeshlet };
+					uint32_t bestNewVertices{ 4 };
+					float bestAlignment{};
+					for (size_t i{}; i < candidates.size();)
+					{
+						const uint32_t triangle{ candidates[i] };
+						if (emitted[triangle])
+						{
+							candidates[i] = candidates.back();
+							candidates.pop_back();
+							continue;
+						}
+						++i;
+
+						uint32_t newVertices{};
+						for (int corner{}; corner < 3; ++corner)
+						{
+							newVertices += vertexMeshlet[indices[triangle * 3 + corner]] != meshletIndex;
+						}
+						if (meshlet.vertexCount + newVertices > maxVertices)
+						{
+							continue;
+						}
+						const float alignment{ Vector3::Dot(faceNormals[triangle], axis) };
+						if (meshlet.triangleCount > 0 && alignment < minimumAlignment)
+						{
+							continue;
+						}
+						if (newVertices < bestNewVertices || (newVertices == bestNewVertices && alignment > bestAlignment))
+						{
+							best = triangle;
+							bestNewVertices = newVertices;
+							bestAlignment = alignment;
+						}
+					}
+					if (best == noMeshlet)
+					{
+						break;
+					}
+
+					emitted[best] = true;
+					for (int corner{}; corner < 3; ++corner)
+					{
+						const uint32_t vertex{ indices[best * 3 + corner] };
+						ordered.push_back(vertex);
+						if (vertexMeshlet[vertex] == meshletIndex)
+						{
+							continue;
+						}
+						vertexMeshlet[vertex] = meshletIndex;
+						++meshlet.vertexCount;
+						const uint32_t position{ positionIds[vertex] };
+						candidates.insert(candidates.end(), adjacency.begin() + adjacencyOffsets[position], adjacency.begin() + adjacencyOffsets[position + 1]);
+					}
+					orderedNormals.push_back(faceNormals[best]);
+					normalSum += faceNormals[best];
+					++meshlet.triangleCount;
+				}
+
+				ComputeBounds(vertices, &ordered[meshlet.firstIndex], orderedNormals, meshlet.firstIndex / 3, meshlet);
+				meshlets.push_back(meshlet);
+			}
+
+			indices = std::move(ordered);
+			return meshlets;
+		}
+
+		CullStats Cull(const std::vector<Meshlet>& meshlets, const Matrix& world, const Matrix& viewProjection, const Vector3& cameraPosition,
+			FaceCull faceCull, std::vector<IndexRange>& ranges)
+		{
+			const auto start{ std::chrono::steady_clock::now() };
+			CullStats stats{};
+			stats.meshlets = meshlets.size();
+			ranges.clear();
+
+			//Planes of the object-space frustum scaled to give distances, so spheres need no transform
+			std::array<Vector4, 6> planes{ FrustumCuller::ExtractPlanes(world * viewProjection) };
+			for (Vector4& plane : planes)
+			{
+				plane = plane * (1.f / plane.GetXYZ().Magnitude());
+			}
+			const Vector3 camera{ Matrix::Inverse(world).TransformPoint(cameraPosition) };
+			const float axisSign{ faceCull == FaceCull::Front ? -1.f : 1.f };
+
+			//Written out, the vector helpers live in other translation units and would not inline
+			for (const Meshlet& meshlet : meshlets)
+			{
+				stats.triangles += meshlet.triangleCount;
+				const Vector3& center{ meshlet.center };
+				bool offscreen{};
+				for (const Vector4& plane : planes)
+				{
+					offscreen |= plane.x * center.x + plane.y * center.y + plane.z * center.z + plane.w < -meshlet.radius;
+				}
+				if (offscreen)
+				{
+					++stats.offscreen;
+					continue;
+				}
+
+				//Every point of the sphere sees every normal of the cone from behind
+				if (faceCull != FaceCull::None && meshlet.coneCutoff < 1.f)
+				{
+					const float toCenterX{ center.x - camera.x };
+					const float toCenterY{ center.y - camera.y };
+					const float toCenterZ{ center.z - camera.z };
+					const float distance{ sqrtf(toCenterX * toCenterX + toCenterY * toCenterY + toCenterZ * toCenterZ) };
+					const Vector3& axis{ meshlet.coneAxis };
+					if (axisSign * (toCenterX * axis.x + toCenterY * axis.y + toCenterZ * axis.z) >= meshlet.coneCutoff * distance + meshlet.radius)
+					{
+						++stats.facingAway;
+						continue;
+					}
+				}
+
+				stats.trianglesDrawn += meshlet.triangleCount;
+				if (!ranges.empty() && ranges.back().firstIndex + ranges.back().indexCount == meshlet.firstIndex)
+				{
+					ranges.back().indexCount += meshlet.triangleCount * 3;
+				}
+				else
+				{
+					ranges.push_back({ meshlet.firstIndex, meshlet.triangleCount * 3 });
+				}
+			}
+
+			stats.ranges = ranges.size();
+			stats.microseconds = std::chrono::duration<float, std::micro>(std::chrono::steady_clock::now() - start).count();
+			return stats;
+		}
+
+		uint32_t CompactRanges(const std::vector<IndexRange>& ranges, const uint32_t* pSource, uint32_t* pDestination)
+		{
+			uint32_t count{};
+			for (const IndexRange& range : ranges)
+			{
+				std::copy_n(pSource + range.firstIndex, range.indexCount, pDestination + count);
+				count += range.indexCount;
+			}
+			return count;
+		}
+	}
+}
@@ -0,0 +1,80 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+
+#include "Math.h"
+
+namespace dae
+{
+	struct Vertex;
+
+	//A cluster of neighbouring triangles that is kept or dropped as a whole, one contiguous run of the
+	//index buffer. The sphere and the cone of its face normals are in object space
+	struct Meshlet
+	{
+		uint32_t firstIndex{};
+		uint32_t triangleCount{};
+		uint32_t vertexCount{};
+
+		Vector3 center{};
+		float radius{};
+		//Every face normal is within the cone around axis, cutoff is the sine of its half angle.
+		//Cones of 90 degrees and wider can never face away and have a cutoff of 1
+		Vector3 coneAxis{};
+		float coneCutoff{ 1.f };
+	};
+
+	//Indices to draw with one DrawIndexed
+	struct IndexRange
+	{
+		uint32_t firstIndex{};
+		uint32_t indexCount{};
+	};
+
+	namespace Meshlets
+	{
+		constexpr size_t maxVertices{ 64 };
+		constexpr size_t maxTriangles{ 124 };
+
+		//Which faces the rasterizer drops, clusters facing only that way are dropped too
+		enum class FaceCull
+		{
+			None,
+			Back,
+			Front
+		};
+
+		struct CullStats
+		{
+			size_t meshlets{};
+			size_t offscreen{}; //outside the frustum
+			size_t facingAway{};
+			size_t triangles{};
+			size_t trianglesDrawn{};
+			size_t ranges{};
+			float microseconds{};
+
+			CullStats& operator+=(const CullStats& other);
+		};
+
+		//Merges vertices with the same position, normal and UV and averages their tangents. The OBJ loader
+		//gives every face its own corners, which leaves nothing for a cluster to share. Its tangents are per
+		//face, so normal mapped shading turns smooth across welded faces: keeping them welds almost nothing
+		//(34914 -> 33362 vertices of the vehicle instead of 12965)
+		void WeldVertices(std::vector<Vertex>& vertices, std::vector<uint32_t>& indices);
+
+		//Grows each meshlet from a seed triangle through the triangles sharing a position with it, taking the one
+		//that adds the fewest vertices and then the one whose normal is closest to the cluster's. Faces turned too
+		//far from the cluster start a new one. Indices are reordered so every meshlet is a contiguous run, winding
+		//is kept. Front faces are clockwise like D3D11's default
+		std::vector<Meshlet> Build(const std::vector<Vertex>& vertices, std::vector<uint32_t>& indices);
+
+		//Frustum and cone tests in object space, world may rotate, translate and scale uniformly. Consecutive
+		//survivors are merged into one range. Conservative: a dropped meshlet has no visible front face
+		CullStats Cull(const std::vector<Meshlet>& meshlets, const Matrix& world, const Matrix& viewProjection, const Vector3& cameraPosition,
+			FaceCull faceCull, std::vector<IndexRange>& ranges);
+
+		//Copies the ranges of pSource back to back into pDestination, returns how many indices that were
+		uint32_t CompactRanges(const std::vector<IndexRange>& ranges, const uint32_t* pSource, uint32_t* pDestination);
+	}
+}
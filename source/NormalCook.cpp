@@ -0,0 +1,156 @@
+#include "pch.h"
+#include "NormalCook.h"
+
+namespace dae
+{
+	namespace NormalCook
+	{
+		//UNORM code -> [-1, 1]
+		static float ToComponent(int code)
+		{
+			return code * (2.f / 255.f) - 1.f;
+		}
+
+		static Vector3 Reconstruct(float x, float y)
+		{
+			//Filtering or quantization can push x, y past the unit circle, z is 0 there and the rest is renormalized
+			const float lengthSq{ x * x + y * y };
+			if (lengthSq >= 1.f)
+			{
+				const float length{ sqrtf(lengthSq) };
+				return { x / length, y / length, 0.f };
+			}
+			return { x, y, sqrtf(1.f - lengthSq) };
+		}
+
+		//Normal must be unit length with z >= 0
+		static void EncodeNormal(const Vector3& normal, uint8_t* pTexel)
+		{
+			const float x{ (normal.x * 0.5f + 0.5f) * 255.f };
+			const float y{ (normal.y * 0.5f + 0.5f) * 255.f };
+			const int x0{ std::clamp(static_cast<int>(x), 0, 254) };
+			const int y0{ std::clamp(static_cast<int>(y), 0, 254) };
+
+			float bestDot{ -2.f };
+			for (int cy{ y0 }; cy <= y0 + 1; ++cy)
+			{
+				for (int cx{ x0 }; cx <= x0 + 1; ++cx)
+				{
+					const float dot{ Vector3::Dot(Reconstruct(ToComponent(cx), ToComponent(cy)), normal) };
+					if (dot > bestDot)
+					{
+						bestDot = dot;
+						pTexel[0] = static_cast<uint8_t>(cx);
+						pTexel[1] = static_cast<uint8_t>(cy);
+					}
+				}
+			}
+		}
+
+		std::string MakeKey(const std::string& path)
+		{
+			return path.empty() ? std::string{} : "rg8:" + path;
+		}
+
+		EncodedNormals Encode(const TextureData& source)
+		{
+			EncodedNormals result{};
+			if (!source.IsValid() || source.format != TexelFormat::RGBA8)
+			{
+				return result;
+			}
+
+			TextureData& texture{ result.texture };
+			texture.path = MakeKey(source.path);
+			texture.width = source.width;
+			texture.height = source.height;
+			texture.format = TexelFormat::RG8;
+			texture.pixels.resize(static_cast<size_t>(texture.width) * texture.height * GetTexelSize(TexelFormat::RG8));
+			result.sourceBytes = source.pixels.size();
+
+			NormalErrorStats& error{ result.error };
+			double sumDegrees{};
+			double sumSqDegrees{};
+			const size_t texelCount{ static_cast<size_t>(texture.width) * texture.height };
+			for (size_t i{}; i < texelCount; ++i)
+			{
+				const uint8_t* pSource{ source.pixels.data() + i * 4 };
+				Vector3 normal{ ToComponent(pSource[0]), ToComponent(pSource[1]), ToComponent(pSource[2]) };
+				if (normal.z < 0.f)
+				{
+					++error.belowHorizon;
+					normal.z = 0.f;
+				}
+				if (normal.Normalize() <= 0.f)
+				{
+					normal = Vector3::UnitZ;
+				}
+
+				uint8_t* pTexel{ texture.pixels.data() + i * 2 };
+				EncodeNormal(normal, pTexel);
+
+				//Error against the source as it was, including the fold onto the horizon
+				const Vector3 original{ Vector3{ ToComponent(pSource[0]), ToComponent(pSource[1]), ToComponent(pSource[2]) }.Normalized() };
+				const float dot{ std::clamp(Vector3::Dot(Decode(pTexel[0], pTexel[1]), original), -1.f, 1.f) };
+				const float degrees{ acosf(dot) * TO_DEGREES };
+				sumDegrees += degrees;
+				sumSqDegrees += static_cast<double>(degrees) * degrees;
+				error.maxDegrees = std::max(error.maxDegrees, degrees);
+			}
+
+			error.texels = texelCount;
+			error.meanDegrees = static_cast<float>(sumDegrees / texelCount);
+			error.rmsDegrees = static_cast<float>(sqrt(sumSqDegrees / texelCount));
+			return result;
+		}
+
+		Vector3 Decode(uint8_t x, uint8_t y)
+		{
+			return Reconstruct(ToComponent(x), ToComponent(y));
+		}
+
+		std::vector<std::vector<uint8_t>> BuildMipChain(const uint8_t* pTexels, int width, int height)
+		{
+			std::vector<std::vector<uint8_t>> levels{};
+			levels.emplace_back(pTexels, pTexels + static_cast<size_t>(width) * height * 2);
+
+			//Odd sizes reuse the last row/column, like MipChain::Build
+			while (width > 1 || height > 1)
+			{
+				const std::vector<uint8_t>& source{ levels.back() };
+				const int levelWidth{ std::max(1, width / 2) };
+				const int levelHeight{ std::max(1, height / 2) };
+				std::vector<uint8_t> level(static_cast<size_t>(levelWidth) * levelHeight * 2);
+
+				for (int y{}; y < levelHeight; ++y)
+				{
+					const int y0{ std::min(y * 2, height - 1) };
+					const int y1{ std::min(y * 2 + 1, height - 1) };
+					for (int x{}; x < levelWidth; ++x)
+					{
+						const int x0{ std::min(x * 2, width - 1) };
+						const int x1{ std::min(x * 2 + 1, width - 1) };
+						const auto texel = [&](int tx, int ty)
+						{
+							const uint8_t* pTexel{ source.data() + (static_cast<size_t>(ty) * width + tx) * 2 };
+							return Decode(pTexel[0], pTexel[1]);
+						};
+
+						Vector3 sum{ texel(x0, y0) + texel(x1, y0) + texel(x0, y1) + texel(x1, y1) };
+						if (sum.Normalize() <= 0.f)
+						{
+							sum = Vector3::UnitZ;
+						}
+						EncodeNormal(sum, level.data() + (static_cast<size_t>(y) * levelWidth + x) * 2);
+					}
+				}
+
+				width = levelWidth;
+				height = levelHeight;
+				levels.push_back(std::move(level));
+			}
+
+			return levels;
+		}
+	}
+}
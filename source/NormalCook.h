@@ -0,0 +1,42 @@
+#pragma once
+#include "TextureData.h"
+
+namespace dae
+{
+	//Angle between the stored normals and the normalized source, in degrees
+	struct NormalErrorStats
+	{
+		size_t texels{};
+		size_t belowHorizon{}; //source normals pointing into the surface, folded onto the horizon
+		float meanDegrees{};
+		float rmsDegrees{};
+		float maxDegrees{};
+	};
+
+	struct EncodedNormals
+	{
+		TextureData texture{}; //RG8
+		NormalErrorStats error{};
+
+		size_t sourceBytes{};
+
+		bool IsValid() const { return texture.IsValid(); }
+	};
+
+	namespace NormalCook
+	{
+		//Name of the encoded map, known before the source is decoded so caches can be checked first
+		std::string MakeKey(const std::string& path);
+
+		//RGBA8 tangent-space normal map -> RG8 holding x and y. Each texel takes whichever of the
+		//neighbouring code pairs decodes closest in angle, not just the rounded one
+		EncodedNormals Encode(const TextureData& source);
+
+		//Unit normal from a stored x, y pair, z = sqrt(1 - x^2 - y^2) like the shader
+		Vector3 Decode(uint8_t x, uint8_t y);
+
+		//Every level of an RG8 map down to 1x1, finest first. 2x2 boxes of decoded normals are
+		//averaged and renormalized, averaging the codes would shorten them and drift z
+		std::vector<std::vector<uint8_t>> BuildMipChain(const uint8_t* pTexels, int width, int height);
+	}
+}
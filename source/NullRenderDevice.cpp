@@ -0,0 +1,520 @@
+#include "pch.h"
+#include "NullRenderDevice.h"
+#include "TextureData.h"
+
+namespace dae
+{
+	NullRenderDevice::NullRenderDevice(int width, int height)
+		: m_Width{ width }
+		, m_Height{ height }
+	{
+	}
+
+	BufferHandle NullRenderDevice::CreateBuffer(const BufferDesc& desc, const void* pData)
+	{
+		if (desc.byteWidth == 0 || desc.stride == 0)
+		{
+			Error("CreateBuffer: empty buffer or no stride");
+			return {};
+		}
+		if (desc.binding == BufferBinding::Index && desc.stride != sizeof(uint32_t))
+		{
+			Error("CreateBuffer: index buffers hold 32-bit indices");
+			return {};
+		}
+		if (desc.usage == BufferUsage::Immutable && !pData)
+		{
+			Error("CreateBuffer: immutable buffer without data");
+			return {};
+		}
+
+		Buffer buffer{ desc, true };
+		if (desc.usage == BufferUsage::Dynamic)
+		{
+			buffer.bytes.resize(desc.byteWidth);
+			if (pData)
+			{
+				std::copy_n(static_cast<const uint8_t*>(pData), desc.byteWidth, buffer.bytes.data());
+			}
+		}
+		m_Buffers.push_back(std::move(buffer));
+		return { static_cast<uint32_t>(m_Buffers.size()) };
+	}
+
+	void NullRenderDevice::ReleaseBuffer(BufferHandle buffer)
+	{
+		if (Buffer* pBuffer{ FindBuffer(buffer, "ReleaseBuffer") })
+		{
+			*pBuffer = {};
+		}
+	}
+
+	void* NullRenderDevice::Map(BufferHandle buffer)
+	{
+		Buffer* pBuffer{ FindBuffer(buffer, "Map") };
+		if (!pBuffer)
+		{
+			return nullptr;
+		}
+		if (pBuffer->desc.usage != BufferUsage::Dynamic)
+		{
+			Error("Map: buffer " + std::to_string(buffer.id) + " is immutable");
+			return nullptr;
+		}
+		if (pBuffer->mapped)
+		{
+			Error("Map: buffer " + std::to_string(buffer.id) + " is already mapped");
+		}
+		pBuffer->mapped = true;
+		m_Stats.bytesMapped += pBuffer->desc.byteWidth;
+		Record(CommandType::Map, { buffer.id });
+		return pBuffer->bytes.data();
+	}
+
+	void NullRenderDevice::Unmap(BufferHandle buffer)
+	{
+		Buffer* pBuffer{ FindBuffer(buffer, "Unmap") };
+		if (!pBuffer)
+		{
+			return;
+		}
+		if (!pBuffer->mapped)
+		{
+			Error("Unmap: buffer " + std::to_string(buffer.id) + " is not mapped");
+		}
+		pBuffer->mapped = false;
+		Record(CommandType::Unmap, { buffer.id });
+	}
+
+	TextureHandle NullRenderDevice::CreateTexture(const TextureDesc& desc, const std::vector<const void*>& mips)
+	{
+		const int maxMips{ 1 + static_cast<int>(std::log2(std::max(std::max(desc.width, desc.height), 1))) };
+		if (desc.width <= 0 || desc.height <= 0 || desc.mipLevels < 1 || desc.mipLevels > maxMips || desc.arraySize < 0)
+		{
+			Error("CreateTexture: bad size, mip or slice count");
+			return {};
+		}
+		const bool filled{ static_cast<int>(mips.size()) == desc.mipLevels * std::max(desc.arraySize, 1) };
+		if ((!mips.empty() && !filled) || std::find(mips.begin(), mips.end(), nullptr) != mips.end())
+		{
+			Error("CreateTexture: needs data for every mip of every slice or none");
+			return {};
+		}
+		m_Textures.push_back(desc);
+		m_TexturesAlive.push_back(true);
+		return { static_cast<uint32_t>(m_Textures.size()) };
+	}
+
+	void NullRenderDevice::ReleaseTexture(TextureHandle texture)
+	{
+		if (!texture.IsValid() || texture.id > m_TexturesAlive.size() || !m_TexturesAlive[texture.id - 1])
+		{
+			Error("ReleaseTexture: no texture " + std::to_string(texture.id));
+			return;
+		}
+		m_TexturesAlive[texture.id - 1] = false;
+	}
+
+	void NullRenderDevice::UpdateTexture(TextureHandle texture, int mip, const void* pData)
+	{
+		const TextureDesc* pDesc{ FindTexture(texture, "UpdateTexture") };
+		if (!pDesc)
+		{
+			return;
+		}
+		if (pDesc->arraySize > 0 || mip < 0 || mip >= pDesc->mipLevels || !pData)
+		{
+			Error("UpdateTexture: texture " + std::to_string(texture.id) + " is an array, has no mip " + std::to_string(mip) + " or got no data");
+		}
+	}
+
+	void NullRenderDevice::CopyTextureLevels(TextureHandle source, int sourceMip, TextureHandle destination, int destinationMip, int count)
+	{
+		const TextureDesc* pSource{ FindTexture(source, "CopyTextureLevels") };
+		const TextureDesc* pDestination{ FindTexture(destination, "CopyTextureLevels") };
+		if (!pSource || !pDestination)
+		{
+			return;
+		}
+		if (count < 0 || sourceMip < 0 || destinationMip < 0 || sourceMip + count > pSource->mipLevels || destinationMip + count > pDestination->mipLevels)
+		{
+			Error("CopyTextureLevels: levels out of range");
+			return;
+		}
+		if (count > 0 && (pSource->format != pDestination->format || pSource->colorSpace != pDestination->colorSpace
+			|| std::max(pSource->width >> sourceMip, 1) != std::max(pDestination->width >> destinationMip, 1)
+			|| std::max(pSource->height >> sourceMip, 1) != std::max(pDestination->height >> destinationMip, 1)))
+		{
+			Error("CopyTextureLevels: levels of texture " + std::to_string(source.id) + " and " + std::to_string(destination.id) + " do not match");
+		}
+	}
+
+	SamplerHandle NullRenderDevice::CreateSampler(const SamplerDesc& desc)
+	{
+		if (desc.filter == SamplerFilter::Anisotropic && (desc.maxAnisotropy < 1 || desc.maxAnisotropy > 16))
+		{
+			Error("CreateSampler: anisotropy must be 1 to 16");
+			return {};
+		}
+		m_SamplersAlive.push_back(true);
+		return { static_cast<uint32_t>(m_SamplersAlive.size()) };
+	}
+
+	void NullRenderDevice::ReleaseSampler(SamplerHandle sampler)
+	{
+		if (!sampler.IsValid() || sampler.id > m_SamplersAlive.size() || !m_SamplersAlive[sampler.id - 1])
+		{
+			Error("ReleaseSampler: no sampler " + std::to_string(sampler.id));
+			return;
+		}
+		m_SamplersAlive[sampler.id - 1] = false;
+	}
+
+	RasterizerHandle NullRenderDevice::CreateRasterizer(const RasterizerDesc&)
+	{
+		m_RasterizersAlive.push_back(true);
+		return { static_cast<uint32_t>(m_RasterizersAlive.size()) };
+	}
+
+	void NullRenderDevice::ReleaseRasterizer(RasterizerHandle rasterizer)
+	{
+		if (!rasterizer.IsValid() || rasterizer.id > m_RasterizersAlive.size() || !m_RasterizersAlive[rasterizer.id - 1])
+		{
+			Error("ReleaseRasterizer: no rasterizer " + std::to_string(rasterizer.id));
+			return;
+		}
+		m_RasterizersAlive[rasterizer.id - 1] = false;
+	}
+
+	ProgramHandle NullRenderDevice::CreateProgram(const ProgramDesc& desc)
+	{
+		if (desc.source.empty() || desc.layout.empty())
+		{
+			Error("CreateProgram: no source or no vertex layout");
+			return {};
+		}
+		for (size_t i{}; i < desc.layout.size(); ++i)
+		{
+			const VertexElement& element{ desc.layout[i] };
+			if (element.semantic.empty() || element.slot >= vertexSlotCount)
+			{
+				Error("CreateProgram: element " + std::to_string(i) + " has no semantic or its slot is out of range");
+				return {};
+			}
+			for (size_t j{}; j < i; ++j)
+			{
+				if (desc.layout[j].semantic == element.semantic && desc.layout[j].semanticIndex == element.semanticIndex)
+				{
+					Error("CreateProgram: " + element.semantic + std::to_string(element.semanticIndex) + " is in the layout twice");
+					return {};
+				}
+			}
+		}
+		m_Programs.push_back({ desc, true });
+		return { static_cast<uint32_t>(m_Programs.size()) };
+	}
+
+	void NullRenderDevice::ReleaseProgram(ProgramHandle program)
+	{
+		if (Program* pProgram{ FindProgram(program, "ReleaseProgram") })
+		{
+			*pProgram = {};
+		}
+	}
+
+	void NullRenderDevice::SetMatrix(ProgramHandle program, const std::string& name, const Matrix&)
+	{
+		FindParameter(program, name, "SetMatrix");
+	}
+
+	void NullRenderDevice::SetVector(ProgramHandle program, const std::string& name, const Vector4&)
+	{
+		FindParameter(program, name, "SetVector");
+	}
+
+	void NullRenderDevice::SetScalar(ProgramHandle program, const std::string& name, float)
+	{
+		FindParameter(program, name, "SetScalar");
+	}
+
+	void NullRenderDevice::SetTexture(ProgramHandle program, const std::string& name, TextureHandle texture)
+	{
+		Program* pProgram{ FindParameter(program, name, "SetTexture") };
+		if (pProgram && FindTexture(texture, "SetTexture"))
+		{
+			pProgram->textures[name] = texture;
+		}
+	}
+
+	void NullRenderDevice::SetSampler(ProgramHandle program, const std::string& name, SamplerHandle sampler)
+	{
+		FindParameter(program, name, "SetSampler");
+		if (!sampler.IsValid() || sampler.id > m_SamplersAlive.size() || !m_SamplersAlive[sampler.id - 1])
+		{
+			Error("SetSampler: no sampler " + std::to_string(sampler.id));
+		}
+	}
+
+	void NullRenderDevice::SetRasterizer(ProgramHandle program, const std::string& name, RasterizerHandle rasterizer)
+	{
+		FindParameter(program, name, "SetRasterizer");
+		if (!rasterizer.IsValid() || rasterizer.id > m_RasterizersAlive.size() || !m_RasterizersAlive[rasterizer.id - 1])
+		{
+			Error("SetRasterizer: no rasterizer " + std::to_string(rasterizer.id));
+		}
+	}
+
+	void NullRenderDevice::SetProgram(ProgramHandle program)
+	{
+		if (!FindProgram(program, "SetProgram"))
+		{
+			m_Program = {};
+			return;
+		}
+		if (program != m_Program)
+		{
+			++m_Stats.programChanges;
+		}
+		m_Program = program;
+		Record(CommandType::SetProgram, { program.id });
+	}
+
+	void NullRenderDevice::SetVertexBuffer(uint32_t slot, BufferHandle buffer)
+	{
+		if (slot >= vertexSlotCount)
+		{
+			Error("SetVertexBuffer: slot " + std::to_string(slot) + " out of range");
+			return;
+		}
+		const Buffer* pBuffer{ FindBuffer(buffer, "SetVertexBuffer") };
+		if (pBuffer && pBuffer->desc.binding != BufferBinding::Vertex)
+		{
+			Error("SetVertexBuffer: buffer " + std::to_string(buffer.id) + " is not a vertex buffer");
+			pBuffer = nullptr;
+		}
+		m_VertexBuffers[slot] = pBuffer ? buffer : BufferHandle{};
+		Record(CommandType::SetVertexBuffer, { slot, buffer.id });
+	}
+
+	void NullRenderDevice::SetIndexBuffer(BufferHandle buffer)
+	{
+		const Buffer* pBuffer{ FindBuffer(buffer, "SetIndexBuffer") };
+		if (pBuffer && pBuffer->desc.binding != BufferBinding::Index)
+		{
+			Error("SetIndexBuffer: buffer " + std::to_string(buffer.id) + " is not an index buffer");
+			pBuffer = nullptr;
+		}
+		m_IndexBuffer = pBuffer ? buffer : BufferHandle{};
+		Record(CommandType::SetIndexBuffer, { buffer.id });
+	}
+
+	void NullRenderDevice::DrawIndexed(uint32_t indexCount, uint32_t firstIndex, int32_t baseVertex)
+	{
+		Record(CommandType::DrawIndexed, { indexCount, firstIndex, static_cast<uint32_t>(baseVertex) });
+		if (!ValidateDraw(indexCount, firstIndex, "DrawIndexed"))
+		{
+			return;
+		}
+		++m_Stats.draws;
+		++m_Stats.instances;
+		m_Stats.triangles += indexCount / 3;
+	}
+
+	void NullRenderDevice::DrawIndexedInstanced(uint32_t indexCount, uint32_t instanceCount, uint32_t firstIndex, int32_t baseVertex,
+		uint32_t firstInstance)
+	{
+		Record(CommandType::DrawIndexedInstanced, { indexCount, instanceCount, firstIndex, static_cast<uint32_t>(baseVertex), firstInstance });
+		if (!ValidateDraw(indexCount, firstIndex, "DrawIndexedInstanced"))
+		{
+			return;
+		}
+
+		//The per-instance streams of the program's layout hold every instance drawn
+		for (const VertexElement& element : m_Programs[m_Program.id - 1].desc.layout)
+		{
+			if (!element.perInstance)
+			{
+				continue;
+			}
+			const uint32_t slot{ element.slot };
+			const BufferDesc& desc{ m_Buffers[m_VertexBuffers[slot].id - 1].desc };
+			if (static_cast<uint64_t>(firstInstance) + instanceCount > desc.byteWidth / desc.stride)
+			{
+				Error("DrawIndexedInstanced: instances " + std::to_string(firstInstance) + "+" + std::to_string(instanceCount)
+					+ " run past the " + std::to_string(desc.byteWidth / desc.stride) + " in slot " + std::to_string(slot));
+				return;
+			}
+		}
+		++m_Stats.draws;
+		m_Stats.instances += instanceCount;
+		m_Stats.triangles += static_cast<size_t>(indexCount / 3) * instanceCount;
+	}
+
+	void NullRenderDevice::Clear(const ColorRGB&)
+	{
+		Record(CommandType::Clear, {});
+	}
+
+	void NullRenderDevice::CopyToBackBuffer(TextureHandle texture)
+	{
+		const TextureDesc* pDesc{ FindTexture(texture, "CopyToBackBuffer") };
+		if (!pDesc)
+		{
+			return;
+		}
+		if (pDesc->width != m_Width || pDesc->height != m_Height || pDesc->mipLevels != 1 || pDesc->arraySize > 0 || pDesc->format != TexelFormat::RGBA8)
+		{
+			Error("CopyToBackBuffer: texture " + std::to_string(texture.id) + " is not a single RGBA8 image of the back buffer's size");
+			return;
+		}
+		Record(CommandType::CopyToBackBuffer, { texture.id });
+	}
+
+	void NullRenderDevice::Present()
+	{
+		for (size_t i{}; i < m_Buffers.size(); ++i)
+		{
+			if (m_Buffers[i].mapped)
+			{
+				Error("Present: buffer " + std::to_string(i + 1) + " is still mapped");
+			}
+		}
+		++m_Stats.frames;
+		Record(CommandType::Present, {});
+	}
+
+	size_t NullRenderDevice::GetLiveResourceCount() const
+	{
+		return std::count_if(m_Buffers.begin(), m_Buffers.end(), [](const Buffer& buffer) { return buffer.alive; })
+			+ std::count(m_TexturesAlive.begin(), m_TexturesAlive.end(), true)
+			+ std::count(m_SamplersAlive.begin(), m_SamplersAlive.end(), true)
+			+ std::count(m_RasterizersAlive.begin(), m_RasterizersAlive.end(), true)
+			+ std::count_if(m_Programs.begin(), m_Programs.end(), [](const Program& program) { return program.alive; });
+	}
+
+	void NullRenderDevice::ResetStats()
+	{
+		m_Stats = {};
+		m_Commands.clear();
+		m_Errors.clear();
+	}
+
+	void NullRenderDevice::Record(CommandType type, std::initializer_list<uint32_t> arguments)
+	{
+		if (!m_Record)
+		{
+			return;
+		}
+		Command command{ type };
+		std::copy(arguments.begin(), arguments.end(), command.arguments);
+		m_Commands.push_back(command);
+	}
+
+	void NullRenderDevice::Error(const std::string& message)
+	{
+		++m_Stats.errors;
+		if (m_Errors.size() < maxErrors)
+		{
+			m_Errors.push_back(message);
+		}
+	}
+
+	NullRenderDevice::Buffer* NullRenderDevice::FindBuffer(BufferHandle buffer, const char* pCall)
+	{
+		if (!buffer.IsValid() || buffer.id > m_Buffers.size() || !m_Buffers[buffer.id - 1].alive)
+		{
+			Error(std::string{ pCall } + ": no buffer " + std::to_string(buffer.id));
+			return nullptr;
+		}
+		return &m_Buffers[buffer.id - 1];
+	}
+
+	const TextureDesc* NullRenderDevice::FindTexture(TextureHandle texture, const char* pCall)
+	{
+		if (!texture.IsValid() || texture.id > m_TexturesAlive.size() || !m_TexturesAlive[texture.id - 1])
+		{
+			Error(std::string{ pCall } + ": no texture " + std::to_string(texture.id));
+			return nullptr;
+		}
+		return &m_Textures[texture.id - 1];
+	}
+
+	NullRenderDevice::Program* NullRenderDevice::FindProgram(ProgramHandle program, const char* pCall)
+	{
+		if (!program.IsValid() || program.id > m_Programs.size() || !m_Programs[program.id - 1].alive)
+		{
+			Error(std::string{ pCall } + ": no program " + std::to_string(program.id));
+			return nullptr;
+		}
+		return &m_Programs[program.id - 1];
+	}
+
+	NullRenderDevice::Program* NullRenderDevice::FindParameter(ProgramHandle program, const std::string& name, const char* pCall)
+	{
+		if (name.empty())
+		{
+			Error(std::string{ pCall } + ": no parameter name");
+			return nullptr;
+		}
+		return FindProgram(program, pCall);
+	}
+
+	bool NullRenderDevice::ValidateDraw(uint32_t indexCount, uint32_t firstIndex, const char* pCall)
+	{
+		const std::string call{ pCall };
+		if (!m_Program.IsValid() || !m_Programs[m_Program.id - 1].alive)
+		{
+			Error(call + ": no program set");
+			return false;
+		}
+		const Program& program{ m_Programs[m_Program.id - 1] };
+		if (!m_IndexBuffer.IsValid())
+		{
+			Error(call + ": no index buffer bound");
+			return false;
+		}
+		for (const VertexElement& element : program.desc.layout)
+		{
+			if (!m_VertexBuffers[element.slot].IsValid())
+			{
+				Error(call + ": no vertex buffer in slot " + std::to_string(element.slot) + " for " + element.semantic);
+				return false;
+			}
+		}
+		for (const auto& [name, texture] : program.textures)
+		{
+			if (!m_TexturesAlive[texture.id - 1])
+			{
+				Error(call + ": texture " + std::to_string(texture.id) + " set as " + name + " is released");
+				return false;
+			}
+		}
+		//Bound buffers may have been released since
+		for (const BufferHandle buffer : m_VertexBuffers)
+		{
+			if (buffer.IsValid() && (!m_Buffers[buffer.id - 1].alive || m_Buffers[buffer.id - 1].mapped))
+			{
+				Error(call + ": vertex buffer " + std::to_string(buffer.id) + " is released or mapped");
+				return false;
+			}
+		}
+		const Buffer& indexBuffer{ m_Buffers[m_IndexBuffer.id - 1] };
+		if (!indexBuffer.alive || indexBuffer.mapped)
+		{
+			Error(call + ": index buffer " + std::to_string(m_IndexBuffer.id) + " is released or mapped");
+			return false;
+		}
+		if (indexCount == 0 || indexCount % 3 != 0)
+		{
+			Error(call + ": " + std::to_string(indexCount) + " indices is not a whole number of triangles");
+			return false;
+		}
+		if (static_cast<uint64_t>(firstIndex) + indexCount > indexBuffer.desc.byteWidth / sizeof(uint32_t))
+		{
+			Error(call + ": indices " + std::to_string(firstIndex) + "+" + std::to_string(indexCount) + " run past the "
+				+ std::to_string(indexBuffer.desc.byteWidth / sizeof(uint32_t)) + " in the buffer");
+			return false;
+		}
+		return true;
+	}
+}
@@ -0,0 +1,148 @@
+#pragma once
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "RenderDevice.h"
+
+namespace dae
+{
+	//RenderDevice without a GPU. Every call is checked against what a draw on a real device needs and can be
+	//recorded, so frame logic can be tested and benchmarked headless. Dynamic buffers keep their bytes in
+	//memory, nothing else keeps data. Programs keep their layout and the textures set on them, no shader is compiled
+	class NullRenderDevice final : public RenderDevice
+	{
+	public:
+		enum class CommandType : uint8_t
+		{
+			SetProgram,
+			SetVertexBuffer,
+			SetIndexBuffer,
+			Map,
+			Unmap,
+			DrawIndexed,
+			DrawIndexedInstanced,
+			Clear,
+			CopyToBackBuffer,
+			Present
+		};
+
+		//The call's arguments in order, handles as their ids
+		struct Command
+		{
+			CommandType type{};
+			uint32_t arguments[5]{};
+		};
+
+		struct Stats
+		{
+			size_t frames{};
+			size_t draws{};
+			size_t instances{}; //one per non-instanced draw
+			size_t triangles{}; //over all instances
+			size_t bytesMapped{};
+			size_t programChanges{};
+			size_t errors{};
+		};
+
+		explicit NullRenderDevice(int width = 640, int height = 480);
+
+		BufferHandle CreateBuffer(const BufferDesc& desc, const void* pData) override;
+		void ReleaseBuffer(BufferHandle buffer) override;
+		void* Map(BufferHandle buffer) override;
+		void Unmap(BufferHandle buffer) override;
+
+		TextureHandle CreateTexture(const TextureDesc& desc, const std::vector<const void*>& mips) override;
+		void ReleaseTexture(TextureHandle texture) override;
+		void UpdateTexture(TextureHandle texture, int mip, const void* pData) override;
+		void CopyTextureLevels(TextureHandle source, int sourceMip, TextureHandle destination, int destinationMip, int count) override;
+
+		SamplerHandle CreateSampler(const SamplerDesc& desc) override;
+		void ReleaseSampler(SamplerHandle sampler) override;
+		RasterizerHandle CreateRasterizer(const RasterizerDesc& desc) override;
+		void ReleaseRasterizer(RasterizerHandle rasterizer) override;
+		ProgramHandle CreateProgram(const ProgramDesc& desc) override;
+		void ReleaseProgram(ProgramHandle program) override;
+
+		void SetMatrix(ProgramHandle program, const std::string& name, const Matrix& matrix) override;
+		void SetVector(ProgramHandle program, const std::string& name, const Vector4& vector) override;
+		void SetScalar(ProgramHandle program, const std::string& name, float value) override;
+		//Drawing with a program fails once a texture set on it is released
+		void SetTexture(ProgramHandle program, const std::string& name, TextureHandle texture) override;
+		void SetSampler(ProgramHandle program, const std::string& name, SamplerHandle sampler) override;
+		void SetRasterizer(ProgramHandle program, const std::string& name, RasterizerHandle rasterizer) override;
+
+		void SetProgram(ProgramHandle program) override;
+		void SetVertexBuffer(uint32_t slot, BufferHandle buffer) override;
+		void SetIndexBuffer(BufferHandle buffer) override;
+		void DrawIndexed(uint32_t indexCount, uint32_t firstIndex, int32_t baseVertex = 0) override;
+		void DrawIndexedInstanced(uint32_t indexCount, uint32_t instanceCount, uint32_t firstIndex, int32_t baseVertex,
+			uint32_t firstInstance) override;
+
+		int GetWidth() const override { return m_Width; }
+		int GetHeight() const override { return m_Height; }
+		void Clear(const ColorRGB& color) override;
+		void CopyToBackBuffer(TextureHandle texture) override;
+		void Present() override;
+
+		//Off by default, stats and errors are kept either way
+		void SetRecording(bool record) { m_Record = record; }
+		const std::vector<Command>& GetCommands() const { return m_Commands; }
+		//First few errors with what was wrong, Stats::errors counts all of them
+		const std::vector<std::string>& GetErrors() const { return m_Errors; }
+		const Stats& GetStats() const { return m_Stats; }
+		//Resources still alive, leaks show up here
+		size_t GetLiveResourceCount() const;
+		void ResetStats();
+
+	private:
+		static constexpr size_t maxErrors{ 64 };
+		static constexpr uint32_t vertexSlotCount{ 16 };
+
+		struct Buffer
+		{
+			BufferDesc desc{};
+			bool alive{};
+			bool mapped{};
+			std::vector<uint8_t> bytes{}; //dynamic buffers only
+		};
+
+		struct Program
+		{
+			ProgramDesc desc{};
+			bool alive{};
+			std::unordered_map<std::string, TextureHandle> textures{};
+		};
+
+		int m_Width{};
+		int m_Height{};
+
+		std::vector<Buffer> m_Buffers{};
+		std::vector<TextureDesc> m_Textures{};
+		std::vector<bool> m_TexturesAlive{};
+		std::vector<bool> m_SamplersAlive{};
+		std::vector<bool> m_RasterizersAlive{};
+		std::vector<Program> m_Programs{};
+
+		//Bound state
+		ProgramHandle m_Program{};
+		BufferHandle m_VertexBuffers[vertexSlotCount]{};
+		BufferHandle m_IndexBuffer{};
+
+		bool m_Record{};
+		std::vector<Command> m_Commands{};
+		std::vector<std::string> m_Errors{};
+		Stats m_Stats{};
+
+		void Record(CommandType type, std::initializer_list<uint32_t> arguments);
+		void Error(const std::string& message);
+		Buffer* FindBuffer(BufferHandle buffer, const char* pCall);
+		const TextureDesc* FindTexture(TextureHandle texture, const char* pCall);
+		Program* FindProgram(ProgramHandle program, const char* pCall);
+		//A program with a parameter name, for the Set calls
+		Program* FindParameter(ProgramHandle program, const std::string& name, const char* pCall);
+		//Program, index buffer and every slot the program's layout reads are bound, the indices drawn are in the
+		//index buffer and the textures set on the program are alive
+		bool ValidateDraw(uint32_t indexCount, uint32_t firstIndex, const char* pCall);
+	};
+}
@@ -0,0 +1,356 @@
+#include "pch.h"
+#include "OcclusionCuller.h"
+#include <bit>
+#include <chrono>
+#include <immintrin.h>
+
+namespace dae
+{
+	namespace
+	{
+		constexpr int tileLevels{ std::countr_zero(static_cast<unsigned>(OcclusionCuller::tileSize)) };
+		static_assert(OcclusionCuller::tileSize == 1 << tileLevels, "tiles must be a power of two so their texels never straddle tiles");
+
+		//depth = min(depth, new) where bit i of mask covers lane i
+		void WriteDepthRowAvx2(float* pDepth, uint32_t mask, const __m256& newDepth)
+		{
+			const __m256i laneBits{ _mm256_setr_epi32(1, 2, 4, 8, 16, 32, 64, 128) };
+			const __m256i covered{ _mm256_cmpeq_epi32(_mm256_and_si256(_mm256_set1_epi32(static_cast<int>(mask)), laneBits), laneBits) };
+			const __m256 current{ _mm256_loadu_ps(pDepth) };
+			_mm256_storeu_ps(pDepth, _mm256_blendv_ps(current, _mm256_min_ps(current, newDepth), _mm256_castsi256_ps(covered)));
+		}
+	}
+
+	OcclusionCuller::OcclusionCuller(int width, int height, int threadCount, JobSystem* pJobs)
+		: m_Width{ (width + tileSize - 1) / tileSize * tileSize }
+		, m_Height{ (height + tileSize - 1) / tileSize * tileSize }
+		, m_TilesX{ m_Width / tileSize }
+		, m_TilesY{ m_Height / tileSize }
+		, m_TileLevels{ tileLevels }
+		, m_Workers{ threadCount, pJobs }
+	{
+		//Down to 1x1, odd sizes round up and the last texel of a row or column takes the max of what is there
+		int levelWidth{ m_Width };
+		int levelHeight{ m_Height };
+		while (true)
+		{
+			Level& level{ m_Levels.emplace_back() };
+			level.width = levelWidth;
+			level.height = levelHeight;
+			level.depth.resize(static_cast<size_t>(levelWidth) * levelHeight, 1.f);
+			if (levelWidth == 1 && levelHeight == 1)
+			{
+				break;
+			}
+			levelWidth = (levelWidth + 1) / 2;
+			levelHeight = (levelHeight + 1) / 2;
+		}
+
+		m_ThreadData.resize(m_Workers.GetThreadCount());
+		for (ThreadData& data : m_ThreadData)
+		{
+			data.bins.resize(static_cast<size_t>(m_TilesX) * m_TilesY);
+		}
+	}
+
+	size_t OcclusionCuller::AddOccluder(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices)
+	{
+		Occluder& occluder{ m_Occluders.emplace_back() };
+		occluder.positions.reserve(vertices.size());
+		for (const Vertex& vertex : vertices)
+		{
+			occluder.positions.push_back(vertex.Position);
+		}
+		occluder.indices = indices;
+		occluder.screen.resize(vertices.size());
+		occluder.inFront.resize(vertices.size());
+		return m_Occluders.size() - 1;
+	}
+
+	void OcclusionCuller::SetOccluderWorld(size_t occluder, const Matrix& world)
+	{
+		m_Occluders[occluder].world = world;
+	}
+
+	void OcclusionCuller::Render(const Matrix& viewProjection)
+	{
+		const auto start{ std::chrono::steady_clock::now() };
+		m_Stats = {};
+		m_ViewProjection = viewProjection;
+
+		TransformOccluders();
+		m_Workers.Run([this](int threadIndex) { BinTriangles(threadIndex); });
+
+		m_NextTile = 0;
+		const int tileCount{ m_TilesX * m_TilesY };
+		m_Workers.Run([this, tileCount](int threadIndex)
+			{
+				ThreadData& data{ m_ThreadData[threadIndex] };
+				for (int tile{ m_NextTile++ }; tile < tileCount; tile = m_NextTile++)
+				{
+					RasterizeTile(tile, data);
+				}
+			});
+
+		//The levels above one texel per tile are a few dozen texels, not worth another round of the workers
+		for (int level{ m_TileLevels + 1 }; level < GetLevelCount(); ++level)
+		{
+			ReduceLevel(level, { 0, 0, m_Levels[level].width, m_Levels[level].height });
+		}
+
+		for (const ThreadData& data : m_ThreadData)
+		{
+			m_Stats.occluderTriangles += data.triangles.size();
+		}
+		m_Stats.renderMicroseconds = std::chrono::duration<float, std::micro>(std::chrono::steady_clock::now() - start).count();
+	}
+
+	void OcclusionCuller::TransformOccluders()
+	{
+		const float width{ static_cast<float>(m_Width) };
+		const float height{ static_cast<float>(m_Height) };
+
+		m_Workers.Run([&](int threadIndex)
+			{
+				const size_t threadCount{ static_cast<size_t>(m_Workers.GetThreadCount()) };
+				for (Occluder& occluder : m_Occluders)
+				{
+					const Matrix worldViewProjection{ occluder.world * m_ViewProjection };
+					const size_t begin{ occluder.positions.size() * threadIndex / threadCount };
+					const size_t end{ occluder.positions.size() * (threadIndex + 1) / threadCount };
+
+					for (size_t i{ begin }; i < end; ++i)
+					{
+						const Vector4 clip{ worldViewProjection.TransformPoint(Vector4{ occluder.positions[i], 1.f }) };
+						const bool inFront{ clip.z >= 0.f };
+						const float invW{ inFront ? 1.f / clip.w : 0.f };
+						occluder.inFront[i] = inFront;
+						occluder.screen[i] = { (clip.x * invW * 0.5f + 0.5f) * width, (0.5f - clip.y * invW * 0.5f) * height, clip.z * invW, invW };
+					}
+				}
+			});
+	}
+
+	void OcclusionCuller::BinTriangles(int threadIndex)
+	{
+		ThreadData& data{ m_ThreadData[threadIndex] };
+		data.triangles.clear();
+		for (std::vector<uint32_t>& bin : data.bins)
+		{
+			bin.clear();
+		}
+
+		//Depth only keeps the nearest, so unlike the color rasterizer the order triangles are drawn in does not matter
+		size_t triangleCount{};
+		for (const Occluder& occluder : m_Occluders)
+		{
+			triangleCount += occluder.indices.size() / 3;
+		}
+		const size_t threadCount{ static_cast<size_t>(m_Workers.GetThreadCount()) };
+		const size_t begin{ triangleCount * threadIndex / threadCount };
+		const size_t end{ triangleCount * (threadIndex + 1) / threadCount };
+
+		size_t occluderStart{};
+		for (const Occluder& occluder : m_Occluders)
+		{
+			const size_t occluderEnd{ occluderStart + occluder.indices.size() / 3 };
+			for (size_t i{ std::max(begin, occluderStart) }; i < std::min(end, occluderEnd); ++i)
+			{
+				const uint32_t* pIndices{ &occluder.indices[(i - occluderStart) * 3] };
+				//Dropping a triangle only hides less, so ones reaching in front of the near plane are not clipped
+				if (!occluder.inFront[pIndices[0]] || !occluder.inFront[pIndices[1]] || !occluder.inFront[pIndices[2]])
+				{
+					continue;
+				}
+
+				const RasterKernel::ScreenVertex vertices[3]{ occluder.screen[pIndices[0]], occluder.screen[pIndices[1]], occluder.screen[pIndices[2]] };
+				if (std::min({ vertices[0].z, vertices[1].z, vertices[2].z }) > 1.f)
+				{
+					continue;
+				}
+
+				//Occluders need not be closed, so both faces draw
+				Triangle triangle{};
+				if (!RasterKernel::Setup(vertices, { 0, 0, m_Width, m_Height }, RasterKernel::Cull::None, triangle.setup))
+				{
+					continue;
+				}
+				const RasterKernel::TriangleSetup& setup{ triangle.setup };
+				for (int vertex{}; vertex < 3; ++vertex)
+				{
+					triangle.depthA += setup.weightA[vertex] * setup.z[vertex];
+					triangle.depthB += setup.weightB[vertex] * setup.z[vertex];
+					triangle.depthC += setup.weightC[vertex] * setup.z[vertex];
+				}
+
+				const uint32_t triangleIndex{ static_cast<uint32_t>(data.triangles.size()) };
+				data.triangles.push_back(triangle);
+				for (int tileY{ setup.minY / tileSize }; tileY <= setup.maxY / tileSize; ++tileY)
+				{
+					for (int tileX{ setup.minX / tileSize }; tileX <= setup.maxX / tileSize; ++tileX)
+					{
+						if (RasterKernel::Overlaps(setup, { tileX * tileSize, tileY * tileSize, (tileX + 1) * tileSize, (tileY + 1) * tileSize }))
+						{
+							data.bins[static_cast<size_t>(tileY) * m_TilesX + tileX].push_back(triangleIndex);
+						}
+					}
+				}
+			}
+			occluderStart = occluderEnd;
+		}
+	}
+
+	void OcclusionCuller::RasterizeTile(int tile, ThreadData& data)
+	{
+		const int tileX{ tile % m_TilesX };
+		const int tileY{ tile / m_TilesX };
+		const RasterKernel::Rect rect{ tileX * tileSize, tileY * tileSize, (tileX + 1) * tileSize, (tileY + 1) * tileSize };
+
+		std::vector<float>& depth{ m_Levels[0].depth };
+		for (int y{ rect.top }; y < rect.bottom; ++y)
+		{
+			std::fill_n(depth.begin() + static_cast<size_t>(y) * m_Width + rect.left, tileSize, 1.f);
+		}
+
+		for (const ThreadData& binner : m_ThreadData)
+		{
+			for (const uint32_t triangleIndex : binner.bins[tile])
+			{
+				DrawTriangle(binner.triangles[triangleIndex], rect, data);
+			}
+		}
+
+		//Every level down to one texel for the tile only reads this tile's texels
+		for (int level{ 1 }; level <= m_TileLevels; ++level)
+		{
+			ReduceLevel(level, { rect.left >> level, rect.top >> level, rect.right >> level, rect.bottom >> level });
+		}
+	}
+
+	void OcclusionCuller::DrawTriangle(const Triangle& triangle, const RasterKernel::Rect& tile, ThreadData& data)
+	{
+		const RasterKernel::TriangleSetup& setup{ triangle.setup };
+		const bool avx2{ RasterKernel::HasAvx2() };
+		float* pDepth{ m_Levels[0].depth.data() };
+
+		data.blocks.clear();
+		RasterKernel::Rasterize(setup, tile, data.blocks);
+		for (const RasterKernel::CoverageBlock& block : data.blocks)
+		{
+			const float startX{ static_cast<float>(block.x - setup.minX) };
+			for (int row{}; row < RasterKernel::blockSize; ++row)
+			{
+				const uint32_t rowMask{ static_cast<uint32_t>(block.mask >> (row * RasterKernel::blockSize)) & 0xFF };
+				if (!rowMask)
+				{
+					continue;
+				}
+
+				const int y{ block.y + row };
+				const float rowDepth{ triangle.depthB * static_cast<float>(y - setup.minY) + triangle.depthC };
+				float* pRow{ pDepth + static_cast<size_t>(y) * m_Width + block.x };
+				if (avx2)
+				{
+					const __m256 columns{ _mm256_add_ps(_mm256_set1_ps(startX), _mm256_setr_ps(0.f, 1.f, 2.f, 3.f, 4.f, 5.f, 6.f, 7.f)) };
+					WriteDepthRowAvx2(pRow, rowMask, _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(triangle.depthA), columns), _mm256_set1_ps(rowDepth)));
+					continue;
+				}
+				for (int column{}; column < RasterKernel::blockSize; ++column)
+				{
+					if (rowMask & (1u << column))
+					{
+						pRow[column] = std::min(pRow[column], triangle.depthA * (startX + static_cast<float>(column)) + rowDepth);
+					}
+				}
+			}
+		}
+	}
+
+	void OcclusionCuller::ReduceLevel(int levelIndex, const RasterKernel::Rect& rect)
+	{
+		const Level& source{ m_Levels[levelIndex - 1] };
+		Level& level{ m_Levels[levelIndex] };
+
+		for (int y{ rect.top }; y < rect.bottom; ++y)
+		{
+			const float* pRow0{ &source.depth[static_cast<size_t>(y * 2) * source.width] };
+			const float* pRow1{ &source.depth[static_cast<size_t>(std::min(y * 2 + 1, source.height - 1)) * source.width] };
+			float* pTarget{ &level.depth[static_cast<size_t>(y) * level.width] };
+
+			int x{ rect.left };
+			//4 texels from 8 columns of both rows, SSE is always there on x64
+			for (; x + 4 <= rect.right && x * 2 + 8 <= source.width; x += 4)
+			{
+				const __m128 low{ _mm_max_ps(_mm_loadu_ps(pRow0 + x * 2), _mm_loadu_ps(pRow1 + x * 2)) };
+				const __m128 high{ _mm_max_ps(_mm_loadu_ps(pRow0 + x * 2 + 4), _mm_loadu_ps(pRow1 + x * 2 + 4)) };
+				_mm_storeu_ps(pTarget + x, _mm_max_ps(_mm_shuffle_ps(low, high, _MM_SHUFFLE(2, 0, 2, 0)), _mm_shuffle_ps(low, high, _MM_SHUFFLE(3, 1, 3, 1))));
+			}
+			for (; x < rect.right; ++x)
+			{
+				const int right{ std::min(x * 2 + 1, source.width - 1) };
+				pTarget[x] = std::max({ pRow0[x * 2], pRow0[right], pRow1[x * 2], pRow1[right] });
+			}
+		}
+	}
+
+	bool OcclusionCuller::IsVisible(const Vector3& minimum, const Vector3& maximum, const Matrix& world)
+	{
+		++m_Stats.tested;
+		const Matrix worldViewProjection{ world * m_ViewProjection };
+
+		float minX{ FLT_MAX };
+		float minY{ FLT_MAX };
+		float maxX{ -FLT_MAX };
+		float maxY{ -FLT_MAX };
+		float minZ{ FLT_MAX };
+		for (int corner{}; corner < 8; ++corner)
+		{
+			const Vector3 position{ corner & 1 ? maximum.x : minimum.x, corner & 2 ? maximum.y : minimum.y, corner & 4 ? maximum.z : minimum.z };
+			const Vector4 clip{ worldViewProjection.TransformPoint(Vector4{ position, 1.f }) };
+			//Its projection could cover anything
+			if (clip.z < 0.f)
+			{
+				return true;
+			}
+			const float invW{ 1.f / clip.w };
+			const float x{ (clip.x * invW * 0.5f + 0.5f) * static_cast<float>(m_Width) };
+			const float y{ (0.5f - clip.y * invW * 0.5f) * static_cast<float>(m_Height) };
+			minX = std::min(minX, x);
+			maxX = std::max(maxX, x);
+			minY = std::min(minY, y);
+			maxY = std::max(maxY, y);
+			minZ = std::min(minZ, clip.z * invW);
+		}
+
+		if (maxX < 0.f || maxY < 0.f || minX >= static_cast<float>(m_Width) || minY >= static_cast<float>(m_Height) || minZ > 1.f)
+		{
+			++m_Stats.offscreen;
+			return false;
+		}
+
+		//Every pixel the rect touches, then the finest level that spans it with at most maxTestTexels per side
+		const int left{ std::max(static_cast<int>(minX), 0) };
+		const int top{ std::max(static_cast<int>(minY), 0) };
+		const int right{ std::min(static_cast<int>(maxX), m_Width - 1) };
+		const int bottom{ std::min(static_cast<int>(maxY), m_Height - 1) };
+		int levelIndex{};
+		while ((right >> levelIndex) - (left >> levelIndex) >= maxTestTexels || (bottom >> levelIndex) - (top >> levelIndex) >= maxTestTexels)
+		{
+			++levelIndex;
+		}
+
+		const Level& level{ m_Levels[levelIndex] };
+		for (int y{ top >> levelIndex }; y <= bottom >> levelIndex; ++y)
+		{
+			for (int x{ left >> levelIndex }; x <= right >> levelIndex; ++x)
+			{
+				if (minZ <= level.depth[static_cast<size_t>(y) * level.width + x])
+				{
+					return true;
+				}
+			}
+		}
+		++m_Stats.culled;
+		return false;
+	}
+}
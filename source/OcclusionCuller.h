@@ -0,0 +1,114 @@
+#pragma once
+#include <atomic>
+
+#include "MeshData.h"
+#include "RasterKernel.h"
+#include "WorkerPool.h"
+
+namespace dae
+{
+	//Depth-only CPU rasterizer at low resolution. Occluder meshes are drawn into a depth buffer every frame,
+	//which is then reduced into a chain of max-depth levels. A box is hidden when its nearest point is behind
+	//the farthest occluder depth over the few texels of the level its screen rect fits in, so the test never
+	//rejects a box an occluder pixel does not hide. Tiles are rasterized and reduced in parallel.
+	class OcclusionCuller final
+	{
+	public:
+		struct Stats
+		{
+			size_t occluderTriangles{}; //binned, after culling and dropping those crossing the near plane
+			float renderMicroseconds{}; //transform, binning, rasterization and the max-depth chain
+			int tested{};
+			int culled{};    //behind occluders
+			int offscreen{}; //outside the view, also reported hidden
+		};
+
+		static constexpr int defaultWidth{ 256 };
+		static constexpr int defaultHeight{ 128 };
+		static constexpr int tileSize{ 32 };
+		//A box is tested against at most this many texels per row and column
+		static constexpr int maxTestTexels{ 4 };
+
+		//The size is rounded up to whole tiles. 0 threads starts one per hardware thread, with jobs it starts none and runs on theirs
+		explicit OcclusionCuller(int width = defaultWidth, int height = defaultHeight, int threadCount = 0, JobSystem* pJobs = nullptr);
+		~OcclusionCuller() = default;
+
+		OcclusionCuller(const OcclusionCuller&) = delete;
+		OcclusionCuller(OcclusionCuller&&) noexcept = delete;
+		OcclusionCuller& operator=(const OcclusionCuller&) = delete;
+		OcclusionCuller& operator=(OcclusionCuller&&) noexcept = delete;
+
+		//Keeps the positions only
+		size_t AddOccluder(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices);
+		void SetOccluderWorld(size_t occluder, const Matrix& world);
+
+		//Once per frame, before the tests
+		void Render(const Matrix& viewProjection);
+
+		//Object-space box. Boxes reaching in front of the near plane are always visible
+		bool IsVisible(const Vector3& minimum, const Vector3& maximum, const Matrix& world);
+
+		int GetWidth() const { return m_Width; }
+		int GetHeight() const { return m_Height; }
+		int GetThreadCount() const { return m_Workers.GetThreadCount(); }
+		const Stats& GetStats() const { return m_Stats; }
+		//Level 0 is the depth buffer itself, every next level the max of 2x2 texels
+		const std::vector<float>& GetDepthLevel(int level) const { return m_Levels[level].depth; }
+		int GetLevelCount() const { return static_cast<int>(m_Levels.size()); }
+
+	private:
+		struct Occluder
+		{
+			std::vector<Vector3> positions{};
+			std::vector<uint32_t> indices{};
+			Matrix world{};
+			std::vector<RasterKernel::ScreenVertex> screen{};
+			std::vector<bool> inFront{};
+		};
+
+		struct Level
+		{
+			int width{};
+			int height{};
+			std::vector<float> depth{};
+		};
+
+		//Depth is linear in screen space: a * (x - minX) + b * (y - minY) + c
+		struct Triangle
+		{
+			RasterKernel::TriangleSetup setup{};
+			float depthA{};
+			float depthB{};
+			float depthC{};
+		};
+
+		struct ThreadData
+		{
+			std::vector<Triangle> triangles{};
+			std::vector<std::vector<uint32_t>> bins{}; //per tile, indices into triangles
+			std::vector<RasterKernel::CoverageBlock> blocks{};
+		};
+
+		int m_Width{};
+		int m_Height{};
+		int m_TilesX{};
+		int m_TilesY{};
+		int m_TileLevels{}; //levels whose texels never straddle a tile, reduced by the tile's worker
+
+		std::vector<Occluder> m_Occluders{};
+		std::vector<Level> m_Levels{};
+		Matrix m_ViewProjection{};
+
+		WorkerPool m_Workers;
+		std::vector<ThreadData> m_ThreadData{};
+		std::atomic<int> m_NextTile{};
+		Stats m_Stats{};
+
+		void TransformOccluders();
+		void BinTriangles(int threadIndex);
+		void RasterizeTile(int tile, ThreadData& data);
+		void DrawTriangle(const Triangle& triangle, const RasterKernel::Rect& tile, ThreadData& data);
+		//Max of 2x2 texels of level - 1 for the texels of level inside rect, rect in texels of level
+		void ReduceLevel(int level, const RasterKernel::Rect& rect);
+	};
+}
@@ -0,0 +1,508 @@
+#include "pch.h"
+#include "RasterKernel.h"
+#include <immintrin.h>
+#include <type_traits>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+namespace dae
+{
+	namespace RasterKernel
+	{
+		namespace
+		{
+			constexpr int pixelCenter{ subpixelScale / 2 };
+
+			int64_t FloorDiv(int64_t value, int64_t divisor)
+			{
+				return value >= 0 ? value / divisor : -((-value + divisor - 1) / divisor);
+			}
+
+			int64_t EvaluateEdge(const TriangleSetup& setup, int edge, int x, int y)
+			{
+				return setup.edgeA[edge] * (static_cast<int64_t>(x) * subpixelScale + pixelCenter)
+					+ setup.edgeB[edge] * (static_cast<int64_t>(y) * subpixelScale + pixelCenter) + setup.edgeC[edge];
+			}
+
+			//Edges that cross a block, as 32 bit values at its top left pixel and per pixel steps.
+			//Crossing means the edge changes sign inside the block, which bounds every value in it
+			struct PartialEdges
+			{
+				int32_t start[3]{};
+				int32_t stepX[3]{};
+				int32_t stepY[3]{};
+				int count{};
+			};
+
+			uint64_t CoverPartialScalar(const PartialEdges& edges)
+			{
+				uint64_t mask{};
+				for (int row{}; row < blockSize; ++row)
+				{
+					for (int column{}; column < blockSize; ++column)
+					{
+						bool inside{ true };
+						for (int edge{}; edge < edges.count; ++edge)
+						{
+							inside = inside && edges.start[edge] + edges.stepX[edge] * column + edges.stepY[edge] * row >= 0;
+						}
+						mask |= static_cast<uint64_t>(inside) << (row * blockSize + column);
+					}
+				}
+				return mask;
+			}
+
+			//A row of 8 per step, the sign bits of the OR of all edges are the pixels outside
+			uint64_t CoverPartialAvx2(const PartialEdges& edges)
+			{
+				const __m256i lanes{ _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7) };
+				__m256i values[3]{};
+				__m256i stepY[3]{};
+				for (int edge{}; edge < edges.count; ++edge)
+				{
+					values[edge] = _mm256_add_epi32(_mm256_set1_epi32(edges.start[edge]), _mm256_mullo_epi32(_mm256_set1_epi32(edges.stepX[edge]), lanes));
+					stepY[edge] = _mm256_set1_epi32(edges.stepY[edge]);
+				}
+
+				uint64_t mask{};
+				for (int row{}; row < blockSize; ++row)
+				{
+					__m256i outside{ values[0] };
+					for (int edge{ 1 }; edge < edges.count; ++edge)
+					{
+						outside = _mm256_or_si256(outside, values[edge]);
+					}
+					const uint64_t rowMask{ static_cast<uint64_t>(~_mm256_movemask_ps(_mm256_castsi256_ps(outside)) & 0xFF) };
+					mask |= rowMask << (row * blockSize);
+
+					for (int edge{}; edge < edges.count; ++edge)
+					{
+						values[edge] = _mm256_add_epi32(values[edge], stepY[edge]);
+					}
+				}
+				return mask;
+			}
+
+			//Pixels of a block that lie inside rect
+			uint64_t GetRectMask(const Rect& rect, int x, int y)
+			{
+				const int columns{ std::min(blockSize, rect.right - x) };
+				const int rows{ std::min(blockSize, rect.bottom - y) };
+				const uint64_t rowMask{ (1ull << columns) - 1 };
+				uint64_t mask{};
+				for (int row{}; row < rows; ++row)
+				{
+					mask |= rowMask << (row * blockSize);
+				}
+				return mask;
+			}
+
+			//Pixels of a block whose sample lies inside all edges, values are at the sample of the top left pixel
+			template<typename CoverPartial>
+			uint64_t CoverBlock(const int64_t(&values)[3], const int64_t(&stepX)[3], const int64_t(&stepY)[3],
+				const int64_t(&blockMaxOffset)[3], const int64_t(&blockMinOffset)[3], CoverPartial coverPartial)
+			{
+				PartialEdges partial{};
+				for (int edge{}; edge < 3; ++edge)
+				{
+					const int64_t value{ values[edge] };
+					if (value + blockMaxOffset[edge] < 0)
+					{
+						return 0;
+					}
+					if (value + blockMinOffset[edge] < 0)
+					{
+						partial.start[partial.count] = static_cast<int32_t>(value);
+						partial.stepX[partial.count] = static_cast<int32_t>(stepX[edge]);
+						partial.stepY[partial.count] = static_cast<int32_t>(stepY[edge]);
+						++partial.count;
+					}
+				}
+				return partial.count == 0 ? ~0ull : coverPartial(partial);
+			}
+
+			//Block is CoverageBlock for pixel centers or SampleCoverageBlock for every sample
+			template<typename Block, typename CoverPartial>
+			void RasterizeBlocks(const TriangleSetup& setup, const Rect& rect, std::vector<Block>& blocks, CoverPartial coverPartial)
+			{
+				constexpr bool multisample{ std::is_same_v<Block, SampleCoverageBlock> };
+				const int startX{ std::max(rect.left, setup.minX & ~(blockSize - 1)) };
+				const int startY{ std::max(rect.top, setup.minY & ~(blockSize - 1)) };
+				const int endX{ std::min(rect.right - 1, setup.maxX) };
+				const int endY{ std::min(rect.bottom - 1, setup.maxY) };
+
+				int64_t stepX[3]{};
+				int64_t stepY[3]{};
+				int64_t blockMaxOffset[3]{}; //from the top left pixel to the largest value in a block
+				int64_t blockMinOffset[3]{};
+				for (int edge{}; edge < 3; ++edge)
+				{
+					stepX[edge] = setup.edgeA[edge] * subpixelScale;
+					stepY[edge] = setup.edgeB[edge] * subpixelScale;
+					blockMaxOffset[edge] = (std::max<int64_t>(stepX[edge], 0) + std::max<int64_t>(stepY[edge], 0)) * (blockSize - 1);
+					blockMinOffset[edge] = (std::min<int64_t>(stepX[edge], 0) + std::min<int64_t>(stepY[edge], 0)) * (blockSize - 1);
+				}
+
+				//A sample is the pixel center moved by its offset, which moves the edge values by a constant
+				int64_t sampleShifts[sampleCount][3]{};
+				for (int sample{}; sample < sampleCount; ++sample)
+				{
+					for (int edge{}; edge < 3; ++edge)
+					{
+						sampleShifts[sample][edge] = setup.edgeA[edge] * sampleOffsets[sample][0] + setup.edgeB[edge] * sampleOffsets[sample][1];
+					}
+				}
+
+				for (int y{ startY }; y <= endY; y += blockSize)
+				{
+					int64_t values[3]{};
+					for (int edge{}; edge < 3; ++edge)
+					{
+						values[edge] = EvaluateEdge(setup, edge, startX, y);
+					}
+
+					for (int x{ startX }; x <= endX; x += blockSize)
+					{
+						const int64_t blockValues[3]{ values[0], values[1], values[2] };
+						for (int edge{}; edge < 3; ++edge)
+						{
+							values[edge] += stepX[edge] * blockSize;
+						}
+
+						const uint64_t rectMask{ GetRectMask(rect, x, y) };
+						if constexpr (multisample)
+						{
+							SampleCoverageBlock block{ { x, y, 0 } };
+							for (int sample{}; sample < sampleCount; ++sample)
+							{
+								const int64_t sampleValues[3]{ blockValues[0] + sampleShifts[sample][0], blockValues[1] + sampleShifts[sample][1],
+									blockValues[2] + sampleShifts[sample][2] };
+								block.samples[sample] = CoverBlock(sampleValues, stepX, stepY, blockMaxOffset, blockMinOffset, coverPartial) & rectMask;
+								block.pixels.mask |= block.samples[sample];
+							}
+							if (block.pixels.mask)
+							{
+								blocks.push_back(block);
+							}
+						}
+						else
+						{
+							const uint64_t mask{ CoverBlock(blockValues, stepX, stepY, blockMaxOffset, blockMinOffset, coverPartial) & rectMask };
+							if (mask)
+							{
+								blocks.push_back({ x, y, mask });
+							}
+						}
+					}
+				}
+			}
+		}
+
+		bool HasAvx2()
+		{
+			static const bool hasAvx2{ []
+			{
+#ifdef _MSC_VER
+				int info[4]{};
+				__cpuid(info, 0);
+				if (info[0] < 7)
+				{
+					return false;
+				}
+				//The OS must save the ymm registers too
+				__cpuid(info, 1);
+				const bool osSavesAvx{ (info[2] & (1 << 27)) != 0 && (info[2] & (1 << 28)) != 0 && (_xgetbv(0) & 6) == 6 };
+				__cpuidex(info, 7, 0);
+				return osSavesAvx && (info[1] & (1 << 5)) != 0;
+#else
+				return __builtin_cpu_supports("avx2") != 0;
+#endif
+			}() };
+			return hasAvx2;
+		}
+
+		bool Setup(const ScreenVertex(&vertices)[3], const Rect& viewport, Cull cull, TriangleSetup& setup, bool multisample)
+		{
+			int64_t x[3]{};
+			int64_t y[3]{};
+			for (int i{}; i < 3; ++i)
+			{
+				//Also false for NaN
+				if (!(std::abs(vertices[i].x) <= maxCoordinate && std::abs(vertices[i].y) <= maxCoordinate))
+				{
+					return false;
+				}
+				x[i] = static_cast<int64_t>(std::floor(vertices[i].x * subpixelScale + 0.5f));
+				y[i] = static_cast<int64_t>(std::floor(vertices[i].y * subpixelScale + 0.5f));
+			}
+
+			int64_t area{ (x[1] - x[0]) * (y[2] - y[0]) - (y[1] - y[0]) * (x[2] - x[0]) };
+			if (area == 0 || (cull == Cull::Back && area < 0) || (cull == Cull::Front && area > 0))
+			{
+				return false;
+			}
+
+			//Counter-clockwise faces are set up clockwise, the weights still go to the input vertices
+			int order[3]{ 0, 1, 2 };
+			if (area < 0)
+			{
+				std::swap(order[1], order[2]);
+				area = -area;
+			}
+
+			//Pixel centers, or any of the samples, inside the bounds
+			const int reach{ multisample ? maxSampleOffset : 0 };
+			const int64_t minX{ std::min({ x[0], x[1], x[2] }) };
+			const int64_t minY{ std::min({ y[0], y[1], y[2] }) };
+			const int64_t maxX{ std::max({ x[0], x[1], x[2] }) };
+			const int64_t maxY{ std::max({ y[0], y[1], y[2] }) };
+			setup.minX = static_cast<int>(std::max<int64_t>(viewport.left, -FloorDiv(pixelCenter + reach - minX, subpixelScale)));
+			setup.minY = static_cast<int>(std::max<int64_t>(viewport.top, -FloorDiv(pixelCenter + reach - minY, subpixelScale)));
+			setup.maxX = static_cast<int>(std::min<int64_t>(viewport.right - 1, FloorDiv(maxX - pixelCenter + reach, subpixelScale)));
+			setup.maxY = static_cast<int>(std::min<int64_t>(viewport.bottom - 1, FloorDiv(maxY - pixelCenter + reach, subpixelScale)));
+			setup.multisample = multisample;
+			if (setup.minX > setup.maxX || setup.minY > setup.maxY)
+			{
+				return false;
+			}
+
+			const double invArea{ 1.0 / static_cast<double>(area) };
+			const int64_t originX{ static_cast<int64_t>(setup.minX) * subpixelScale + pixelCenter };
+			const int64_t originY{ static_cast<int64_t>(setup.minY) * subpixelScale + pixelCenter };
+			for (int edge{}; edge < 3; ++edge)
+			{
+				//Edge i runs between the other two vertices and weighs vertex i
+				const int from{ order[(edge + 1) % 3] };
+				const int to{ order[(edge + 2) % 3] };
+				const int64_t a{ y[from] - y[to] };
+				const int64_t b{ x[to] - x[from] };
+				const int64_t c{ -a * x[from] - b * y[from] };
+
+				//Clockwise with y down: left edges go up, top edges go right. Other edges need E > 0, which is E - 1 >= 0 in integers
+				const bool topLeft{ a > 0 || (a == 0 && b > 0) };
+				setup.edgeA[edge] = a;
+				setup.edgeB[edge] = b;
+				setup.edgeC[edge] = topLeft ? c : c - 1;
+
+				const int vertex{ order[edge] };
+				setup.weightA[vertex] = static_cast<float>(a * subpixelScale * invArea);
+				setup.weightB[vertex] = static_cast<float>(b * subpixelScale * invArea);
+				setup.weightC[vertex] = static_cast<float>((a * originX + b * originY + c) * invArea);
+			}
+
+			for (int i{}; i < 3; ++i)
+			{
+				setup.z[i] = vertices[i].z;
+				setup.invW[i] = vertices[i].invW;
+			}
+			return true;
+		}
+
+		bool Overlaps(const TriangleSetup& setup, const Rect& rect)
+		{
+			//Each edge is largest at one corner, clamped to the bounds
+			const int left{ std::max(rect.left, setup.minX) };
+			const int top{ std::max(rect.top, setup.minY) };
+			const int right{ std::min(rect.right - 1, setup.maxX) };
+			const int bottom{ std::min(rect.bottom - 1, setup.maxY) };
+			if (left > right || top > bottom)
+			{
+				return false;
+			}
+			//A sample can be up to maxSampleOffset further along the edge's gradient
+			const int64_t reach{ setup.multisample ? maxSampleOffset : 0 };
+			for (int edge{}; edge < 3; ++edge)
+			{
+				const int64_t sampleReach{ (std::abs(setup.edgeA[edge]) + std::abs(setup.edgeB[edge])) * reach };
+				if (EvaluateEdge(setup, edge, setup.edgeA[edge] > 0 ? right : left, setup.edgeB[edge] > 0 ? bottom : top) + sampleReach < 0)
+				{
+					return false;
+				}
+			}
+			return true;
+		}
+
+		void Rasterize(const TriangleSetup& setup, const Rect& rect, std::vector<CoverageBlock>& blocks)
+		{
+			if (HasAvx2())
+			{
+				RasterizeBlocks(setup, rect, blocks, &CoverPartialAvx2);
+			}
+			else
+			{
+				RasterizeBlocks(setup, rect, blocks, &CoverPartialScalar);
+			}
+		}
+
+		void RasterizeScalar(const TriangleSetup& setup, const Rect& rect, std::vector<CoverageBlock>& blocks)
+		{
+			RasterizeBlocks(setup, rect, blocks, &CoverPartialScalar);
+		}
+
+		void RasterizeSamples(const TriangleSetup& setup, const Rect& rect, std::vector<SampleCoverageBlock>& blocks)
+		{
+			if (HasAvx2())
+			{
+				RasterizeBlocks(setup, rect, blocks, &CoverPartialAvx2);
+			}
+			else
+			{
+				RasterizeBlocks(setup, rect, blocks, &CoverPartialScalar);
+			}
+		}
+
+		void ComputeBarycentrics(const TriangleSetup& setup, int x, int y, Barycentrics8& barycentrics)
+		{
+			if (!HasAvx2())
+			{
+				ComputeBarycentricsScalar(setup, x, y, barycentrics);
+				return;
+			}
+
+			const __m256 pixelX{ _mm256_add_ps(_mm256_set1_ps(static_cast<float>(x - setup.minX)), _mm256_setr_ps(0.f, 1.f, 2.f, 3.f, 4.f, 5.f, 6.f, 7.f)) };
+			const __m256 pixelY{ _mm256_set1_ps(static_cast<float>(y - setup.minY)) };
+
+			__m256 linear[3]{};
+			__m256 perspective[3]{};
+			__m256 sum{ _mm256_setzero_ps() };
+			__m256 depth{ _mm256_setzero_ps() };
+			for (int i{}; i < 3; ++i)
+			{
+				linear[i] = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(setup.weightA[i]), pixelX),
+					_mm256_mul_ps(_mm256_set1_ps(setup.weightB[i]), pixelY)), _mm256_set1_ps(setup.weightC[i]));
+				perspective[i] = _mm256_mul_ps(linear[i], _mm256_set1_ps(setup.invW[i]));
+				sum = _mm256_add_ps(sum, perspective[i]);
+				depth = _mm256_add_ps(depth, _mm256_mul_ps(linear[i], _mm256_set1_ps(setup.z[i])));
+			}
+
+			const __m256 scale{ _mm256_div_ps(_mm256_set1_ps(1.f), sum) };
+			for (int i{}; i < 3; ++i)
+			{
+				_mm256_store_ps(barycentrics.weights[i], _mm256_mul_ps(perspective[i], scale));
+			}
+			_mm256_store_ps(barycentrics.depth, depth);
+		}
+
+		void ComputeBarycentricsScalar(const TriangleSetup& setup, int x, int y, Barycentrics8& barycentrics)
+		{
+			const float pixelY{ static_cast<float>(y - setup.minY) };
+			for (int lane{}; lane < 8; ++lane)
+			{
+				const float pixelX{ static_cast<float>(x - setup.minX + lane) };
+				float linear[3]{};
+				float perspective[3]{};
+				float sum{};
+				float depth{};
+				for (int i{}; i < 3; ++i)
+				{
+					linear[i] = setup.weightA[i] * pixelX + setup.weightB[i] * pixelY + setup.weightC[i];
+					perspective[i] = linear[i] * setup.invW[i];
+					sum += perspective[i];
+					depth += linear[i] * setup.z[i];
+				}
+
+				const float scale{ 1.f / sum };
+				for (int i{}; i < 3; ++i)
+				{
+					barycentrics.weights[i][lane] = perspective[i] * scale;
+				}
+				barycentrics.depth[lane] = depth;
+			}
+		}
+
+		void ComputeSampleBarycentrics(const TriangleSetup& setup, int x, int y, int sample, float(&weights)[3])
+		{
+			const float pixelX{ static_cast<float>(x - setup.minX) + static_cast<float>(sampleOffsets[sample][0]) / subpixelScale };
+			const float pixelY{ static_cast<float>(y - setup.minY) + static_cast<float>(sampleOffsets[sample][1]) / subpixelScale };
+			float sum{};
+			for (int i{}; i < 3; ++i)
+			{
+				weights[i] = (setup.weightA[i] * pixelX + setup.weightB[i] * pixelY + setup.weightC[i]) * setup.invW[i];
+				sum += weights[i];
+			}
+			for (float& weight : weights)
+			{
+				weight /= sum;
+			}
+		}
+
+		void ComputeDepthSlopes(const TriangleSetup& setup, float& slopeX, float& slopeY)
+		{
+			slopeX = setup.weightA[0] * setup.z[0] + setup.weightA[1] * setup.z[1] + setup.weightA[2] * setup.z[2];
+			slopeY = setup.weightB[0] * setup.z[0] + setup.weightB[1] * setup.z[1] + setup.weightB[2] * setup.z[2];
+		}
+
+		void ComputeDepthBounds(const TriangleSetup& setup, int x, int y, float& minDepth, float& maxDepth)
+		{
+			float slopeX{};
+			float slopeY{};
+			ComputeDepthSlopes(setup, slopeX, slopeY);
+			const float origin{ setup.weightC[0] * setup.z[0] + setup.weightC[1] * setup.z[1] + setup.weightC[2] * setup.z[2] };
+
+			const float corner{ origin + slopeX * static_cast<float>(x - setup.minX) + slopeY * static_cast<float>(y - setup.minY) };
+			const float spanX{ slopeX * static_cast<float>(blockSize - 1) };
+			const float spanY{ slopeY * static_cast<float>(blockSize - 1) };
+			minDepth = corner + std::min(spanX, 0.f) + std::min(spanY, 0.f);
+			maxDepth = corner + std::max(spanX, 0.f) + std::max(spanY, 0.f);
+		}
+
+		void Interpolate(const float* pVertex0, const float* pVertex1, const float* pVertex2, int count,
+			const Barycentrics8& barycentrics, float(*pAttributes)[8])
+		{
+			if (!HasAvx2())
+			{
+				for (int i{}; i < count; ++i)
+				{
+					for (int lane{}; lane < 8; ++lane)
+					{
+						pAttributes[i][lane] = barycentrics.weights[0][lane] * pVertex0[i] + barycentrics.weights[1][lane] * pVertex1[i]
+							+ barycentrics.weights[2][lane] * pVertex2[i];
+					}
+				}
+				return;
+			}
+
+			const __m256 weight0{ _mm256_load_ps(barycentrics.weights[0]) };
+			const __m256 weight1{ _mm256_load_ps(barycentrics.weights[1]) };
+			const __m256 weight2{ _mm256_load_ps(barycentrics.weights[2]) };
+			for (int i{}; i < count; ++i)
+			{
+				const __m256 value{ _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(weight0, _mm256_set1_ps(pVertex0[i])),
+					_mm256_mul_ps(weight1, _mm256_set1_ps(pVertex1[i]))), _mm256_mul_ps(weight2, _mm256_set1_ps(pVertex2[i]))) };
+				_mm256_storeu_ps(pAttributes[i], value);
+			}
+		}
+
+		namespace Reference
+		{
+			void Rasterize(const TriangleSetup& setup, const Rect& rect, std::vector<CoverageBlock>& blocks)
+			{
+				const int startX{ std::max(rect.left, setup.minX & ~(blockSize - 1)) };
+				const int startY{ std::max(rect.top, setup.minY & ~(blockSize - 1)) };
+				const int endX{ std::min(rect.right - 1, setup.maxX) };
+				const int endY{ std::min(rect.bottom - 1, setup.maxY) };
+
+				for (int blockY{ startY }; blockY <= endY; blockY += blockSize)
+				{
+					for (int blockX{ startX }; blockX <= endX; blockX += blockSize)
+					{
+						uint64_t mask{};
+						for (int y{ blockY }; y < std::min(blockY + blockSize, rect.bottom); ++y)
+						{
+							for (int x{ blockX }; x < std::min(blockX + blockSize, rect.right); ++x)
+							{
+								const bool inside{ EvaluateEdge(setup, 0, x, y) >= 0 && EvaluateEdge(setup, 1, x, y) >= 0 && EvaluateEdge(setup, 2, x, y) >= 0 };
+								mask |= static_cast<uint64_t>(inside) << ((y - blockY) * blockSize + x - blockX);
+							}
+						}
+						if (mask)
+						{
+							blocks.push_back({ blockX, blockY, mask });
+						}
+					}
+				}
+			}
+		}
+	}
+}
@@ -0,0 +1,138 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+
+//Triangle traversal for the CPU rasterizers. Coverage is decided in fixed point with the D3D top-left
+//fill rule, so shared edges are hit exactly once. The screen is walked in 8x8 blocks: blocks all three
+//edges miss are skipped, blocks all three edges contain are accepted whole, only the rest are tested
+//per pixel, 8 at a time with AVX2 when the CPU has it.
+namespace dae
+{
+	namespace RasterKernel
+	{
+		constexpr int subpixelBits{ 4 };
+		constexpr int subpixelScale{ 1 << subpixelBits };
+		constexpr int blockSize{ 8 };
+		//Vertices further out are rejected, it keeps edge values inside a block in 32 bits. Clipping's guard band stays inside it
+		constexpr float maxCoordinate{ 32768.f };
+
+		//The D3D standard 4x pattern, in subpixels from the pixel center
+		constexpr int sampleCount{ 4 };
+		constexpr int sampleOffsets[sampleCount][2]{ { -2, -6 }, { 6, -2 }, { -6, 2 }, { 2, 6 } };
+		constexpr int maxSampleOffset{ 6 };
+
+		//Which faces are dropped, clockwise on screen is front like the D3D default
+		enum class Cull
+		{
+			None,
+			Back,
+			Front
+		};
+
+		//Post-divide position in pixels, (0, 0) is the top left corner of the screen
+		struct ScreenVertex
+		{
+			float x{};
+			float y{};
+			float z{}; //depth, z / w
+			float invW{};
+		};
+
+		//Pixels [left, right) x [top, bottom), left and top must be multiples of blockSize
+		struct Rect
+		{
+			int left{};
+			int top{};
+			int right{};
+			int bottom{};
+		};
+
+		struct TriangleSetup
+		{
+			//E(X, Y) = A * X + B * Y + C at subpixel coordinates, the pixel is covered when all three are >= 0.
+			//The fill rule is folded into C
+			int64_t edgeA[3]{};
+			int64_t edgeB[3]{};
+			int64_t edgeC[3]{};
+
+			//Pixels whose centers can be covered, inclusive
+			int minX{};
+			int minY{};
+			int maxX{};
+			int maxY{};
+
+			//Screen-space barycentric of every input vertex (in input order) at pixel centers,
+			//relative to pixel (minX, minY): b = a * (x - minX) + b * (y - minY) + c
+			float weightA[3]{};
+			float weightB[3]{};
+			float weightC[3]{};
+			float invW[3]{};
+			float z[3]{};
+
+			//Bounds and Overlaps cover the samples, not only the pixel centers
+			bool multisample{};
+		};
+
+		//One 8x8 block, bit row * 8 + column is pixel (x + column, y + row)
+		struct CoverageBlock
+		{
+			int x{};
+			int y{};
+			uint64_t mask{};
+		};
+
+		//The same pixels with the coverage of every sample, mask is their union
+		struct SampleCoverageBlock
+		{
+			CoverageBlock pixels{};
+			uint64_t samples[sampleCount]{};
+		};
+
+		//Perspective-correct weights of the three vertices for 8 pixels of a row, and their linear depth
+		struct Barycentrics8
+		{
+			alignas(32) float weights[3][8]{};
+			alignas(32) float depth[8]{};
+		};
+
+		bool HasAvx2();
+
+		//False for culled, degenerate or off-viewport triangles and ones that need clipping first.
+		//Multisampled triangles keep the ones that only cover samples
+		bool Setup(const ScreenVertex(&vertices)[3], const Rect& viewport, Cull cull, TriangleSetup& setup, bool multisample = false);
+
+		//False when one of the edges is negative on all of rect, for binning
+		bool Overlaps(const TriangleSetup& setup, const Rect& rect);
+
+		//Appends the covered blocks of rect, AVX2 when available
+		void Rasterize(const TriangleSetup& setup, const Rect& rect, std::vector<CoverageBlock>& blocks);
+		//Same blocks without AVX2
+		void RasterizeScalar(const TriangleSetup& setup, const Rect& rect, std::vector<CoverageBlock>& blocks);
+		//Coverage of the sampleOffsets samples, blocks where at least one is covered
+		void RasterizeSamples(const TriangleSetup& setup, const Rect& rect, std::vector<SampleCoverageBlock>& blocks);
+
+		//Pixels x .. x + 7 of row y, lanes outside the triangle extrapolate like helper pixels do
+		void ComputeBarycentrics(const TriangleSetup& setup, int x, int y, Barycentrics8& barycentrics);
+		void ComputeBarycentricsScalar(const TriangleSetup& setup, int x, int y, Barycentrics8& barycentrics);
+
+		//Perspective-correct weights at a sample of pixel (x, y) instead of its center, for centroid interpolation
+		void ComputeSampleBarycentrics(const TriangleSetup& setup, int x, int y, int sample, float(&weights)[3]);
+
+		//Change of the linear depth per pixel
+		void ComputeDepthSlopes(const TriangleSetup& setup, float& slopeX, float& slopeY);
+		//Bounds of the linear depth over the pixel centers of the 8x8 block at (x, y), covered or not. Depth is a plane
+		//in screen space, so its corners bound it
+		void ComputeDepthBounds(const TriangleSetup& setup, int x, int y, float& minDepth, float& maxDepth);
+
+		//count floats per vertex, e.g. the Normal, Tangent and UV that follow each other in a Vertex.
+		//pAttributes[i][lane] receives attribute i of the 8 pixels
+		void Interpolate(const float* pVertex0, const float* pVertex1, const float* pVertex2, int count,
+			const Barycentrics8& barycentrics, float(*pAttributes)[8]);
+
+		namespace Reference
+		{
+			//Every pixel of the bounds on its own in 64 bits, the ground truth for the blocked paths
+			void Rasterize(const TriangleSetup& setup, const Rect& rect, std::vector<CoverageBlock>& blocks);
+		}
+	}
+}
@@ -0,0 +1,193 @@
+#pragma once
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "Math.h"
+#include "ColorRGB.h"
+#include "ColorSpace.h"
+
+namespace dae
+{
+	enum class TexelFormat : uint8_t;
+
+	//Index into one of a device's tables, 0 is never a valid one. The tag keeps the kinds apart
+	template<typename Tag>
+	struct DeviceHandle
+	{
+		uint32_t id{};
+
+		bool IsValid() const { return id != 0; }
+		bool operator==(const DeviceHandle&) const = default;
+	};
+	using BufferHandle = DeviceHandle<struct BufferTag>;
+	using TextureHandle = DeviceHandle<struct TextureTag>;
+	using SamplerHandle = DeviceHandle<struct SamplerTag>;
+	using RasterizerHandle = DeviceHandle<struct RasterizerTag>;
+	//Shaders with the vertex layout they read and the parameters they are drawn with
+	using ProgramHandle = DeviceHandle<struct ProgramTag>;
+
+	//Releases the texture when the last copy goes, see RenderDevice::Share
+	using SharedTexture = std::shared_ptr<const TextureHandle>;
+
+	enum class BufferBinding : uint8_t
+	{
+		Vertex,
+		Index //always 32-bit indices
+	};
+
+	enum class BufferUsage : uint8_t
+	{
+		Immutable, //contents are given at creation
+		Dynamic //rewritten whole with Map
+	};
+
+	struct BufferDesc
+	{
+		BufferBinding binding{};
+		BufferUsage usage{};
+		uint32_t byteWidth{};
+		uint32_t stride{}; //bytes per vertex, 4 for index buffers
+	};
+
+	struct TextureDesc
+	{
+		int width{};
+		int height{};
+		int mipLevels{ 1 };
+		int arraySize{}; //0 for a plain texture, otherwise the slices of a texture array
+		TexelFormat format{};
+		ColorSpace colorSpace{};
+	};
+
+	enum class SamplerFilter : uint8_t
+	{
+		Point,
+		Linear,
+		Anisotropic
+	};
+
+	//Samplers always wrap
+	struct SamplerDesc
+	{
+		SamplerFilter filter{};
+		uint32_t maxAnisotropy{ 16 };
+	};
+
+	enum class FaceCulling : uint8_t
+	{
+		Back,
+		Front,
+		None
+	};
+
+	struct RasterizerDesc
+	{
+		FaceCulling culling{};
+	};
+
+	enum class VertexFormat : uint8_t
+	{
+		Float2,
+		Float3,
+		Float4
+	};
+
+	//One attribute the vertex shader reads, by its semantic
+	struct VertexElement
+	{
+		std::string semantic{};
+		uint32_t semanticIndex{};
+		VertexFormat format{};
+		uint32_t slot{};
+		uint32_t offset{}; //bytes into the slot's vertex
+		bool perInstance{}; //advances once per instance instead of once per vertex
+	};
+
+	//A shader source compiled with the defines set to 1. Every pass it has is drawn, in order
+	struct ProgramDesc
+	{
+		std::wstring source{};
+		std::vector<std::string> defines{};
+		std::vector<VertexElement> layout{};
+	};
+
+	//The calls the renderer makes to create resources and draw with them. Everything is a triangle list.
+	//Backends report failure with invalid handles and null pointers, drawing with invalid handles is an error
+	//a backend may ignore or record but never crashes on.
+	//D3D11RenderDevice draws, NullRenderDevice only validates and records, so frame logic runs without a GPU
+	class RenderDevice
+	{
+	public:
+		RenderDevice() = default;
+		virtual ~RenderDevice() = default;
+
+		RenderDevice(const RenderDevice&) = delete;
+		RenderDevice(RenderDevice&&) noexcept = delete;
+		RenderDevice& operator=(const RenderDevice&) = delete;
+		RenderDevice& operator=(RenderDevice&&) noexcept = delete;
+
+		//pData holds desc.byteWidth bytes, it may be nullptr for dynamic buffers
+		virtual BufferHandle CreateBuffer(const BufferDesc& desc, const void* pData) = 0;
+		virtual void ReleaseBuffer(BufferHandle buffer) = 0;
+		//Dynamic buffers only, the old contents are discarded. Returns nullptr on failure
+		virtual void* Map(BufferHandle buffer) = 0;
+		virtual void Unmap(BufferHandle buffer) = 0;
+
+		//mipLevels entries per slice, slice by slice with rows tightly packed. Empty leaves the contents undefined
+		//until UpdateTexture or CopyTextureLevels fills them
+		virtual TextureHandle CreateTexture(const TextureDesc& desc, const std::vector<const void*>& mips) = 0;
+		virtual void ReleaseTexture(TextureHandle texture) = 0;
+		//Plain textures only, pData holds the whole level
+		virtual void UpdateTexture(TextureHandle texture, int mip, const void* pData) = 0;
+		//count levels from sourceMip on into destination from destinationMip on, on the device. Sizes and format must match
+		virtual void CopyTextureLevels(TextureHandle source, int sourceMip, TextureHandle destination, int destinationMip, int count) = 0;
+
+		//Owns texture from here on, invalid handles give nullptr. The device must outlive every copy
+		SharedTexture Share(TextureHandle texture)
+		{
+			if (!texture.IsValid())
+			{
+				return {};
+			}
+			return { new TextureHandle{ texture }, [this](const TextureHandle* pTexture)
+				{
+					ReleaseTexture(*pTexture);
+					delete pTexture;
+				} };
+		}
+
+		virtual SamplerHandle CreateSampler(const SamplerDesc& desc) = 0;
+		virtual void ReleaseSampler(SamplerHandle sampler) = 0;
+		virtual RasterizerHandle CreateRasterizer(const RasterizerDesc& desc) = 0;
+		virtual void ReleaseRasterizer(RasterizerHandle rasterizer) = 0;
+		//Invalid when the source does not compile or the layout does not match its vertex shader
+		virtual ProgramHandle CreateProgram(const ProgramDesc& desc) = 0;
+		virtual void ReleaseProgram(ProgramHandle program) = 0;
+
+		//Parameters of a program by their name in its source, they keep their value until set again
+		virtual void SetMatrix(ProgramHandle program, const std::string& name, const Matrix& matrix) = 0;
+		virtual void SetVector(ProgramHandle program, const std::string& name, const Vector4& vector) = 0;
+		virtual void SetScalar(ProgramHandle program, const std::string& name, float value) = 0;
+		virtual void SetTexture(ProgramHandle program, const std::string& name, TextureHandle texture) = 0;
+		virtual void SetSampler(ProgramHandle program, const std::string& name, SamplerHandle sampler) = 0;
+		virtual void SetRasterizer(ProgramHandle program, const std::string& name, RasterizerHandle rasterizer) = 0;
+
+		virtual void SetProgram(ProgramHandle program) = 0;
+		//Strides come from the buffer's desc
+		virtual void SetVertexBuffer(uint32_t slot, BufferHandle buffer) = 0;
+		virtual void SetIndexBuffer(BufferHandle buffer) = 0;
+		virtual void DrawIndexed(uint32_t indexCount, uint32_t firstIndex, int32_t baseVertex = 0) = 0;
+		virtual void DrawIndexedInstanced(uint32_t indexCount, uint32_t instanceCount, uint32_t firstIndex, int32_t baseVertex,
+			uint32_t firstInstance) = 0;
+
+		//Color and depth of the back buffer
+		virtual int GetWidth() const = 0;
+		virtual int GetHeight() const = 0;
+		virtual void Clear(const ColorRGB& color) = 0;
+		//Replaces the back buffer with a frame drawn on the CPU, an RGBA8 texture of its size with one mip
+		virtual void CopyToBackBuffer(TextureHandle texture) = 0;
+		virtual void Present() = 0;
+	};
+}
@@ -0,0 +1,170 @@
+#include "pch.h"
+#include "RenderQueue.h"
+#include "JobSystem.h"
+#include <array>
+#include <chrono>
+
+namespace dae
+{
+	namespace
+	{
+		constexpr uint32_t depthMask{ (1u << 24) - 1 };
+		constexpr uint32_t fieldMask{ (1u << 12) - 1 };
+
+		//Below this a comparison sort wins, the radix passes clear and walk 256 buckets each
+		constexpr size_t minRadixPackets{ 2048 };
+		//Fewer packets than this per chunk are not worth a job
+		constexpr size_t minChunkPackets{ 4096 };
+
+		uint64_t MakePrefix(uint32_t pass, bool translucent)
+		{
+			return static_cast<uint64_t>(pass & 3) << 62 | static_cast<uint64_t>(translucent) << 61;
+		}
+
+		uint32_t QuantizeDepth(float depth)
+		{
+			return static_cast<uint32_t>(std::clamp(depth, 0.f, 1.f) * static_cast<float>(depthMask));
+		}
+	}
+
+	uint64_t RenderQueue::MakeOpaqueKey(uint32_t pass, uint32_t effect, uint32_t textureSet, float depth)
+	{
+		return MakePrefix(pass, false)
+			| static_cast<uint64_t>(effect & fieldMask) << 49
+			| static_cast<uint64_t>(textureSet & fieldMask) << 37
+			| QuantizeDepth(depth);
+	}
+
+	uint64_t RenderQueue::MakeTranslucentKey(uint32_t pass, uint32_t effect, uint32_t textureSet, float depth)
+	{
+		//Inverted, so the farthest draw has the smallest key
+		return MakePrefix(pass, true)
+			| static_cast<uint64_t>(depthMask - QuantizeDepth(depth)) << 37
+			| static_cast<uint64_t>(effect & fieldMask) << 25
+			| static_cast<uint64_t>(textureSet & fieldMask) << 13;
+	}
+
+	uint32_t RenderQueue::GetEffect(uint64_t key)
+	{
+		return static_cast<uint32_t>(key >> (IsTranslucent(key) ? 25 : 49)) & fieldMask;
+	}
+
+	uint32_t RenderQueue::GetTextureSet(uint64_t key)
+	{
+		return static_cast<uint32_t>(key >> (IsTranslucent(key) ? 13 : 37)) & fieldMask;
+	}
+
+	void RenderQueue::Sort(std::vector<Packet>& packets, std::vector<Packet>& scratch, JobSystem* pJobs)
+	{
+		const size_t count{ packets.size() };
+		if (count < minRadixPackets)
+		{
+			std::stable_sort(packets.begin(), packets.end(), [](const Packet& a, const Packet& b) { return a.key < b.key; });
+			return;
+		}
+		scratch.resize(count);
+
+		//Bits that differ from the first key somewhere, a byte without any needs no pass
+		uint64_t varying{};
+		for (const Packet& packet : packets)
+		{
+			varying |= packet.key ^ packets[0].key;
+		}
+
+		//Every chunk counts its own digits and scatters to its own offsets, so the passes stay stable
+		const size_t chunkCount{ pJobs ? std::clamp(count / minChunkPackets, size_t{ 1 }, static_cast<size_t>(pJobs->GetThreadCount()) * 4) : 1 };
+		std::vector<std::array<uint32_t, 256>> offsets(chunkCount);
+		const auto forEachChunk = [&](const auto& body)
+		{
+			if (chunkCount == 1)
+			{
+				body(size_t{ 0 }, size_t{ 0 }, count);
+				return;
+			}
+			pJobs->ParallelFor(chunkCount, 1, [&](size_t begin, size_t end)
+				{
+					for (size_t chunk{ begin }; chunk < end; ++chunk)
+					{
+						body(chunk, count * chunk / chunkCount, count * (chunk + 1) / chunkCount);
+					}
+				});
+		};
+
+		Packet* pSource{ packets.data() };
+		Packet* pDestination{ scratch.data() };
+		for (int shift{}; shift < 64; shift += 8)
+		{
+			if (((varying >> shift) & 0xFF) == 0)
+			{
+				continue;
+			}
+
+			forEachChunk([&](size_t chunk, size_t begin, size_t end)
+				{
+					std::array<uint32_t, 256>& histogram{ offsets[chunk] };
+					histogram.fill(0);
+					for (size_t i{ begin }; i < end; ++i)
+					{
+						++histogram[(pSource[i].key >> shift) & 0xFF];
+					}
+				});
+
+			//Digit by digit, and within a digit chunk by chunk
+			uint32_t sum{};
+			for (size_t digit{}; digit < 256; ++digit)
+			{
+				for (std::array<uint32_t, 256>& histogram : offsets)
+				{
+					const uint32_t digitCount{ histogram[digit] };
+					histogram[digit] = sum;
+					sum += digitCount;
+				}
+			}
+
+			forEachChunk([&](size_t chunk, size_t begin, size_t end)
+				{
+					std::array<uint32_t, 256>& offset{ offsets[chunk] };
+					for (size_t i{ begin }; i < end; ++i)
+					{
+						pDestination[offset[(pSource[i].key >> shift) & 0xFF]++] = pSource[i];
+					}
+				});
+			std::swap(pSource, pDestination);
+		}
+
+		if (pSource != packets.data())
+		{
+			packets.swap(scratch);
+		}
+	}
+
+	void RenderQueue::Sort(JobSystem* pJobs)
+	{
+		const auto start{ std::chrono::steady_clock::now() };
+		Sort(m_Packets, m_Scratch, pJobs);
+
+		m_Stats = {};
+		m_Stats.packets = m_Packets.size();
+		for (size_t i{}; i < m_Packets.size(); ++i)
+		{
+			const uint64_t key{ m_Packets[i].key };
+			if (i == 0 || GetEffect(key) != GetEffect(m_Packets[i - 1].key))
+			{
+				++m_Stats.effectChanges;
+			}
+			if (i == 0 || GetTextureSet(key) != GetTextureSet(m_Packets[i - 1].key))
+			{
+				++m_Stats.textureSetChanges;
+			}
+		}
+		m_Stats.sortMicroseconds = std::chrono::duration<float, std::micro>(std::chrono::steady_clock::now() - start).count();
+	}
+
+	void RenderQueue::Execute(const std::function<void(const Packet&)>& draw) const
+	{
+		for (const Packet& packet : m_Packets)
+		{
+			draw(packet);
+		}
+	}
+}
@@ -0,0 +1,67 @@
+#pragma once
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+namespace dae
+{
+	class JobSystem;
+
+	//Draws of one frame as small packets, each with a 64-bit key that orders them. Sorting the keys groups
+	//opaque draws by effect and then by texture set, front to back within a set, and lays translucent draws
+	//back to front after them. Knows nothing about what a packet draws, the caller maps object and data back
+	//to its own draw calls.
+	//Opaque keys, from the top bit down: pass 2, translucent 1 (0), effect 12, texture set 12, unused 13, depth 24.
+	//Translucent keys: pass 2, translucent 1 (1), inverted depth 24, effect 12, texture set 12, unused 13
+	class RenderQueue final
+	{
+	public:
+		struct Packet
+		{
+			uint64_t key{};
+			uint32_t object{};
+			uint32_t data{};
+		};
+
+		struct Stats
+		{
+			size_t packets{};
+			size_t effectChanges{}; //counted in sorted order, the first draw counts as one
+			size_t textureSetChanges{};
+			float sortMicroseconds{};
+		};
+
+		static constexpr uint32_t passCount{ 4 };
+		static constexpr uint32_t effectCount{ 1 << 12 };
+		static constexpr uint32_t textureSetCount{ 1 << 12 };
+
+		//depth is 0 at the near plane and 1 at the far plane, values outside are clamped
+		static uint64_t MakeOpaqueKey(uint32_t pass, uint32_t effect, uint32_t textureSet, float depth);
+		static uint64_t MakeTranslucentKey(uint32_t pass, uint32_t effect, uint32_t textureSet, float depth);
+		static uint32_t GetPass(uint64_t key) { return static_cast<uint32_t>(key >> 62); }
+		static bool IsTranslucent(uint64_t key) { return (key >> 61) & 1; }
+		static uint32_t GetEffect(uint64_t key);
+		static uint32_t GetTextureSet(uint64_t key);
+
+		//Stable LSD radix sort on the key, a byte per pass. Passes where every key has the same byte are skipped,
+		//so keys that only differ in a few fields cost a few passes. Large queues sort on the jobs, small ones
+		//with a comparison sort
+		static void Sort(std::vector<Packet>& packets, std::vector<Packet>& scratch, JobSystem* pJobs = nullptr);
+
+		void Clear() { m_Packets.clear(); }
+		void Push(uint64_t key, uint32_t object, uint32_t data = 0) { m_Packets.push_back({ key, object, data }); }
+		//Sorts and counts the state changes the order leaves
+		void Sort(JobSystem* pJobs = nullptr);
+
+		//Calls draw for every packet in order
+		void Execute(const std::function<void(const Packet&)>& draw) const;
+
+		const std::vector<Packet>& GetPackets() const { return m_Packets; }
+		const Stats& GetStats() const { return m_Stats; }
+
+	private:
+		std::vector<Packet> m_Packets{};
+		std::vector<Packet> m_Scratch{};
+		Stats m_Stats{};
+	};
+}
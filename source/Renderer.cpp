@@ -1,100 +1,43 @@
 #include "pch.h"
 #include "Renderer.h"
-#include <future>
-
-#define DEBUG
+#include "SoftwareRenderer.h"
+#include <map>
+#include <unordered_map>
+#include <chrono>
 
 namespace dae {
 
-	Renderer::Renderer(SDL_Window* pWindow, Camera* pCamera) :
-		m_pWindow(pWindow),
+	Renderer::Renderer(RenderDevice& device, Camera* pCamera) :
+		m_pDevice(&device),
+		m_Width(device.GetWidth()),
+		m_Height(device.GetHeight()),
 		m_pCamera(pCamera)
 	{
-		//Initialize
-		SDL_GetWindowSize(pWindow, &m_Width, &m_Height);
-
-		//Initialize DirectX pipeline
-		const HRESULT result = InitializeDirectX();
-		if (result == S_OK)
-		{
-			m_IsInitialized = true;
-			std::cout << "DirectX is initialized and ready!\n";
-		}
-		else
-		{
-			std::cout << "DirectX initialization failed!\n";
-		}
-
 		CreateMesh();
-
-		//Initialize sampler
-		m_pEffectSamplerVariable = m_pMeshes[0]->GetSampleVar();
-		if (!m_pEffectSamplerVariable->IsValid())
-		{
-			std::wcout << L"m_pEffectSamplerVariable not valid!\n";
-		}
-
-		//Create sampler
-		m_SamplerDesc.AddressU = D3D11_TEXTURE_ADDRESS_WRAP;
-		m_SamplerDesc.AddressV = D3D11_TEXTURE_ADDRESS_WRAP;
-		m_SamplerDesc.AddressW = D3D11_TEXTURE_ADDRESS_WRAP;
-
-		m_SamplerDesc.ComparisonFunc = D3D11_COMPARISON_NEVER;
-		m_SamplerDesc.MipLODBias = 0;
-		m_SamplerDesc.MinLOD = 0;
-
-		m_SamplerDesc.MaxLOD = D3D11_FLOAT32_MAX;
-		m_SamplerDesc.MaxAnisotropy = 16;
 	}
 
 	Renderer::~Renderer()
 	{
-		if (m_pRenderTargetView)
-		{
-			m_pRenderTargetView->Release();
-		}
-		if (m_pRenderTargetBuffer)
-		{
-			m_pRenderTargetBuffer->Release();
-		}
-		if (m_pDepthStencilView)
-		{
-			m_pDepthStencilView->Release();
-		}
-		if (m_pDepthStencilBuffer)
-		{
-			m_pDepthStencilBuffer->Release();
-		}
-		if (m_pSwapChain)
-		{
-			m_pSwapChain->Release();
-		}
-		if (m_pDeviceContext)
-		{
-			m_pDeviceContext->ClearState();
-			m_pDeviceContext->Flush();
-			m_pDeviceContext->Release();
-		}
-		if (m_pDevice)
-		{
-			m_pDevice->Release();
-		}
-		if (m_pEffectSamplerVariable)
+		//Meshes release their buffers and programs through the device.
+		//Textures the cache and the streamer still hold go before it too
+		for (const auto pMesh : m_pMeshes)
 		{
-			m_pEffectSamplerVariable->Release();
+			delete pMesh;
 		}
-		if (m_pSamplerState)
+		delete m_pInstancedMesh;
+		m_TextureStreamer.Clear();
+		m_TextureCache.Clear();
+		if (m_SoftwareFrame.IsValid())
 		{
-			m_pSamplerState->Release();
+			m_pDevice->ReleaseTexture(m_SoftwareFrame);
 		}
-		if (m_pRasterizerState)
+		if (m_Sampler.IsValid())
 		{
-			m_pRasterizerState->Release();
+			m_pDevice->ReleaseSampler(m_Sampler);
 		}
-
-		for (const auto pMesh : m_pMeshes)
+		if (m_Rasterizer.IsValid())
 		{
-			delete pMesh;
+			m_pDevice->ReleaseRasterizer(m_Rasterizer);
 		}
 	}
 
@@ -102,286 +45,548 @@ namespace dae {
 	{
 		constexpr float rotateSpeed{ 45.0f };
 
-		for (const auto pMesh : m_pMeshes)
+		const int size = static_cast<int>(m_pMeshes.size());
+		for (int i{}; i < size; ++i)
 		{
+			Mesh* pMesh{ m_pMeshes[i] };
 			if (m_Rotate)
 			{
 				pMesh->RotateY(rotateSpeed * TO_RADIANS * pTimer->GetElapsed());
 			}
-
-			pMesh->SetMatrices(m_pCamera->viewMatrix * m_pCamera->projectionMatrix, m_pCamera->invViewMatrix);
+			m_FrustumCuller.SetWorld(i, pMesh->GetWorldMatrix());
 		}
-	}
 
+		const Matrix viewProjection{ m_pCamera->viewMatrix * m_pCamera->projectionMatrix };
+		m_FrustumCuller.Cull(viewProjection);
+		CullOccludedMeshes();
 
-	void Renderer::Render() const
-	{
-		if (!m_IsInitialized)
-			return;
+		//Effect variables are set on this thread, level selection and meshlet culling of the meshes run as jobs.
+		//Only the vehicle's rasterizer state follows the cull mode, the fire is always drawn two-sided
+		constexpr float maxLodPixelError{ 1.f };
+		for (int i{}; i < size; ++i)
+		{
+			if (m_MeshVisible[i])
+			{
+				m_pMeshes[i]->SetMatrices(viewProjection, m_pCamera->invViewMatrix);
+			}
+		}
+		m_Jobs.ParallelFor(size, 1, [&](size_t begin, size_t end)
+			{
+				for (size_t i{ begin }; i < end; ++i)
+				{
+					if (!m_MeshVisible[i])
+					{
+						continue;
+					}
+					m_pMeshes[i]->SelectLod(*m_pCamera, static_cast<float>(m_Height), maxLodPixelError);
+
+					Meshlets::FaceCull faceCull{ Meshlets::FaceCull::None };
+					if (i == 0 && m_CullMode != None)
+					{
+						faceCull = m_CullMode == Back ? Meshlets::FaceCull::Back : Meshlets::FaceCull::Front;
+					}
+					m_pMeshes[i]->CullMeshlets(viewProjection, m_pCamera->origin, faceCull);
+				}
+			});
 
-		//Clear window for next frame
-		ColorRGB clearColor{ 0.39f, 0.59f, 0.93f };
-		if (m_ClearColor)
+		if (m_ShowInstances && m_pInstancedMesh)
 		{
-			clearColor = {0.1f,0.1f,0.1f};
+			m_VehicleInstances.Update(*m_pCamera, static_cast<float>(m_Height), maxLodPixelError);
+			m_pInstancedMesh->SetMatrices(viewProjection, m_pCamera->invViewMatrix);
 		}
-		m_pDeviceContext->ClearRenderTargetView(m_pRenderTargetView, &clearColor.r);
-		m_pDeviceContext->ClearDepthStencilView(m_pDepthStencilView, D3D11_CLEAR_DEPTH | D3D11_CLEAR_STENCIL, 1.0f, 0);
 
-		//Set pipeline + invoke drawcalls (= render)
-		const int size = static_cast<int>(m_pMeshes.size());
+		FillRenderQueue();
+
+		m_MeshletStats = {};
 		for (int i{}; i < size; ++i)
 		{
-			if (m_ShowFireMesh == false && i > 0)
+			if (m_MeshVisible[i])
 			{
-				break;
+				m_MeshletStats += m_pMeshes[i]->GetMeshletStats();
 			}
-			m_pMeshes[i]->Render(m_pDeviceContext);
 		}
-		
 
-		//Present to screen
-		m_pSwapChain->Present(0, 0);
-	}
+		for (int i{}; i < size; ++i)
+		{
+			//Hidden meshes ask for nothing, their maps shrink back to the tail
+			if ((m_ShowFireMesh || i == 0) && m_MeshVisible[i])
+			{
+				m_pMeshes[i]->RequestMips(m_TextureStreamer, *m_pCamera, static_cast<float>(m_Height));
+			}
+		}
 
-	HRESULT Renderer::InitializeDirectX()
-	{
-		///1. Create Device & DeviceContext
-		D3D_FEATURE_LEVEL featureLevel = D3D_FEATURE_LEVEL_11_1;
-		uint32_t createDeviceFlags = 0;
-#if defined(DEBUG) || defined(_DEBUG)
-		createDeviceFlags |= D3D11_CREATE_DEVICE_DEBUG;
-#endif
+		m_TextureStreamer.Update(*m_pDevice);
 
-		IDXGIFactory1* pFactory = nullptr;
-		HRESULT hr = CreateDXGIFactory1(__uuidof(IDXGIFactory1), (void**)&pFactory);
+		if (m_UseSoftwareRenderer && m_pSoftwareRenderer)
+		{
+			constexpr Sampling::Filter filters[]{ Sampling::Filter::Point, Sampling::Filter::Trilinear, Sampling::Filter::Anisotropic };
+			constexpr SoftwareRenderer::Cull cullModes[]{ SoftwareRenderer::Cull::Back, SoftwareRenderer::Cull::Front, SoftwareRenderer::Cull::None };
+			Sampling::SamplerState samplerState{};
+			samplerState.filter = filters[m_SampleState];
+			m_pSoftwareRenderer->SetSamplerState(samplerState);
+			m_pSoftwareRenderer->SetCullMode(cullModes[m_CullMode]);
+			m_pSoftwareRenderer->SetClearColor(GetClearColor());
+			for (int i{}; i < size; ++i)
+			{
+				m_pSoftwareRenderer->SetWorldMatrix(i, m_pMeshes[i]->GetWorldMatrix());
+				m_pSoftwareRenderer->SetVisible(i, (m_ShowFireMesh || i == 0) && m_MeshVisible[i]);
+			}
+		}
+	}
 
-		HRESULT result{};
 
-		if (SUCCEEDED(hr))
+	void Renderer::FillRenderQueue()
+	{
+		//View depth of the bounds center, 0 at the near plane and 1 at the far plane
+		const float depthRange{ m_pCamera->farC - m_pCamera->nearC };
+		const auto getDepth = [this, depthRange](const Mesh* pMesh)
 		{
-			IDXGIAdapter1* pAdapter = nullptr;
+			const Vector3 center{ pMesh->GetWorldMatrix().TransformPoint((pMesh->GetBoundsMinimum() + pMesh->GetBoundsMaximum()) * 0.5f) };
+			return (Vector3::Dot(center - m_pCamera->origin, m_pCamera->forward) - m_pCamera->nearC) / depthRange;
+		};
+		const auto makeKey = [](const DrawState& state, float depth)
+		{
+			return state.translucent ? RenderQueue::MakeTranslucentKey(0, state.effect, state.textureSet, depth)
+				: RenderQueue::MakeOpaqueKey(0, state.effect, state.textureSet, depth);
+		};
 
-			hr = pFactory->EnumAdapters1(m_GpuIndex, &pAdapter);
-			if (SUCCEEDED(hr))
+		m_RenderQueue.Clear();
+		for (size_t i{}; i < m_pMeshes.size(); ++i)
+		{
+			if ((m_ShowFireMesh || i == 0) && m_MeshVisible[i])
 			{
-				// Create device and context on the second GPU
-				result = D3D11CreateDevice(pAdapter, D3D_DRIVER_TYPE_UNKNOWN, nullptr, createDeviceFlags, &featureLevel, 1, D3D11_SDK_VERSION, &m_pDevice, nullptr, &m_pDeviceContext);
-
-				if (FAILED(result))
-				{
-					return result;
-				}
-
-				pAdapter->Release();
+				m_RenderQueue.Push(makeKey(m_MeshStates[i], getDepth(m_pMeshes[i])), static_cast<uint32_t>(i), static_cast<uint32_t>(DrawKind::Mesh));
 			}
-
-			pFactory->Release();
 		}
-
-		
-
-		IDXGIFactory1* pDxgiFactory{ nullptr };
-		result = CreateDXGIFactory1(__uuidof(IDXGIFactory1), reinterpret_cast<void**>(&pDxgiFactory));
-		if (FAILED(result))
+		//The copies spread over the whole field, the batch sorts as if it were at the near plane
+		if (m_ShowInstances && m_pInstancedMesh && !m_VehicleInstances.GetVisible().empty())
 		{
-			return result;
+			m_RenderQueue.Push(makeKey(m_InstancedState, 0.f), 0, static_cast<uint32_t>(DrawKind::Instances));
 		}
+		m_RenderQueue.Sort(&m_Jobs);
+	}
 
-		///2. Create swapchain
-
-		//Set properties of swapchain
-		DXGI_SWAP_CHAIN_DESC swapChainDesc{};
-		swapChainDesc.BufferDesc.Width = m_Width;
-		swapChainDesc.BufferDesc.Height = m_Height;
-		swapChainDesc.BufferDesc.RefreshRate.Numerator = 1;
-		swapChainDesc.BufferDesc.RefreshRate.Denominator = 60;
-		swapChainDesc.BufferDesc.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
-		swapChainDesc.BufferDesc.ScanlineOrdering = DXGI_MODE_SCANLINE_ORDER_UNSPECIFIED;
-		swapChainDesc.BufferDesc.Scaling = DXGI_MODE_SCALING_UNSPECIFIED;
-		swapChainDesc.SampleDesc.Count = 1;
-		swapChainDesc.SampleDesc.Quality = 0;
-		swapChainDesc.BufferUsage = DXGI_USAGE_RENDER_TARGET_OUTPUT;
-		swapChainDesc.BufferCount = 1;
-		swapChainDesc.Windowed = true;
-		swapChainDesc.SwapEffect = DXGI_SWAP_EFFECT_DISCARD;
-		swapChainDesc.Flags = 0;
-
-		//Get the handle (HWND) from the SDL Backbuffer
-		SDL_SysWMinfo sysWMInfo{};
-		SDL_VERSION(&sysWMInfo.version);
-		SDL_GetWindowWMInfo(m_pWindow, &sysWMInfo);
-		swapChainDesc.OutputWindow = sysWMInfo.info.win.window;
-
-		//Create swapchain
-		result = pDxgiFactory->CreateSwapChain(m_pDevice, &swapChainDesc, &m_pSwapChain);
-		if (FAILED(result))
-		{
-			return result;
+	void Renderer::CullOccludedMeshes()
+	{
+		m_MeshVisible.resize(m_pMeshes.size());
+		for (size_t i{}; i < m_pMeshes.size(); ++i)
+		{
+			m_MeshVisible[i] = m_FrustumCuller.IsVisible(i);
 		}
-
-		///3. Create DepthStencil (DS) & DepthStencilView (DSV)
-
-		//Set properties of depthstencil
-		D3D11_TEXTURE2D_DESC depthStencilDesc{};
-		depthStencilDesc.Width = m_Width;
-		depthStencilDesc.Height = m_Height;
-		depthStencilDesc.MipLevels = 1;
-		depthStencilDesc.ArraySize = 1;
-		depthStencilDesc.Format = DXGI_FORMAT_D24_UNORM_S8_UINT;
-		depthStencilDesc.SampleDesc.Count = 1;
-		depthStencilDesc.SampleDesc.Quality = 0;
-		depthStencilDesc.Usage = D3D11_USAGE_DEFAULT;
-		depthStencilDesc.BindFlags = D3D11_BIND_DEPTH_STENCIL;
-		depthStencilDesc.CPUAccessFlags = 0;
-		depthStencilDesc.MiscFlags = 0;
-
-		//View
-		D3D11_DEPTH_STENCIL_VIEW_DESC depthStencilViewDesc{};
-		depthStencilViewDesc.Format = depthStencilDesc.Format;
-		depthStencilViewDesc.ViewDimension = D3D11_DSV_DIMENSION_TEXTURE2D;
-		depthStencilViewDesc.Texture2D.MipSlice = 0;
-
-		result = m_pDevice->CreateTexture2D(&depthStencilDesc, nullptr, &m_pDepthStencilBuffer);
-		if (FAILED(result))
-		{
-			return result;
+		if (m_Occluders.empty())
+		{
+			return;
 		}
 
-		result = m_pDevice->CreateDepthStencilView(m_pDepthStencilBuffer, &depthStencilViewDesc, &m_pDepthStencilView);
-		if (FAILED(result))
+		for (const auto& [occluder, mesh] : m_Occluders)
 		{
-			return result;
+			m_OcclusionCuller.SetOccluderWorld(occluder, m_pMeshes[mesh]->GetWorldMatrix());
 		}
+		m_OcclusionCuller.Render(m_pCamera->viewMatrix * m_pCamera->projectionMatrix);
 
-		///4. Create RenderTarget (RT) and RenderTargetView (RTV)
-		result = m_pSwapChain->GetBuffer(0, __uuidof(ID3D11Texture2D), reinterpret_cast<void**>(&m_pRenderTargetBuffer));
-		if (FAILED(result))
+		//Occluders are tested too, another one can hide them
+		for (size_t i{}; i < m_pMeshes.size(); ++i)
 		{
-			return result;
+			if (!m_MeshVisible[i])
+			{
+				continue;
+			}
+			const Mesh* pMesh{ m_pMeshes[i] };
+			m_MeshVisible[i] = m_OcclusionCuller.IsVisible(pMesh->GetBoundsMinimum(), pMesh->GetBoundsMaximum(), pMesh->GetWorldMatrix());
 		}
+	}
 
-		//View
-		result = m_pDevice->CreateRenderTargetView(m_pRenderTargetBuffer, nullptr, &m_pRenderTargetView);
-		if (FAILED(result))
+	void Renderer::Render() const
+	{
+		if (m_UseSoftwareRenderer && m_pSoftwareRenderer)
 		{
-			return result;
+			m_pSoftwareRenderer->Render(*m_pCamera);
+			m_pDevice->UpdateTexture(m_SoftwareFrame, 0, m_pSoftwareRenderer->GetPixels());
+			m_pDevice->CopyToBackBuffer(m_SoftwareFrame);
+			m_pDevice->Present();
+			return;
 		}
 
-		///5. Bind RTV and DSV to Output Merger Stage
-		m_pDeviceContext->OMSetRenderTargets(1, &m_pRenderTargetView, m_pDepthStencilView);
+		//Clear window for next frame
+		m_pDevice->Clear(GetClearColor());
+
+		//Set pipeline + invoke drawcalls (= render), in the order the queue was sorted in
+		m_RenderQueue.Execute([this](const RenderQueue::Packet& packet)
+			{
+				if (static_cast<DrawKind>(packet.data) == DrawKind::Instances)
+				{
+					m_pInstancedMesh->RenderInstanced(*m_pDevice, m_VehicleInstances);
+				}
+				else
+				{
+					m_pMeshes[packet.object]->Render(*m_pDevice);
+				}
+			});
+
+
+		//Present to screen
+		m_pDevice->Present();
+	}
 
-		///6. Set viewport
-		D3D11_VIEWPORT viewport{};
-		viewport.Width = static_cast<FLOAT>(m_Width);
-		viewport.Height = static_cast<FLOAT>(m_Height);
-		viewport.TopLeftX = 0;
-		viewport.TopLeftY = 0;
-		viewport.MinDepth = 0;
-		viewport.MaxDepth = 1;
-		m_pDeviceContext->RSSetViewports(1, &viewport);
+	ColorRGB Renderer::GetClearColor() const
+	{
+		//The colors are picked in sRGB but the view expects linear
+		ColorRGB clearColor{ 0.39f, 0.59f, 0.93f };
+		if (m_ClearColor)
+		{
+			clearColor = {0.1f,0.1f,0.1f};
+		}
+		return { ColorConversion::SrgbToLinear(clearColor.r), ColorConversion::SrgbToLinear(clearColor.g), ColorConversion::SrgbToLinear(clearColor.b) };
+	}
 
-		return S_OK;
+	void Renderer::ToggleSoftwareRenderer()
+	{
+		m_UseSoftwareRenderer = !m_UseSoftwareRenderer;
+		std::cout << (m_UseSoftwareRenderer ? "SOFTWARE\n" : "HARDWARE\n");
+		if (m_UseSoftwareRenderer && !m_pSoftwareRenderer)
+		{
+			CreateSoftwareRenderer();
+		}
 	}
 
 	void Renderer::CycleSampleStates()
 	{
 		m_SampleState = static_cast<SampleState>((static_cast<int>(m_SampleState) + 1) % 3);
 
+		SamplerDesc samplerDesc{};
 		switch (m_SampleState)
 		{
 		case dae::Point:
 			std::cout << "POINT\n";
-			m_SamplerDesc.Filter = D3D11_FILTER_MIN_MAG_MIP_POINT;
+			samplerDesc.filter = SamplerFilter::Point;
 			break;
 		case dae::Linear:
 			std::cout << "LINEAR\n";
-			m_SamplerDesc.Filter = D3D11_FILTER_MIN_MAG_MIP_LINEAR;
+			samplerDesc.filter = SamplerFilter::Linear;
 			break;
 		case dae::Anisotropic:
 			std::cout << "ANISOTROPIC\n";
-			m_SamplerDesc.Filter = D3D11_FILTER_ANISOTROPIC;
+			samplerDesc.filter = SamplerFilter::Anisotropic;
 			break;
 		}
 
-		if (m_pSamplerState) m_pSamplerState->Release();
+		if (m_Sampler.IsValid()) m_pDevice->ReleaseSampler(m_Sampler);
 
-		const HRESULT result{ m_pDevice->CreateSamplerState(&m_SamplerDesc, &m_pSamplerState) };
+		m_Sampler = m_pDevice->CreateSampler(samplerDesc);
 
-		if (FAILED(result)) return;
+		if (!m_Sampler.IsValid()) return;
 
-		m_pEffectSamplerVariable->SetSampler(0, m_pSamplerState);
+		m_pMeshes[0]->SetSampler(m_Sampler);
+		if (m_pInstancedMesh)
+		{
+			//Its permutation is a separate program
+			m_pInstancedMesh->SetSampler(m_Sampler);
+		}
 	}
 	void Renderer::CycleCullModes()
 	{
 		m_CullMode = static_cast<CullMode>((static_cast<int>(m_CullMode) + 1) % 3);
 
-		D3D11_RASTERIZER_DESC rasterizerDesc{};
-		rasterizerDesc.FillMode = D3D11_FILL_SOLID;
-		rasterizerDesc.FrontCounterClockwise = false;
-		rasterizerDesc.DepthBias = 0;
-		rasterizerDesc.SlopeScaledDepthBias = 0.0f;
-		rasterizerDesc.DepthBiasClamp = 0.0f;
-		rasterizerDesc.DepthClipEnable = true;
-		rasterizerDesc.ScissorEnable = false;
-		rasterizerDesc.MultisampleEnable = false;
-		rasterizerDesc.AntialiasedLineEnable = false;
-
+		RasterizerDesc rasterizerDesc{};
 		switch (m_CullMode)
 		{
 		case Back:
-			rasterizerDesc.CullMode = D3D11_CULL_BACK;
+			rasterizerDesc.culling = FaceCulling::Back;
 			std::cout << "Set to back cull mode\n";
 			break;
 		case Front:
-			rasterizerDesc.CullMode = D3D11_CULL_FRONT;
+			rasterizerDesc.culling = FaceCulling::Front;
 			std::cout << "Set to front cull mode\n";
 			break;
 		case None:
-			rasterizerDesc.CullMode = D3D11_CULL_NONE;
+			rasterizerDesc.culling = FaceCulling::None;
 			std::cout << "Set to none cull mode\n";
 			break;
 		}
 
-		if (m_pRasterizerState)
+		if (m_Rasterizer.IsValid())
 		{
-			m_pRasterizerState->Release();
+			m_pDevice->ReleaseRasterizer(m_Rasterizer);
 		}
 
-		const HRESULT hr{ m_pDevice->CreateRasterizerState(&rasterizerDesc, &m_pRasterizerState) };
-		if (FAILED(hr)) std::wcout << L"m_pRasterizerState failed to create\n";
+		m_Rasterizer = m_pDevice->CreateRasterizer(rasterizerDesc);
+		if (!m_Rasterizer.IsValid()) std::wcout << L"m_Rasterizer failed to create\n";
 
 		//for (const auto pMesh : m_pMeshes)
 		//{
 		//	pMesh->GetRasterizer()->SetRasterizerState(0, m_pRasterizerState);
 		//}
-		m_pMeshes[0]->GetRasterizer()->SetRasterizerState(0, m_pRasterizerState);
+		m_pMeshes[0]->SetRasterizer(m_Rasterizer);
 	}
 
 	void Renderer::CreateMesh()
 	{
-		std::vector<Vertex> vertices{};
-		std::vector<uint32_t> indices{};
-
-		//Load main mesh
-		Utils::ParseOBJ("Resources/vehicle.obj", vertices, indices);
-
-		MeshDataPaths paths;
-		paths.effect = L"Resources/PosCol3D.fx";
-		paths.diffuse = "Resources/vehicle_diffuse.png";
-		paths.normal = "Resources/vehicle_normal.png";
-		paths.specular = "Resources/vehicle_specular.png";
-		paths.gloss = "Resources/vehicle_gloss.png";
-
-		m_pMeshes.push_back(new Mesh{ m_pDevice, vertices, indices, paths});
-		vertices.clear();
-		indices.clear();
-		paths.Clear();
-
-		//Load fire mesh
-		paths.effect = L"Resources/PosTrans3D.fx";
-		paths.diffuse = "Resources/fireFX_diffuse.png";
-		Utils::ParseOBJ("Resources/fireFX.obj", vertices, indices);
-		m_pMeshes.push_back(new Mesh{ m_pDevice, vertices, indices, paths });
+		const auto start{ std::chrono::steady_clock::now() };
+
+		std::vector<MeshDataPaths>& meshPaths{ m_MeshPaths };
+		meshPaths.resize(2);
+
+		//Main mesh
+		meshPaths[0].mesh = "Resources/vehicle.obj";
+		meshPaths[0].effect = L"Resources/PosCol3D.fx";
+		meshPaths[0].diffuse = "Resources/vehicle_diffuse.png";
+		meshPaths[0].normal = "Resources/vehicle_normal.png";
+		meshPaths[0].specular = "Resources/vehicle_specular.png";
+		meshPaths[0].gloss = "Resources/vehicle_gloss.png";
+
+		//Fire mesh
+		meshPaths[1].mesh = "Resources/fireFX.obj";
+		meshPaths[1].effect = L"Resources/PosTrans3D.fx";
+		meshPaths[1].translucent = true;
+		meshPaths[1].diffuse = "Resources/fireFX_diffuse.png";
+
+		//Decode stage: all meshes (and within them all maps) load concurrently
+		constexpr bool packMaterials{ true };
+		constexpr bool encodeNormals{ true };
+		constexpr bool buildMeshlets{ true };
+		constexpr bool buildLods{ true };
+		constexpr bool streamTextures{ true };
+		constexpr bool packTextureArrays{ false }; //needs every map decoded, so it replaces streaming
+		TextureStreamer* pStreamer{ streamTextures && !packTextureArrays ? &m_TextureStreamer : nullptr };
+		std::vector<MeshData> meshData(meshPaths.size());
+		JobSystem::Counter loading{};
+		for (size_t i{}; i < meshPaths.size(); ++i)
+		{
+			m_Jobs.Run([&, i]
+				{
+					meshData[i] = MeshData::Load(meshPaths[i], &m_TextureCache, pStreamer, packMaterials, encodeNormals, buildMeshlets, buildLods,
+						&m_Jobs);
+				}, &loading);
+		}
+		m_Jobs.Wait(loading);
+		const auto decoded{ std::chrono::steady_clock::now() };
+
+		//Upload stage: device resources are created on the render thread
+		constexpr bool occlusionCulling{ true };
+		const std::vector<MeshArrayMaps> arrayMaps{ packTextureArrays ? PackTextureArrays(meshData) : std::vector<MeshArrayMaps>{} };
+		float serialTime{};
+		std::unordered_map<std::wstring, uint32_t> effectIds{};
+		std::unordered_map<std::string, uint32_t> textureSetIds{};
+		const auto getDrawState = [&](const MeshData& data, bool instanced)
+		{
+			//Instancing compiles its own permutation of the effect
+			const std::wstring effect{ instanced ? data.effect + L"|instanced" : data.effect };
+			const std::string textureSet{ data.diffuse.path + "|" + data.normal.path + "|" + data.specular.path + "|" + data.gloss.path + "|"
+				+ data.material.texture.path };
+			DrawState state{};
+			state.effect = effectIds.emplace(effect, static_cast<uint32_t>(effectIds.size())).first->second;
+			state.textureSet = textureSetIds.emplace(textureSet, static_cast<uint32_t>(textureSetIds.size())).first->second;
+			state.translucent = data.translucent;
+			return state;
+		};
+		for (size_t i{}; i < meshData.size(); ++i)
+		{
+			const MeshData& data{ meshData[i] };
+			m_pMeshes.push_back(new Mesh{ *m_pDevice, data, m_TextureCache, pStreamer, arrayMaps.empty() ? nullptr : &arrayMaps[i] });
+			m_FrustumCuller.AddObject(m_pMeshes.back()->GetBoundsMinimum(), m_pMeshes.back()->GetBoundsMaximum());
+			m_MeshStates.push_back(getDrawState(data, false));
+			//Only opaque meshes hide what is behind them
+			if (occlusionCulling && !m_MeshStates.back().translucent)
+			{
+				m_Occluders.emplace_back(m_OcclusionCuller.AddOccluder(data.vertices, data.indices), i);
+			}
+			serialTime += data.GetSerialLoadTime();
+
+			if (!data.lods.empty())
+			{
+				std::cout << "LOD chain of " << meshPaths[i].mesh << ": " << data.lods.size() << " levels, "
+					<< (data.lodsCooked ? "read from the cook in " : "simplified in ") << data.lodTime * 1000.f << "ms\n";
+			}
+
+			if (data.material.texture.IsValid())
+			{
+				const PackedMaterial& material{ data.material };
+				std::cout << "Packed " << material.sourceCount << " maps into " << material.texture.path << ": "
+					<< material.sourceBytes / 1024 << "KB -> " << material.texture.pixels.size() / 1024 << "KB, "
+					<< material.sourceCount << " fetches -> 1\n";
+			}
+			if (data.normalError.texels > 0)
+			{
+				const NormalErrorStats& error{ data.normalError };
+				std::cout << "Encoded " << data.normal.path << ": " << error.texels * 4 / 1024 << "KB -> " << data.normal.pixels.size() / 1024
+					<< "KB, angular error mean " << error.meanDegrees << " rms " << error.rmsDegrees << " max " << error.maxDegrees
+					<< " degrees, " << error.belowHorizon << " texels below the horizon\n";
+			}
+		}
+
+		//Instanced copies of the vehicle, 32 x 32 below the scene with a different heading each
+		constexpr int instanceGrid{ 32 };
+		constexpr float instanceSpacing{ 50.f };
+		m_pInstancedMesh = new Mesh{ *m_pDevice, meshData[0], m_TextureCache, pStreamer, arrayMaps.empty() ? nullptr : &arrayMaps[0], true };
+		m_InstancedState = getDrawState(meshData[0], true);
+		m_VehicleInstances.Initialize(m_pInstancedMesh->GetBoundsMinimum(), m_pInstancedMesh->GetBoundsMaximum(), m_pInstancedMesh->GetLodErrors());
+		for (int z{}; z < instanceGrid; ++z)
+		{
+			for (int x{}; x < instanceGrid; ++x)
+			{
+				//Half a cell off, so no copy sits on the original
+				const Vector3 position{ (x - instanceGrid / 2 + 0.5f) * instanceSpacing, -20.f, (z - instanceGrid / 2 + 0.5f) * instanceSpacing };
+				const float yaw{ static_cast<float>((x * 7 + z * 13) % 36) * 10.f * TO_RADIANS };
+				m_VehicleInstances.Add(Matrix::CreateRotationY(yaw) * Matrix::CreateTranslation(position));
+			}
+		}
+
+		//Never below the scene at full detail, the baseline drew every map at full resolution. Streaming still
+		//starts from the tails and drops the levels of what is small or off screen
+		m_TextureStreamer.SetBudget(std::max(minimumStreamingBudget, m_TextureStreamer.GetFullChainBytes()));
+		m_TextureCache.Trim();
+		const auto uploaded{ std::chrono::steady_clock::now() };
+
+		const float loadMs{ std::chrono::duration<float, std::milli>(decoded - start).count() };
+		const float uploadMs{ std::chrono::duration<float, std::milli>(uploaded - decoded).count() };
+		std::cout << "CreateMesh: " << loadMs + uploadMs << "ms (load " << loadMs << "ms, upload " << uploadMs
+			<< "ms), serial load would take ~" << serialTime * 1000.f << "ms\n";
+
+		const TextureCache::Stats cacheStats{ m_TextureCache.GetStats() };
+		std::cout << "TextureCache: " << cacheStats.entries << " entries, " << cacheStats.residentBytes / 1024 << "KB/"
+			<< cacheStats.budgetBytes / 1024 << "KB, hits " << cacheStats.hits << " (content " << cacheStats.contentHits
+			<< ", collisions " << cacheStats.hashCollisions << "), misses " << cacheStats.misses << ", decodes skipped " << cacheStats.decodesSkipped
+			<< ", evictions " << cacheStats.evictions << "\n";
+		std::cout << "TextureStreamer: budget " << m_TextureStreamer.GetFullChainBytes() / 1024 << "KB for the full chains, at least "
+			<< minimumStreamingBudget / 1024 << "KB\n";
+	}
+
+	void Renderer::CreateSoftwareRenderer()
+	{
+		const auto start{ std::chrono::steady_clock::now() };
+
+		//The meshes' maps went to the cache and the streamer without their pixels, loading without either keeps them decoded.
+		//Meshlets are built for the weld alone, so both renderers shade with the same averaged tangents
+		std::vector<MeshData> meshData(m_MeshPaths.size());
+		JobSystem::Counter loading{};
+		for (size_t i{}; i < m_MeshPaths.size(); ++i)
+		{
+			m_Jobs.Run([&, i]
+				{
+					meshData[i] = MeshData::Load(m_MeshPaths[i], nullptr, nullptr, true, true, true, false, &m_Jobs);
+				}, &loading);
+		}
+		m_Jobs.Wait(loading);
+
+		//RGBA8 and sRGB encoded like the software renderer's frame, filled every frame
+		TextureDesc frameDesc{};
+		frameDesc.width = m_Width;
+		frameDesc.height = m_Height;
+		frameDesc.format = TexelFormat::RGBA8;
+		frameDesc.colorSpace = ColorSpace::sRGB;
+		m_SoftwareFrame = m_pDevice->CreateTexture(frameDesc, {});
+		if (!m_SoftwareFrame.IsValid())
+		{
+			std::cout << "Software renderer: no frame texture on the device\n";
+			m_UseSoftwareRenderer = false;
+			return;
+		}
+
+		//Added in the order of m_pMeshes, the opaque vehicle before the fire
+		m_pSoftwareRenderer = std::make_unique<SoftwareRenderer>(m_Width, m_Height, 0, &m_Jobs);
+		for (const MeshData& data : meshData)
+		{
+			m_pSoftwareRenderer->AddMesh(data);
+		}
+
+		const float loadMs{ std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count() };
+		std::cout << "Software renderer: " << m_pSoftwareRenderer->GetThreadCount() << " threads, loaded in " << loadMs << "ms\n";
+	}
+
+	std::vector<MeshArrayMaps> Renderer::PackTextureArrays(const std::vector<MeshData>& meshData) const
+	{
+		std::vector<MeshArrayMaps> arrayMaps(meshData.size());
+
+		//Every distinct map once, with the array maps of all meshes that use it
+		struct Group
+		{
+			std::vector<const TextureData*> maps{};
+			std::vector<std::vector<ArrayMap*>> users{};
+			std::unordered_map<std::string, size_t> lookup{};
+		};
+		std::map<std::pair<TexelFormat, ColorSpace>, Group> groups{};
+
+		for (size_t i{}; i < meshData.size(); ++i)
+		{
+			const MeshData& data{ meshData[i] };
+			MeshArrayMaps& maps{ arrayMaps[i] };
+			const std::pair<const TextureData*, ArrayMap*> sources[]
+			{
+				{ &data.diffuse, &maps.diffuse },
+				{ &data.normal, &maps.normal },
+				{ &data.specular, &maps.specular },
+				{ &data.gloss, &maps.gloss },
+				{ &data.material.texture, &maps.material }
+			};
+			for (const auto& [pTexture, pArrayMap] : sources)
+			{
+				if (!pTexture->IsValid())
+				{
+					continue;
+				}
+
+				Group& group{ groups[{ pTexture->format, pTexture->colorSpace }] };
+				const auto [lookup, inserted] { group.lookup.emplace(pTexture->path, group.maps.size()) };
+				if (inserted)
+				{
+					group.maps.push_back(pTexture);
+					group.users.emplace_back();
+				}
+				group.users[lookup->second].push_back(pArrayMap);
+			}
+		}
+
+		for (const auto& [key, group] : groups)
+		{
+			const TexturePack pack{ TexturePacker::Pack(group.maps) };
+			if (!pack.IsValid())
+			{
+				continue;
+			}
+
+			const TextureData& first{ pack.slices.front() };
+			std::vector<const void*> slices{};
+			for (const TextureData& slice : pack.slices)
+			{
+				if (slice.width != first.width || slice.height != first.height || slice.pixels.size() != first.pixels.size())
+				{
+					std::cout << "PackTextureArrays: array slice " << slice.path << " does not match " << first.path << "\n";
+					break;
+				}
+				slices.push_back(slice.pixels.data());
+			}
+			if (slices.size() != pack.slices.size())
+			{
+				continue;
+			}
+
+			TextureDesc desc{};
+			desc.width = first.width;
+			desc.height = first.height;
+			desc.arraySize = static_cast<int>(slices.size());
+			desc.format = first.format;
+			desc.colorSpace = first.colorSpace;
+			const TextureHandle array{ m_pDevice->CreateTexture(desc, slices) };
+			if (!array.IsValid())
+			{
+				continue;
+			}
+			const SharedTexture pArray{ m_pDevice->Share(array) };
+			for (size_t i{}; i < group.maps.size(); ++i)
+			{
+				for (ArrayMap* pArrayMap : group.users[i])
+				{
+					pArrayMap->pArray = pArray;
+					pArrayMap->region = pack.regions[i];
+				}
+			}
+
+			const TexturePackReport& report{ pack.report };
+			std::cout << "Packed " << report.maps << " maps into " << report.slices << " array slices (" << report.sharedSlices << " shared): "
+				<< report.sourceBytes / 1024 << "KB -> " << report.packedBytes / 1024 << "KB, " << report.GetWastePercent() << "% waste (gutters "
+				<< report.gutterBytes / 1024 << "KB, unused " << report.unusedBytes / 1024 << "KB)\n";
+		}
+
+		return arrayMaps;
 	}
 }
@@ -1,12 +1,18 @@
 #pragma once
+#include "Mesh.h"
 #include "Utils.h"
 #include "Camera.h"
-
-struct SDL_Window;
-struct SDL_Surface;
+#include "OcclusionCuller.h"
+#include "FrustumCuller.h"
+#include "JobSystem.h"
+#include "Instancing.h"
+#include "RenderQueue.h"
+#include "RenderDevice.h"
 
 namespace dae
 {
+	class SoftwareRenderer;
+
 	enum SampleState
 	{
 		Point,
@@ -24,7 +30,8 @@ namespace dae
 	class Renderer final
 	{
 	public:
-		Renderer(SDL_Window* pWindow, Camera* pCamera);
+		//The device outlives the renderer, the frame is its size
+		Renderer(RenderDevice& device, Camera* pCamera);
 		~Renderer();
 
 		void ToggleRotation() { m_Rotate = !m_Rotate; }
@@ -32,7 +39,10 @@ namespace dae
 		void ToggleClearCollor() { m_ClearColor = !m_ClearColor; }
 
 		void ToggleFireMesh() { m_ShowFireMesh = !m_ShowFireMesh; }
+		void ToggleInstances() { m_ShowInstances = !m_ShowInstances; }
 		void CycleSampleStates();
+		//Draws the meshes on the CPU and copies the frame to the device's back buffer, or back to drawing on the device
+		void ToggleSoftwareRenderer();
 
 		Renderer(const Renderer&) = delete;
 		Renderer(Renderer&&) noexcept = delete;
@@ -42,31 +52,23 @@ namespace dae
 		void Update(const Timer* pTimer);
 		void Render() const;
 
+		TextureCache::Stats GetTextureCacheStats() const { return m_TextureCache.GetStats(); }
+		const TextureStreamer::Stats& GetTextureStreamerStats() const { return m_TextureStreamer.GetStats(); }
+		const OcclusionCuller::Stats& GetOcclusionStats() const { return m_OcclusionCuller.GetStats(); }
+		const FrustumCuller::Stats& GetFrustumStats() const { return m_FrustumCuller.GetStats(); }
+		//Summed over the meshes drawn this frame
+		const Meshlets::CullStats& GetMeshletStats() const { return m_MeshletStats; }
+		const InstanceSet::Stats& GetInstanceStats() const { return m_VehicleInstances.GetStats(); }
+		const RenderQueue::Stats& GetRenderQueueStats() const { return m_RenderQueue.GetStats(); }
+
 	private:
-		SDL_Window* m_pWindow{};
+		RenderDevice* m_pDevice{};
 
 		int m_Width{};
 		int m_Height{};
 
-		bool m_IsInitialized{ false };
-
-		//DIRECTX
-		HRESULT InitializeDirectX();
-		ID3D11Device* m_pDevice{ nullptr };
-		ID3D11DeviceContext* m_pDeviceContext{ nullptr };
-		IDXGISwapChain* m_pSwapChain{ nullptr };
-		ID3D11Texture2D* m_pDepthStencilBuffer{ nullptr };
-		ID3D11DepthStencilView* m_pDepthStencilView{ nullptr };
-		ID3D11Resource* m_pRenderTargetBuffer{ nullptr };
-		ID3D11RenderTargetView* m_pRenderTargetView{ nullptr };
-
-		ID3DX11EffectSamplerVariable* m_pEffectSamplerVariable{};
-		ID3D11SamplerState* m_pSamplerState{};
-		ID3D11RasterizerState* m_pRasterizerState{};
-		D3D11_SAMPLER_DESC m_SamplerDesc{};
-
-		//GPU SLOT
-		const UINT m_GpuIndex{ 0 }; //0 default
+		SamplerHandle m_Sampler{};
+		RasterizerHandle m_Rasterizer{};
 
 		//Render settings
 		bool m_Rotate{ true };
@@ -75,11 +77,65 @@ namespace dae
 
 		//DirectX only
 		bool m_ShowFireMesh{ true };
+		bool m_ShowInstances{ false };
 		SampleState m_SampleState{ Point };
 
+		//Loading and per-mesh frame work, the render thread is its worker 0
+		JobSystem m_Jobs{};
+
+		std::vector<MeshDataPaths> m_MeshPaths{};
 		std::vector<Mesh*> m_pMeshes{};
 		Camera* m_pCamera{};
 
+		TextureCache m_TextureCache{ 256 * 1024 * 1024 };
+		//Raised in CreateMesh to what the streamed maps take with their full chains
+		static constexpr size_t minimumStreamingBudget{ 8 * 1024 * 1024 };
+		TextureStreamer m_TextureStreamer{ minimumStreamingBudget };
+
+		//One object per mesh, in the same order. Meshes outside the view are not occlusion tested or drawn
+		FrustumCuller m_FrustumCuller{};
+		//Occluder meshes are drawn into it every frame, meshes it hides are not drawn. Runs on m_Jobs' workers
+		OcclusionCuller m_OcclusionCuller{ OcclusionCuller::defaultWidth, OcclusionCuller::defaultHeight, 0, &m_Jobs };
+		std::vector<std::pair<size_t, size_t>> m_Occluders{}; //occluder index, mesh index
+		std::vector<bool> m_MeshVisible{};
+		Meshlets::CullStats m_MeshletStats{};
+
+		//A grid of vehicle copies around the scene, drawn with one instanced draw per level of detail.
+		//Culled against the frustum only, they neither occlude nor get occlusion tested
+		Mesh* m_pInstancedMesh{};
+		InstanceSet m_VehicleInstances{};
+
+		//What a packet in the render queue draws, in its data
+		enum class DrawKind : uint32_t
+		{
+			Mesh, //object is the index in m_pMeshes
+			Instances //m_pInstancedMesh with m_VehicleInstances
+		};
+		//Key fields of a mesh, ids of its effect and of its set of maps, in the order they were first seen
+		struct DrawState
+		{
+			uint32_t effect{};
+			uint32_t textureSet{};
+			bool translucent{};
+		};
+		std::vector<DrawState> m_MeshStates{};
+		DrawState m_InstancedState{};
+		//Filled in Update, drawn in order in Render
+		RenderQueue m_RenderQueue{};
+
+		//Created the first time it is selected, with its own decoded maps. Draws the meshes with the same
+		//world matrices, culling and states, but not the instanced copies. Its frame goes to the device through m_SoftwareFrame
+		std::unique_ptr<SoftwareRenderer> m_pSoftwareRenderer{};
+		TextureHandle m_SoftwareFrame{};
+		bool m_UseSoftwareRenderer{};
+
 		void CreateMesh();
+		void CreateSoftwareRenderer();
+		ColorRGB GetClearColor() const;
+		void FillRenderQueue();
+		//Only tests the meshes the frustum kept
+		void CullOccludedMeshes();
+		//Maps of every mesh that share format and color space go into one Texture2DArray
+		std::vector<MeshArrayMaps> PackTextureArrays(const std::vector<MeshData>& meshData) const;
 	};
 }
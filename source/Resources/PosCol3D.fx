@@ -1,7 +1,25 @@
-Texture2D gDiffuseMap : DiffuseMap;
-Texture2D gNormalMap : NormalMap;
-Texture2D gSpecularMap : SpecularMap;
-Texture2D gGlossinessMap : GlossinessMap;
+#ifdef TEXTURE_ARRAYS
+//Maps are slices of Texture2DArrays shared between meshes, every map has a slice and a
+//region (xy scale, zw offset) that places its uv inside the slice (see TexturePacker)
+#define MAP(name) Texture2DArray name##Map; float4 name##Region = float4(1.f, 1.f, 0.f, 0.f); float name##Slice = 0.f
+#else
+#define MAP(name) Texture2D name##Map
+#endif
+
+//The diffuse map is bound through an _SRGB view and the render target is _SRGB as well,
+//so every sample and all the lighting below is in linear space
+MAP(gDiffuse);
+//RGBA8 by default, with TWO_CHANNEL_NORMALS only x and y are stored (see NormalCook)
+MAP(gNormal);
+#ifdef PACKED_MATERIAL
+//Scalar maps cooked into one texture, the masks select the channel (see MaterialPacking)
+MAP(gMaterial);
+float4 gGlossMask = float4(1.f, 0.f, 0.f, 0.f);
+float4 gSpecularMask = float4(0.f, 1.f, 0.f, 0.f);
+#else
+MAP(gSpecular);
+MAP(gGlossiness);
+#endif
 
 
 float4x4 gWorldViewProj : WorldViewPorjection;
@@ -43,6 +61,17 @@ RasterizerState gRasterizerState
 	FrontCounterClockwise = false; //default
 };
 
+#ifdef TEXTURE_ARRAYS
+//frac keeps wrap addressing inside the region, gradients of the unwrapped uv keep the frac seam out of the mip selection
+float4 SampleRegion(Texture2DArray map, float4 region, float slice, float2 uv)
+{
+	return map.SampleGrad(gSampler, float3(frac(uv) * region.xy + region.zw, slice), ddx(uv) * region.xy, ddy(uv) * region.xy);
+}
+#define SAMPLE_MAP(name, uv) SampleRegion(name##Map, name##Region, name##Slice, uv)
+#else
+#define SAMPLE_MAP(name, uv) name##Map.Sample(gSampler, uv)
+#endif
+
 //-------------------------
 //	Input/Output Structs
 //-------------------------
@@ -52,6 +81,13 @@ struct VS_INPUT
 	float3 Normal : NORMAL;
 	float3 Tangent : TANGENT;
 	float2 UV : TEXCOORD;
+#ifdef INSTANCED
+	//Rows of the instance's world matrix, from the second vertex buffer
+	float4 World0 : WORLD0;
+	float4 World1 : WORLD1;
+	float4 World2 : WORLD2;
+	float4 World3 : WORLD3;
+#endif
 };
 
 struct VS_OUTPUT
@@ -69,10 +105,18 @@ struct VS_OUTPUT
 VS_OUTPUT VS(VS_INPUT input)
 {
 	VS_OUTPUT output;
+#ifdef INSTANCED
+	//gWorldViewProj is the view projection alone, the world matrix is the instance's
+	const float4x4 world = float4x4(input.World0, input.World1, input.World2, input.World3);
+	output.WorldPosition = mul(float4(input.Position, 1.f), world);
+	output.Position = mul(output.WorldPosition, gWorldViewProj);
+#else
+	const float4x4 world = gWorldMatrix;
 	output.Position = mul(float4(input.Position, 1.f), gWorldViewProj);
-	output.WorldPosition = mul(float4(input.Position, 1.f), gWorldMatrix);
-	output.Tangent = mul(normalize(input.Tangent), (float3x3)gWorldMatrix);
-	output.Normal = mul(normalize(input.Normal), (float3x3)gWorldMatrix);
+	output.WorldPosition = mul(float4(input.Position, 1.f), world);
+#endif
+	output.Tangent = mul(normalize(input.Tangent), (float3x3)world);
+	output.Normal = mul(normalize(input.Normal), (float3x3)world);
 	output.UV = input.UV;
 	return output;
 }
@@ -87,27 +131,41 @@ float4 PS(VS_OUTPUT input) : SV_TARGET
 	float3 sampledNormal = input.Normal;
 	const float3 binormal = cross(sampledNormal, input.Tangent);
 	const float3x3 tangentSpaceAxis = { input.Tangent, normalize(binormal), sampledNormal };
-	const float4 colorNormal = gNormalMap.Sample(gSampler, input.UV);
+#ifdef TWO_CHANNEL_NORMALS
+	//z is rebuilt on the upper hemisphere, filtered x and y past the unit circle end up on the horizon
+	const float2 normalXY = SAMPLE_MAP(gNormal, input.UV).rg * 2.f - 1.f;
+	sampledNormal = normalize(float3(normalXY, sqrt(saturate(1.f - dot(normalXY, normalXY)))));
+#else
+	const float4 colorNormal = SAMPLE_MAP(gNormal, input.UV);
 	sampledNormal = colorNormal.rgb;
 	sampledNormal = (2 * sampledNormal) - float3(1.f, 1.f, 1.f);
+#endif
 	sampledNormal = mul(sampledNormal, tangentSpaceAxis);
 
 	//Observed area color
 	const float observedArea = saturate(dot(sampledNormal, -gLightDirection));
 
 	//Diffuse color
-	float4 diffuseColor = gDiffuseMap.Sample(gSampler, input.UV);
+	float4 diffuseColor = SAMPLE_MAP(gDiffuse, input.UV);
 	diffuseColor = (diffuseColor * gKD / PI) * gLightIntensity;
 
 	//Specular color
 	const float3 reflectVector = reflect(gLightDirection, sampledNormal);
 	const float reflectAngle = saturate(dot(reflectVector, -viewDirection));
 
-	const float4 glossColor = gGlossinessMap.Sample(gSampler, input.UV);
+#ifdef PACKED_MATERIAL
+	const float4 material = SAMPLE_MAP(gMaterial, input.UV);
+	const float exponent = dot(material, gGlossMask) * gShininess;
+
+	const float phongValue = pow(reflectAngle, exponent);
+	const float4 specularColor = dot(material, gSpecularMask) * phongValue;
+#else
+	const float4 glossColor = SAMPLE_MAP(gGlossiness, input.UV);
 	const float exponent = glossColor.r * gShininess;
 
 	const float phongValue = pow(reflectAngle, exponent);
-	const float4 specularColor = gSpecularMap.Sample(gSampler, input.UV) * phongValue;
+	const float4 specularColor = SAMPLE_MAP(gSpecular, input.UV) * phongValue;
+#endif
 
 	//Add each calculation to each other and convert to float4
 	return float4((diffuseColor.rgb * observedArea) + specularColor.rgb + gAmbientColor, 1.f);
@@ -1,4 +1,12 @@
+#ifdef TEXTURE_ARRAYS
+//The diffuse map is a slice of a Texture2DArray shared between meshes, the region
+//(xy scale, zw offset) places its uv inside the slice (see TexturePacker)
+Texture2DArray gDiffuseMap : DiffuseMap;
+float4 gDiffuseRegion = float4(1.f, 1.f, 0.f, 0.f);
+float gDiffuseSlice = 0.f;
+#else
 Texture2D gDiffuseMap : DiffuseMap;
+#endif
 float4x4 gWorldViewProj : WorldViewPorjection;
 
 SamplerState gSampler : Sampler
@@ -61,6 +69,13 @@ struct VS_INPUT
 	float3 Normal : NORMAL;
 	float3 Tangent : TANGENT;
 	float2 UV : TEXCOORD;
+#ifdef INSTANCED
+	//Rows of the instance's world matrix, from the second vertex buffer
+	float4 World0 : WORLD0;
+	float4 World1 : WORLD1;
+	float4 World2 : WORLD2;
+	float4 World3 : WORLD3;
+#endif
 };
 
 struct VS_OUTPUT
@@ -78,7 +93,13 @@ struct VS_OUTPUT
 VS_OUTPUT VS(VS_INPUT input)
 {
 	VS_OUTPUT output;
+#ifdef INSTANCED
+	//gWorldViewProj is the view projection alone, the world matrix is the instance's
+	const float4x4 world = float4x4(input.World0, input.World1, input.World2, input.World3);
+	output.Position = mul(mul(float4(input.Position, 1.0f), world), gWorldViewProj);
+#else
 	output.Position = mul(float4(input.Position, 1.0f), gWorldViewProj);
+#endif
 	output.UV = input.UV;
 	return output;
 }
@@ -88,7 +109,13 @@ VS_OUTPUT VS(VS_INPUT input)
 //-------------------------
 float4 PS(VS_OUTPUT input) : SV_TARGET
 {
+#ifdef TEXTURE_ARRAYS
+	//frac keeps wrap addressing inside the region, gradients of the unwrapped uv keep the frac seam out of the mip selection
+	const float2 uv = frac(input.UV) * gDiffuseRegion.xy + gDiffuseRegion.zw;
+	return gDiffuseMap.SampleGrad(gSampler, float3(uv, gDiffuseSlice), ddx(input.UV) * gDiffuseRegion.xy, ddy(input.UV) * gDiffuseRegion.xy);
+#else
 	return gDiffuseMap.Sample(gSampler, input.UV);
+#endif
 }
 
 //-------------------------
@@ -0,0 +1,536 @@
+#pragma once
+#include <cfloat>
+#include <cstdint>
+#include <cmath>
+#include <vector>
+#include <algorithm>
+#include <type_traits>
+#include <emmintrin.h>
+
+#include "Vector2.h"
+#include "TexelLayout.h"
+#include "ColorSpace.h"
+
+//CPU counterpart of the D3D11 sampler states the Renderer cycles through.
+//Header only so it can be dropped into tools and a software rasterizer without the D3D side.
+namespace dae
+{
+	namespace Sampling
+	{
+		struct ColorRGBA
+		{
+			float r{};
+			float g{};
+			float b{};
+			float a{};
+
+			ColorRGBA operator+(const ColorRGBA& c) const { return { r + c.r, g + c.g, b + c.b, a + c.a }; }
+			ColorRGBA operator*(float s) const { return { r * s, g * s, b * s, a * s }; }
+			ColorRGBA& operator+=(const ColorRGBA& c) { r += c.r; g += c.g; b += c.b; a += c.a; return *this; }
+
+			static ColorRGBA Lerp(const ColorRGBA& c1, const ColorRGBA& c2, float factor)
+			{
+				return c1 + (ColorRGBA{ c2.r - c1.r, c2.g - c1.g, c2.b - c1.b, c2.a - c1.a } * factor);
+			}
+		};
+
+		//D3D11_FILTER_MIN_MAG_MIP_POINT, MIN_MAG_LINEAR_MIP_POINT, MIN_MAG_MIP_LINEAR, ANISOTROPIC
+		enum class Filter
+		{
+			Point,
+			Bilinear,
+			Trilinear,
+			Anisotropic
+		};
+
+		//D3D11_TEXTURE_ADDRESS_MODE
+		enum class AddressMode
+		{
+			Wrap,
+			Mirror,
+			Clamp,
+			Border
+		};
+
+		//The fields of D3D11_SAMPLER_DESC that affect filtering, same defaults as the Renderer uses
+		struct SamplerState
+		{
+			Filter filter{ Filter::Point };
+			AddressMode addressU{ AddressMode::Wrap };
+			AddressMode addressV{ AddressMode::Wrap };
+			ColorRGBA borderColor{};
+			float mipLodBias{};
+			float minLod{};
+			float maxLod{ FLT_MAX };
+			uint32_t maxAnisotropy{ 16 };
+		};
+
+		//RGBA texels, T = uint8_t is UNORM8 and T = float is FLOAT32.
+		//sRGB UNORM8 levels decode to linear on fetch like an _SRGB view does, float levels are always linear
+		template<typename T>
+		struct MipLevel
+		{
+			int width{};
+			int height{};
+			std::vector<T> texels{};
+			TexelLayout layout{ TexelLayout::Linear };
+			ColorSpace colorSpace{ ColorSpace::Linear };
+
+			ColorRGBA Fetch(int x, int y) const
+			{
+				const T* pTexel{ texels.data() + Tiling::GetTexelIndex(layout, x, y, width) * 4 };
+				if constexpr (std::is_same_v<T, uint8_t>)
+				{
+					constexpr float toFloat{ 1.f / 255.f };
+					if (colorSpace == ColorSpace::sRGB)
+					{
+						const float* pTable{ ColorConversion::GetSrgb8ToLinearTable() };
+						return { pTable[pTexel[0]], pTable[pTexel[1]], pTable[pTexel[2]], pTexel[3] * toFloat };
+					}
+					return { pTexel[0] * toFloat, pTexel[1] * toFloat, pTexel[2] * toFloat, pTexel[3] * toFloat };
+				}
+				else
+				{
+					return { pTexel[0], pTexel[1], pTexel[2], pTexel[3] };
+				}
+			}
+		};
+
+		template<typename T>
+		struct MipChain
+		{
+			std::vector<MipLevel<T>> levels{};
+
+			int GetLevelCount() const { return static_cast<int>(levels.size()); }
+
+			//Box filters down to 1x1, odd sizes reuse the last row/column. Input is row-major.
+			//sRGB color is averaged in linear space, averaging the encoded values darkens every level.
+			//Float input in sRGB is decoded up front since float levels are always linear
+			static MipChain Build(const T* pTexels, int width, int height, TexelLayout layout = TexelLayout::Linear,
+				ColorSpace colorSpace = ColorSpace::Linear, int maxLevels = 32)
+			{
+				MipChain chain{};
+				chain.levels.push_back({ width, height, std::vector<T>(pTexels, pTexels + static_cast<size_t>(width) * height * 4) });
+				if constexpr (std::is_same_v<T, float>)
+				{
+					if (colorSpace == ColorSpace::sRGB)
+					{
+						std::vector<float>& texels{ chain.levels.back().texels };
+						ColorConversion::SrgbToLinear(texels.data(), texels.data(), texels.size() / 4);
+						colorSpace = ColorSpace::Linear;
+					}
+				}
+				chain.levels.back().colorSpace = colorSpace;
+				const float* pDecode{ ColorConversion::GetSrgb8ToLinearTable() };
+
+				while ((width > 1 || height > 1) && chain.GetLevelCount() < maxLevels)
+				{
+					const MipLevel<T>& source{ chain.levels.back() };
+					MipLevel<T> level{ std::max(1, width / 2), std::max(1, height / 2) };
+					level.texels.resize(static_cast<size_t>(level.width) * level.height * 4);
+
+					for (int y{}; y < level.height; ++y)
+					{
+						const int y0{ std::min(y * 2, source.height - 1) };
+						const int y1{ std::min(y * 2 + 1, source.height - 1) };
+						for (int x{}; x < level.width; ++x)
+						{
+							const int x0{ std::min(x * 2, source.width - 1) };
+							const int x1{ std::min(x * 2 + 1, source.width - 1) };
+							for (int c{}; c < 4; ++c)
+							{
+								const auto texel = [&](int tx, int ty)
+								{
+									return source.texels[(static_cast<size_t>(ty) * source.width + tx) * 4 + c];
+								};
+								T& result{ level.texels[(static_cast<size_t>(y) * level.width + x) * 4 + c] };
+								if constexpr (std::is_same_v<T, uint8_t>)
+								{
+									if (colorSpace == ColorSpace::sRGB && c < 3)
+									{
+										result = ColorConversion::LinearToSrgb8((pDecode[texel(x0, y0)] + pDecode[texel(x1, y0)]
+											+ pDecode[texel(x0, y1)] + pDecode[texel(x1, y1)]) * 0.25f);
+									}
+									else
+									{
+										const int sum{ texel(x0, y0) + texel(x1, y0) + texel(x0, y1) + texel(x1, y1) };
+										result = static_cast<uint8_t>((sum + 2) / 4);
+									}
+								}
+								else
+								{
+									result = (texel(x0, y0) + texel(x1, y0) + texel(x0, y1) + texel(x1, y1)) * 0.25f;
+								}
+							}
+						}
+					}
+
+					width = level.width;
+					height = level.height;
+					level.colorSpace = colorSpace;
+					chain.levels.push_back(std::move(level));
+				}
+
+				chain.SetLayout(layout);
+				return chain;
+			}
+
+			void SetLayout(TexelLayout layout)
+			{
+				for (MipLevel<T>& level : levels)
+				{
+					if (level.layout == layout)
+					{
+						continue;
+					}
+					if (level.layout != TexelLayout::Linear)
+					{
+						level.texels = Tiling::TiledToLinear(level.texels.data(), level.width, level.height, level.layout);
+					}
+					level.texels = Tiling::LinearToTiled(level.texels.data(), level.width, level.height, layout);
+					level.layout = layout;
+				}
+			}
+		};
+
+		using MipChainRGBA8 = MipChain<uint8_t>;
+		using MipChainFloat = MipChain<float>;
+
+#pragma region Scalar
+		//Maps an integer texel coordinate into [0, size), false means border color
+		inline bool ApplyAddress(int& coord, int size, AddressMode mode)
+		{
+			switch (mode)
+			{
+			case AddressMode::Wrap:
+				coord %= size;
+				if (coord < 0) coord += size;
+				return true;
+			case AddressMode::Mirror:
+			{
+				const int period{ size * 2 };
+				coord %= period;
+				if (coord < 0) coord += period;
+				if (coord >= size) coord = period - 1 - coord;
+				return true;
+			}
+			case AddressMode::Clamp:
+				coord = std::clamp(coord, 0, size - 1);
+				return true;
+			case AddressMode::Border:
+			default:
+				return coord >= 0 && coord < size;
+			}
+		}
+
+		template<typename T>
+		ColorRGBA FetchAddressed(const MipLevel<T>& level, const SamplerState& state, int x, int y)
+		{
+			if (!ApplyAddress(x, level.width, state.addressU) || !ApplyAddress(y, level.height, state.addressV))
+			{
+				return state.borderColor;
+			}
+			return level.Fetch(x, y);
+		}
+
+		template<typename T>
+		ColorRGBA SamplePoint(const MipLevel<T>& level, const SamplerState& state, const Vector2& uv)
+		{
+			const int x{ static_cast<int>(std::floor(uv.x * level.width)) };
+			const int y{ static_cast<int>(std::floor(uv.y * level.height)) };
+			return FetchAddressed(level, state, x, y);
+		}
+
+		template<typename T>
+		ColorRGBA SampleBilinear(const MipLevel<T>& level, const SamplerState& state, const Vector2& uv)
+		{
+			//Texel centers sit at half coordinates
+			const float x{ uv.x * level.width - 0.5f };
+			const float y{ uv.y * level.height - 0.5f };
+			const float x0{ std::floor(x) };
+			const float y0{ std::floor(y) };
+			const float fx{ x - x0 };
+			const float fy{ y - y0 };
+			const int ix{ static_cast<int>(x0) };
+			const int iy{ static_cast<int>(y0) };
+
+			const ColorRGBA top{ ColorRGBA::Lerp(FetchAddressed(level, state, ix, iy), FetchAddressed(level, state, ix + 1, iy), fx) };
+			const ColorRGBA bottom{ ColorRGBA::Lerp(FetchAddressed(level, state, ix, iy + 1), FetchAddressed(level, state, ix + 1, iy + 1), fx) };
+			return ColorRGBA::Lerp(top, bottom, fy);
+		}
+
+		template<typename T>
+		float ClampLod(const MipChain<T>& chain, const SamplerState& state, float lod)
+		{
+			lod = std::clamp(lod + state.mipLodBias, state.minLod, state.maxLod);
+			return std::clamp(lod, 0.f, static_cast<float>(chain.GetLevelCount() - 1));
+		}
+
+		//Explicit level of detail, like SampleLevel. Anisotropic falls back to trilinear without gradients
+		template<typename T>
+		ColorRGBA SampleLevel(const MipChain<T>& chain, const SamplerState& state, const Vector2& uv, float lod)
+		{
+			lod = ClampLod(chain, state, lod);
+
+			switch (state.filter)
+			{
+			case Filter::Point:
+				return SamplePoint(chain.levels[static_cast<int>(lod + 0.5f)], state, uv);
+			case Filter::Bilinear:
+				return SampleBilinear(chain.levels[static_cast<int>(lod + 0.5f)], state, uv);
+			case Filter::Trilinear:
+			case Filter::Anisotropic:
+			default:
+			{
+				const int level{ static_cast<int>(lod) };
+				const ColorRGBA fine{ SampleBilinear(chain.levels[level], state, uv) };
+				if (level + 1 >= chain.GetLevelCount())
+				{
+					return fine;
+				}
+				return ColorRGBA::Lerp(fine, SampleBilinear(chain.levels[level + 1], state, uv), lod - level);
+			}
+			}
+		}
+
+		//Derivatives are in uv units per pixel, like SampleGrad
+		template<typename T>
+		ColorRGBA SampleGrad(const MipChain<T>& chain, const SamplerState& state, const Vector2& uv, const Vector2& ddx, const Vector2& ddy)
+		{
+			const float width{ static_cast<float>(chain.levels[0].width) };
+			const float height{ static_cast<float>(chain.levels[0].height) };
+			const Vector2 ddxTexels{ ddx.x * width, ddx.y * height };
+			const Vector2 ddyTexels{ ddy.x * width, ddy.y * height };
+			const float lengthX{ ddxTexels.Magnitude() };
+			const float lengthY{ ddyTexels.Magnitude() };
+
+			if (state.filter != Filter::Anisotropic || state.maxAnisotropy <= 1)
+			{
+				const float lod{ std::log2(std::max(std::max(lengthX, lengthY), 1e-8f)) };
+				return SampleLevel(chain, state, uv, lod);
+			}
+
+			//Footprint is walked with probes along its major axis, lod follows the minor axis
+			const float major{ std::max(lengthX, lengthY) };
+			const float minor{ std::max(std::min(lengthX, lengthY), 1e-8f) };
+			const int probeCount{ std::clamp(static_cast<int>(std::ceil(major / minor)), 1, static_cast<int>(state.maxAnisotropy)) };
+			const float lod{ std::log2(std::max(major / probeCount, 1e-8f)) };
+			const Vector2 axis{ lengthX >= lengthY ? ddx : ddy };
+
+			ColorRGBA sum{};
+			for (int i{}; i < probeCount; ++i)
+			{
+				const float offset{ (i + 0.5f) / probeCount - 0.5f };
+				sum += SampleLevel(chain, state, uv + axis * offset, lod);
+			}
+			return sum * (1.f / probeCount);
+		}
+#pragma endregion
+
+#pragma region SIMD
+		//Four samples in SoA form, lanes follow the quad order top-left, top-right, bottom-left, bottom-right
+		struct ColorQuad
+		{
+			__m128 r{};
+			__m128 g{};
+			__m128 b{};
+			__m128 a{};
+
+			ColorRGBA Get(int lane) const
+			{
+				alignas(16) float values[4][4];
+				_mm_store_ps(values[0], r);
+				_mm_store_ps(values[1], g);
+				_mm_store_ps(values[2], b);
+				_mm_store_ps(values[3], a);
+				return { values[0][lane], values[1][lane], values[2][lane], values[3][lane] };
+			}
+		};
+
+		namespace Simd
+		{
+			//SSE2 has no floor, truncate and step back where that rounded up
+			inline __m128 Floor(__m128 x)
+			{
+				const __m128 truncated{ _mm_cvtepi32_ps(_mm_cvttps_epi32(x)) };
+				return _mm_sub_ps(truncated, _mm_and_ps(_mm_cmpgt_ps(truncated, x), _mm_set1_ps(1.f)));
+			}
+
+			inline __m128 Lerp(__m128 a, __m128 b, __m128 t)
+			{
+				return _mm_add_ps(a, _mm_mul_ps(_mm_sub_ps(b, a), t));
+			}
+
+			inline __m128 Select(__m128 mask, __m128 ifTrue, __m128 ifFalse)
+			{
+				return _mm_or_ps(_mm_and_ps(mask, ifTrue), _mm_andnot_ps(mask, ifFalse));
+			}
+
+			//Whole texel coordinates in, indices in [0, size) out, outside is set where Border applies
+			inline __m128i Address(__m128 coord, int size, AddressMode mode, __m128& outside)
+			{
+				const __m128 fSize{ _mm_set1_ps(static_cast<float>(size)) };
+				const __m128 maxCoord{ _mm_set1_ps(static_cast<float>(size - 1)) };
+				outside = _mm_setzero_ps();
+
+				switch (mode)
+				{
+				case AddressMode::Wrap:
+					coord = _mm_sub_ps(coord, _mm_mul_ps(fSize, Floor(_mm_div_ps(coord, fSize))));
+					break;
+				case AddressMode::Mirror:
+				{
+					const __m128 period{ _mm_add_ps(fSize, fSize) };
+					coord = _mm_sub_ps(coord, _mm_mul_ps(period, Floor(_mm_div_ps(coord, period))));
+					const __m128 mirrored{ _mm_sub_ps(_mm_sub_ps(period, _mm_set1_ps(1.f)), coord) };
+					coord = Select(_mm_cmpge_ps(coord, fSize), mirrored, coord);
+					break;
+				}
+				case AddressMode::Border:
+					outside = _mm_or_ps(_mm_cmplt_ps(coord, _mm_setzero_ps()), _mm_cmpgt_ps(coord, maxCoord));
+					[[fallthrough]];
+				case AddressMode::Clamp:
+				default:
+					coord = _mm_min_ps(_mm_max_ps(coord, _mm_setzero_ps()), maxCoord);
+					break;
+				}
+
+				return _mm_cvttps_epi32(coord);
+			}
+
+			template<typename T>
+			ColorQuad Fetch(const MipLevel<T>& level, const SamplerState& state, __m128 x, __m128 y)
+			{
+				__m128 outsideX, outsideY;
+				alignas(16) int32_t ix[4];
+				alignas(16) int32_t iy[4];
+				_mm_store_si128(reinterpret_cast<__m128i*>(ix), Address(x, level.width, state.addressU, outsideX));
+				_mm_store_si128(reinterpret_cast<__m128i*>(iy), Address(y, level.height, state.addressV, outsideY));
+
+				//No gather in SSE2, load the four texels and transpose to SoA
+				ColorRGBA texels[4];
+				for (int lane{}; lane < 4; ++lane)
+				{
+					texels[lane] = level.Fetch(ix[lane], iy[lane]);
+				}
+
+				ColorQuad quad{};
+				quad.r = _mm_setr_ps(texels[0].r, texels[1].r, texels[2].r, texels[3].r);
+				quad.g = _mm_setr_ps(texels[0].g, texels[1].g, texels[2].g, texels[3].g);
+				quad.b = _mm_setr_ps(texels[0].b, texels[1].b, texels[2].b, texels[3].b);
+				quad.a = _mm_setr_ps(texels[0].a, texels[1].a, texels[2].a, texels[3].a);
+
+				const __m128 outside{ _mm_or_ps(outsideX, outsideY) };
+				if (_mm_movemask_ps(outside))
+				{
+					quad.r = Select(outside, _mm_set1_ps(state.borderColor.r), quad.r);
+					quad.g = Select(outside, _mm_set1_ps(state.borderColor.g), quad.g);
+					quad.b = Select(outside, _mm_set1_ps(state.borderColor.b), quad.b);
+					quad.a = Select(outside, _mm_set1_ps(state.borderColor.a), quad.a);
+				}
+				return quad;
+			}
+
+			inline ColorQuad Lerp(const ColorQuad& q1, const ColorQuad& q2, __m128 t)
+			{
+				return { Lerp(q1.r, q2.r, t), Lerp(q1.g, q2.g, t), Lerp(q1.b, q2.b, t), Lerp(q1.a, q2.a, t) };
+			}
+
+			template<typename T>
+			ColorQuad SamplePoint(const MipLevel<T>& level, const SamplerState& state, __m128 u, __m128 v)
+			{
+				const __m128 x{ Floor(_mm_mul_ps(u, _mm_set1_ps(static_cast<float>(level.width)))) };
+				const __m128 y{ Floor(_mm_mul_ps(v, _mm_set1_ps(static_cast<float>(level.height)))) };
+				return Fetch(level, state, x, y);
+			}
+
+			template<typename T>
+			ColorQuad SampleBilinear(const MipLevel<T>& level, const SamplerState& state, __m128 u, __m128 v)
+			{
+				const __m128 half{ _mm_set1_ps(0.5f) };
+				const __m128 one{ _mm_set1_ps(1.f) };
+				const __m128 x{ _mm_sub_ps(_mm_mul_ps(u, _mm_set1_ps(static_cast<float>(level.width))), half) };
+				const __m128 y{ _mm_sub_ps(_mm_mul_ps(v, _mm_set1_ps(static_cast<float>(level.height))), half) };
+				const __m128 x0{ Floor(x) };
+				const __m128 y0{ Floor(y) };
+				const __m128 x1{ _mm_add_ps(x0, one) };
+				const __m128 y1{ _mm_add_ps(y0, one) };
+				const __m128 fx{ _mm_sub_ps(x, x0) };
+				const __m128 fy{ _mm_sub_ps(y, y0) };
+
+				const ColorQuad top{ Lerp(Fetch(level, state, x0, y0), Fetch(level, state, x1, y0), fx) };
+				const ColorQuad bottom{ Lerp(Fetch(level, state, x0, y1), Fetch(level, state, x1, y1), fx) };
+				return Lerp(top, bottom, fy);
+			}
+
+			template<typename T>
+			ColorQuad SampleLevel(const MipChain<T>& chain, const SamplerState& state, __m128 u, __m128 v, float lod)
+			{
+				switch (state.filter)
+				{
+				case Filter::Point:
+					return SamplePoint(chain.levels[static_cast<int>(lod + 0.5f)], state, u, v);
+				case Filter::Bilinear:
+					return SampleBilinear(chain.levels[static_cast<int>(lod + 0.5f)], state, u, v);
+				case Filter::Trilinear:
+				case Filter::Anisotropic:
+				default:
+				{
+					const int level{ static_cast<int>(lod) };
+					const ColorQuad fine{ SampleBilinear(chain.levels[level], state, u, v) };
+					if (level + 1 >= chain.GetLevelCount())
+					{
+						return fine;
+					}
+					return Lerp(fine, SampleBilinear(chain.levels[level + 1], state, u, v), _mm_set1_ps(lod - level));
+				}
+				}
+			}
+		}
+
+		//Samples a 2x2 pixel quad at once. Gradients come from the quad itself (coarse ddx/ddy)
+		//so the whole quad shares one level of detail, exactly like a GPU quad does.
+		template<typename T>
+		ColorQuad SampleQuad(const MipChain<T>& chain, const SamplerState& state, const Vector2 (&uv)[4])
+		{
+			const Vector2 ddx{ uv[1] - uv[0] };
+			const Vector2 ddy{ uv[2] - uv[0] };
+
+			const float width{ static_cast<float>(chain.levels[0].width) };
+			const float height{ static_cast<float>(chain.levels[0].height) };
+			const float lengthX{ Vector2{ ddx.x * width, ddx.y * height }.Magnitude() };
+			const float lengthY{ Vector2{ ddy.x * width, ddy.y * height }.Magnitude() };
+
+			const __m128 u{ _mm_setr_ps(uv[0].x, uv[1].x, uv[2].x, uv[3].x) };
+			const __m128 v{ _mm_setr_ps(uv[0].y, uv[1].y, uv[2].y, uv[3].y) };
+
+			if (state.filter != Filter::Anisotropic || state.maxAnisotropy <= 1)
+			{
+				const float lod{ ClampLod(chain, state, std::log2(std::max(std::max(lengthX, lengthY), 1e-8f))) };
+				return Simd::SampleLevel(chain, state, u, v, lod);
+			}
+
+			const float major{ std::max(lengthX, lengthY) };
+			const float minor{ std::max(std::min(lengthX, lengthY), 1e-8f) };
+			const int probeCount{ std::clamp(static_cast<int>(std::ceil(major / minor)), 1, static_cast<int>(state.maxAnisotropy)) };
+			const float lod{ ClampLod(chain, state, std::log2(std::max(major / probeCount, 1e-8f))) };
+			const Vector2 axis{ lengthX >= lengthY ? ddx : ddy };
+
+			ColorQuad sum{ _mm_setzero_ps(), _mm_setzero_ps(), _mm_setzero_ps(), _mm_setzero_ps() };
+			for (int i{}; i < probeCount; ++i)
+			{
+				const float offset{ (i + 0.5f) / probeCount - 0.5f };
+				const ColorQuad probe{ Simd::SampleLevel(chain, state,
+					_mm_add_ps(u, _mm_set1_ps(axis.x * offset)), _mm_add_ps(v, _mm_set1_ps(axis.y * offset)), lod) };
+				sum.r = _mm_add_ps(sum.r, probe.r);
+				sum.g = _mm_add_ps(sum.g, probe.g);
+				sum.b = _mm_add_ps(sum.b, probe.b);
+				sum.a = _mm_add_ps(sum.a, probe.a);
+			}
+
+			const __m128 scale{ _mm_set1_ps(1.f / probeCount) };
+			return { _mm_mul_ps(sum.r, scale), _mm_mul_ps(sum.g, scale), _mm_mul_ps(sum.b, scale), _mm_mul_ps(sum.a, scale) };
+		}
+#pragma endregion
+	}
+}
@@ -0,0 +1,569 @@
+#include "pch.h"
+#include "Simplifier.h"
+#include "MeshData.h"
+#include "JobSystem.h"
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <numeric>
+
+namespace dae
+{
+	namespace Simplifier
+	{
+		namespace
+		{
+			constexpr uint32_t noVertex{ ~0u };
+			//Border planes against the face planes, edge length squared against area
+			constexpr double borderWeight{ 10.0 };
+			//A level that keeps more than this of the previous one means the mesh is out of collapses
+			constexpr float stalledRatio{ 0.9f };
+			//How far past the cost of the last collapse a pass needs, if none were blocked, it may go
+			constexpr double passCostFactor{ 1.5 };
+
+			//Cooked chain file: header, then per level its error, index count and indices
+			struct ChainHeader
+			{
+				char magic[4]{ 'L', 'O', 'D', 'S' };
+				uint32_t version{ 1 }; //bump with every change to what Simplify produces
+				uint32_t levelCount{};
+				uint32_t padding{};
+				uint64_t meshHash{};
+			};
+
+			std::string GetChainPath(const std::string& directory, uint64_t meshHash)
+			{
+				std::stringstream name{};
+				name << std::hex << meshHash << ".lods";
+				return (std::filesystem::path{ directory } / name.str()).string();
+			}
+
+			//Sum of squared distances to weighted planes, x^T A x + 2 b.x + c
+			struct Quadric
+			{
+				double a00{}, a01{}, a02{}, a11{}, a12{}, a22{};
+				double b0{}, b1{}, b2{};
+				double c{};
+				double weight{};
+
+				//Unit normal n, the plane is n.x + d = 0
+				void AddPlane(const Vector3& n, float d, double planeWeight)
+				{
+					a00 += planeWeight * n.x * n.x;
+					a01 += planeWeight * n.x * n.y;
+					a02 += planeWeight * n.x * n.z;
+					a11 += planeWeight * n.y * n.y;
+					a12 += planeWeight * n.y * n.z;
+					a22 += planeWeight * n.z * n.z;
+					b0 += planeWeight * n.x * d;
+					b1 += planeWeight * n.y * d;
+					b2 += planeWeight * n.z * d;
+					c += planeWeight * d * d;
+					weight += planeWeight;
+				}
+
+				Quadric& operator+=(const Quadric& other)
+				{
+					a00 += other.a00; a01 += other.a01; a02 += other.a02;
+					a11 += other.a11; a12 += other.a12; a22 += other.a22;
+					b0 += other.b0; b1 += other.b1; b2 += other.b2;
+					c += other.c;
+					weight += other.weight;
+					return *this;
+				}
+
+				double Evaluate(const Vector3& p) const
+				{
+					const double x{ p.x }, y{ p.y }, z{ p.z };
+					return a00 * x * x + a11 * y * y + a22 * z * z + 2.0 * (a01 * x * y + a02 * x * z + a12 * y * z)
+						+ 2.0 * (b0 * x + b1 * y + b2 * z) + c;
+				}
+			};
+
+			struct Collapse
+			{
+				double cost{};
+				uint32_t from{}; //positions
+				uint32_t to{};
+
+				bool operator<(const Collapse& other) const { return cost < other.cost; }
+			};
+
+			uint64_t MakeEdgeKey(uint32_t a, uint32_t b)
+			{
+				return static_cast<uint64_t>(std::min(a, b)) << 32 | std::max(a, b);
+			}
+
+			Vector3 GetTriangleNormal(const Vector3& p0, const Vector3& p1, const Vector3& p2)
+			{
+				return Vector3::Cross(p1 - p0, p2 - p0);
+			}
+
+			//Mean squared distance to the planes of both ends, at the end that stays
+			double GetCollapseCost(const Quadric& from, const Quadric& to, const Vector3& target)
+			{
+				const double weight{ from.weight + to.weight };
+				return weight > 0.0 ? std::max(from.Evaluate(target) + to.Evaluate(target), 0.0) / weight : 0.0;
+			}
+		}
+
+		std::vector<uint32_t> Simplify(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices, size_t targetIndexCount,
+			float& error)
+		{
+			error = 0.f;
+
+			//Vertices that share a position move as one
+			std::map<std::array<float, 3>, uint32_t> positionLookup{};
+			std::vector<uint32_t> positionIds(vertices.size());
+			std::vector<Vector3> points{};
+			for (size_t i{}; i < vertices.size(); ++i)
+			{
+				const Vector3& position{ vertices[i].Position };
+				const auto [it, inserted] { positionLookup.try_emplace({ position.x, position.y, position.z }, static_cast<uint32_t>(points.size())) };
+				if (inserted)
+				{
+					points.push_back(position);
+				}
+				positionIds[i] = it->second;
+			}
+			const size_t positionCount{ points.size() };
+			std::vector<uint32_t> wedgeOffsets(positionCount + 1);
+			for (const uint32_t position : positionIds)
+			{
+				++wedgeOffsets[position + 1];
+			}
+			for (size_t i{ 1 }; i < wedgeOffsets.size(); ++i)
+			{
+				wedgeOffsets[i] += wedgeOffsets[i - 1];
+			}
+			std::vector<uint32_t> wedges(vertices.size());
+			std::vector<uint32_t> wedgeFill(wedgeOffsets.begin(), wedgeOffsets.end() - 1);
+			for (size_t i{}; i < vertices.size(); ++i)
+			{
+				wedges[wedgeFill[positionIds[i]]++] = static_cast<uint32_t>(i);
+			}
+
+			//Planes of the original faces, weighted by area
+			std::vector<Quadric> quadrics(positionCount);
+			for (size_t i{}; i + 2 < indices.size(); i += 3)
+			{
+				const Vector3& p0{ vertices[indices[i]].Position };
+				const Vector3 normal{ GetTriangleNormal(p0, vertices[indices[i + 1]].Position, vertices[indices[i + 2]].Position) };
+				const float length{ normal.Magnitude() };
+				if (length <= 0.f)
+				{
+					continue;
+				}
+				const Vector3 unitNormal{ normal / length };
+				for (int corner{}; corner < 3; ++corner)
+				{
+					quadrics[positionIds[indices[i + corner]]].AddPlane(unitNormal, -Vector3::Dot(unitNormal, p0), length * 0.5);
+				}
+			}
+
+			std::vector<uint32_t> result{ indices };
+			std::vector<uint32_t> remap(vertices.size());
+			std::vector<uint32_t> triangleOffsets(vertices.size() + 1);
+			std::vector<uint32_t> vertexTriangles{};
+			std::vector<uint64_t> edges{};
+			std::vector<uint64_t> edgeKeys{};
+			std::vector<uint32_t> edgeCounts{};
+			std::vector<bool> border(positionCount);
+			std::vector<bool> locked(positionCount);
+			std::vector<bool> touched(positionCount);
+			std::vector<Collapse> collapses{};
+			std::vector<std::pair<uint32_t, uint32_t>> wedgeTargets{};
+			bool bordersAdded{};
+			double maxCost{};
+
+			while (result.size() > targetIndexCount)
+			{
+				const size_t triangleCount{ result.size() / 3 };
+
+				//Triangles around every vertex
+				std::fill(triangleOffsets.begin(), triangleOffsets.end(), 0);
+				for (const uint32_t index : result)
+				{
+					++triangleOffsets[index + 1];
+				}
+				for (size_t i{ 1 }; i < triangleOffsets.size(); ++i)
+				{
+					triangleOffsets[i] += triangleOffsets[i - 1];
+				}
+				vertexTriangles.resize(result.size());
+				std::vector<uint32_t> triangleFill(triangleOffsets.begin(), triangleOffsets.end() - 1);
+				for (size_t i{}; i < result.size(); ++i)
+				{
+					vertexTriangles[triangleFill[result[i]]++] = static_cast<uint32_t>(i / 3);
+				}
+
+				//Edges between positions: one triangle is a border, more than two cannot collapse safely
+				edges.clear();
+				for (size_t i{}; i < result.size(); i += 3)
+				{
+					for (int corner{}; corner < 3; ++corner)
+					{
+						edges.push_back(MakeEdgeKey(positionIds[result[i + corner]], positionIds[result[i + (corner + 1) % 3]]));
+					}
+				}
+				std::sort(edges.begin(), edges.end());
+				edgeKeys.clear();
+				edgeCounts.clear();
+				for (const uint64_t edge : edges)
+				{
+					if (edgeKeys.empty() || edgeKeys.back() != edge)
+					{
+						edgeKeys.push_back(edge);
+						edgeCounts.push_back(0);
+					}
+					++edgeCounts.back();
+				}
+				const auto getEdgeCount = [&](uint32_t a, uint32_t b)
+				{
+					const auto it{ std::lower_bound(edgeKeys.begin(), edgeKeys.end(), MakeEdgeKey(a, b)) };
+					return it != edgeKeys.end() && *it == MakeEdgeKey(a, b) ? edgeCounts[it - edgeKeys.begin()] : 0u;
+				};
+				std::fill(border.begin(), border.end(), false);
+				std::fill(locked.begin(), locked.end(), false);
+				for (size_t i{}; i < edgeKeys.size(); ++i)
+				{
+					const uint32_t a{ static_cast<uint32_t>(edgeKeys[i] >> 32) };
+					const uint32_t b{ static_cast<uint32_t>(edgeKeys[i]) };
+					if (edgeCounts[i] == 1)
+					{
+						border[a] = border[b] = true;
+					}
+					else if (edgeCounts[i] > 2)
+					{
+						locked[a] = locked[b] = true;
+					}
+				}
+
+				//Planes through the borders of the original mesh, perpendicular to their face, keep its outline
+				if (!bordersAdded)
+				{
+					bordersAdded = true;
+					for (size_t i{}; i < result.size(); i += 3)
+					{
+						const Vector3 normal{ GetTriangleNormal(points[positionIds[result[i]]], points[positionIds[result[i + 1]]], points[positionIds[result[i + 2]]]) };
+						for (int corner{}; corner < 3; ++corner)
+						{
+							const uint32_t a{ positionIds[result[i + corner]] };
+							const uint32_t b{ positionIds[result[i + (corner + 1) % 3]] };
+							const Vector3 edge{ points[b] - points[a] };
+							const Vector3 planeNormal{ Vector3::Cross(edge, normal) };
+							const float length{ planeNormal.Magnitude() };
+							if (getEdgeCount(a, b) != 1 || length <= 0.f)
+							{
+								continue;
+							}
+							const Vector3 unitNormal{ planeNormal / length };
+							const float d{ -Vector3::Dot(unitNormal, points[a]) };
+							quadrics[a].AddPlane(unitNormal, d, borderWeight * edge.SqrMagnitude());
+							quadrics[b].AddPlane(unitNormal, d, borderWeight * edge.SqrMagnitude());
+						}
+					}
+				}
+
+				collapses.clear();
+				for (size_t i{}; i < result.size(); i += 3)
+				{
+					for (int corner{}; corner < 3; ++corner)
+					{
+						const uint32_t a{ positionIds[result[i + corner]] };
+						const uint32_t b{ positionIds[result[i + (corner + 1) % 3]] };
+						if (a == b)
+						{
+							continue;
+						}
+						for (const auto& [from, to] : { std::pair{ a, b }, std::pair{ b, a } })
+						{
+							if (locked[from] || (border[from] && getEdgeCount(from, to) != 1))
+							{
+								continue;
+							}
+							collapses.push_back({ GetCollapseCost(quadrics[from], quadrics[to], points[to]), from, to });
+						}
+					}
+				}
+				//Every vertex at from needs a vertex at to across one of its edges, which has the attributes to continue the
+				//surface. Fills wedgeTargets and counts the triangles that disappear
+				const auto checkCollapse = [&](const Collapse& collapse, size_t& removed)
+				{
+					removed = 0;
+					wedgeTargets.clear();
+					for (uint32_t w{ wedgeOffsets[collapse.from] }; w < wedgeOffsets[collapse.from + 1]; ++w)
+					{
+						const uint32_t vertex{ wedges[w] };
+						//Vertices no triangle uses anymore do not matter
+						if (triangleOffsets[vertex] == triangleOffsets[vertex + 1])
+						{
+							continue;
+						}
+						uint32_t target{ noVertex };
+						for (uint32_t t{ triangleOffsets[vertex] }; t < triangleOffsets[vertex + 1]; ++t)
+						{
+							const uint32_t* pTriangle{ &result[vertexTriangles[t] * 3] };
+							std::array<Vector3, 3> corners{};
+							bool removedByCollapse{};
+							for (int corner{}; corner < 3; ++corner)
+							{
+								const uint32_t position{ positionIds[pTriangle[corner]] };
+								if (position == collapse.to)
+								{
+									target = pTriangle[corner];
+									removedByCollapse = true;
+								}
+								corners[corner] = points[position];
+							}
+							if (removedByCollapse)
+							{
+								++removed;
+								continue;
+							}
+
+							//The triangle stays, with from moved onto to
+							const Vector3 before{ GetTriangleNormal(corners[0], corners[1], corners[2]) };
+							for (int corner{}; corner < 3; ++corner)
+							{
+								if (positionIds[pTriangle[corner]] == collapse.from)
+								{
+									corners[corner] = points[collapse.to];
+								}
+							}
+							const Vector3 after{ GetTriangleNormal(corners[0], corners[1], corners[2]) };
+							if (Vector3::Dot(before, after) <= 0.f)
+							{
+								return false;
+							}
+						}
+						if (target == noVertex)
+						{
+							return false;
+						}
+						wedgeTargets.emplace_back(vertex, target);
+					}
+					return !wedgeTargets.empty();
+				};
+
+				//Collapses with disjoint neighbourhoods do not change what the others see, so checking them all up front
+				//against the mesh as it is holds for the whole pass
+				size_t removed{};
+				collapses.erase(std::remove_if(collapses.begin(), collapses.end(), [&](const Collapse& collapse) { return !checkCollapse(collapse, removed); }),
+					collapses.end());
+				std::sort(collapses.begin(), collapses.end());
+
+				//Cheap collapses get blocked by their neighbours, without a limit the pass would take expensive ones instead.
+				//Each collapse removes about two triangles
+				const size_t targetTriangles{ targetIndexCount / 3 };
+				const size_t collapseGoal{ (triangleCount - targetTriangles) / 2 };
+				const double costLimit{ collapseGoal < collapses.size() ? passCostFactor * collapses[collapseGoal].cost : DBL_MAX };
+
+				std::fill(touched.begin(), touched.end(), false);
+				std::iota(remap.begin(), remap.end(), 0);
+				size_t removedTriangles{};
+				size_t collapseCount{};
+				for (const Collapse& collapse : collapses)
+				{
+					if (triangleCount - removedTriangles <= targetTriangles || collapse.cost > costLimit)
+					{
+						break;
+					}
+					if (touched[collapse.from] || touched[collapse.to])
+					{
+						continue;
+					}
+					checkCollapse(collapse, removed);
+
+					for (const auto& [vertex, target] : wedgeTargets)
+					{
+						remap[vertex] = target;
+						for (uint32_t t{ triangleOffsets[vertex] }; t < triangleOffsets[vertex + 1]; ++t)
+						{
+							for (int corner{}; corner < 3; ++corner)
+							{
+								touched[positionIds[result[vertexTriangles[t] * 3 + corner]]] = true;
+							}
+						}
+					}
+					maxCost = std::max(maxCost, collapse.cost);
+					quadrics[collapse.to] += quadrics[collapse.from];
+					//Each removed triangle was counted once per vertex of from it has, which is one
+					removedTriangles += removed;
+					++collapseCount;
+				}
+				if (collapseCount == 0)
+				{
+					break;
+				}
+
+				//Drop what collapsed to a line or a point
+				size_t kept{};
+				for (size_t i{}; i < result.size(); i += 3)
+				{
+					const uint32_t a{ remap[result[i]] };
+					const uint32_t b{ remap[result[i + 1]] };
+					const uint32_t c{ remap[result[i + 2]] };
+					if (positionIds[a] == positionIds[b] || positionIds[b] == positionIds[c] || positionIds[a] == positionIds[c])
+					{
+						continue;
+					}
+					result[kept++] = a;
+					result[kept++] = b;
+					result[kept++] = c;
+				}
+				result.resize(kept);
+			}
+
+			error = static_cast<float>(sqrt(maxCost));
+			return result;
+		}
+
+		std::vector<LodLevel> BuildChain(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices, JobSystem* pJobs,
+			float* pSimplifyTime)
+		{
+			constexpr size_t ratioCount{ std::size(chainRatios) };
+			std::vector<LodLevel> candidates(ratioCount);
+			std::array<float, ratioCount> simplifyTimes{};
+			const auto simplify = [&](size_t begin, size_t end)
+			{
+				for (size_t i{ begin }; i < end; ++i)
+				{
+					const auto start{ std::chrono::steady_clock::now() };
+					const size_t targetIndexCount{ static_cast<size_t>(indices.size() / 3 * chainRatios[i]) * 3 };
+					candidates[i].indices = Simplify(vertices, indices, targetIndexCount, candidates[i].error);
+					simplifyTimes[i] = std::chrono::duration<float>(std::chrono::steady_clock::now() - start).count();
+				}
+			};
+			if (pJobs)
+			{
+				pJobs->ParallelFor(ratioCount, 1, simplify);
+			}
+			else
+			{
+				simplify(0, ratioCount);
+			}
+
+			std::vector<LodLevel> levels{};
+			size_t previousCount{ indices.size() };
+			for (LodLevel& level : candidates)
+			{
+				if (level.indices.empty() || level.indices.size() > previousCount * stalledRatio)
+				{
+					break;
+				}
+				//Levels are simplified independently, the selector relies on errors that only grow
+				level.error = std::max(level.error, levels.empty() ? 0.f : levels.back().error);
+				previousCount = level.indices.size();
+				levels.push_back(std::move(level));
+			}
+
+			if (pSimplifyTime)
+			{
+				*pSimplifyTime = std::accumulate(simplifyTimes.begin(), simplifyTimes.end(), 0.f);
+			}
+			return levels;
+		}
+
+		uint64_t HashMesh(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices)
+		{
+			//FNV-1a over the raw vertex and index bytes, with both counts so the split between them matters
+			uint64_t hash{ 0xCBF29CE484222325ull };
+			const auto hashBytes = [&hash](const void* pData, size_t bytes)
+			{
+				const auto pBytes{ static_cast<const uint8_t*>(pData) };
+				for (size_t i{}; i < bytes; ++i)
+				{
+					hash = (hash ^ pBytes[i]) * 0x100000001B3ull;
+				}
+			};
+			const uint64_t counts[]{ vertices.size(), indices.size() };
+			hashBytes(counts, sizeof(counts));
+			hashBytes(vertices.data(), vertices.size() * sizeof(Vertex));
+			hashBytes(indices.data(), indices.size() * sizeof(uint32_t));
+			return hash;
+		}
+
+		bool ReadChain(const std::string& directory, uint64_t meshHash, std::vector<LodLevel>& levels)
+		{
+			std::ifstream file{ GetChainPath(directory, meshHash), std::ios::binary };
+			ChainHeader header{};
+			const ChainHeader expected{};
+			if (!file.read(reinterpret_cast<char*>(&header), sizeof(header)) || memcmp(header.magic, expected.magic, sizeof(header.magic)) != 0
+				|| header.version != expected.version || header.meshHash != meshHash || header.levelCount > std::size(chainRatios))
+			{
+				return false;
+			}
+
+			std::vector<LodLevel> read(header.levelCount);
+			for (LodLevel& level : read)
+			{
+				uint32_t indexCount{};
+				if (!file.read(reinterpret_cast<char*>(&level.error), sizeof(level.error))
+					|| !file.read(reinterpret_cast<char*>(&indexCount), sizeof(indexCount)) || indexCount % 3 != 0)
+				{
+					return false;
+				}
+				level.indices.resize(indexCount);
+				if (!file.read(reinterpret_cast<char*>(level.indices.data()), static_cast<std::streamsize>(indexCount * sizeof(uint32_t))))
+				{
+					return false;
+				}
+			}
+			levels = std::move(read);
+			return true;
+		}
+
+		bool WriteChain(const std::string& directory, uint64_t meshHash, const std::vector<LodLevel>& levels)
+		{
+			//Numbers the temporary file of every write, concurrent loads of one mesh never share one
+			static std::atomic<uint32_t> s_WriteCount{};
+
+			ChainHeader header{};
+			header.levelCount = static_cast<uint32_t>(levels.size());
+			header.meshHash = meshHash;
+
+			const std::string path{ GetChainPath(directory, meshHash) };
+			const std::string tempPath{ path + "." + std::to_string(s_WriteCount.fetch_add(1, std::memory_order_relaxed)) + ".tmp" };
+			std::error_code error{};
+			std::filesystem::create_directories(directory, error);
+			{
+				std::ofstream file{ tempPath, std::ios::binary | std::ios::trunc };
+				file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+				for (const LodLevel& level : levels)
+				{
+					const uint32_t indexCount{ static_cast<uint32_t>(level.indices.size()) };
+					file.write(reinterpret_cast<const char*>(&level.error), sizeof(level.error));
+					file.write(reinterpret_cast<const char*>(&indexCount), sizeof(indexCount));
+					file.write(reinterpret_cast<const char*>(level.indices.data()), static_cast<std::streamsize>(indexCount * sizeof(uint32_t)));
+				}
+				if (!file)
+				{
+					file.close();
+					std::filesystem::remove(tempPath, error);
+					return false;
+				}
+			}
+			std::filesystem::rename(tempPath, path, error);
+			if (error)
+			{
+				std::filesystem::remove(tempPath, error);
+				return false;
+			}
+			return true;
+		}
+
+		size_t SelectLevel(const std::vector<float>& errors, float pixelsPerUnit, float maxPixelError)
+		{
+			size_t level{};
+			while (level + 1 < errors.size() && errors[level + 1] * pixelsPerUnit <= maxPixelError)
+			{
+				++level;
+			}
+			return level;
+		}
+	}
+}
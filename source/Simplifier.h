@@ -0,0 +1,50 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace dae
+{
+	struct Vertex;
+	class JobSystem;
+
+	//A coarser index buffer over the same vertices
+	struct LodLevel
+	{
+		std::vector<uint32_t> indices{};
+		float error{}; //estimated object-space distance the surface moved, for picking the level by projected size
+	};
+
+	//Quadric error metric edge collapses that only ever move a vertex onto a neighbour, so every level keeps
+	//using the original vertex buffer. Vertices that share a position are collapsed together, and only when
+	//each of them has an edge to a vertex at the target: UV seams and hard normals stay intact. Open borders
+	//only collapse along themselves and collapses that would flip a triangle are skipped.
+	namespace Simplifier
+	{
+		//Fractions of the full triangle count of the levels BuildChain makes
+		constexpr float chainRatios[]{ 0.5f, 0.25f, 0.125f };
+
+		//Collapses the cheapest edges first until at most targetIndexCount indices are left, or nothing can
+		//collapse anymore. error receives the largest error of a collapse that was made
+		std::vector<uint32_t> Simplify(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices, size_t targetIndexCount,
+			float& error);
+
+		//Every level of chainRatios the mesh gets reasonably close to, finest first. Levels are simplified from
+		//the full mesh, not from each other, so with jobs they are built at the same time.
+		//pSimplifyTime receives the seconds spent in Simplify over all levels, what building them one by one takes
+		std::vector<LodLevel> BuildChain(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices, JobSystem* pJobs = nullptr,
+			float* pSimplifyTime = nullptr);
+
+		//Cooked chains are keyed by a hash of the exact vertices and indices they were built from, so a changed obj,
+		//weld or meshlet order never reads back a stale chain
+		uint64_t HashMesh(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices);
+		//Thread-safe. False if directory holds no chain for meshHash or it was cooked by another version of the simplifier
+		bool ReadChain(const std::string& directory, uint64_t meshHash, std::vector<LodLevel>& levels);
+		//Thread-safe. Writes under a temporary name first, a crash never leaves a valid header over a partial chain
+		bool WriteChain(const std::string& directory, uint64_t meshHash, const std::vector<LodLevel>& levels);
+
+		//The coarsest level whose error covers at most maxPixelError pixels. errors start with the full mesh's 0 and
+		//only grow, pixelsPerUnit is the screen size of one object-space unit at the closest point of the bounds
+		size_t SelectLevel(const std::vector<float>& errors, float pixelsPerUnit, float maxPixelError);
+	}
+}
@@ -0,0 +1,1030 @@
+#include "pch.h"
+#include "SoftwareRenderer.h"
+#include "Camera.h"
+#include <bit>
+#include <chrono>
+
+namespace dae
+{
+	namespace
+	{
+		//Same constants as PosCol3D.fx
+		const Vector3 lightDirection{ Vector3{ 0.577f, -0.577f, 0.577f }.Normalized() };
+		constexpr float lightIntensity{ 7.f };
+		constexpr float shininess{ 25.f };
+		constexpr float kd{ 1.f };
+		constexpr float ambient{ 0.025f };
+
+		//Block4x4 keeps the 2x2 quads' footprints on few cache lines (see "--bench tiling")
+		constexpr TexelLayout mapLayout{ TexelLayout::Block4x4 };
+
+		Sampling::MipChainRGBA8 BuildChain(const TextureData& texture)
+		{
+			if (!texture.IsValid())
+			{
+				return {};
+			}
+			if (texture.format == TexelFormat::RGBA8)
+			{
+				return Sampling::MipChainRGBA8::Build(texture.pixels.data(), texture.width, texture.height, mapLayout, texture.colorSpace);
+			}
+
+			//RG8 normals are widened, the box filter shortens filtered normals a little but z is rebuilt after sampling anyway
+			std::vector<uint8_t> texels(static_cast<size_t>(texture.width) * texture.height * 4);
+			for (size_t i{}; i < texels.size() / 4; ++i)
+			{
+				texels[i * 4] = texture.pixels[i * 2];
+				texels[i * 4 + 1] = texture.pixels[i * 2 + 1];
+				texels[i * 4 + 3] = 255;
+			}
+			return Sampling::MipChainRGBA8::Build(texels.data(), texture.width, texture.height, mapLayout, texture.colorSpace);
+		}
+
+		//An unbound map samples as zero on the GPU too
+		Sampling::ColorRGBA Sample(const Sampling::MipChainRGBA8& chain, const Sampling::SamplerState& state, const Vector2& uv,
+			const Vector2& ddx, const Vector2& ddy)
+		{
+			return chain.levels.empty() ? Sampling::ColorRGBA{} : Sampling::SampleGrad(chain, state, uv, ddx, ddy);
+		}
+
+		float ElapsedMs(std::chrono::steady_clock::time_point& start)
+		{
+			const auto now{ std::chrono::steady_clock::now() };
+			const float elapsed{ std::chrono::duration<float, std::milli>(now - start).count() };
+			start = now;
+			return elapsed;
+		}
+	}
+
+	SoftwareRenderer::SoftwareRenderer(int width, int height, int threadCount, JobSystem* pJobs)
+		: m_Width{ width }
+		, m_Height{ height }
+		, m_TilesX{ (width + tileSize - 1) / tileSize }
+		, m_TilesY{ (height + tileSize - 1) / tileSize }
+		, m_GuardBand{ Clipping::GuardBand::ForViewport(width, height) }
+		, m_Pixels(static_cast<size_t>(width) * height * 4)
+		, m_Workers{ threadCount, pJobs }
+	{
+		m_ThreadData.resize(m_Workers.GetThreadCount());
+		for (ThreadData& data : m_ThreadData)
+		{
+			data.bins.resize(static_cast<size_t>(m_TilesX) * m_TilesY);
+			data.tileColor.resize(tileSize * tileSize);
+			data.tileDepth = DepthBuffer{ tileSize, tileSize };
+			data.tileAccumulation.resize(tileSize * tileSize);
+			data.tileRevealage.resize(tileSize * tileSize);
+			data.tileFragmentHeads.resize(tileSize * tileSize);
+		}
+	}
+
+	size_t SoftwareRenderer::AddMesh(const MeshData& data)
+	{
+		SoftwareMesh& mesh{ m_Meshes.emplace_back() };
+		mesh.vertices = data.vertices;
+		mesh.indices = data.indices;
+		mesh.transparent = data.translucent;
+		mesh.input = VertexShading::InputStreams::FromVertices(mesh.vertices);
+		mesh.output.Resize(mesh.vertices.size(), !mesh.transparent);
+		mesh.shaded.resize(mesh.vertices.size());
+		mesh.outcodes.resize(mesh.vertices.size());
+
+		mesh.diffuse = BuildChain(data.diffuse);
+		mesh.normal = BuildChain(data.normal);
+		mesh.twoChannelNormals = data.normal.format == TexelFormat::RG8;
+		if (data.material.IsValid())
+		{
+			mesh.material = BuildChain(data.material.texture);
+			mesh.glossMask = data.material.packing.GetMask(MaterialChannel::Gloss);
+			mesh.specularMask = data.material.packing.GetMask(MaterialChannel::Specular);
+		}
+		else
+		{
+			mesh.specular = BuildChain(data.specular);
+			mesh.gloss = BuildChain(data.gloss);
+		}
+		return m_Meshes.size() - 1;
+	}
+
+	void SoftwareRenderer::SetShadingMode(ShadingMode mode)
+	{
+		m_ShadingMode = mode;
+		if (mode == ShadingMode::VisibilityBuffer && m_VisibilityIds.empty())
+		{
+			const size_t pixelCount{ static_cast<size_t>(m_Width) * m_Height };
+			m_VisibilityIds.resize(pixelCount);
+			m_VisibilityDepth.resize(pixelCount);
+			m_ShadedColor.resize(pixelCount);
+		}
+	}
+
+	void SoftwareRenderer::SetDepthFormat(DepthBuffer::Format format)
+	{
+		m_DepthFormat = format;
+		for (ThreadData& data : m_ThreadData)
+		{
+			data.tileDepth = DepthBuffer{ tileSize, tileSize, format };
+			if (!data.sampleSlots.empty())
+			{
+				data.sampleDepth = DepthBuffer{ tileSize * 2, tileSize * 2, format };
+			}
+		}
+	}
+
+	void SoftwareRenderer::SetMultisample(bool enabled)
+	{
+		m_Multisample = enabled;
+		for (ThreadData& data : m_ThreadData)
+		{
+			if (enabled && data.sampleSlots.empty())
+			{
+				data.sampleDepth = DepthBuffer{ tileSize * 2, tileSize * 2, m_DepthFormat };
+				data.sampleSlots.resize(tileSize * tileSize);
+			}
+		}
+	}
+
+	void SoftwareRenderer::SetWorldMatrix(size_t mesh, const Matrix& world)
+	{
+		m_Meshes[mesh].world = world;
+	}
+
+	void SoftwareRenderer::SetVisible(size_t mesh, bool visible)
+	{
+		m_Meshes[mesh].visible = visible;
+	}
+
+	void SoftwareRenderer::Render(const Camera& camera)
+	{
+		m_Stats = {};
+		auto start{ std::chrono::steady_clock::now() };
+		const auto frameStart{ start };
+
+		m_CameraOrigin = camera.origin;
+		TransformVertices(camera);
+		m_Stats.vertexMs = ElapsedMs(start);
+
+		m_Workers.Run([this](int threadIndex) { BinTriangles(threadIndex); });
+		m_Stats.binMs = ElapsedMs(start);
+
+		for (ThreadData& data : m_ThreadData)
+		{
+			data.pixelsShaded = 0;
+			data.blocksTested = 0;
+			data.blocksRejected = 0;
+			data.blocksAccepted = 0;
+			data.pixelsExpanded = 0;
+		}
+		if (m_ShadingMode == ShadingMode::Forward)
+		{
+			ForEachTile(&SoftwareRenderer::RasterizeTile);
+			m_Stats.rasterMs = ElapsedMs(start);
+		}
+		else
+		{
+			ForEachTile(&SoftwareRenderer::RasterizeVisibilityTile);
+			m_Stats.rasterMs = ElapsedMs(start);
+
+			//Every pixel is about the same work now, the tiles' varying overdraw is gone
+			m_NextTile = 0;
+			const int rowPairs{ (m_Height + 1) / 2 };
+			m_Workers.Run([this, rowPairs](int threadIndex)
+				{
+					ThreadData& data{ m_ThreadData[threadIndex] };
+					for (int rowPair{ m_NextTile++ }; rowPair < rowPairs; rowPair = m_NextTile++)
+					{
+						ShadeVisibilityRows(rowPair, data);
+					}
+				});
+			m_Stats.shadeMs = ElapsedMs(start);
+
+			ForEachTile(&SoftwareRenderer::BlendTransparentTile);
+			m_Stats.rasterMs += ElapsedMs(start);
+		}
+		m_Stats.totalMs = std::chrono::duration<float, std::milli>(start - frameStart).count();
+
+		for (const ThreadData& data : m_ThreadData)
+		{
+			m_Stats.trianglesBinned += data.triangles.size();
+			m_Stats.trianglesClipped += data.trianglesClipped;
+			m_Stats.pixelsShaded += data.pixelsShaded;
+			m_Stats.blocksTested += data.blocksTested;
+			m_Stats.blocksRejected += data.blocksRejected;
+			m_Stats.blocksAccepted += data.blocksAccepted;
+			m_Stats.pixelsExpanded += data.pixelsExpanded;
+			for (const std::vector<uint32_t>& bin : data.bins)
+			{
+				m_Stats.binEntries += bin.size();
+			}
+		}
+	}
+
+	void SoftwareRenderer::TransformVertices(const Camera& camera)
+	{
+		const Matrix viewProjection{ camera.viewMatrix * camera.projectionMatrix };
+		const float width{ static_cast<float>(m_Width) };
+		const float height{ static_cast<float>(m_Height) };
+
+		m_Workers.Run([&](int threadIndex)
+			{
+				const size_t threadCount{ static_cast<size_t>(m_Workers.GetThreadCount()) };
+				for (SoftwareMesh& mesh : m_Meshes)
+				{
+					if (!mesh.visible)
+					{
+						continue;
+					}
+					const size_t begin{ mesh.vertices.size() * threadIndex / threadCount };
+					const size_t end{ mesh.vertices.size() * (threadIndex + 1) / threadCount };
+
+					//VS of PosCol3D.fx, PosTrans3D.fx only uses the position and uv of it
+					const VertexShading::OutputStreams& output{ mesh.output };
+					VertexShading::Run({ mesh.world * viewProjection, mesh.world }, mesh.input, begin, end, !mesh.transparent, mesh.output);
+					for (size_t i{ begin }; i < end; ++i)
+					{
+						ShadedVertex& shaded{ mesh.shaded[i] };
+						const float clipW{ output.clipW[i] };
+						shaded.invW = clipW > 0.f ? 1.f / clipW : 0.f;
+						shaded.x = (output.clipX[i] * shaded.invW * 0.5f + 0.5f) * width;
+						shaded.y = (0.5f - output.clipY[i] * shaded.invW * 0.5f) * height;
+						shaded.z = output.clipZ[i] * shaded.invW;
+						shaded.uv = mesh.vertices[i].UV;
+						if (!mesh.transparent)
+						{
+							shaded.worldPosition = { output.worldX[i], output.worldY[i], output.worldZ[i] };
+							shaded.normal = { output.normalX[i], output.normalY[i], output.normalZ[i] };
+							shaded.tangent = { output.tangentX[i], output.tangentY[i], output.tangentZ[i] };
+						}
+					}
+					Clipping::ComputeOutcodes(&output.clipX[begin], &output.clipY[begin], &output.clipZ[begin], &output.clipW[begin], end - begin,
+						m_GuardBand, &mesh.outcodes[begin]);
+				}
+			});
+	}
+
+	void SoftwareRenderer::BinTriangles(int threadIndex)
+	{
+		ThreadData& data{ m_ThreadData[threadIndex] };
+		data.triangles.clear();
+		data.clippedVertices.clear();
+		data.trianglesClipped = 0;
+		for (std::vector<uint32_t>& bin : data.bins)
+		{
+			bin.clear();
+		}
+
+		//Every thread takes a contiguous run of all visible triangles. Tiles read the bins of thread 0 first,
+		//then thread 1 and so on, which keeps the submission order blending depends on
+		size_t triangleCount{};
+		for (const SoftwareMesh& mesh : m_Meshes)
+		{
+			triangleCount += mesh.visible ? mesh.indices.size() / 3 : 0;
+		}
+		if (threadIndex == 0)
+		{
+			m_Stats.triangles = triangleCount;
+		}
+		const size_t threadCount{ static_cast<size_t>(m_Workers.GetThreadCount()) };
+		const size_t begin{ triangleCount * threadIndex / threadCount };
+		const size_t end{ triangleCount * (threadIndex + 1) / threadCount };
+
+		size_t meshStart{};
+		for (uint32_t meshIndex{}; meshIndex < m_Meshes.size(); ++meshIndex)
+		{
+			const SoftwareMesh& mesh{ m_Meshes[meshIndex] };
+			if (!mesh.visible)
+			{
+				continue;
+			}
+			const size_t meshEnd{ meshStart + mesh.indices.size() / 3 };
+			const size_t first{ std::max(begin, meshStart) };
+			const size_t last{ std::min(end, meshEnd) };
+
+			for (size_t i{ first }; i < last; ++i)
+			{
+				const uint32_t* pIndices{ &mesh.indices[(i - meshStart) * 3] };
+				const uint8_t outcodes[3]{ mesh.outcodes[pIndices[0]], mesh.outcodes[pIndices[1]], mesh.outcodes[pIndices[2]] };
+				if (Clipping::IsOutside(outcodes[0], outcodes[1], outcodes[2]))
+				{
+					continue;
+				}
+				if (Clipping::NeedsClipping(outcodes[0], outcodes[1], outcodes[2]))
+				{
+					ClipTriangle(meshIndex, pIndices, outcodes[0] | outcodes[1] | outcodes[2], data);
+					continue;
+				}
+
+				Triangle triangle{ meshIndex, { pIndices[0], pIndices[1], pIndices[2] } };
+				if (SetupTriangle(mesh.shaded[pIndices[0]], mesh.shaded[pIndices[1]], mesh.shaded[pIndices[2]], triangle))
+				{
+					BinTriangle(triangle, data);
+				}
+			}
+			meshStart = meshEnd;
+		}
+	}
+
+	bool SoftwareRenderer::SetupTriangle(const ShadedVertex& vertex0, const ShadedVertex& vertex1, const ShadedVertex& vertex2, Triangle& triangle) const
+	{
+		const RasterKernel::ScreenVertex vertices[3]
+		{
+			{ vertex0.x, vertex0.y, vertex0.z, vertex0.invW },
+			{ vertex1.x, vertex1.y, vertex1.z, vertex1.invW },
+			{ vertex2.x, vertex2.y, vertex2.z, vertex2.invW }
+		};
+		return RasterKernel::Setup(vertices, { 0, 0, m_Width, m_Height }, m_Meshes[triangle.mesh].transparent ? Cull::None : m_Cull, triangle.setup,
+			m_Multisample && m_ShadingMode == ShadingMode::Forward);
+	}
+
+	void SoftwareRenderer::BinTriangle(const Triangle& triangle, ThreadData& data) const
+	{
+		const uint32_t triangleIndex{ static_cast<uint32_t>(data.triangles.size()) };
+		data.triangles.push_back(triangle);
+		const RasterKernel::TriangleSetup& setup{ triangle.setup };
+		for (int tileY{ setup.minY / tileSize }; tileY <= setup.maxY / tileSize; ++tileY)
+		{
+			for (int tileX{ setup.minX / tileSize }; tileX <= setup.maxX / tileSize; ++tileX)
+			{
+				//Skip tiles the bounds overlap but the triangle misses
+				if (RasterKernel::Overlaps(setup, GetTileRect(tileX, tileY)))
+				{
+					data.bins[static_cast<size_t>(tileY) * m_TilesX + tileX].push_back(triangleIndex);
+				}
+			}
+		}
+	}
+
+	void SoftwareRenderer::ClipTriangle(uint32_t meshIndex, const uint32_t* pIndices, uint8_t planes, ThreadData& data) const
+	{
+		constexpr int clippedFloats{ 4 + interpolatedFloats };
+		const SoftwareMesh& mesh{ m_Meshes[meshIndex] };
+		++data.trianglesClipped;
+
+		//Clip-space position followed by the interpolated run
+		float input[3][clippedFloats]{};
+		for (int i{}; i < 3; ++i)
+		{
+			const uint32_t index{ pIndices[i] };
+			input[i][0] = mesh.output.clipX[index];
+			input[i][1] = mesh.output.clipY[index];
+			input[i][2] = mesh.output.clipZ[index];
+			input[i][3] = mesh.output.clipW[index];
+			std::copy_n(&mesh.shaded[index].worldPosition.x, interpolatedFloats, &input[i][4]);
+		}
+
+		float polygon[Clipping::maxPolygonVertices][Clipping::maxFloats];
+		const int count{ Clipping::ClipTriangle(input[0], input[1], input[2], clippedFloats, planes, m_GuardBand, polygon) };
+		if (count < 3)
+		{
+			return;
+		}
+
+		const uint32_t first{ static_cast<uint32_t>(data.clippedVertices.size()) };
+		for (int i{}; i < count; ++i)
+		{
+			const RasterKernel::ScreenVertex screen{ Clipping::ToScreen(polygon[i], m_Width, m_Height) };
+			ShadedVertex& vertex{ data.clippedVertices.emplace_back() };
+			vertex.x = screen.x;
+			vertex.y = screen.y;
+			vertex.z = screen.z;
+			vertex.invW = screen.invW;
+			std::copy_n(&polygon[i][4], interpolatedFloats, &vertex.worldPosition.x);
+		}
+
+		for (int i{ 1 }; i + 1 < count; ++i)
+		{
+			Triangle triangle{ meshIndex, { first, first + i, first + i + 1 }, true };
+			if (SetupTriangle(data.clippedVertices[first], data.clippedVertices[first + i], data.clippedVertices[first + i + 1], triangle))
+			{
+				BinTriangle(triangle, data);
+			}
+		}
+	}
+
+	RasterKernel::Rect SoftwareRenderer::GetTileRect(int tileX, int tileY) const
+	{
+		return { tileX * tileSize, tileY * tileSize, std::min((tileX + 1) * tileSize, m_Width), std::min((tileY + 1) * tileSize, m_Height) };
+	}
+
+	void SoftwareRenderer::ForEachTile(void (SoftwareRenderer::*pFunction)(int, ThreadData&))
+	{
+		//Tiles are handed out one at a time, their cost varies too much for a fixed split
+		m_NextTile = 0;
+		const int tileCount{ m_TilesX * m_TilesY };
+		m_Workers.Run([this, tileCount, pFunction](int threadIndex)
+			{
+				ThreadData& data{ m_ThreadData[threadIndex] };
+				for (int tile{ m_NextTile++ }; tile < tileCount; tile = m_NextTile++)
+				{
+					(this->*pFunction)(tile, data);
+				}
+			});
+	}
+
+	void SoftwareRenderer::RasterizeTile(int tile, ThreadData& data)
+	{
+		const int tileX{ tile % m_TilesX };
+		const int tileY{ tile / m_TilesX };
+
+		std::fill(data.tileColor.begin(), data.tileColor.end(), Sampling::ColorRGBA{ m_ClearColor.r, m_ClearColor.g, m_ClearColor.b, 1.f });
+		data.tileDepth.Clear();
+		if (m_Multisample)
+		{
+			data.sampleDepth.Clear();
+			std::fill(data.sampleSlots.begin(), data.sampleSlots.end(), -1);
+			data.sampleColors.clear();
+		}
+		ClearTransparency(data);
+
+		for (const ThreadData& binner : m_ThreadData)
+		{
+			for (const uint32_t triangleIndex : binner.bins[tile])
+			{
+				DrawTriangle(binner.triangles[triangleIndex], binner, tileX, tileY, data);
+			}
+		}
+		if (m_Multisample)
+		{
+			ResolveSamples(data);
+		}
+		CompositeTransparency(data);
+		ResolveTile(tileX, tileY, data);
+	}
+
+	void SoftwareRenderer::RasterizeVisibilityTile(int tile, ThreadData& data)
+	{
+		const RasterKernel::Rect rect{ GetTileRect(tile % m_TilesX, tile / m_TilesX) };
+		for (int y{ rect.top }; y < rect.bottom; ++y)
+		{
+			const size_t row{ static_cast<size_t>(y) * m_Width };
+			std::fill(m_VisibilityIds.begin() + row + rect.left, m_VisibilityIds.begin() + row + rect.right, noTriangle);
+			std::fill(m_VisibilityDepth.begin() + row + rect.left, m_VisibilityDepth.begin() + row + rect.right, 1.f);
+		}
+
+		for (uint32_t thread{}; thread < m_ThreadData.size(); ++thread)
+		{
+			const ThreadData& binner{ m_ThreadData[thread] };
+			for (const uint32_t triangleIndex : binner.bins[tile])
+			{
+				const Triangle& triangle{ binner.triangles[triangleIndex] };
+				if (!m_Meshes[triangle.mesh].transparent)
+				{
+					DrawVisibility(triangle, thread << idThreadShift | triangleIndex, rect, data);
+				}
+			}
+		}
+	}
+
+	void SoftwareRenderer::DrawVisibility(const Triangle& triangle, uint32_t id, const RasterKernel::Rect& tile, ThreadData& data)
+	{
+		//Same depth as forward down to the bit, the winners are the same triangles
+		data.blocks.clear();
+		RasterKernel::Rasterize(triangle.setup, tile, data.blocks);
+		for (const RasterKernel::CoverageBlock& block : data.blocks)
+		{
+			for (int row{}; row < RasterKernel::blockSize; ++row)
+			{
+				const uint32_t rowMask{ static_cast<uint32_t>(block.mask >> (row * RasterKernel::blockSize)) & 0xFF };
+				if (!rowMask)
+				{
+					continue;
+				}
+
+				RasterKernel::Barycentrics8 barycentrics{};
+				RasterKernel::ComputeBarycentrics(triangle.setup, block.x, block.y + row, barycentrics);
+				const size_t rowStart{ static_cast<size_t>(block.y + row) * m_Width + block.x };
+				for (int lane{}; lane < RasterKernel::blockSize; ++lane)
+				{
+					if ((rowMask & (1u << lane)) && barycentrics.depth[lane] < m_VisibilityDepth[rowStart + lane])
+					{
+						m_VisibilityDepth[rowStart + lane] = barycentrics.depth[lane];
+						m_VisibilityIds[rowStart + lane] = id;
+					}
+				}
+			}
+		}
+	}
+
+	void SoftwareRenderer::ShadeVisibilityRows(int rowPair, ThreadData& data)
+	{
+		constexpr int stripWidth{ RasterKernel::blockSize };
+		const int top{ rowPair * 2 };
+		const Sampling::ColorRGBA clearColor{ m_ClearColor.r, m_ClearColor.g, m_ClearColor.b, 1.f };
+
+		for (int left{}; left < m_Width; left += stripWidth)
+		{
+			//Pixels off the screen and background ones need nothing
+			uint32_t ids[2][stripWidth]{};
+			uint32_t pending{};
+			for (int row{}; row < 2; ++row)
+			{
+				for (int lane{}; lane < stripWidth; ++lane)
+				{
+					const int x{ left + lane };
+					const int y{ top + row };
+					ids[row][lane] = x < m_Width && y < m_Height ? m_VisibilityIds[static_cast<size_t>(y) * m_Width + x] : noTriangle;
+					if (ids[row][lane] != noTriangle)
+					{
+						pending |= 1u << (row * stripWidth + lane);
+					}
+					else if (x < m_Width && y < m_Height)
+					{
+						m_ShadedColor[static_cast<size_t>(y) * m_Width + x] = clearColor;
+					}
+				}
+			}
+
+			//One interpolation per triangle in the strip, at the same pixels forward interpolates, so the result is the same
+			while (pending)
+			{
+				const int first{ std::countr_zero(pending) };
+				const uint32_t id{ ids[first / stripWidth][first % stripWidth] };
+				const ThreadData& binner{ m_ThreadData[id >> idThreadShift] };
+				const Triangle& triangle{ binner.triangles[id & ((1u << idThreadShift) - 1)] };
+				const SoftwareMesh& mesh{ m_Meshes[triangle.mesh] };
+				const ShadedVertex* pVertices{ triangle.clipped ? binner.clippedVertices.data() : mesh.shaded.data() };
+
+				RasterKernel::Barycentrics8 barycentrics[2]{};
+				alignas(32) float attributes[2][interpolatedFloats][8]{};
+				for (int row{}; row < 2; ++row)
+				{
+					RasterKernel::ComputeBarycentrics(triangle.setup, left, top + row, barycentrics[row]);
+					RasterKernel::Interpolate(&pVertices[triangle.vertices[0]].worldPosition.x, &pVertices[triangle.vertices[1]].worldPosition.x,
+						&pVertices[triangle.vertices[2]].worldPosition.x, interpolatedFloats, barycentrics[row], attributes[row]);
+				}
+				const auto getUV = [&](int row, int lane)
+				{
+					return Vector2{ attributes[row][uvAttribute][lane], attributes[row][uvAttribute + 1][lane] };
+				};
+
+				for (uint32_t remaining{ pending }; remaining; remaining &= remaining - 1)
+				{
+					const int pixel{ std::countr_zero(remaining) };
+					const int row{ pixel / stripWidth };
+					const int lane{ pixel % stripWidth };
+					if (ids[row][lane] != id)
+					{
+						continue;
+					}
+					pending &= ~(1u << pixel);
+					++data.pixelsShaded;
+
+					//Derivatives of the 2x2 quad the pixel is in, like the GPU and the forward path take them
+					const int quadLane{ lane & ~1 };
+					const Vector2 ddx{ getUV(0, quadLane + 1) - getUV(0, quadLane) };
+					const Vector2 ddy{ getUV(1, quadLane) - getUV(0, quadLane) };
+
+					ShadedVertex vertex{};
+					float* pPixelAttributes{ &vertex.worldPosition.x };
+					for (int attribute{}; attribute < interpolatedFloats; ++attribute)
+					{
+						pPixelAttributes[attribute] = attributes[row][attribute][lane];
+					}
+					m_ShadedColor[static_cast<size_t>(top + row) * m_Width + left + lane] = ShadeOpaque(mesh, vertex, ddx, ddy);
+				}
+			}
+		}
+	}
+
+	void SoftwareRenderer::BlendTransparentTile(int tile, ThreadData& data)
+	{
+		const int tileX{ tile % m_TilesX };
+		const int tileY{ tile / m_TilesX };
+		const RasterKernel::Rect rect{ GetTileRect(tileX, tileY) };
+		for (int y{ rect.top }; y < rect.bottom; ++y)
+		{
+			const size_t row{ static_cast<size_t>(y) * m_Width };
+			const size_t tileRow{ static_cast<size_t>(y - rect.top) * tileSize };
+			std::copy(m_ShadedColor.begin() + row + rect.left, m_ShadedColor.begin() + row + rect.right, data.tileColor.begin() + tileRow);
+		}
+		//The part of the tile outside the screen stays cleared, no triangle gets there
+		data.tileDepth.Clear();
+		for (int y{ rect.top }; y < rect.bottom; ++y)
+		{
+			const size_t row{ static_cast<size_t>(y) * m_Width };
+			for (int x{ rect.left }; x < rect.right; ++x)
+			{
+				data.tileDepth.Write(x - rect.left, y - rect.top, data.tileDepth.ToKey(m_VisibilityDepth[row + x]));
+			}
+		}
+		data.tileDepth.UpdateBlocks();
+		ClearTransparency(data);
+
+		for (const ThreadData& binner : m_ThreadData)
+		{
+			for (const uint32_t triangleIndex : binner.bins[tile])
+			{
+				const Triangle& triangle{ binner.triangles[triangleIndex] };
+				if (m_Meshes[triangle.mesh].transparent)
+				{
+					DrawTriangle(triangle, binner, tileX, tileY, data);
+				}
+			}
+		}
+		CompositeTransparency(data);
+		ResolveTile(tileX, tileY, data);
+	}
+
+	void SoftwareRenderer::ClearTransparency(ThreadData& data) const
+	{
+		switch (m_TransparencyMode)
+		{
+		case TransparencyMode::Ordered:
+			break;
+		case TransparencyMode::WeightedBlended:
+			std::fill(data.tileAccumulation.begin(), data.tileAccumulation.end(), Sampling::ColorRGBA{});
+			std::fill(data.tileRevealage.begin(), data.tileRevealage.end(), 1.f);
+			break;
+		case TransparencyMode::Sorted:
+			std::fill(data.tileFragmentHeads.begin(), data.tileFragmentHeads.end(), -1);
+			data.fragments.clear();
+			break;
+		}
+	}
+
+	void SoftwareRenderer::CompositeTransparency(ThreadData& data) const
+	{
+		if (m_TransparencyMode == TransparencyMode::WeightedBlended)
+		{
+			for (size_t i{}; i < data.tileColor.size(); ++i)
+			{
+				//Untouched pixels keep their color exactly
+				if (data.tileRevealage[i] < 1.f || data.tileAccumulation[i].a > 0.f)
+				{
+					data.tileColor[i] = Transparency::Composite(data.tileAccumulation[i], data.tileRevealage[i], data.tileColor[i]);
+				}
+			}
+		}
+		else if (m_TransparencyMode == TransparencyMode::Sorted)
+		{
+			std::vector<const Fragment*> pixelFragments{};
+			for (size_t i{}; i < data.tileColor.size(); ++i)
+			{
+				pixelFragments.clear();
+				for (int fragment{ data.tileFragmentHeads[i] }; fragment >= 0; fragment = data.fragments[fragment].next)
+				{
+					pixelFragments.push_back(&data.fragments[fragment]);
+				}
+				if (pixelFragments.empty())
+				{
+					continue;
+				}
+
+				//The list runs newest first, the stable sort keeps submission order between equal depths
+				std::reverse(pixelFragments.begin(), pixelFragments.end());
+				std::stable_sort(pixelFragments.begin(), pixelFragments.end(), [](const Fragment* pA, const Fragment* pB) { return pA->depth > pB->depth; });
+				Sampling::ColorRGBA& target{ data.tileColor[i] };
+				for (const Fragment* pFragment : pixelFragments)
+				{
+					target = Sampling::ColorRGBA::Lerp(target, pFragment->color, pFragment->color.a);
+				}
+				target.a = 0.f;
+			}
+		}
+	}
+
+	void SoftwareRenderer::ResolveSamples(ThreadData& data) const
+	{
+		//A box filter over the linear samples, what ResolveSubresource does with an _SRGB target
+		for (size_t pixel{}; pixel < data.sampleSlots.size(); ++pixel)
+		{
+			const int slot{ data.sampleSlots[pixel] };
+			if (slot < 0)
+			{
+				continue;
+			}
+			Sampling::ColorRGBA sum{};
+			for (const Sampling::ColorRGBA& sample : data.sampleColors[slot])
+			{
+				sum += sample;
+			}
+			data.tileColor[pixel] = sum * (1.f / RasterKernel::sampleCount);
+			++data.pixelsExpanded;
+		}
+	}
+
+	void SoftwareRenderer::ResolveTile(int tileX, int tileY, const ThreadData& data)
+	{
+		//The render target is _SRGB
+		const int left{ tileX * tileSize };
+		const int top{ tileY * tileSize };
+		const int width{ std::min(tileSize, m_Width - left) };
+		const int height{ std::min(tileSize, m_Height - top) };
+		for (int y{}; y < height; ++y)
+		{
+			ColorConversion::LinearToSrgb(&data.tileColor[static_cast<size_t>(y) * tileSize].r,
+				&m_Pixels[(static_cast<size_t>(top + y) * m_Width + left) * 4], width);
+		}
+	}
+
+	void SoftwareRenderer::DrawTriangle(const Triangle& triangle, const ThreadData& binner, int tileX, int tileY, ThreadData& data) const
+	{
+		const SoftwareMesh& mesh{ m_Meshes[triangle.mesh] };
+		const ShadedVertex* pVertices{ triangle.clipped ? binner.clippedVertices.data() : mesh.shaded.data() };
+		const ShadedVertex& v0{ pVertices[triangle.vertices[0]] };
+		const ShadedVertex& v1{ pVertices[triangle.vertices[1]] };
+		const ShadedVertex& v2{ pVertices[triangle.vertices[2]] };
+		const RasterKernel::TriangleSetup& setup{ triangle.setup };
+		const RasterKernel::Rect tile{ GetTileRect(tileX, tileY) };
+
+		//The transparent effect only reads the uv at the end of the run
+		const int attributeOffset{ mesh.transparent ? uvAttribute : 0 };
+		const int attributeCount{ interpolatedFloats - attributeOffset };
+
+		//Samples take the depth of the triangle's plane at their position, the attributes of the pixel center
+		const bool multisample{ m_Multisample && m_ShadingMode == ShadingMode::Forward };
+		float sampleDepthOffsets[RasterKernel::sampleCount]{};
+		if (multisample)
+		{
+			float slopeX{};
+			float slopeY{};
+			RasterKernel::ComputeDepthSlopes(setup, slopeX, slopeY);
+			for (int sample{}; sample < RasterKernel::sampleCount; ++sample)
+			{
+				sampleDepthOffsets[sample] = (slopeX * RasterKernel::sampleOffsets[sample][0] + slopeY * RasterKernel::sampleOffsets[sample][1])
+					/ RasterKernel::subpixelScale;
+			}
+		}
+
+		DepthBuffer& depthBuffer{ data.tileDepth };
+		data.blocks.clear();
+		data.sampleBlocks.clear();
+		if (multisample)
+		{
+			RasterKernel::RasterizeSamples(setup, tile, data.sampleBlocks);
+		}
+		else
+		{
+			RasterKernel::Rasterize(setup, tile, data.blocks);
+		}
+		const size_t blockCount{ multisample ? data.sampleBlocks.size() : data.blocks.size() };
+		for (size_t blockIndex{}; blockIndex < blockCount; ++blockIndex)
+		{
+			const RasterKernel::CoverageBlock& block{ multisample ? data.sampleBlocks[blockIndex].pixels : data.blocks[blockIndex] };
+			const int blockX{ (block.x - tile.left) / RasterKernel::blockSize };
+			const int blockY{ (block.y - tile.top) / RasterKernel::blockSize };
+			DepthBuffer::BlockTest blockTest{ DepthBuffer::BlockTest::Partial };
+			if (m_HierarchicalDepth && !multisample)
+			{
+				float minDepth{};
+				float maxDepth{};
+				RasterKernel::ComputeDepthBounds(setup, block.x, block.y, minDepth, maxDepth);
+				blockTest = depthBuffer.TestBlock(blockX, blockY, minDepth, maxDepth);
+				++data.blocksTested;
+				if (blockTest == DepthBuffer::BlockTest::Rejected)
+				{
+					++data.blocksRejected;
+					continue;
+				}
+				data.blocksAccepted += blockTest == DepthBuffer::BlockTest::Accepted ? 1 : 0;
+			}
+			bool depthWritten{};
+
+			//Two rows at a time make four 2x2 quads like the GPU, uv differences inside a quad are the ddx and ddy that pick the mip
+			for (int row{}; row < RasterKernel::blockSize; row += 2)
+			{
+				const uint64_t rowsMask{ (block.mask >> (row * RasterKernel::blockSize)) & 0xFFFF };
+				if (!rowsMask)
+				{
+					continue;
+				}
+
+				RasterKernel::Barycentrics8 barycentrics[2]{};
+				alignas(32) float attributes[2][interpolatedFloats][8]{};
+				for (int i{}; i < 2; ++i)
+				{
+					RasterKernel::ComputeBarycentrics(setup, block.x, block.y + row + i, barycentrics[i]);
+					RasterKernel::Interpolate(&v0.worldPosition.x + attributeOffset, &v1.worldPosition.x + attributeOffset,
+						&v2.worldPosition.x + attributeOffset, attributeCount, barycentrics[i], attributes[i] + attributeOffset);
+				}
+
+				for (int quad{}; quad < RasterKernel::blockSize / 2; ++quad)
+				{
+					const int coverage{ static_cast<int>(((rowsMask >> (quad * 2)) & 3) | (((rowsMask >> (RasterKernel::blockSize + quad * 2)) & 3) << 2)) };
+					if (!coverage)
+					{
+						continue;
+					}
+
+					const int lane{ quad * 2 };
+					const auto getUV = [&](int quadRow, int pixelLane)
+					{
+						return Vector2{ attributes[quadRow][uvAttribute][pixelLane], attributes[quadRow][uvAttribute + 1][pixelLane] };
+					};
+					const Vector2 ddx{ getUV(0, lane + 1) - getUV(0, lane) };
+					const Vector2 ddy{ getUV(1, lane) - getUV(0, lane) };
+
+					for (int i{}; i < 4; ++i)
+					{
+						if (!(coverage & (1 << i)))
+						{
+							continue;
+						}
+						const int quadRow{ i >> 1 };
+						const int pixelLane{ lane + (i & 1) };
+						const float depth{ barycentrics[quadRow].depth[pixelLane] };
+						const int pixelX{ block.x + pixelLane - tile.left };
+						const int pixelY{ block.y + row + quadRow - tile.top };
+						const size_t index{ static_cast<size_t>(pixelY) * tileSize + pixelX };
+
+						//Neither shader writes depth, so the test can run before shading
+						uint32_t depthKey{};
+						uint32_t covered{ allSamples }; //multisampling only
+						uint32_t samples{}; //covered and passing
+						uint32_t sampleKeys[RasterKernel::sampleCount]{};
+						if (multisample)
+						{
+							const int bit{ (row + quadRow) * RasterKernel::blockSize + pixelLane };
+							covered = 0;
+							for (int sample{}; sample < RasterKernel::sampleCount; ++sample)
+							{
+								covered |= ((data.sampleBlocks[blockIndex].samples[sample] >> bit) & 1) << sample;
+								sampleKeys[sample] = data.sampleDepth.ToKey(depth + sampleDepthOffsets[sample]);
+								if ((covered & (1u << sample))
+									&& data.sampleDepth.Passes(pixelX * 2 + (sample & 1), pixelY * 2 + (sample >> 1), sampleKeys[sample]))
+								{
+									samples |= 1u << sample;
+								}
+							}
+							if (!samples)
+							{
+								continue;
+							}
+						}
+						else
+						{
+							depthKey = depthBuffer.ToKey(depth);
+							if (blockTest != DepthBuffer::BlockTest::Accepted && !depthBuffer.Passes(pixelX, pixelY, depthKey))
+							{
+								continue;
+							}
+						}
+						++data.pixelsShaded;
+
+						ShadedVertex pixel{};
+						float* pPixelAttributes{ &pixel.worldPosition.x };
+						if (covered == allSamples)
+						{
+							for (int attribute{ attributeOffset }; attribute < interpolatedFloats; ++attribute)
+							{
+								pPixelAttributes[attribute] = attributes[quadRow][attribute][pixelLane];
+							}
+						}
+						else
+						{
+							//Centroid: the center may be outside the triangle and extrapolate far off, take the first covered sample
+							float weights[3]{};
+							RasterKernel::ComputeSampleBarycentrics(setup, block.x + pixelLane, block.y + row + quadRow, std::countr_zero(covered), weights);
+							const float* pAttributes[3]{ &v0.worldPosition.x, &v1.worldPosition.x, &v2.worldPosition.x };
+							for (int attribute{ attributeOffset }; attribute < interpolatedFloats; ++attribute)
+							{
+								pPixelAttributes[attribute] = weights[0] * pAttributes[0][attribute] + weights[1] * pAttributes[1][attribute]
+									+ weights[2] * pAttributes[2][attribute];
+							}
+						}
+
+						Sampling::ColorRGBA& target{ data.tileColor[index] };
+						if (mesh.transparent)
+						{
+							//PS of PosTrans3D.fx, blended src_alpha / inv_src_alpha without depth write, alpha blends to zero
+							Sampling::ColorRGBA source{ Sample(mesh.diffuse, m_SamplerState, pixel.uv, ddx, ddy) };
+							if (m_TransparencyMode == TransparencyMode::Ordered && multisample)
+							{
+								StoreSamples(data, index, samples, source, true);
+							}
+							else if (m_TransparencyMode == TransparencyMode::Ordered)
+							{
+								target = Sampling::ColorRGBA::Lerp(target, source, source.a);
+								target.a = 0.f;
+							}
+							else if (m_TransparencyMode == TransparencyMode::WeightedBlended)
+							{
+								//The lists and sums are per pixel, a partly covered pixel gets the covered part of the alpha
+								source.a *= multisample ? static_cast<float>(std::popcount(samples)) / RasterKernel::sampleCount : 1.f;
+								//View depth is the interpolated w, SV_Position.w in the pixel shader
+								const RasterKernel::Barycentrics8& weights{ barycentrics[quadRow] };
+								const float viewDepth{ weights.weights[0][pixelLane] / v0.invW + weights.weights[1][pixelLane] / v1.invW
+									+ weights.weights[2][pixelLane] / v2.invW };
+								Transparency::Accumulate(data.tileAccumulation[index], data.tileRevealage[index], source, viewDepth);
+							}
+							else
+							{
+								source.a *= multisample ? static_cast<float>(std::popcount(samples)) / RasterKernel::sampleCount : 1.f;
+								data.fragments.push_back({ source, depth, data.tileFragmentHeads[index] });
+								data.tileFragmentHeads[index] = static_cast<int>(data.fragments.size() - 1);
+							}
+						}
+						else if (multisample)
+						{
+							for (int sample{}; sample < RasterKernel::sampleCount; ++sample)
+							{
+								if (samples & (1u << sample))
+								{
+									data.sampleDepth.Write(pixelX * 2 + (sample & 1), pixelY * 2 + (sample >> 1), sampleKeys[sample]);
+								}
+							}
+							StoreSamples(data, index, samples, ShadeOpaque(mesh, pixel, ddx, ddy), false);
+						}
+						else
+						{
+							depthBuffer.Write(pixelX, pixelY, depthKey);
+							depthWritten = true;
+							target = ShadeOpaque(mesh, pixel, ddx, ddy);
+						}
+					}
+				}
+			}
+
+			if (depthWritten && m_HierarchicalDepth)
+			{
+				depthBuffer.UpdateBlock(blockX, blockY);
+			}
+		}
+	}
+
+	void SoftwareRenderer::StoreSamples(ThreadData& data, size_t pixel, uint32_t samples, const Sampling::ColorRGBA& color, bool blend) const
+	{
+		const auto store = [&color, blend](Sampling::ColorRGBA& target)
+		{
+			if (blend)
+			{
+				target = Sampling::ColorRGBA::Lerp(target, color, color.a);
+				target.a = 0.f;
+			}
+			else
+			{
+				target = color;
+			}
+		};
+
+		//Covering every sample keeps one color, an opaque triangle doing so merges split samples again
+		int& slot{ data.sampleSlots[pixel] };
+		if (samples == allSamples && (slot < 0 || !blend))
+		{
+			store(data.tileColor[pixel]);
+			slot = -1;
+			return;
+		}
+
+		if (slot < 0)
+		{
+			slot = static_cast<int>(data.sampleColors.size());
+			data.sampleColors.emplace_back().fill(data.tileColor[pixel]);
+		}
+		for (int sample{}; sample < RasterKernel::sampleCount; ++sample)
+		{
+			if (samples & (1u << sample))
+			{
+				store(data.sampleColors[slot][sample]);
+			}
+		}
+	}
+
+	Sampling::ColorRGBA SoftwareRenderer::ShadeOpaque(const SoftwareMesh& mesh, const ShadedVertex& pixel, const Vector2& ddx, const Vector2& ddy) const
+	{
+		//PS of PosCol3D.fx, the interpolated normal and tangent are not renormalized there either
+		const Vector3 viewDirection{ (pixel.worldPosition - m_CameraOrigin).Normalized() };
+		const Vector3 binormal{ Vector3::Cross(pixel.normal, pixel.tangent).Normalized() };
+
+		const Sampling::ColorRGBA normalSample{ Sample(mesh.normal, m_SamplerState, pixel.uv, ddx, ddy) };
+		Vector3 sampledNormal{};
+		if (mesh.twoChannelNormals)
+		{
+			const float x{ normalSample.r * 2.f - 1.f };
+			const float y{ normalSample.g * 2.f - 1.f };
+			sampledNormal = Vector3{ x, y, sqrtf(Saturate(1.f - x * x - y * y)) }.Normalized();
+		}
+		else
+		{
+			sampledNormal = Vector3{ normalSample.r, normalSample.g, normalSample.b } * 2.f - Vector3{ 1.f, 1.f, 1.f };
+		}
+		sampledNormal = pixel.tangent * sampledNormal.x + binormal * sampledNormal.y + pixel.normal * sampledNormal.z;
+
+		const float observedArea{ Saturate(Vector3::Dot(sampledNormal, -lightDirection)) };
+		const Sampling::ColorRGBA diffuse{ Sample(mesh.diffuse, m_SamplerState, pixel.uv, ddx, ddy) * (kd / PI * lightIntensity) };
+
+		const Vector3 reflected{ Vector3::Reflect(lightDirection, sampledNormal) };
+		const float reflectAngle{ Saturate(Vector3::Dot(reflected, -viewDirection)) };
+
+		Sampling::ColorRGBA specular{};
+		if (!mesh.material.levels.empty())
+		{
+			const Sampling::ColorRGBA material{ Sample(mesh.material, m_SamplerState, pixel.uv, ddx, ddy) };
+			const Vector4 values{ material.r, material.g, material.b, material.a };
+			const float exponent{ Vector4::Dot(values, mesh.glossMask) * shininess };
+			const float phong{ powf(reflectAngle, exponent) };
+			const float value{ Vector4::Dot(values, mesh.specularMask) * phong };
+			specular = { value, value, value, value };
+		}
+		else
+		{
+			const float exponent{ Sample(mesh.gloss, m_SamplerState, pixel.uv, ddx, ddy).r * shininess };
+			specular = Sample(mesh.specular, m_SamplerState, pixel.uv, ddx, ddy) * powf(reflectAngle, exponent);
+		}
+
+		return {
+			diffuse.r * observedArea + specular.r + ambient,
+			diffuse.g * observedArea + specular.g + ambient,
+			diffuse.b * observedArea + specular.b + ambient,
+			1.f };
+	}
+}
@@ -0,0 +1,252 @@
+#pragma once
+#include <array>
+#include <atomic>
+
+#include "MeshData.h"
+#include "Sampler.h"
+#include "RasterKernel.h"
+#include "Clipper.h"
+#include "DepthBuffer.h"
+#include "Transparency.h"
+#include "VertexProcessor.h"
+#include "WorkerPool.h"
+
+namespace dae
+{
+	struct Camera;
+
+	//Draws MeshData on the CPU the way PosCol3D.fx and PosTrans3D.fx draw it on the GPU, into an sRGB RGBA8 image.
+	//Triangles are binned into screen tiles and every tile is shaded start to finish by one worker,
+	//so workers never share a pixel and each tile's color and depth stay in that worker's cache.
+	class SoftwareRenderer final
+	{
+	public:
+		using Cull = RasterKernel::Cull;
+
+		//Ordered blends transparent triangles in submission order like the effect does, right only for sorted triangles.
+		//WeightedBlended is order independent (see Transparency.h), Sorted keeps every fragment of a pixel and
+		//blends them back to front, the exact reference. Both composite after a tile's last triangle, so opaque
+		//meshes have to be added before the transparent ones
+		enum class TransparencyMode
+		{
+			Ordered,
+			WeightedBlended,
+			Sorted
+		};
+
+		//Forward shades every fragment that passes the depth test when its triangle is drawn. VisibilityBuffer
+		//first rasterizes only triangle IDs and depth of the opaque meshes, then shades each covered pixel once
+		//in a pass over the screen. Transparent meshes are blended over the result the forward way in both
+		enum class ShadingMode
+		{
+			Forward,
+			VisibilityBuffer
+		};
+
+		struct Stats
+		{
+			float vertexMs{};
+			float binMs{};
+			float rasterMs{}; //shading, blending and the resolve to sRGB; IDs, blending and the resolve with a visibility buffer
+			float shadeMs{};  //visibility buffer only, the pass over the pixels
+			float totalMs{};
+			size_t triangles{};       //of the visible meshes
+			size_t trianglesBinned{}; //left after culling, clipped ones count every triangle of their fan
+			size_t trianglesClipped{}; //crossing the near or far plane or the guard band
+			size_t binEntries{};      //triangle-tile pairs
+			size_t pixelsShaded{}; //pixel shader invocations, both effects
+			size_t blocksTested{};   //8x8 blocks of triangles tested against the tile's block depth
+			size_t blocksRejected{}; //skipped whole
+			size_t blocksAccepted{}; //drawn without a per-pixel depth test
+			size_t pixelsExpanded{}; //multisampled pixels left with more than one color
+		};
+
+		static constexpr int tileSize{ 64 };
+
+		//0 starts one thread per hardware thread, with jobs it starts none and runs on theirs
+		SoftwareRenderer(int width, int height, int threadCount = 0, JobSystem* pJobs = nullptr);
+		~SoftwareRenderer() = default;
+
+		SoftwareRenderer(const SoftwareRenderer&) = delete;
+		SoftwareRenderer(SoftwareRenderer&&) noexcept = delete;
+		SoftwareRenderer& operator=(const SoftwareRenderer&) = delete;
+		SoftwareRenderer& operator=(SoftwareRenderer&&) noexcept = delete;
+
+		//Copies the geometry and builds mip chains of the decoded maps. Maps that came back as a path
+		//without pixels (cached or streamed) count as missing, load with neither to draw them.
+		//Meshes are drawn in the order they were added, translucent ones are alpha blended like PosTrans3D.fx
+		size_t AddMesh(const MeshData& data);
+		void SetWorldMatrix(size_t mesh, const Matrix& world);
+		void SetVisible(size_t mesh, bool visible);
+
+		//Opaque meshes only, the transparent effect never culls
+		void SetCullMode(Cull cull) { m_Cull = cull; }
+		void SetSamplerState(const Sampling::SamplerState& state) { m_SamplerState = state; }
+		//Linear, like the clear of the _SRGB render target
+		void SetClearColor(const ColorRGB& color) { m_ClearColor = color; }
+		void SetShadingMode(ShadingMode mode);
+		void SetTransparencyMode(TransparencyMode mode) { m_TransparencyMode = mode; }
+		//Precision of the depth test, the DXGI formats the GPU path could use
+		void SetDepthFormat(DepthBuffer::Format format);
+		//Tests whole 8x8 blocks of forward-drawn triangles against the min and max depth of the block first
+		void SetHierarchicalDepth(bool enabled) { m_HierarchicalDepth = enabled; }
+		//4x MSAA in forward shading: coverage and depth per sample, the pixel shader once per pixel at its center.
+		//A pixel keeps one color until triangles split its samples, only then it gets all four.
+		//The block depth test is off, the order-independent transparency modes weigh alpha by the covered samples
+		void SetMultisample(bool enabled);
+
+		void Render(const Camera& camera);
+
+		//RGBA8, sRGB encoded, rows tightly packed
+		const uint8_t* GetPixels() const { return m_Pixels.data(); }
+		int GetWidth() const { return m_Width; }
+		int GetHeight() const { return m_Height; }
+		int GetThreadCount() const { return m_Workers.GetThreadCount(); }
+		const Stats& GetStats() const { return m_Stats; }
+
+	private:
+		//Vertex shader output, screen position plus what the pixel shader interpolates.
+		//The screen position is only valid for vertices inside every clip plane
+		struct ShadedVertex
+		{
+			float x{}; //pixels
+			float y{};
+			float z{}; //depth, z / w
+			float invW{};
+			//Interpolated and clipped as one run of floats
+			Vector3 worldPosition{};
+			Vector3 normal{};
+			Vector3 tangent{};
+			Vector2 uv{};
+		};
+		static constexpr int interpolatedFloats{ 11 };
+		static constexpr int uvAttribute{ 9 }; //of uv.x in that run
+
+		struct SoftwareMesh
+		{
+			std::vector<Vertex> vertices{};
+			std::vector<uint32_t> indices{};
+			bool transparent{};
+			bool visible{ true };
+			Matrix world{};
+
+			Sampling::MipChainRGBA8 diffuse{};
+			Sampling::MipChainRGBA8 normal{};
+			bool twoChannelNormals{}; //x, y in rg, z is rebuilt
+			Sampling::MipChainRGBA8 specular{};
+			Sampling::MipChainRGBA8 gloss{};
+			Sampling::MipChainRGBA8 material{};
+			Vector4 glossMask{};
+			Vector4 specularMask{};
+
+			VertexShading::InputStreams input{};
+			//The clip-space positions feed the outcode pass and the clipper
+			VertexShading::OutputStreams output{};
+			std::vector<ShadedVertex> shaded{};
+			std::vector<uint8_t> outcodes{};
+		};
+
+		struct Triangle
+		{
+			uint32_t mesh{};
+			uint32_t vertices[3]{}; //into the mesh's shaded vertices, or the binning thread's clipped ones
+			bool clipped{};
+			RasterKernel::TriangleSetup setup{};
+		};
+
+		//A transparent fragment of the sorted reference, in a per-pixel list
+		struct Fragment
+		{
+			Sampling::ColorRGBA color{};
+			float depth{};
+			int next{ -1 };
+		};
+
+		static constexpr uint32_t allSamples{ (1u << RasterKernel::sampleCount) - 1 };
+
+		//Per worker, reused every frame
+		struct ThreadData
+		{
+			std::vector<Triangle> triangles{};
+			std::vector<std::vector<uint32_t>> bins{}; //per tile, indices into triangles
+			std::vector<ShadedVertex> clippedVertices{};
+			size_t trianglesClipped{};
+			std::vector<Sampling::ColorRGBA> tileColor{};
+			DepthBuffer tileDepth{};
+			//Order-independent transparency of the tile, depending on the mode
+			std::vector<Sampling::ColorRGBA> tileAccumulation{};
+			std::vector<float> tileRevealage{};
+			std::vector<int> tileFragmentHeads{};
+			std::vector<Fragment> fragments{};
+			std::vector<RasterKernel::CoverageBlock> blocks{};
+			//Multisampling, sample s of tile pixel (x, y) is at (2x + (s & 1), 2y + (s >> 1)) in the depth
+			std::vector<RasterKernel::SampleCoverageBlock> sampleBlocks{};
+			DepthBuffer sampleDepth{};
+			std::vector<int> sampleSlots{}; //per pixel into sampleColors, -1 while tileColor is the color of every sample
+			std::vector<std::array<Sampling::ColorRGBA, RasterKernel::sampleCount>> sampleColors{};
+			size_t pixelsExpanded{};
+			size_t pixelsShaded{};
+			size_t blocksTested{};
+			size_t blocksRejected{};
+			size_t blocksAccepted{};
+		};
+
+		int m_Width{};
+		int m_Height{};
+		int m_TilesX{};
+		int m_TilesY{};
+
+		Cull m_Cull{ Cull::None };
+		Sampling::SamplerState m_SamplerState{};
+		ColorRGB m_ClearColor{};
+		Vector3 m_CameraOrigin{};
+		Clipping::GuardBand m_GuardBand{};
+		ShadingMode m_ShadingMode{ ShadingMode::Forward };
+		TransparencyMode m_TransparencyMode{ TransparencyMode::Ordered };
+		bool m_HierarchicalDepth{ true };
+		bool m_Multisample{};
+		DepthBuffer::Format m_DepthFormat{ DepthBuffer::Format::Float32 };
+
+		std::vector<SoftwareMesh> m_Meshes{};
+		std::vector<uint8_t> m_Pixels{};
+
+		//Visibility buffer, whole screen. IDs are the binning thread above idThreadShift and the index into its triangles below,
+		//which leaves room for 255 threads
+		static constexpr int idThreadShift{ 24 };
+		static constexpr uint32_t noTriangle{ ~0u };
+		std::vector<uint32_t> m_VisibilityIds{};
+		std::vector<float> m_VisibilityDepth{};
+		std::vector<Sampling::ColorRGBA> m_ShadedColor{}; //linear, opaque meshes only
+
+		WorkerPool m_Workers;
+		std::vector<ThreadData> m_ThreadData{};
+		std::atomic<int> m_NextTile{};
+		Stats m_Stats{};
+
+		void TransformVertices(const Camera& camera);
+		void BinTriangles(int threadIndex);
+		//Hands out tiles one at a time to all workers
+		void ForEachTile(void (SoftwareRenderer::*pFunction)(int, ThreadData&));
+		void RasterizeTile(int tile, ThreadData& data);
+		void RasterizeVisibilityTile(int tile, ThreadData& data);
+		//Two rows of the screen, 8x2 strips of pixels share the interpolation of every triangle visible in them
+		void ShadeVisibilityRows(int rowPair, ThreadData& data);
+		void BlendTransparentTile(int tile, ThreadData& data);
+		void ClearTransparency(ThreadData& data) const;
+		//Blends what the order-independent modes gathered over the tile's color
+		void CompositeTransparency(ThreadData& data) const;
+		//Averages the samples of split pixels into the tile's color, the resolve of a multisampled target
+		void ResolveSamples(ThreadData& data) const;
+		void ResolveTile(int tileX, int tileY, const ThreadData& data);
+		bool SetupTriangle(const ShadedVertex& vertex0, const ShadedVertex& vertex1, const ShadedVertex& vertex2, Triangle& triangle) const;
+		void BinTriangle(const Triangle& triangle, ThreadData& data) const;
+		//Sets up and bins the fan of what is left, new vertices go to the thread's clipped vertices
+		void ClipTriangle(uint32_t mesh, const uint32_t* pIndices, uint8_t planes, ThreadData& data) const;
+		RasterKernel::Rect GetTileRect(int tileX, int tileY) const;
+		void DrawTriangle(const Triangle& triangle, const ThreadData& binner, int tileX, int tileY, ThreadData& data) const;
+		//Writes color to the samples of a pixel, or alpha blends it over them
+		void StoreSamples(ThreadData& data, size_t pixel, uint32_t samples, const Sampling::ColorRGBA& color, bool blend) const;
+		void DrawVisibility(const Triangle& triangle, uint32_t id, const RasterKernel::Rect& tile, ThreadData& data);
+		Sampling::ColorRGBA ShadeOpaque(const SoftwareMesh& mesh, const ShadedVertex& vertex, const Vector2& ddx, const Vector2& ddy) const;
+	};
+}
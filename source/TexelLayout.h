@@ -0,0 +1,171 @@
+#pragma once
+#include <cstdint>
+#include <cstring>
+#include <vector>
+#include <algorithm>
+
+//Memory orders for RGBA texels. Row-major is what SDL and D3D hand us, but a bilinear or
+//anisotropic footprint moving diagonally touches a new cache line on nearly every row there.
+namespace dae
+{
+	enum class TexelLayout
+	{
+		Linear,   //row-major
+		Block4x4, //4x4 texel blocks in row-major block order, one RGBA8 block is one 64 byte cache line
+		Morton    //Z-order inside 32x32 tiles, tiles in row-major order
+	};
+
+	namespace Tiling
+	{
+		constexpr int blockSize{ 4 };
+		constexpr int mortonTileSize{ 32 };
+
+		//Inserts a zero bit between each of the low 16 bits
+		constexpr uint32_t SpreadBits(uint32_t value)
+		{
+			value &= 0x0000FFFF;
+			value = (value | (value << 8)) & 0x00FF00FF;
+			value = (value | (value << 4)) & 0x0F0F0F0F;
+			value = (value | (value << 2)) & 0x33333333;
+			value = (value | (value << 1)) & 0x55555555;
+			return value;
+		}
+
+		constexpr uint32_t CompactBits(uint32_t value)
+		{
+			value &= 0x55555555;
+			value = (value | (value >> 1)) & 0x33333333;
+			value = (value | (value >> 2)) & 0x0F0F0F0F;
+			value = (value | (value >> 4)) & 0x00FF00FF;
+			value = (value | (value >> 8)) & 0x0000FFFF;
+			return value;
+		}
+
+		constexpr uint32_t MortonEncode(uint32_t x, uint32_t y)
+		{
+			return SpreadBits(x) | (SpreadBits(y) << 1);
+		}
+
+		constexpr void MortonDecode(uint32_t code, uint32_t& x, uint32_t& y)
+		{
+			x = CompactBits(code);
+			y = CompactBits(code >> 1);
+		}
+
+		constexpr int GetTileSize(TexelLayout layout)
+		{
+			switch (layout)
+			{
+			case TexelLayout::Block4x4: return blockSize;
+			case TexelLayout::Morton: return mortonTileSize;
+			default: return 1;
+			}
+		}
+
+		//Storage width/height, tiled layouts round up to whole tiles
+		constexpr int GetPaddedSize(TexelLayout layout, int size)
+		{
+			const int tileSize{ GetTileSize(layout) };
+			return (size + tileSize - 1) / tileSize * tileSize;
+		}
+
+		constexpr size_t GetTexelCount(TexelLayout layout, int width, int height)
+		{
+			return static_cast<size_t>(GetPaddedSize(layout, width)) * GetPaddedSize(layout, height);
+		}
+
+		//Index of texel (x, y) in storage, width is the unpadded width
+		constexpr size_t GetTexelIndex(TexelLayout layout, int x, int y, int width)
+		{
+			switch (layout)
+			{
+			case TexelLayout::Block4x4:
+			{
+				const size_t blocksPerRow{ static_cast<size_t>(GetPaddedSize(layout, width) / blockSize) };
+				const size_t block{ static_cast<size_t>(y >> 2) * blocksPerRow + static_cast<size_t>(x >> 2) };
+				return block * (blockSize * blockSize) + static_cast<size_t>((y & 3) * blockSize + (x & 3));
+			}
+			case TexelLayout::Morton:
+			{
+				//Coordinates are never negative here, unsigned keeps the divisions plain shifts
+				const uint32_t ux{ static_cast<uint32_t>(x) };
+				const uint32_t uy{ static_cast<uint32_t>(y) };
+				const size_t tilesPerRow{ static_cast<size_t>(GetPaddedSize(layout, width) / mortonTileSize) };
+				const size_t tile{ static_cast<size_t>(uy / mortonTileSize) * tilesPerRow + ux / mortonTileSize };
+				return tile * (mortonTileSize * mortonTileSize) + MortonEncode(ux % mortonTileSize, uy % mortonTileSize);
+			}
+			case TexelLayout::Linear:
+			default:
+				return static_cast<size_t>(y) * width + x;
+			}
+		}
+
+		//Reorders row-major RGBA texels into layout, padding is left zeroed
+		template<typename T>
+		std::vector<T> LinearToTiled(const T* pTexels, int width, int height, TexelLayout layout)
+		{
+			std::vector<T> tiled(GetTexelCount(layout, width, height) * 4);
+
+			switch (layout)
+			{
+			case TexelLayout::Block4x4:
+			{
+				//A block row is 4 contiguous texels in both layouts, copy it in one go
+				for (int y{}; y < height; ++y)
+				{
+					for (int x{}; x < width; x += blockSize)
+					{
+						const int count{ std::min(blockSize, width - x) };
+						memcpy(&tiled[GetTexelIndex(layout, x, y, width) * 4], pTexels + (static_cast<size_t>(y) * width + x) * 4, sizeof(T) * 4 * count);
+					}
+				}
+				break;
+			}
+			case TexelLayout::Morton:
+			{
+				//Spread x once per column, the y half only changes per row
+				uint32_t spreadX[mortonTileSize]{};
+				for (int i{}; i < mortonTileSize; ++i)
+				{
+					spreadX[i] = SpreadBits(i);
+				}
+
+				const size_t tilesPerRow{ static_cast<size_t>(GetPaddedSize(layout, width) / mortonTileSize) };
+				for (int y{}; y < height; ++y)
+				{
+					const uint32_t spreadY{ SpreadBits(y % mortonTileSize) << 1 };
+					const size_t tileRow{ static_cast<size_t>(y / mortonTileSize) * tilesPerRow };
+					const T* pRow{ pTexels + static_cast<size_t>(y) * width * 4 };
+					for (int x{}; x < width; ++x)
+					{
+						const size_t tile{ tileRow + static_cast<size_t>(x / mortonTileSize) };
+						const size_t index{ tile * (mortonTileSize * mortonTileSize) + (spreadX[x % mortonTileSize] | spreadY) };
+						memcpy(&tiled[index * 4], pRow + static_cast<size_t>(x) * 4, sizeof(T) * 4);
+					}
+				}
+				break;
+			}
+			case TexelLayout::Linear:
+			default:
+				memcpy(tiled.data(), pTexels, sizeof(T) * tiled.size());
+				break;
+			}
+
+			return tiled;
+		}
+
+		template<typename T>
+		std::vector<T> TiledToLinear(const T* pTexels, int width, int height, TexelLayout layout)
+		{
+			std::vector<T> linear(static_cast<size_t>(width) * height * 4);
+			for (int y{}; y < height; ++y)
+			{
+				for (int x{}; x < width; ++x)
+				{
+					memcpy(&linear[(static_cast<size_t>(y) * width + x) * 4], pTexels + GetTexelIndex(layout, x, y, width) * 4, sizeof(T) * 4);
+				}
+			}
+			return linear;
+		}
+	}
+}
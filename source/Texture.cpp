@@ -1,18 +1,21 @@
 #include "pch.h"
 #include "Texture.h"
 
-Texture::Texture(ID3D11Device* pDevice, const std::string& path)
+Texture::Texture(ID3D11Device* pDevice, int width, int height, int mipLevels, int arraySize, const D3D11_SUBRESOURCE_DATA* pInitData,
+	dae::ColorSpace colorSpace, dae::TexelFormat texelFormat)
 {
-	//Load texture image
-	SDL_Surface* pSurface = IMG_Load(path.c_str());
-
-	//Set texture settings for directX
-	const DXGI_FORMAT format{ DXGI_FORMAT_R8G8B8A8_UNORM };
+	//Set texture settings for directX, the sampler decodes _SRGB to linear before filtering.
+	//Two-channel normals are plain UNORM, the same layout BC5 compresses
+	DXGI_FORMAT format{ colorSpace == dae::ColorSpace::sRGB ? DXGI_FORMAT_R8G8B8A8_UNORM_SRGB : DXGI_FORMAT_R8G8B8A8_UNORM };
+	if (texelFormat == dae::TexelFormat::RG8)
+	{
+		format = DXGI_FORMAT_R8G8_UNORM;
+	}
 	D3D11_TEXTURE2D_DESC desc{};
-	desc.Width = pSurface->w;
-	desc.Height = pSurface->h;
-	desc.MipLevels = 1;
-	desc.ArraySize = 1;
+	desc.Width = width;
+	desc.Height = height;
+	desc.MipLevels = mipLevels;
+	desc.ArraySize = std::max(arraySize, 1);
 	desc.Format = format;
 	desc.SampleDesc.Count = 1;
 	desc.SampleDesc.Quality = 0;
@@ -21,13 +24,8 @@ Texture::Texture(ID3D11Device* pDevice, const std::string& path)
 	desc.CPUAccessFlags = 0;
 	desc.MiscFlags = 0;
 
-	D3D11_SUBRESOURCE_DATA initData{};
-	initData.pSysMem = pSurface->pixels;
-	initData.SysMemPitch = static_cast<UINT>(pSurface->pitch);
-	initData.SysMemSlicePitch = static_cast<UINT>(pSurface->h * pSurface->pitch);
-
 	//Create texture on GPU
-	HRESULT hr = pDevice->CreateTexture2D(&desc, &initData, &m_pTexture2D);
+	HRESULT hr = pDevice->CreateTexture2D(&desc, pInitData, &m_pTexture2D);
 	if (FAILED(hr))
 	{
 		return;
@@ -36,8 +34,17 @@ Texture::Texture(ID3D11Device* pDevice, const std::string& path)
 	//Set the shader resource view description
 	D3D11_SHADER_RESOURCE_VIEW_DESC SRVDesc{};
 	SRVDesc.Format = format;
-	SRVDesc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURE2D;
-	SRVDesc.Texture2D.MipLevels = 1;
+	if (arraySize > 0)
+	{
+		SRVDesc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURE2DARRAY;
+		SRVDesc.Texture2DArray.MipLevels = mipLevels;
+		SRVDesc.Texture2DArray.ArraySize = arraySize;
+	}
+	else
+	{
+		SRVDesc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURE2D;
+		SRVDesc.Texture2D.MipLevels = mipLevels;
+	}
 
 	//Create the shader resource view on GPU
 	hr = pDevice->CreateShaderResourceView(m_pTexture2D, &SRVDesc, &m_pSRV);
@@ -46,14 +53,20 @@ Texture::Texture(ID3D11Device* pDevice, const std::string& path)
 		return;
 	}
 
-	//Release sdl surface
-	SDL_FreeSurface(pSurface);
+	m_MipLevels = mipLevels;
+	m_ArraySize = arraySize;
 }
 
 Texture::~Texture()
 {
-	m_pTexture2D->Release();
-	m_pSRV->Release();
+	if (m_pSRV)
+	{
+		m_pSRV->Release();
+	}
+	if (m_pTexture2D)
+	{
+		m_pTexture2D->Release();
+	}
 }
 
 ID3D11Texture2D* Texture::GetTexture2D() const
@@ -64,4 +77,4 @@ ID3D11Texture2D* Texture::GetTexture2D() const
 ID3D11ShaderResourceView* Texture::GetSRV() const
 {
 	return m_pSRV;
-}
\ No newline at end of file
+}
@@ -1,17 +1,27 @@
 #pragma once
+#include "TextureData.h"
+
 class Texture final
 {
 public:
-	Texture(ID3D11Device* pDevice, const std::string& path);
+	//The D3D11 backend's texture. pInitData holds mipLevels entries per slice or is nullptr to fill it later.
+	//arraySize 0 creates a plain Texture2D, anything else a Texture2DArray view
+	Texture(ID3D11Device* pDevice, int width, int height, int mipLevels, int arraySize, const D3D11_SUBRESOURCE_DATA* pInitData,
+		dae::ColorSpace colorSpace, dae::TexelFormat texelFormat);
 	~Texture();
 
 	ID3D11Texture2D* GetTexture2D() const;
 	ID3D11ShaderResourceView* GetSRV() const;
+	int GetMipLevels() const { return m_MipLevels; }
+	int GetArraySize() const { return m_ArraySize; }
 
+	Texture(const Texture&) = delete;
 	Texture(Texture&&) noexcept = delete;
 	Texture& operator=(const Texture&) = delete;
 	Texture& operator=(Texture&&) noexcept = delete;
 private:
 	ID3D11Texture2D* m_pTexture2D{};
 	ID3D11ShaderResourceView* m_pSRV{};
-};
\ No newline at end of file
+	int m_MipLevels{};
+	int m_ArraySize{}; //0 for a plain Texture2D
+};
@@ -0,0 +1,217 @@
+#include "pch.h"
+#include "TextureCache.h"
+
+namespace dae
+{
+	TextureCache::TextureCache(size_t budgetBytes)
+	{
+		m_Stats.budgetBytes = budgetBytes;
+	}
+
+	std::shared_ptr<const TextureCache::Decode> TextureCache::RequestDecode(const std::string& path, JobSystem& jobs)
+	{
+		std::lock_guard lock{ m_Mutex };
+
+		if (m_PathLookup.contains(path))
+		{
+			++m_Stats.decodesSkipped;
+
+			auto pResident{ std::make_shared<Decode>() };
+			pResident->data.path = path;
+			return pResident;
+		}
+
+		const auto pending{ m_PendingDecodes.find(path) };
+		if (pending != m_PendingDecodes.end())
+		{
+			++m_Stats.decodesSkipped;
+			return pending->second;
+		}
+
+		auto pDecode{ std::make_shared<Decode>() };
+		jobs.Run([pDecode, path] { pDecode->data = TextureData::Load(path); }, &pDecode->counter);
+		m_PendingDecodes.emplace(path, pDecode);
+		return pDecode;
+	}
+
+	bool TextureCache::Contains(const std::string& path) const
+	{
+		std::lock_guard lock{ m_Mutex };
+		return m_PathLookup.contains(path);
+	}
+
+	TextureCache::Handle TextureCache::Acquire(RenderDevice& device, const TextureData& data)
+	{
+		std::lock_guard lock{ m_Mutex };
+
+		const auto byPath{ m_PathLookup.find(data.path) };
+		if (byPath != m_PathLookup.end())
+		{
+			++m_Stats.hits;
+			m_Entries.splice(m_Entries.begin(), m_Entries, byPath->second);
+			return byPath->second->pTexture;
+		}
+
+		m_PendingDecodes.erase(data.path);
+
+		if (!data.IsValid())
+		{
+			std::cout << "TextureCache: " << data.path << " is neither decoded nor resident\n";
+			return {};
+		}
+
+		//Same image under another name, alias it instead of uploading again.
+		//Only the low half is looked up, an entry whose high half differs is another image
+		const ContentHash hash{ HashContent(data) };
+		const auto [first, last]{ m_ContentLookup.equal_range(hash.low) };
+		for (auto byContent{ first }; byContent != last; ++byContent)
+		{
+			const EntryIterator entry{ byContent->second };
+			if (entry->hash != hash)
+			{
+				continue;
+			}
+
+			++m_Stats.contentHits;
+			entry->paths.push_back(data.path);
+			m_PathLookup.emplace(data.path, entry);
+			m_Entries.splice(m_Entries.begin(), m_Entries, entry);
+			return entry->pTexture;
+		}
+
+		if (first != last)
+		{
+			++m_Stats.hashCollisions;
+		}
+		++m_Stats.misses;
+
+		TextureDesc desc{};
+		desc.width = data.width;
+		desc.height = data.height;
+		desc.format = data.format;
+		desc.colorSpace = data.colorSpace;
+
+		Entry entry{};
+		entry.pTexture = device.Share(device.CreateTexture(desc, { data.pixels.data() }));
+		if (!entry.pTexture)
+		{
+			std::cout << "TextureCache: failed to upload " << data.path << "\n";
+			return {};
+		}
+		entry.hash = hash;
+		entry.bytes = data.pixels.size();
+		entry.paths.push_back(data.path);
+
+		m_Entries.push_front(std::move(entry));
+		m_PathLookup.emplace(data.path, m_Entries.begin());
+		m_ContentLookup.emplace(hash.low, m_Entries.begin());
+
+		m_Stats.residentBytes += m_Entries.front().bytes;
+		m_Stats.entries = m_Entries.size();
+
+		return m_Entries.front().pTexture;
+	}
+
+	void TextureCache::SetBudget(size_t budgetBytes)
+	{
+		{
+			std::lock_guard lock{ m_Mutex };
+			m_Stats.budgetBytes = budgetBytes;
+		}
+		Trim();
+	}
+
+	void TextureCache::Trim()
+	{
+		std::lock_guard lock{ m_Mutex };
+
+		//Decodes nobody picked up anymore are dead weight
+		m_PendingDecodes.clear();
+
+		auto it{ m_Entries.end() };
+		while (m_Stats.residentBytes > m_Stats.budgetBytes && it != m_Entries.begin())
+		{
+			--it;
+
+			//The cache's own handle is the only reference left
+			if (it->pTexture.use_count() > 1)
+			{
+				continue;
+			}
+
+			for (const std::string& path : it->paths)
+			{
+				m_PathLookup.erase(path);
+			}
+			const auto [first, last]{ m_ContentLookup.equal_range(it->hash.low) };
+			for (auto byContent{ first }; byContent != last; ++byContent)
+			{
+				if (byContent->second == it)
+				{
+					m_ContentLookup.erase(byContent);
+					break;
+				}
+			}
+			m_Stats.residentBytes -= it->bytes;
+			++m_Stats.evictions;
+
+			it = m_Entries.erase(it);
+		}
+
+		m_Stats.entries = m_Entries.size();
+	}
+
+	void TextureCache::Clear()
+	{
+		std::lock_guard lock{ m_Mutex };
+
+		m_PendingDecodes.clear();
+		m_PathLookup.clear();
+		m_ContentLookup.clear();
+		m_Entries.clear();
+
+		m_Stats.residentBytes = 0;
+		m_Stats.entries = 0;
+	}
+
+	TextureCache::Stats TextureCache::GetStats() const
+	{
+		std::lock_guard lock{ m_Mutex };
+		return m_Stats;
+	}
+
+	TextureCache::ContentHash TextureCache::HashContent(const TextureData& data)
+	{
+		//Two multiply-xorshift lanes over whole words with their own seeds, multipliers and shifts,
+		//dimensions, color space and format are part of the key
+		constexpr uint64_t lowMultiplier{ 0x9E3779B97F4A7C15ull };
+		constexpr uint64_t highMultiplier{ 0xC2B2AE3D27D4EB4Full };
+		const uint64_t header{ (static_cast<uint64_t>(data.width) << 32) | static_cast<uint32_t>(data.height) };
+		uint64_t low{ header };
+		uint64_t high{ ~header * highMultiplier };
+		const auto mix = [&low, &high](uint64_t value)
+		{
+			low = (low ^ value) * lowMultiplier;
+			low ^= low >> 29;
+			high = (high ^ value) * highMultiplier;
+			high ^= high >> 31;
+		};
+		mix(static_cast<uint64_t>(data.colorSpace));
+		mix(static_cast<uint64_t>(data.format));
+
+		const size_t wordCount{ data.pixels.size() / sizeof(uint64_t) };
+		const uint8_t* pBytes{ data.pixels.data() };
+		for (size_t i{}; i < wordCount; ++i)
+		{
+			uint64_t word{};
+			memcpy(&word, pBytes + i * sizeof(uint64_t), sizeof(uint64_t));
+			mix(word);
+		}
+		for (size_t i{ wordCount * sizeof(uint64_t) }; i < data.pixels.size(); ++i)
+		{
+			mix(pBytes[i]);
+		}
+
+		return { low ^ (low >> 32), high ^ (high >> 32) };
+	}
+}
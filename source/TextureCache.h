@@ -0,0 +1,97 @@
+#pragma once
+#include "TextureData.h"
+#include "RenderDevice.h"
+#include "JobSystem.h"
+#include <list>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+
+namespace dae
+{
+	//Shares uploaded textures between meshes, keyed by path and by pixel content.
+	//Entries nobody references stay resident until Trim pushes them out, least recently used first.
+	//Content is told apart by a 128 bit hash of the pixels, their size, color space and format. Entries keep no
+	//pixels of their own, the only CPU copy is the incoming decode, which is hashed once
+	class TextureCache final
+	{
+	public:
+		using Handle = SharedTexture;
+
+		struct Stats
+		{
+			uint64_t hits{};        //path already resident
+			uint64_t contentHits{}; //new path, identical pixels already resident
+			uint64_t hashCollisions{}; //the lookup half of the content hash matched but the whole hash did not
+			uint64_t misses{};      //had to upload
+			uint64_t decodesSkipped{};
+			uint64_t evictions{};
+			size_t residentBytes{};
+			size_t budgetBytes{};
+			size_t entries{};
+		};
+
+		//One decode, shared by every request of its path. data is final once counter is back at 0
+		struct Decode
+		{
+			JobSystem::Counter counter{};
+			TextureData data{};
+		};
+
+		explicit TextureCache(size_t budgetBytes);
+		~TextureCache() = default;
+
+		TextureCache(const TextureCache&) = delete;
+		TextureCache(TextureCache&&) noexcept = delete;
+		TextureCache& operator=(const TextureCache&) = delete;
+		TextureCache& operator=(TextureCache&&) noexcept = delete;
+
+		//Thread-safe. A resident path resolves to data without pixels, concurrent requests share one decode.
+		//The decode is a job on jobs, waiting for its counter with jobs.Wait runs other jobs meanwhile
+		std::shared_ptr<const Decode> RequestDecode(const std::string& path, JobSystem& jobs);
+		bool Contains(const std::string& path) const;
+
+		//Render thread. Data without pixels must have been resident when it was requested.
+		//Textures are created on device, which must outlive every handle
+		Handle Acquire(RenderDevice& device, const TextureData& data);
+
+		void SetBudget(size_t budgetBytes);
+		//Evicts unreferenced entries until the resident size fits the budget
+		void Trim();
+		//Drops every entry and pending decode, before the device they were created on goes away
+		void Clear();
+
+		Stats GetStats() const;
+
+	private:
+		//Two independent 64 bit lanes, low keys the content lookup
+		struct ContentHash
+		{
+			uint64_t low{};
+			uint64_t high{};
+
+			bool operator==(const ContentHash& other) const = default;
+		};
+
+		struct Entry
+		{
+			Handle pTexture{};
+			ContentHash hash{};
+			size_t bytes{};
+			std::vector<std::string> paths{};
+		};
+		using EntryIterator = std::list<Entry>::iterator;
+
+		//Most recently used in front
+		std::list<Entry> m_Entries{};
+		std::unordered_map<std::string, EntryIterator> m_PathLookup{};
+		//Colliding hashes share a bucket
+		std::unordered_multimap<uint64_t, EntryIterator> m_ContentLookup{};
+		std::unordered_map<std::string, std::shared_ptr<Decode>> m_PendingDecodes{};
+
+		mutable std::mutex m_Mutex{};
+		Stats m_Stats{};
+
+		static ContentHash HashContent(const TextureData& data);
+	};
+}
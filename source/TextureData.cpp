@@ -0,0 +1,46 @@
+#include "pch.h"
+#include "TextureData.h"
+#include <chrono>
+
+TextureData TextureData::Load(const std::string& path)
+{
+	const auto start{ std::chrono::steady_clock::now() };
+
+	TextureData data{};
+	data.path = path;
+
+	//Load texture image
+	SDL_Surface* pLoaded = IMG_Load(path.c_str());
+	if (!pLoaded)
+	{
+		std::cout << "Failed to load texture: " << path << "\n";
+		return data;
+	}
+
+	//PNG's can come in as RGB24, force the layout DXGI_FORMAT_R8G8B8A8_UNORM expects
+	SDL_Surface* pSurface = SDL_ConvertSurfaceFormat(pLoaded, SDL_PIXELFORMAT_RGBA32, 0);
+	SDL_FreeSurface(pLoaded);
+	if (!pSurface)
+	{
+		std::cout << "Failed to convert texture: " << path << "\n";
+		return data;
+	}
+
+	data.width = pSurface->w;
+	data.height = pSurface->h;
+
+	const size_t rowSize{ static_cast<size_t>(data.width) * 4 };
+	data.pixels.resize(rowSize * data.height);
+
+	const auto pSource = static_cast<const uint8_t*>(pSurface->pixels);
+	for (int y{}; y < data.height; ++y)
+	{
+		memcpy(data.pixels.data() + y * rowSize, pSource + y * pSurface->pitch, rowSize);
+	}
+
+	//Release sdl surface
+	SDL_FreeSurface(pSurface);
+
+	data.decodeTime = std::chrono::duration<float>(std::chrono::steady_clock::now() - start).count();
+	return data;
+}
@@ -0,0 +1,36 @@
+#pragma once
+#include <string>
+#include <vector>
+#include "ColorSpace.h"
+
+namespace dae
+{
+	//What one texel of TextureData holds
+	enum class TexelFormat : uint8_t
+	{
+		RGBA8,
+		RG8 //x and y of a tangent-space normal, z is rebuilt on use (see NormalCook)
+	};
+
+	constexpr int GetTexelSize(TexelFormat format)
+	{
+		return format == TexelFormat::RG8 ? 2 : 4;
+	}
+}
+
+//Decoded image in CPU memory, safe to create on any thread
+struct TextureData final
+{
+	std::string path{};
+	int width{};
+	int height{};
+	std::vector<uint8_t> pixels{}; //in format, rows tightly packed
+	dae::ColorSpace colorSpace{ dae::ColorSpace::Linear }; //sRGB maps are uploaded as _SRGB so sampling returns linear values
+	dae::TexelFormat format{ dae::TexelFormat::RGBA8 }; //Load always produces RGBA8
+
+	float decodeTime{}; //seconds spent in Load
+
+	bool IsValid() const { return !pixels.empty(); }
+
+	static TextureData Load(const std::string& path);
+};
@@ -0,0 +1,167 @@
+#include "pch.h"
+#include "TexturePacker.h"
+
+namespace dae
+{
+	namespace TexturePacker
+	{
+		TexturePack Pack(const std::vector<const TextureData*>& maps, int gutter)
+		{
+			TexturePack pack{};
+			if (maps.empty())
+			{
+				return pack;
+			}
+
+			const TextureData* pFirst{ maps[0] };
+			int sliceWidth{};
+			int sliceHeight{};
+			for (const TextureData* pMap : maps)
+			{
+				if (!pMap || !pMap->IsValid() || !pFirst->IsValid() || pMap->format != pFirst->format || pMap->colorSpace != pFirst->colorSpace)
+				{
+					std::cout << "TexturePacker: " << (pMap ? pMap->path : std::string{ "(null)" }) << " is not loaded or does not match "
+						<< (pFirst ? pFirst->path : std::string{ "(null)" }) << "\n";
+					return pack;
+				}
+				sliceWidth = std::max(sliceWidth, pMap->width);
+				sliceHeight = std::max(sliceHeight, pMap->height);
+			}
+			const int texelSize{ GetTexelSize(pFirst->format) };
+
+			//Footprint with the gutter, which shrinks where the slice has no room for it
+			struct Placement
+			{
+				int gutterX{};
+				int gutterY{};
+				int paddedWidth{};
+				int paddedHeight{};
+				int slice{};
+				int x{};
+				int y{};
+			};
+			std::vector<Placement> placements(maps.size());
+			std::vector<size_t> order(maps.size());
+			for (size_t i{}; i < maps.size(); ++i)
+			{
+				Placement& placement{ placements[i] };
+				placement.gutterX = std::min(gutter, (sliceWidth - maps[i]->width) / 2);
+				placement.gutterY = std::min(gutter, (sliceHeight - maps[i]->height) / 2);
+				placement.paddedWidth = maps[i]->width + placement.gutterX * 2;
+				placement.paddedHeight = maps[i]->height + placement.gutterY * 2;
+				order[i] = i;
+			}
+
+			//Shelf packing, tallest first keeps the shelves tight. Every slice only fills its last shelf
+			std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b)
+				{
+					return placements[a].paddedHeight > placements[b].paddedHeight;
+				});
+
+			struct Shelf
+			{
+				int y{};
+				int height{};
+				int cursorX{};
+				int maps{};
+			};
+			std::vector<Shelf> shelves{}; //current shelf of every slice
+
+			for (const size_t index : order)
+			{
+				Placement& placement{ placements[index] };
+				bool placed{};
+				for (size_t slice{}; slice < shelves.size() && !placed; ++slice)
+				{
+					Shelf& shelf{ shelves[slice] };
+					if (shelf.cursorX + placement.paddedWidth > sliceWidth || placement.paddedHeight > shelf.height)
+					{
+						if (shelf.y + shelf.height + placement.paddedHeight > sliceHeight)
+						{
+							continue;
+						}
+						shelf.y += shelf.height;
+						shelf.height = placement.paddedHeight;
+						shelf.cursorX = 0;
+					}
+
+					placement.slice = static_cast<int>(slice);
+					placement.x = shelf.cursorX;
+					placement.y = shelf.y;
+					shelf.cursorX += placement.paddedWidth;
+					++shelf.maps;
+					placed = true;
+				}
+
+				if (!placed)
+				{
+					placement.slice = static_cast<int>(shelves.size());
+					shelves.push_back({ 0, placement.paddedHeight, placement.paddedWidth, 1 });
+				}
+			}
+
+			const size_t sliceBytes{ static_cast<size_t>(sliceWidth) * sliceHeight * texelSize };
+			pack.slices.resize(shelves.size());
+			for (TextureData& slice : pack.slices)
+			{
+				slice.path = "array:" + pFirst->path;
+				slice.width = sliceWidth;
+				slice.height = sliceHeight;
+				slice.format = pFirst->format;
+				slice.colorSpace = pFirst->colorSpace;
+				slice.pixels.resize(sliceBytes);
+			}
+
+			//Copy every map in, the gutter repeats the opposite edge so it matches wrap addressing
+			TexturePackReport& report{ pack.report };
+			pack.regions.resize(maps.size());
+			for (size_t i{}; i < maps.size(); ++i)
+			{
+				const TextureData& map{ *maps[i] };
+				const Placement& placement{ placements[i] };
+				TextureData& slice{ pack.slices[placement.slice] };
+
+				const int left{ placement.x + placement.gutterX };
+				const int top{ placement.y + placement.gutterY };
+				for (int y{ -placement.gutterY }; y < map.height + placement.gutterY; ++y)
+				{
+					const int sourceY{ (y % map.height + map.height) % map.height };
+					const uint8_t* pSourceRow{ map.pixels.data() + static_cast<size_t>(sourceY) * map.width * texelSize };
+					uint8_t* pRow{ slice.pixels.data() + (static_cast<size_t>(top + y) * sliceWidth + left) * texelSize };
+
+					memcpy(pRow, pSourceRow, static_cast<size_t>(map.width) * texelSize);
+					for (int x{ 1 }; x <= placement.gutterX; ++x)
+					{
+						//Maps narrower than the gutter wrap more than once
+						const int leftX{ ((map.width - x) % map.width + map.width) % map.width };
+						const int rightX{ (x - 1) % map.width };
+						memcpy(pRow - static_cast<ptrdiff_t>(x) * texelSize, pSourceRow + static_cast<size_t>(leftX) * texelSize, texelSize);
+						memcpy(pRow + static_cast<size_t>(map.width + x - 1) * texelSize, pSourceRow + static_cast<size_t>(rightX) * texelSize, texelSize);
+					}
+				}
+
+				TextureRegion& region{ pack.regions[i] };
+				region.slice = placement.slice;
+				region.transform = Vector4{
+					static_cast<float>(map.width) / sliceWidth,
+					static_cast<float>(map.height) / sliceHeight,
+					static_cast<float>(left) / sliceWidth,
+					static_cast<float>(top) / sliceHeight };
+
+				report.sourceBytes += map.pixels.size();
+				report.gutterBytes += (static_cast<size_t>(placement.paddedWidth) * placement.paddedHeight
+					- static_cast<size_t>(map.width) * map.height) * texelSize;
+			}
+
+			report.maps = static_cast<int>(maps.size());
+			report.slices = static_cast<int>(pack.slices.size());
+			for (const Shelf& shelf : shelves)
+			{
+				report.sharedSlices += shelf.maps > 1;
+			}
+			report.packedBytes = sliceBytes * pack.slices.size();
+			report.unusedBytes = report.packedBytes - report.sourceBytes - report.gutterBytes;
+			return pack;
+		}
+	}
+}
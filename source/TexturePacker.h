@@ -0,0 +1,45 @@
+#pragma once
+#include "TextureData.h"
+
+namespace dae
+{
+	//Where a packed map ended up: an array slice plus the transform from its uv into the slice
+	struct TextureRegion
+	{
+		int slice{};
+		Vector4 transform{ 1.f, 1.f, 0.f, 0.f }; //xy scale, zw offset, applied to frac(uv)
+	};
+
+	struct TexturePackReport
+	{
+		int maps{};
+		int slices{};
+		int sharedSlices{}; //slices holding more than one map
+		size_t sourceBytes{};
+		size_t packedBytes{};
+		size_t gutterBytes{}; //wrapped edge texels around atlas regions
+		size_t unusedBytes{};
+
+		//Share of the packed texture that is not source texels
+		float GetWastePercent() const { return packedBytes > 0 ? 100.f * static_cast<float>(packedBytes - sourceBytes) / packedBytes : 0.f; }
+	};
+
+	struct TexturePack
+	{
+		std::vector<TextureData> slices{}; //all the same size, one Texture2DArray
+		std::vector<TextureRegion> regions{}; //one per input map, in input order
+		TexturePackReport report{};
+
+		bool IsValid() const { return !slices.empty(); }
+	};
+
+	namespace TexturePacker
+	{
+		constexpr int defaultGutter{ 4 };
+
+		//Maps must share format and color space. Slices take the size of the largest map: maps that size get
+		//a slice of their own, smaller ones are shelf packed into shared slices with a gutter of wrapped
+		//texels around them so filtering at their edges behaves like wrap addressing
+		TexturePack Pack(const std::vector<const TextureData*>& maps, int gutter = defaultGutter);
+	}
+}
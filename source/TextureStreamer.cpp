@@ -0,0 +1,467 @@
+#include "pch.h"
+#include "TextureStreamer.h"
+#include "Sampler.h"
+#include "NormalCook.h"
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+
+namespace dae
+{
+	namespace
+	{
+		//Cooked chain file: header, then every level tightly packed, finest first
+		struct ChainHeader
+		{
+			char magic[4]{ 'M', 'I', 'P', 'S' };
+			uint32_t version{ 3 };
+			uint32_t width{};
+			uint32_t height{};
+			uint32_t mipCount{};
+			uint16_t colorSpace{};
+			uint16_t format{};
+			uint64_t stamp{};
+		};
+
+		bool IsValidHeader(const ChainHeader& header, uint64_t stamp, ColorSpace colorSpace, TexelFormat format)
+		{
+			const ChainHeader expected{};
+			return memcmp(header.magic, expected.magic, sizeof(header.magic)) == 0 && header.version == expected.version
+				&& header.stamp == stamp && header.colorSpace == static_cast<uint16_t>(colorSpace) && header.format == static_cast<uint16_t>(format)
+				&& header.width > 0 && header.height > 0 && header.mipCount > 0;
+		}
+
+		std::vector<uint8_t> ReadLevel(const std::string& path, size_t offset, size_t bytes)
+		{
+			std::vector<uint8_t> texels(bytes);
+			std::ifstream file{ path, std::ios::binary };
+			if (!file.seekg(static_cast<std::streamoff>(offset)) || !file.read(reinterpret_cast<char*>(texels.data()), static_cast<std::streamsize>(bytes)))
+			{
+				std::cout << "TextureStreamer: failed to read " << bytes << " bytes from " << path << "\n";
+				return {};
+			}
+			return texels;
+		}
+
+		uint64_t HashString(const std::string& text)
+		{
+			//FNV-1a
+			uint64_t hash{ 0xCBF29CE484222325ull };
+			for (const char c : text)
+			{
+				hash = (hash ^ static_cast<uint8_t>(c)) * 0x100000001B3ull;
+			}
+			return hash;
+		}
+	}
+
+	size_t StreamedTexture::GetChainBytes(int first) const
+	{
+		size_t bytes{};
+		for (int mip{ first }; mip < mipCount; ++mip)
+		{
+			bytes += GetMipBytes(mip);
+		}
+		return bytes;
+	}
+
+	TextureStreamer::TextureStreamer(size_t budgetBytes, const std::string& cookDirectory)
+		: m_CookDirectory{ cookDirectory }
+		, m_BudgetBytes{ budgetBytes }
+	{
+	}
+
+	bool TextureStreamer::Prepare(const std::string& key, const std::vector<std::string>& sources, ColorSpace colorSpace, TexelFormat format)
+	{
+		const uint64_t stamp{ GetSourceStamp(sources) };
+		if (stamp == 0)
+		{
+			return false;
+		}
+
+		std::ifstream file{ GetCookPath(key), std::ios::binary };
+		ChainHeader header{};
+		if (!file.read(reinterpret_cast<char*>(&header), sizeof(header)) || !IsValidHeader(header, stamp, colorSpace, format))
+		{
+			return false;
+		}
+
+		//Only the tail is read, finer levels stay on disk until somebody needs them
+		StreamedTexture layout{};
+		layout.width = static_cast<int>(header.width);
+		layout.height = static_cast<int>(header.height);
+		layout.mipCount = static_cast<int>(header.mipCount);
+		layout.format = format;
+		const int tailMip{ GetTailMip(layout.width, layout.height, layout.mipCount) };
+
+		PreparedTail tail{ layout.width, layout.height, layout.mipCount, colorSpace, format };
+		tail.texels.resize(layout.GetChainBytes(tailMip));
+		const size_t offset{ sizeof(ChainHeader) + layout.GetChainBytes(0) - tail.texels.size() };
+		if (!file.seekg(static_cast<std::streamoff>(offset)) || !file.read(reinterpret_cast<char*>(tail.texels.data()), static_cast<std::streamsize>(tail.texels.size())))
+		{
+			return false;
+		}
+
+		std::lock_guard lock{ m_PreparedMutex };
+		m_Prepared[key] = std::move(tail);
+		return true;
+	}
+
+	bool TextureStreamer::Prepare(const std::string& key, const std::vector<std::string>& sources, const TextureData& data)
+	{
+		const uint64_t stamp{ GetSourceStamp(sources) };
+		if (!data.IsValid() || stamp == 0)
+		{
+			return false;
+		}
+
+		std::vector<std::vector<uint8_t>> levels{};
+		if (data.format == TexelFormat::RG8)
+		{
+			levels = NormalCook::BuildMipChain(data.pixels.data(), data.width, data.height);
+		}
+		else
+		{
+			Sampling::MipChainRGBA8 chain{ Sampling::MipChainRGBA8::Build(data.pixels.data(), data.width, data.height, TexelLayout::Linear, data.colorSpace) };
+			for (Sampling::MipLevel<uint8_t>& level : chain.levels)
+			{
+				levels.push_back(std::move(level.texels));
+			}
+		}
+
+		ChainHeader header{};
+		header.width = static_cast<uint32_t>(data.width);
+		header.height = static_cast<uint32_t>(data.height);
+		header.mipCount = static_cast<uint32_t>(levels.size());
+		header.colorSpace = static_cast<uint16_t>(data.colorSpace);
+		header.format = static_cast<uint16_t>(data.format);
+		header.stamp = stamp;
+
+		//Write under a temporary name so a crash never leaves a valid header over a partial chain.
+		//Two cooks of the same key both write a whole chain, whichever is renamed last wins
+		const std::string path{ GetCookPath(key) };
+		const std::string tempPath{ path + "." + std::to_string(m_CookCount.fetch_add(1, std::memory_order_relaxed)) + ".tmp" };
+		std::error_code error{};
+		std::filesystem::create_directories(m_CookDirectory, error);
+		{
+			std::ofstream file{ tempPath, std::ios::binary | std::ios::trunc };
+			file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+			for (const std::vector<uint8_t>& level : levels)
+			{
+				file.write(reinterpret_cast<const char*>(level.data()), static_cast<std::streamsize>(level.size()));
+			}
+			if (!file)
+			{
+				std::cout << "TextureStreamer: failed to cook " << key << " into " << path << "\n";
+				file.close();
+				std::filesystem::remove(tempPath, error);
+				return false;
+			}
+		}
+		std::filesystem::rename(tempPath, path, error);
+		if (error)
+		{
+			std::cout << "TextureStreamer: failed to cook " << key << " into " << path << "\n";
+			std::filesystem::remove(tempPath, error);
+			return false;
+		}
+
+		return Prepare(key, sources, data.colorSpace, data.format);
+	}
+
+	TextureStreamer::Handle TextureStreamer::Acquire(RenderDevice& device, const std::string& key)
+	{
+		for (const Handle& pTexture : m_Textures)
+		{
+			if (pTexture->key == key)
+			{
+				return pTexture;
+			}
+		}
+
+		PreparedTail tail{};
+		{
+			std::lock_guard lock{ m_PreparedMutex };
+			const auto prepared{ m_Prepared.find(key) };
+			if (prepared == m_Prepared.end())
+			{
+				std::cout << "TextureStreamer: " << key << " was never prepared\n";
+				return {};
+			}
+			tail = std::move(prepared->second);
+			m_Prepared.erase(prepared);
+		}
+
+		auto pTexture{ std::make_shared<StreamedTexture>() };
+		pTexture->key = key;
+		pTexture->width = tail.width;
+		pTexture->height = tail.height;
+		pTexture->mipCount = tail.mipCount;
+		pTexture->colorSpace = tail.colorSpace;
+		pTexture->format = tail.format;
+		pTexture->tailMip = GetTailMip(tail.width, tail.height, tail.mipCount);
+		pTexture->residentMip = pTexture->tailMip;
+		pTexture->wantedMip = pTexture->tailMip;
+
+		std::vector<const void*> levels{};
+		size_t offset{};
+		for (int mip{ pTexture->tailMip }; mip < pTexture->mipCount; ++mip)
+		{
+			levels.push_back(tail.texels.data() + offset);
+			offset += pTexture->GetMipBytes(mip);
+		}
+
+		TextureDesc desc{};
+		desc.width = pTexture->GetMipWidth(pTexture->tailMip);
+		desc.height = pTexture->GetMipHeight(pTexture->tailMip);
+		desc.mipLevels = static_cast<int>(levels.size());
+		desc.format = pTexture->format;
+		desc.colorSpace = pTexture->colorSpace;
+		pTexture->pTexture = device.Share(device.CreateTexture(desc, levels));
+		if (!pTexture->pTexture)
+		{
+			std::cout << "TextureStreamer: failed to upload the tail of " << key << "\n";
+			return {};
+		}
+
+		m_Textures.push_back(pTexture);
+		return pTexture;
+	}
+
+	void TextureStreamer::Clear()
+	{
+		//Destroying the futures waits for their reads
+		m_Textures.clear();
+		m_Stats = Stats{};
+		m_Stats.budgetBytes = m_BudgetBytes;
+	}
+
+	size_t TextureStreamer::GetFullChainBytes() const
+	{
+		size_t bytes{};
+		for (const Handle& pTexture : m_Textures)
+		{
+			bytes += pTexture->GetChainBytes(0);
+		}
+		return bytes;
+	}
+
+	void TextureStreamer::Request(const Handle& pTexture, float mip)
+	{
+		if (pTexture)
+		{
+			pTexture->requestedMip = std::min(pTexture->requestedMip, std::max(mip, 0.f));
+		}
+	}
+
+	void TextureStreamer::Update(RenderDevice& device)
+	{
+		Stats stats{};
+		stats.budgetBytes = m_BudgetBytes;
+		stats.textures = m_Textures.size();
+
+		//1. Swap in finished loads
+		for (const Handle& pTexture : m_Textures)
+		{
+			StreamedTexture& texture{ *pTexture };
+			if (texture.pendingMip < 0 || texture.pendingLoad.wait_for(std::chrono::seconds{ 0 }) != std::future_status::ready)
+			{
+				continue;
+			}
+
+			const std::vector<uint8_t> texels{ texture.pendingLoad.get() };
+			if (!texels.empty() && texture.pendingMip == texture.residentMip - 1)
+			{
+				SetResidentMip(device, texture, texture.pendingMip, &texels);
+				++stats.loadsCompleted;
+			}
+			texture.pendingMip = -1;
+		}
+
+		//2. Turn this frame's requests into wanted levels, textures nobody asked for fall back to their tail
+		for (const Handle& pTexture : m_Textures)
+		{
+			StreamedTexture& texture{ *pTexture };
+			texture.wantedMip = texture.requestedMip == FLT_MAX
+				? texture.tailMip
+				: std::min(static_cast<int>(texture.requestedMip), texture.tailMip);
+			texture.requestedMip = FLT_MAX;
+
+			//3. Detail nobody looks at anymore goes right away
+			const int residentMip{ texture.residentMip };
+			if (residentMip < texture.wantedMip && SetResidentMip(device, texture, texture.wantedMip))
+			{
+				stats.evictions += texture.wantedMip - residentMip;
+			}
+
+			stats.residentBytes += texture.GetChainBytes(texture.residentMip);
+			stats.wantedBytes += texture.GetChainBytes(texture.wantedMip);
+			if (texture.pendingMip >= 0)
+			{
+				stats.pendingBytes += texture.GetMipBytes(texture.pendingMip);
+			}
+		}
+
+		//4. Load one level finer for the blurriest textures first, evicting textures that are closer to what they want
+		std::vector<StreamedTexture*> candidates{};
+		int pendingLoads{};
+		for (const Handle& pTexture : m_Textures)
+		{
+			if (pTexture->pendingMip >= 0)
+			{
+				++pendingLoads;
+			}
+			else if (pTexture->residentMip > pTexture->wantedMip)
+			{
+				candidates.push_back(pTexture.get());
+			}
+		}
+		std::sort(candidates.begin(), candidates.end(), [](const StreamedTexture* pA, const StreamedTexture* pB)
+			{
+				return pA->residentMip - pA->wantedMip > pB->residentMip - pB->wantedMip;
+			});
+
+		for (StreamedTexture* pCandidate : candidates)
+		{
+			if (pendingLoads >= maxPendingLoads)
+			{
+				break;
+			}
+
+			const int mip{ pCandidate->residentMip - 1 };
+			const size_t bytes{ pCandidate->GetMipBytes(mip) };
+			const int deficit{ pCandidate->residentMip - pCandidate->wantedMip };
+
+			while (stats.residentBytes + stats.pendingBytes + bytes > m_BudgetBytes)
+			{
+				//Victims must stay better off than the candidate after losing a level, or the two would trade places every frame
+				StreamedTexture* pVictim{};
+				for (const Handle& pTexture : m_Textures)
+				{
+					StreamedTexture& texture{ *pTexture };
+					const int victimDeficit{ texture.residentMip + 1 - texture.wantedMip };
+					if (&texture == pCandidate || texture.residentMip >= texture.tailMip || texture.pendingMip >= 0 || victimDeficit >= deficit - 1)
+					{
+						continue;
+					}
+					if (!pVictim || victimDeficit < pVictim->residentMip + 1 - pVictim->wantedMip)
+					{
+						pVictim = &texture;
+					}
+				}
+				if (!pVictim)
+				{
+					break;
+				}
+
+				const size_t victimBytes{ pVictim->GetMipBytes(pVictim->residentMip) };
+				if (!SetResidentMip(device, *pVictim, pVictim->residentMip + 1))
+				{
+					break;
+				}
+				stats.residentBytes -= victimBytes;
+				++stats.evictions;
+			}
+
+			if (stats.residentBytes + stats.pendingBytes + bytes > m_BudgetBytes)
+			{
+				++stats.loadsDenied;
+				continue;
+			}
+
+			const size_t offset{ sizeof(ChainHeader) + pCandidate->GetChainBytes(0) - pCandidate->GetChainBytes(mip) };
+			pCandidate->pendingLoad = std::async(std::launch::async, &ReadLevel, GetCookPath(pCandidate->key), offset, bytes);
+			pCandidate->pendingMip = mip;
+			stats.pendingBytes += bytes;
+			++stats.loadsIssued;
+			++pendingLoads;
+		}
+
+		for (const Handle& pTexture : m_Textures)
+		{
+			if (pTexture->residentMip <= pTexture->wantedMip)
+			{
+				++stats.atWantedMip;
+			}
+		}
+
+		m_Stats = stats;
+	}
+
+	std::string TextureStreamer::GetCookPath(const std::string& key) const
+	{
+		//Keys can be cook keys rather than file names, hash them into something the file system takes
+		std::stringstream name{};
+		name << std::hex << HashString(key) << ".mips";
+		return (std::filesystem::path{ m_CookDirectory } / name.str()).string();
+	}
+
+	uint64_t TextureStreamer::GetSourceStamp(const std::vector<std::string>& sources)
+	{
+		uint64_t stamp{ 0xCBF29CE484222325ull };
+		bool hasSource{};
+		for (const std::string& source : sources)
+		{
+			if (source.empty())
+			{
+				continue;
+			}
+
+			std::error_code error{};
+			const auto writeTime{ std::filesystem::last_write_time(source, error) };
+			const auto size{ std::filesystem::file_size(source, error) };
+			if (error)
+			{
+				return 0;
+			}
+
+			stamp = (stamp ^ HashString(source)) * 0x100000001B3ull;
+			stamp = (stamp ^ static_cast<uint64_t>(writeTime.time_since_epoch().count())) * 0x100000001B3ull;
+			stamp = (stamp ^ static_cast<uint64_t>(size)) * 0x100000001B3ull;
+			hasSource = true;
+		}
+		return hasSource ? stamp : 0;
+	}
+
+	int TextureStreamer::GetTailMip(int width, int height, int mipCount)
+	{
+		int mip{};
+		while (mip < mipCount - 1 && std::max(width >> mip, height >> mip) > tailSize)
+		{
+			++mip;
+		}
+		return mip;
+	}
+
+	bool TextureStreamer::SetResidentMip(RenderDevice& device, StreamedTexture& texture, int mip, const std::vector<uint8_t>* pNewLevel)
+	{
+		TextureDesc desc{};
+		desc.width = texture.GetMipWidth(mip);
+		desc.height = texture.GetMipHeight(mip);
+		desc.mipLevels = texture.mipCount - mip;
+		desc.format = texture.format;
+		desc.colorSpace = texture.colorSpace;
+		SharedTexture pNew{ device.Share(device.CreateTexture(desc, {})) };
+		if (!pNew)
+		{
+			return false;
+		}
+
+		//Levels both textures hold never leave the GPU
+		const int firstShared{ std::max(mip, texture.residentMip) };
+		device.CopyTextureLevels(*texture.pTexture, firstShared - texture.residentMip, *pNew, firstShared - mip, texture.mipCount - firstShared);
+
+		if (mip < texture.residentMip)
+		{
+			if (!pNewLevel || mip != texture.residentMip - 1)
+			{
+				return false;
+			}
+			device.UpdateTexture(*pNew, 0, pNewLevel->data());
+		}
+
+		texture.pTexture = std::move(pNew);
+		texture.residentMip = mip;
+		return true;
+	}
+}
@@ -0,0 +1,127 @@
+#pragma once
+#include "TextureData.h"
+#include "RenderDevice.h"
+#include <atomic>
+#include <cfloat>
+#include <future>
+#include <mutex>
+#include <unordered_map>
+
+namespace dae
+{
+	//A texture whose finer mips come and go. Owned by the TextureStreamer, meshes only bind pTexture
+	struct StreamedTexture
+	{
+		std::string key{};
+		int width{};  //of mip 0
+		int height{};
+		int mipCount{};
+		ColorSpace colorSpace{};
+		TexelFormat format{};
+		int tailMip{};     //first level of the tail that never leaves
+		int residentMip{}; //finest level currently in pTexture
+		int wantedMip{};   //finest level asked for last frame, clamped to the chain
+		SharedTexture pTexture{};
+
+		float requestedMip{ FLT_MAX }; //finest level asked for so far this frame
+
+		//In flight read of level pendingMip, always residentMip - 1
+		std::future<std::vector<uint8_t>> pendingLoad{};
+		int pendingMip{ -1 };
+
+		int GetMipWidth(int mip) const { return std::max(1, width >> mip); }
+		int GetMipHeight(int mip) const { return std::max(1, height >> mip); }
+		size_t GetMipBytes(int mip) const { return static_cast<size_t>(GetMipWidth(mip)) * GetMipHeight(mip) * GetTexelSize(format); }
+		//Size of levels first..mipCount-1
+		size_t GetChainBytes(int first) const;
+	};
+
+	//Keeps only the mip tail of every texture resident up front and streams finer levels in the
+	//background to match on-screen size, under one byte budget for all of them.
+	//Full chains are cooked once into files in the cook directory, later runs only read the tails at startup.
+	class TextureStreamer final
+	{
+	public:
+		using Handle = std::shared_ptr<StreamedTexture>;
+
+		struct Stats
+		{
+			size_t textures{};
+			size_t residentBytes{};
+			size_t wantedBytes{};   //what every texture at its wanted mip would take
+			size_t pendingBytes{};  //levels being read
+			size_t budgetBytes{};
+			size_t atWantedMip{};   //textures showing at least the detail they asked for
+			int loadsIssued{};
+			int loadsCompleted{};
+			int evictions{};        //levels dropped, for lack of interest or budget
+			int loadsDenied{};      //loads that did not fit even after evicting
+		};
+
+		static constexpr int tailSize{ 64 }; //levels this size and smaller are always resident
+		static constexpr int maxPendingLoads{ 4 };
+
+		explicit TextureStreamer(size_t budgetBytes, const std::string& cookDirectory = "Resources/Streaming");
+		~TextureStreamer() = default; //pending loads are std::async futures, destroying them waits
+
+		TextureStreamer(const TextureStreamer&) = delete;
+		TextureStreamer(TextureStreamer&&) noexcept = delete;
+		TextureStreamer& operator=(const TextureStreamer&) = delete;
+		TextureStreamer& operator=(TextureStreamer&&) noexcept = delete;
+
+		//Thread-safe. Reads the mip tail of key's cooked chain, false if it is missing, older than its sources or cooked for another color space or format
+		bool Prepare(const std::string& key, const std::vector<std::string>& sources, ColorSpace colorSpace, TexelFormat format = TexelFormat::RGBA8);
+		//Thread-safe. Cooks data into a full chain for key first, sRGB data is filtered in linear space and RG8 normals are renormalized
+		bool Prepare(const std::string& key, const std::vector<std::string>& sources, const TextureData& data);
+
+		//Render thread. Uploads the prepared tail to device, which must outlive every texture. nullptr if key was never prepared
+		Handle Acquire(RenderDevice& device, const std::string& key);
+
+		//Finest mip the caller wants to see this frame, several requests keep the finest
+		void Request(const Handle& pTexture, float mip);
+		//Render thread, once per frame: swaps in finished loads, evicts and starts new loads
+		void Update(RenderDevice& device);
+
+		//Render thread. Drops every texture, before the device they were created on goes away
+		void Clear();
+
+		void SetBudget(size_t budgetBytes) { m_BudgetBytes = budgetBytes; }
+		//Mesh cooks, like LOD chains, are kept next to the texture chains
+		const std::string& GetCookDirectory() const { return m_CookDirectory; }
+		//Every acquired texture with its full chain resident, the budget that never holds back detail
+		size_t GetFullChainBytes() const;
+		//Of the last Update
+		const Stats& GetStats() const { return m_Stats; }
+
+	private:
+		struct PreparedTail
+		{
+			int width{};
+			int height{};
+			int mipCount{};
+			ColorSpace colorSpace{};
+			TexelFormat format{};
+			std::vector<uint8_t> texels{}; //tail levels back to back, finest first
+		};
+
+		std::string m_CookDirectory{};
+		size_t m_BudgetBytes{};
+
+		//Numbers the temporary file of every cook, concurrent cooks of one key never share one
+		std::atomic<uint32_t> m_CookCount{};
+
+		std::mutex m_PreparedMutex{};
+		std::unordered_map<std::string, PreparedTail> m_Prepared{};
+
+		std::vector<Handle> m_Textures{};
+		Stats m_Stats{};
+
+		std::string GetCookPath(const std::string& key) const;
+		static uint64_t GetSourceStamp(const std::vector<std::string>& sources);
+		static int GetTailMip(int width, int height, int mipCount);
+
+		//Recreates pTexture holding levels mip.. , levels both textures share are copied on the GPU.
+		//Growing by one level needs that level's texels in pNewLevel
+		static bool SetResidentMip(RenderDevice& device, StreamedTexture& texture, int mip, const std::vector<uint8_t>* pNewLevel = nullptr);
+	};
+}
@@ -0,0 +1,39 @@
+#pragma once
+#include "Sampler.h"
+
+//Weighted blended order-independent transparency (McGuire and Bavoil, 2013). Every fragment adds its
+//premultiplied color times a depth weight to an accumulation and multiplies the revealage (how much of
+//what is behind still shows) by 1 - alpha, both commutative, so triangle order no longer matters.
+//Only float math and clamps, a pixel shader repeats it line for line: Accumulate is the PS writing
+//(color, revealage factor) to an RGBA16F target blended ONE, ONE and an R8 target blended ZERO,
+//INV_SRC_COLOR, Composite the full-screen pass over the opaque image.
+namespace dae
+{
+	namespace Transparency
+	{
+		//Equation 7 of the paper, for view depths of about 0.1 to 500
+		inline float Weight(float viewDepth, float alpha)
+		{
+			const float near{ viewDepth / 5.f };
+			const float far{ viewDepth / 200.f };
+			const float falloff{ 10.f / (1e-5f + near * near + far * far * far * far * far * far) };
+			return alpha * std::clamp(falloff, 1e-2f, 3e3f);
+		}
+
+		inline void Accumulate(Sampling::ColorRGBA& accumulation, float& revealage, const Sampling::ColorRGBA& color, float viewDepth)
+		{
+			const float weight{ Weight(viewDepth, color.a) };
+			accumulation += Sampling::ColorRGBA{ color.r * color.a, color.g * color.a, color.b * color.a, color.a } * weight;
+			revealage *= 1.f - color.a;
+		}
+
+		//Accumulation starts at zero and revealage at one
+		inline Sampling::ColorRGBA Composite(const Sampling::ColorRGBA& accumulation, float revealage, const Sampling::ColorRGBA& background)
+		{
+			//The clamp keeps tiny and huge sums inside half floats on the GPU
+			const float average{ 1.f / std::clamp(accumulation.a, 1e-4f, 5e4f) };
+			const Sampling::ColorRGBA color{ accumulation.r * average, accumulation.g * average, accumulation.b * average, 0.f };
+			return Sampling::ColorRGBA::Lerp(color, background, revealage);
+		}
+	}
+}
@@ -0,0 +1,236 @@
+#include "pch.h"
+#include "VertexProcessor.h"
+#include "RasterKernel.h"
+#include <immintrin.h>
+
+namespace dae
+{
+	namespace VertexShading
+	{
+		namespace
+		{
+			//Matrix entries splatted over 8 lanes, row-vector convention like mul(v, M) in HLSL
+			struct BroadcastMatrix
+			{
+				__m256 m[4][4]{};
+
+				explicit BroadcastMatrix(const Matrix& matrix)
+				{
+					for (int row{}; row < 4; ++row)
+					{
+						for (int column{}; column < 4; ++column)
+						{
+							m[row][column] = _mm256_set1_ps(matrix[row][column]);
+						}
+					}
+				}
+
+				__m256 Vector(__m256 x, __m256 y, __m256 z, int column) const
+				{
+					return _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(x, m[0][column]), _mm256_mul_ps(y, m[1][column])), _mm256_mul_ps(z, m[2][column]));
+				}
+
+				__m256 Point(__m256 x, __m256 y, __m256 z, int column) const
+				{
+					return _mm256_add_ps(Vector(x, y, z, column), m[3][column]);
+				}
+			};
+
+			//normalize() then the 3x3 part of the world matrix
+			void TransformDirection(const BroadcastMatrix& world, __m256 x, __m256 y, __m256 z, float* pX, float* pY, float* pZ)
+			{
+				const __m256 length{ _mm256_sqrt_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(x, x), _mm256_mul_ps(y, y)), _mm256_mul_ps(z, z))) };
+				x = _mm256_div_ps(x, length);
+				y = _mm256_div_ps(y, length);
+				z = _mm256_div_ps(z, length);
+				_mm256_storeu_ps(pX, world.Vector(x, y, z, 0));
+				_mm256_storeu_ps(pY, world.Vector(x, y, z, 1));
+				_mm256_storeu_ps(pZ, world.Vector(x, y, z, 2));
+			}
+
+			//Input vertex i to output entry o, for the tails of the batches and without AVX2
+			void ShadeVertex(const Constants& constants, const InputStreams& input, size_t i, size_t o, bool attributes, OutputStreams& output)
+			{
+				const Vector4 clip{ constants.worldViewProjection.TransformPoint(input.positionX[i], input.positionY[i], input.positionZ[i], 1.f) };
+				output.clipX[o] = clip.x;
+				output.clipY[o] = clip.y;
+				output.clipZ[o] = clip.z;
+				output.clipW[o] = clip.w;
+				if (!attributes)
+				{
+					return;
+				}
+
+				const Vector3 world{ constants.world.TransformPoint(input.positionX[i], input.positionY[i], input.positionZ[i]) };
+				const Vector3 normal{ constants.world.TransformVector(Vector3{ input.normalX[i], input.normalY[i], input.normalZ[i] }.Normalized()) };
+				const Vector3 tangent{ constants.world.TransformVector(Vector3{ input.tangentX[i], input.tangentY[i], input.tangentZ[i] }.Normalized()) };
+				output.worldX[o] = world.x;
+				output.worldY[o] = world.y;
+				output.worldZ[o] = world.z;
+				output.normalX[o] = normal.x;
+				output.normalY[o] = normal.y;
+				output.normalZ[o] = normal.z;
+				output.tangentX[o] = tangent.x;
+				output.tangentY[o] = tangent.y;
+				output.tangentZ[o] = tangent.z;
+			}
+		}
+
+		InputStreams InputStreams::FromVertices(const std::vector<Vertex>& vertices)
+		{
+			InputStreams input{};
+			for (std::vector<float>* pStream : { &input.positionX, &input.positionY, &input.positionZ, &input.normalX, &input.normalY, &input.normalZ,
+				&input.tangentX, &input.tangentY, &input.tangentZ })
+			{
+				pStream->reserve(vertices.size());
+			}
+			for (const Vertex& vertex : vertices)
+			{
+				input.positionX.push_back(vertex.Position.x);
+				input.positionY.push_back(vertex.Position.y);
+				input.positionZ.push_back(vertex.Position.z);
+				input.normalX.push_back(vertex.Normal.x);
+				input.normalY.push_back(vertex.Normal.y);
+				input.normalZ.push_back(vertex.Normal.z);
+				input.tangentX.push_back(vertex.Tangent.x);
+				input.tangentY.push_back(vertex.Tangent.y);
+				input.tangentZ.push_back(vertex.Tangent.z);
+			}
+			return input;
+		}
+
+		void OutputStreams::Resize(size_t count, bool attributes)
+		{
+			for (std::vector<float>* pStream : { &clipX, &clipY, &clipZ, &clipW })
+			{
+				pStream->resize(count);
+			}
+			for (std::vector<float>* pStream : { &worldX, &worldY, &worldZ, &normalX, &normalY, &normalZ, &tangentX, &tangentY, &tangentZ })
+			{
+				pStream->resize(attributes ? count : 0);
+			}
+		}
+
+		void Run(const Constants& constants, const InputStreams& input, size_t begin, size_t end, bool attributes, OutputStreams& output)
+		{
+			if (!RasterKernel::HasAvx2())
+			{
+				RunScalar(constants, input, begin, end, attributes, output);
+				return;
+			}
+
+			const BroadcastMatrix worldViewProjection{ constants.worldViewProjection };
+			const BroadcastMatrix world{ constants.world };
+			size_t i{ begin };
+			for (; i + 8 <= end; i += 8)
+			{
+				const __m256 x{ _mm256_loadu_ps(&input.positionX[i]) };
+				const __m256 y{ _mm256_loadu_ps(&input.positionY[i]) };
+				const __m256 z{ _mm256_loadu_ps(&input.positionZ[i]) };
+				_mm256_storeu_ps(&output.clipX[i], worldViewProjection.Point(x, y, z, 0));
+				_mm256_storeu_ps(&output.clipY[i], worldViewProjection.Point(x, y, z, 1));
+				_mm256_storeu_ps(&output.clipZ[i], worldViewProjection.Point(x, y, z, 2));
+				_mm256_storeu_ps(&output.clipW[i], worldViewProjection.Point(x, y, z, 3));
+				if (!attributes)
+				{
+					continue;
+				}
+
+				_mm256_storeu_ps(&output.worldX[i], world.Point(x, y, z, 0));
+				_mm256_storeu_ps(&output.worldY[i], world.Point(x, y, z, 1));
+				_mm256_storeu_ps(&output.worldZ[i], world.Point(x, y, z, 2));
+				TransformDirection(world, _mm256_loadu_ps(&input.normalX[i]), _mm256_loadu_ps(&input.normalY[i]), _mm256_loadu_ps(&input.normalZ[i]),
+					&output.normalX[i], &output.normalY[i], &output.normalZ[i]);
+				TransformDirection(world, _mm256_loadu_ps(&input.tangentX[i]), _mm256_loadu_ps(&input.tangentY[i]), _mm256_loadu_ps(&input.tangentZ[i]),
+					&output.tangentX[i], &output.tangentY[i], &output.tangentZ[i]);
+			}
+			RunScalar(constants, input, i, end, attributes, output);
+		}
+
+		void RunScalar(const Constants& constants, const InputStreams& input, size_t begin, size_t end, bool attributes, OutputStreams& output)
+		{
+			for (size_t i{ begin }; i < end; ++i)
+			{
+				ShadeVertex(constants, input, i, i, attributes, output);
+			}
+		}
+
+		void RunIndexed(const Constants& constants, const InputStreams& input, const uint32_t* pVertices, size_t count, bool attributes,
+			OutputStreams& packed)
+		{
+			if (!RasterKernel::HasAvx2())
+			{
+				for (size_t i{}; i < count; ++i)
+				{
+					ShadeVertex(constants, input, pVertices[i], i, attributes, packed);
+				}
+				return;
+			}
+
+			const BroadcastMatrix worldViewProjection{ constants.worldViewProjection };
+			const BroadcastMatrix world{ constants.world };
+			const auto gather = [](const std::vector<float>& stream, __m256i indices) { return _mm256_i32gather_ps(stream.data(), indices, 4); };
+			size_t i{};
+			for (; i + 8 <= count; i += 8)
+			{
+				const __m256i indices{ _mm256_loadu_si256(reinterpret_cast<const __m256i*>(pVertices + i)) };
+				const __m256 x{ gather(input.positionX, indices) };
+				const __m256 y{ gather(input.positionY, indices) };
+				const __m256 z{ gather(input.positionZ, indices) };
+				_mm256_storeu_ps(&packed.clipX[i], worldViewProjection.Point(x, y, z, 0));
+				_mm256_storeu_ps(&packed.clipY[i], worldViewProjection.Point(x, y, z, 1));
+				_mm256_storeu_ps(&packed.clipZ[i], worldViewProjection.Point(x, y, z, 2));
+				_mm256_storeu_ps(&packed.clipW[i], worldViewProjection.Point(x, y, z, 3));
+				if (!attributes)
+				{
+					continue;
+				}
+
+				_mm256_storeu_ps(&packed.worldX[i], world.Point(x, y, z, 0));
+				_mm256_storeu_ps(&packed.worldY[i], world.Point(x, y, z, 1));
+				_mm256_storeu_ps(&packed.worldZ[i], world.Point(x, y, z, 2));
+				TransformDirection(world, gather(input.normalX, indices), gather(input.normalY, indices), gather(input.normalZ, indices),
+					&packed.normalX[i], &packed.normalY[i], &packed.normalZ[i]);
+				TransformDirection(world, gather(input.tangentX, indices), gather(input.tangentY, indices), gather(input.tangentZ, indices),
+					&packed.tangentX[i], &packed.tangentY[i], &packed.tangentZ[i]);
+			}
+			for (; i < count; ++i)
+			{
+				ShadeVertex(constants, input, pVertices[i], i, attributes, packed);
+			}
+		}
+
+		PostTransformCache::PostTransformCache(size_t vertexCount)
+			: m_Stamps(vertexCount)
+			, m_Slots(vertexCount)
+		{
+		}
+
+		void PostTransformCache::NewBatch()
+		{
+			//Stamps only have to differ from the current batch, wrapping around to 0 resets them for good
+			if (++m_Batch == 0)
+			{
+				std::fill(m_Stamps.begin(), m_Stamps.end(), 0);
+				m_Batch = 1;
+			}
+		}
+
+		size_t PostTransformCache::Lookup(const uint32_t* pIndices, size_t count, std::vector<uint32_t>& misses, uint32_t* pSlots)
+		{
+			const size_t previousCount{ misses.size() };
+			for (size_t i{}; i < count; ++i)
+			{
+				const uint32_t vertex{ pIndices[i] };
+				if (m_Stamps[vertex] != m_Batch)
+				{
+					m_Stamps[vertex] = m_Batch;
+					m_Slots[vertex] = static_cast<uint32_t>(misses.size());
+					misses.push_back(vertex);
+				}
+				pSlots[i] = m_Slots[vertex];
+			}
+			return misses.size() - previousCount;
+		}
+	}
+}
@@ -0,0 +1,88 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+
+#include "MeshData.h"
+
+//VS() of PosCol3D.fx on the CPU for whole vertex arrays. Vertices are kept as separate arrays per
+//component so 8 of them go through the matrices at once with AVX2, and the output is the same kind of
+//stream: the clip-space positions the clipper, the rasterizers and culling read, and the world-space
+//attributes the pixel shader interpolates. Callers split the vertex range over their threads.
+namespace dae
+{
+	namespace VertexShading
+	{
+		//The effect's gWorldViewProj and gWorldMatrix
+		struct Constants
+		{
+			Matrix worldViewProjection{};
+			Matrix world{};
+		};
+
+		//Position, Normal and Tangent of a Vertex array, UV passes through untouched so it is not copied
+		struct InputStreams
+		{
+			std::vector<float> positionX{};
+			std::vector<float> positionY{};
+			std::vector<float> positionZ{};
+			std::vector<float> normalX{};
+			std::vector<float> normalY{};
+			std::vector<float> normalZ{};
+			std::vector<float> tangentX{};
+			std::vector<float> tangentY{};
+			std::vector<float> tangentZ{};
+
+			static InputStreams FromVertices(const std::vector<Vertex>& vertices);
+			size_t GetCount() const { return positionX.size(); }
+		};
+
+		//SV_POSITION, WORLD, NORMAL and TANGENT of the effect's VS_OUTPUT, indexed like the input or packed in the order vertices were shaded
+		struct OutputStreams
+		{
+			std::vector<float> clipX{};
+			std::vector<float> clipY{};
+			std::vector<float> clipZ{};
+			std::vector<float> clipW{};
+			std::vector<float> worldX{};
+			std::vector<float> worldY{};
+			std::vector<float> worldZ{};
+			std::vector<float> normalX{};
+			std::vector<float> normalY{};
+			std::vector<float> normalZ{};
+			std::vector<float> tangentX{};
+			std::vector<float> tangentY{};
+			std::vector<float> tangentZ{};
+
+			//Without attributes only the clip-space position is kept, enough for culling and picking
+			void Resize(size_t count, bool attributes);
+		};
+
+		//Vertices [begin, end), AVX2 when available. Without attributes only the position is transformed
+		void Run(const Constants& constants, const InputStreams& input, size_t begin, size_t end, bool attributes, OutputStreams& output);
+		void RunScalar(const Constants& constants, const InputStreams& input, size_t begin, size_t end, bool attributes, OutputStreams& output);
+		//Only the listed vertices, gathered 8 at a time. Output i is pVertices[i], a packed stream of count entries
+		void RunIndexed(const Constants& constants, const InputStreams& input, const uint32_t* pVertices, size_t count, bool attributes,
+			OutputStreams& packed);
+
+		//Post-transform cache for drawing part of a mesh: a vertex shared by many triangles is shaded once and its
+		//triangles point at its slot in the packed output. A stamp per vertex instead of the GPU's small FIFO, so within
+		//a batch a vertex never misses twice. One per thread like one per GPU unit, vertices shared across threads
+		//are shaded by each of them
+		class PostTransformCache final
+		{
+		public:
+			explicit PostTransformCache(size_t vertexCount = 0);
+
+			//Every vertex is a miss again and slots start over
+			void NewBatch();
+			//pSlots[i] receives the packed slot of pIndices[i]. Vertices seen for the first time this batch are appended to misses,
+			//which is the vertex list for RunIndexed; returns how many there were
+			size_t Lookup(const uint32_t* pIndices, size_t count, std::vector<uint32_t>& misses, uint32_t* pSlots);
+
+		private:
+			std::vector<uint32_t> m_Stamps{};
+			std::vector<uint32_t> m_Slots{};
+			uint32_t m_Batch{ 1 };
+		};
+	}
+}
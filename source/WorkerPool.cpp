@@ -0,0 +1,112 @@
+#include "pch.h"
+#include "WorkerPool.h"
+#include "JobSystem.h"
+
+namespace dae
+{
+	WorkerPool::WorkerPool(int threadCount, JobSystem* pJobs)
+		: m_pJobs{ pJobs }
+	{
+		if (m_pJobs)
+		{
+			return;
+		}
+
+		if (threadCount <= 0)
+		{
+			threadCount = std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+		}
+
+		m_Threads.reserve(threadCount - 1);
+		for (int i{ 1 }; i < threadCount; ++i)
+		{
+			m_Threads.emplace_back(&WorkerPool::WorkerLoop, this, i);
+		}
+	}
+
+	WorkerPool::~WorkerPool()
+	{
+		{
+			std::lock_guard lock{ m_Mutex };
+			m_Quit = true;
+		}
+		m_WakeCondition.notify_all();
+
+		for (std::thread& thread : m_Threads)
+		{
+			thread.join();
+		}
+	}
+
+	void WorkerPool::Run(const std::function<void(int)>& job)
+	{
+		//Every index runs exactly once, not necessarily on a thread of its own
+		if (m_pJobs)
+		{
+			m_pJobs->ParallelFor(static_cast<size_t>(GetThreadCount()), 1, [&job](size_t begin, size_t end)
+				{
+					for (size_t i{ begin }; i < end; ++i)
+					{
+						job(static_cast<int>(i));
+					}
+				});
+			return;
+		}
+
+		if (m_Threads.empty())
+		{
+			job(0);
+			return;
+		}
+
+		{
+			std::lock_guard lock{ m_Mutex };
+			m_pJob = &job;
+			m_Running = static_cast<int>(m_Threads.size());
+			++m_Generation;
+		}
+		m_WakeCondition.notify_all();
+
+		job(0);
+
+		std::unique_lock lock{ m_Mutex };
+		m_DoneCondition.wait(lock, [this] { return m_Running == 0; });
+		m_pJob = nullptr;
+	}
+
+	int WorkerPool::GetThreadCount() const
+	{
+		return m_pJobs ? m_pJobs->GetThreadCount() : static_cast<int>(m_Threads.size()) + 1;
+	}
+
+	void WorkerPool::WorkerLoop(int threadIndex)
+	{
+		uint64_t generation{};
+		while (true)
+		{
+			const std::function<void(int)>* pJob{};
+			{
+				std::unique_lock lock{ m_Mutex };
+				m_WakeCondition.wait(lock, [&] { return m_Quit || m_Generation != generation; });
+				if (m_Quit)
+				{
+					return;
+				}
+				generation = m_Generation;
+				pJob = m_pJob;
+			}
+
+			(*pJob)(threadIndex);
+
+			bool last{};
+			{
+				std::lock_guard lock{ m_Mutex };
+				last = --m_Running == 0;
+			}
+			if (last)
+			{
+				m_DoneCondition.notify_one();
+			}
+		}
+	}
+}
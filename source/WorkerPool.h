@@ -0,0 +1,46 @@
+#pragma once
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace dae
+{
+	class JobSystem;
+
+	//Persistent threads for work that is split the same way every frame. Run hands one job to every
+	//thread and returns when all of them finished, the calling thread takes part as thread 0
+	class WorkerPool final
+	{
+	public:
+		//0 starts one thread per hardware thread. With jobs no thread is started, Run spreads the
+		//thread indices over the job system's workers so an application keeps a single set of threads
+		explicit WorkerPool(int threadCount = 0, JobSystem* pJobs = nullptr);
+		~WorkerPool();
+
+		WorkerPool(const WorkerPool&) = delete;
+		WorkerPool(WorkerPool&&) noexcept = delete;
+		WorkerPool& operator=(const WorkerPool&) = delete;
+		WorkerPool& operator=(WorkerPool&&) noexcept = delete;
+
+		//job(threadIndex) runs once on every thread, threadIndex in [0, GetThreadCount())
+		void Run(const std::function<void(int)>& job);
+
+		int GetThreadCount() const;
+
+	private:
+		JobSystem* m_pJobs{};
+		std::vector<std::thread> m_Threads{};
+
+		std::mutex m_Mutex{};
+		std::condition_variable m_WakeCondition{};
+		std::condition_variable m_DoneCondition{};
+		const std::function<void(int)>* m_pJob{};
+		uint64_t m_Generation{}; //bumped for every Run so a worker never runs the same job twice
+		int m_Running{};
+		bool m_Quit{};
+
+		void WorkerLoop(int threadIndex);
+	};
+}
@@ -7,6 +7,10 @@
 #undef main
 #include "Renderer.h"
 #include "Camera.h"
+#include "Benchmarks.h"
+#ifdef _WIN32
+#include "D3D11RenderDevice.h"
+#endif
 
 using namespace dae;
 
@@ -18,9 +22,11 @@ void ShutDown(SDL_Window* pWindow)
 
 int main(int argc, char* args[])
 {
-	//Unreferenced parameters
-	(void)argc;
-	(void)args;
+	//Headless benchmarks, no window or device needed
+	if (argc > 1 && std::string{ args[1] } == "--bench")
+	{
+		return Benchmarks::Run(argc, args);
+	}
 
 	//Create window + surfaces
 	SDL_Init(SDL_INIT_VIDEO);
@@ -37,10 +43,22 @@ int main(int argc, char* args[])
 	if (!pWindow)
 		return 1;
 
+	//The device is created for the window, the renderer draws through it
+	std::unique_ptr<RenderDevice> pDevice{};
+#ifdef _WIN32
+	pDevice = D3D11RenderDevice::Create(pWindow);
+#endif
+	if (!pDevice)
+	{
+		std::cout << "No render device, only --bench runs without one\n";
+		ShutDown(pWindow);
+		return 1;
+	}
+
 	//Initialize "framework"
 	const auto pCamera = new Camera{};
 	const auto pTimer = new Timer();
-	const auto pRenderer = new Renderer(pWindow, pCamera);
+	const auto pRenderer = new Renderer(*pDevice, pCamera);
 
 	pCamera->Initialize(static_cast<float>(width) / static_cast<float>(height), 45.f, { 0,0,-50 });
 
@@ -73,6 +91,14 @@ int main(int argc, char* args[])
 				{
 					pRenderer->CycleSampleStates();
 				}
+				if (e.key.keysym.scancode == SDL_SCANCODE_F5)
+				{
+					pRenderer->ToggleInstances();
+				}
+				if (e.key.keysym.scancode == SDL_SCANCODE_F6)
+				{
+					pRenderer->ToggleSoftwareRenderer();
+				}
 				if (e.key.keysym.scancode == SDL_SCANCODE_F9)
 				{
 					pRenderer->CycleCullModes();
@@ -108,6 +134,32 @@ int main(int argc, char* args[])
 			{
 				printTimer = 0.f;
 				std::cout << "dFPS: " << pTimer->GetdFPS() << std::endl;
+
+				const TextureStreamer::Stats& streaming{ pRenderer->GetTextureStreamerStats() };
+				std::cout << "Streaming: " << streaming.atWantedMip << "/" << streaming.textures << " textures at wanted mip, resident "
+					<< streaming.residentBytes / 1024 << "KB/" << streaming.budgetBytes / 1024 << "KB (wanted " << streaming.wantedBytes / 1024
+					<< "KB, pending " << streaming.pendingBytes / 1024 << "KB), loads " << streaming.loadsIssued << "/" << streaming.loadsCompleted
+					<< " issued/completed, evictions " << streaming.evictions << ", denied " << streaming.loadsDenied << std::endl;
+
+				const FrustumCuller::Stats& frustum{ pRenderer->GetFrustumStats() };
+				std::cout << "Frustum: culled " << frustum.culled << "/" << frustum.tested << " meshes in " << frustum.cullMicroseconds << "us" << std::endl;
+
+				const Meshlets::CullStats& meshlets{ pRenderer->GetMeshletStats() };
+				std::cout << "Meshlets: drew " << meshlets.trianglesDrawn << "/" << meshlets.triangles << " triangles in " << meshlets.ranges
+					<< " ranges, culled " << meshlets.offscreen << " offscreen and " << meshlets.facingAway << " facing away of " << meshlets.meshlets
+					<< " meshlets in " << meshlets.microseconds << "us" << std::endl;
+
+				const OcclusionCuller::Stats& occlusion{ pRenderer->GetOcclusionStats() };
+				std::cout << "Occlusion: culled " << occlusion.culled << "/" << occlusion.tested << " meshes (offscreen " << occlusion.offscreen
+					<< "), " << occlusion.occluderTriangles << " occluder triangles in " << occlusion.renderMicroseconds << "us" << std::endl;
+
+				const InstanceSet::Stats& instances{ pRenderer->GetInstanceStats() };
+				std::cout << "Instances: drew " << instances.visible << "/" << instances.instances << ", culled in " << instances.cullMicroseconds
+					<< "us, laid out in " << instances.buildMicroseconds << "us" << std::endl;
+
+				const RenderQueue::Stats& queue{ pRenderer->GetRenderQueueStats() };
+				std::cout << "Render queue: " << queue.packets << " draws, " << queue.effectChanges << " effect and " << queue.textureSetChanges
+					<< " texture set changes, sorted in " << queue.sortMicroseconds << "us" << std::endl;
 			}
 		}
 	}
@@ -117,6 +169,7 @@ int main(int argc, char* args[])
 	delete pRenderer;
 	delete pTimer;
 	delete pCamera;
+	pDevice.reset();
 
 	ShutDown(pWindow);
 	return 0;
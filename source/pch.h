@@ -5,19 +5,23 @@
 #include <algorithm>
 #include <sstream>
 #include <memory>
+#include <cfloat>
+#include <cstring>
 #define NOMINMAX  //for directx
 
 // SDL Headers
 #include "SDL.h"
-#include "SDL_syswm.h"
 #include "SDL_surface.h"
 #include "SDL_image.h"
 
-// DirectX Headers
+// DirectX Headers, only the D3D11 backend needs them
+#ifdef _WIN32
+#include "SDL_syswm.h"
 #include <dxgi.h>
 #include <d3d11.h>
 #include <d3dcompiler.h>
 #include <d3dx11effect.h>
+#endif
 
 // Framework Headers
 #include "Timer.h"